@@ -38,9 +38,13 @@ data class WiFiNetwork(
 }
 
 /**
- * Response wrapper for WiFi scan results from firmware.
- * Format: {"n":[{"s":"SSID","r":-65,"e":1},...]}
+ * One page of WiFi scan results from firmware.
+ * Format: {"i":0,"n":[{"s":"SSID","r":-65,"e":1},...],"d":1}
+ * Results are streamed in MTU-sized pages; i is the page index (0 starts a new
+ * scan) and d is 1 on the last page. Older firmware sends a single page without i/d.
  */
 data class WiFiScanResponse(
-    @SerializedName("n") val networks: List<WiFiNetwork>
+    @SerializedName("i") val page: Int?,
+    @SerializedName("n") val networks: List<WiFiNetwork>,
+    @SerializedName("d") val done: Int?
 )
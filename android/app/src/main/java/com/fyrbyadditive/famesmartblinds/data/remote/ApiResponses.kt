@@ -10,7 +10,7 @@ data class DeviceStatus(
     val position: Int,
     val wifi: WifiStatus,
     val calibration: CalibrationStatus?,
-    val uptime: Int
+    val uptime: Int? = null
 ) {
     data class WifiStatus(
         val ssid: String,
@@ -76,7 +76,10 @@ data class DeviceLogsResponse(
 data class OTAResponse(
     val success: Boolean,
     val message: String?,
-    val error: String?
+    val error: String?,
+    val chunkSize: Int? = null,  // Negotiated by /ota/begin
+    val resumed: Boolean? = null,  // /ota/begin?resume=1 kept the previous session
+    val nextIndex: Int? = null     // First chunk the device still needs
 )
 
 /**
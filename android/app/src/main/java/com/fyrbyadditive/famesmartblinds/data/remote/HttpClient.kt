@@ -8,6 +8,7 @@ import com.fyrbyadditive.famesmartblinds.util.CRC32
 import com.fyrbyadditive.famesmartblinds.util.Constants
 import com.google.gson.Gson
 import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.delay
 import kotlinx.coroutines.withContext
 import okhttp3.MediaType.Companion.toMediaType
 import okhttp3.OkHttpClient
@@ -438,14 +439,14 @@ class HttpClient @Inject constructor(
         deviceId: String,
         onProgress: (Float) -> Unit
     ) = withContext(Dispatchers.IO) {
-        val chunkSize = 8192 // 8KB chunks
         val totalSize = firmwareData.size
-        val totalChunks = (totalSize + chunkSize - 1) / chunkSize
+        // Identifies the image so a dropped upload can be resumed
+        val imageId = CRC32.toHexString(CRC32.calculate(firmwareData))
 
-        Log.d(TAG, "[OTA] Starting chunked upload: $totalSize bytes in $totalChunks chunks")
+        Log.d(TAG, "[OTA] Starting chunked upload: $totalSize bytes")
 
         // Step 1: Initialize OTA
-        val beginUrl = "http://$ipAddress/ota/begin?size=$totalSize"
+        val beginUrl = "http://$ipAddress/ota/begin?size=$totalSize&id=$imageId"
         val beginRequest = Request.Builder()
             .url(beginUrl)
             .post("".toRequestBody(null))
@@ -463,7 +464,16 @@ class HttpClient @Inject constructor(
             throw HttpException(beginResponse.code, beginResponse.body?.string() ?: "Begin failed")
         }
 
-        Log.d(TAG, "[OTA] Begin successful, sending chunks...")
+        // Use the chunk size the device negotiated (older firmware doesn't report one)
+        val negotiated = try {
+            gson.fromJson(beginResponse.body?.string(), OTAResponse::class.java)?.chunkSize
+        } catch (_: Exception) {
+            null
+        }
+        val chunkSize = negotiated?.takeIf { it > 0 } ?: 8192
+        val totalChunks = (totalSize + chunkSize - 1) / chunkSize
+
+        Log.d(TAG, "[OTA] Begin successful, sending $totalChunks chunks of $chunkSize bytes...")
 
         // Step 2: Send chunks
         val chunkClient = OkHttpClient.Builder()
@@ -472,7 +482,10 @@ class HttpClient @Inject constructor(
             .writeTimeout(30, TimeUnit.SECONDS)
             .build()
 
-        for (chunkIndex in 0 until totalChunks) {
+        var chunkIndex = 0
+        var resumeAttempts = 0
+        var busyRetries = 0
+        while (chunkIndex < totalChunks) {
             val startOffset = chunkIndex * chunkSize
             val endOffset = minOf(startOffset + chunkSize, totalSize)
             val chunkData = firmwareData.copyOfRange(startOffset, endOffset)
@@ -489,14 +502,38 @@ class HttpClient @Inject constructor(
                 .addAuthHeader(deviceId)
                 .build()
 
-            val chunkResponse = chunkClient.newCall(chunkRequest).execute()
+            val chunkResponse = try {
+                chunkClient.newCall(chunkRequest).execute()
+            } catch (e: IOException) {
+                // Connection dropped - the device keeps the session, so carry on
+                // from the last chunk it flashed instead of starting over
+                if (resumeAttempts >= OTA_MAX_RESUME_ATTEMPTS) {
+                    try { abortOTA(ipAddress, deviceId) } catch (_: Exception) {}
+                    throw e
+                }
+                resumeAttempts++
+                Log.w(TAG, "[OTA] Chunk $chunkIndex failed (${e.message}), resuming (attempt $resumeAttempts)")
+                delay(OTA_RESUME_DELAY_MS)
+                chunkIndex = resumeOTA(beginClient, ipAddress, deviceId, totalSize, imageId) ?: throw e
+                continue
+            }
             checkAuthResponse(chunkResponse, deviceId)
+            if (chunkResponse.code == 503 && busyRetries < OTA_MAX_BUSY_RETRIES) {
+                // Every buffer on the device is still being flashed - send the chunk again shortly
+                val retryAfter = chunkResponse.header("Retry-After")?.toLongOrNull() ?: 1L
+                chunkResponse.close()
+                busyRetries++
+                delay(retryAfter * 1000)
+                continue
+            }
             if (!chunkResponse.isSuccessful) {
                 // Abort OTA on failure
                 try { abortOTA(ipAddress, deviceId) } catch (_: Exception) {}
                 throw HttpException(chunkResponse.code, "Chunk $chunkIndex failed: ${chunkResponse.body?.string()}")
             }
 
+            busyRetries = 0
+
             // Update progress
             val progress = endOffset.toFloat() / totalSize.toFloat()
             withContext(Dispatchers.Main) {
@@ -507,6 +544,7 @@ class HttpClient @Inject constructor(
             if (chunkIndex % 10 == 0 || chunkIndex == totalChunks - 1) {
                 Log.d(TAG, "[OTA] Chunk ${chunkIndex + 1}/$totalChunks sent (${(progress * 100).toInt()}%)")
             }
+            chunkIndex++
         }
 
         // Step 3: Finalize OTA
@@ -519,15 +557,57 @@ class HttpClient @Inject constructor(
             .addAuthHeader(deviceId)
             .build()
 
-        val endResponse = chunkClient.newCall(endRequest).execute()
-        checkAuthResponse(endResponse, deviceId)
-        if (!endResponse.isSuccessful) {
-            throw HttpException(endResponse.code, "Finalize failed: ${endResponse.body?.string()}")
+        // The device answers 202 while it flashes the last chunks and verifies the image
+        var finishPolls = 0
+        while (true) {
+            val endResponse = chunkClient.newCall(endRequest).execute()
+            checkAuthResponse(endResponse, deviceId)
+            if (endResponse.code == 202 && finishPolls < OTA_MAX_FINISH_POLLS) {
+                val retryAfter = endResponse.header("Retry-After")?.toLongOrNull() ?: 1L
+                endResponse.close()
+                finishPolls++
+                delay(retryAfter * 1000)
+                continue
+            }
+            if (endResponse.code != 200) {
+                throw HttpException(endResponse.code, "Finalize failed: ${endResponse.body?.string()}")
+            }
+            break
         }
 
         Log.d(TAG, "[OTA] Firmware upload complete, device restarting...")
     }
 
+    /**
+     * Ask the device to resume an interrupted upload. Returns the chunk index to
+     * continue from (0 if the device had to start a new session), or null if the
+     * device could not be reached.
+     */
+    private fun resumeOTA(
+        client: OkHttpClient,
+        ipAddress: String,
+        deviceId: String,
+        totalSize: Int,
+        imageId: String
+    ): Int? {
+        return try {
+            val request = Request.Builder()
+                .url("http://$ipAddress/ota/begin?size=$totalSize&id=$imageId&resume=1")
+                .post("".toRequestBody(null))
+                .addAuthHeader(deviceId)
+                .build()
+            val response = client.newCall(request).execute()
+            if (!response.isSuccessful) return null
+            val body = gson.fromJson(response.body?.string(), OTAResponse::class.java)
+            val next = if (body?.resumed == true) body.nextIndex ?: 0 else 0
+            Log.d(TAG, "[OTA] Resumed at chunk $next (resumed=${body?.resumed})")
+            next
+        } catch (e: Exception) {
+            Log.w(TAG, "[OTA] Resume failed: ${e.message}")
+            null
+        }
+    }
+
     /**
      * Abort an in-progress OTA update (PROTECTED)
      */
@@ -651,6 +731,10 @@ class HttpClient @Inject constructor(
 
     companion object {
         private const val TAG = "HttpClient"
+        private const val OTA_MAX_RESUME_ATTEMPTS = 5
+        private const val OTA_RESUME_DELAY_MS = 2000L
+        private const val OTA_MAX_BUSY_RETRIES = 10
+        private const val OTA_MAX_FINISH_POLLS = 30
     }
 }
 
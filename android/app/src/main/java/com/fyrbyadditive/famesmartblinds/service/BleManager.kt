@@ -477,16 +477,27 @@ class BleManager @Inject constructor(
     private fun parseWifiScanResults(jsonString: String) {
         Log.d(TAG, "[WIFI-SCAN] parseWifiScanResults called with: $jsonString")
 
-        // Cancel timeout since we received results
-        wifiScanTimeoutJob?.cancel()
-        Log.d(TAG, "[WIFI-SCAN] Setting isWifiScanning = false (received results)")
-        _isWifiScanning.value = false
-
         try {
             val response = gson.fromJson(jsonString, WiFiScanResponse::class.java)
+
+            // Page 0 starts a new scan; later pages add to (or strengthen) what we have
+            val networks = if ((response.page ?: 0) == 0) {
+                response.networks
+            } else {
+                (_scannedWifiNetworks.value + response.networks)
+                    .groupBy { it.ssid }
+                    .map { (_, entries) -> entries.maxByOrNull { it.rssi }!! }
+            }
             // Sort by signal strength (strongest first)
-            _scannedWifiNetworks.value = response.networks.sortedByDescending { it.rssi }
+            _scannedWifiNetworks.value = networks.sortedByDescending { it.rssi }
             Log.d(TAG, "Parsed ${_scannedWifiNetworks.value.size} WiFi networks")
+
+            if ((response.done ?: 1) == 1) {
+                // Cancel timeout since the last page arrived
+                wifiScanTimeoutJob?.cancel()
+                Log.d(TAG, "[WIFI-SCAN] Setting isWifiScanning = false (received results)")
+                _isWifiScanning.value = false
+            }
         } catch (e: Exception) {
             Log.e(TAG, "Failed to decode WiFi scan results: ${e.message}")
         }
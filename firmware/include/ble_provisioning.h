@@ -42,8 +42,11 @@ public:
     void onCommand(BleCommandCallback callback);
     void onWifiScanRequest(BleWifiScanCallback callback);
 
-    // Set WiFi scan results (notifies connected clients)
-    void setWifiScanResults(const String& results);
+    // Send one page of WiFi scan results (notifies connected clients)
+    void notifyWifiScanResults(const char* data, size_t length);
+
+    // Largest notification the connected client can receive (ATT MTU - 3), 0 if none
+    size_t getNotifyPayloadSize() const;
 
     // Set current values (for read characteristics)
     void setCurrentSsid(const String& ssid);
@@ -0,0 +1,32 @@
+#ifndef BOOT_TIMINGS_H
+#define BOOT_TIMINGS_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// Milestones of the current boot in ms since reset, reported by /info.
+// mark() is safe from any task; the phase name must be a string literal and
+// only its first mark is kept (so reconnects don't overwrite boot timings).
+class BootTimings {
+public:
+    static void setProductionMode(bool production);
+    static bool isProductionMode();
+
+    static void mark(const char* phase);
+
+    static size_t count();
+    static bool get(size_t index, const char*& phase, uint32_t& ms);
+
+private:
+    struct Phase {
+        const char* name;
+        uint32_t ms;
+    };
+
+    static Phase _phases[BOOT_MAX_PHASES];
+    static size_t _count;
+    static bool _production;
+    static portMUX_TYPE _mux;
+};
+
+#endif // BOOT_TIMINGS_H
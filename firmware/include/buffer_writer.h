@@ -0,0 +1,35 @@
+#ifndef BUFFER_WRITER_H
+#define BUFFER_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Appends formatted text to a caller-owned fixed buffer (no heap allocation).
+// Output is always NUL terminated; once the buffer is full further writes are
+// dropped and overflowed() reports it so callers can fall back or log.
+class BufferWriter {
+public:
+    BufferWriter(char* buffer, size_t capacity);
+
+    void reset();
+
+    void print(const char* text);
+    void printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+    // Write a JSON string literal (quoted and escaped)
+    void jsonString(const char* text);
+
+    const char* c_str() const { return _buffer; }
+    size_t length() const { return _length; }
+    bool overflowed() const { return _overflow; }
+
+private:
+    char* _buffer;
+    size_t _capacity;
+    size_t _length;
+    bool _overflow;
+
+    void append(const char* data, size_t len);
+};
+
+#endif // BUFFER_WRITER_H
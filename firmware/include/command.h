@@ -0,0 +1,61 @@
+#ifndef COMMAND_H
+#define COMMAND_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Blind commands shared by MQTT, HTTP and BLE.
+// Text form is NAME or NAME:argument ("open", "POSITION:40", "LOGLEVEL:servo=debug"),
+// matched case-insensitively against one table and parsed in place from the
+// transport's buffer - no copies, no heap. Kept free of Arduino dependencies
+// so it can be exercised off-target.
+enum class CommandId : uint8_t {
+    NONE,
+    OPEN,
+    CLOSE,
+    STOP,
+    OPEN_FORCE,
+    CLOSE_FORCE,
+    CALIBRATE_START,
+    CALIBRATE_SETBOTTOM,
+    CALIBRATE_CANCEL,
+    POSITION,               // value: percent 0-100 (100 = open)
+    GOTO,                   // value: cumulative servo counts
+    SPEED,                  // value: servo speed 0-4095
+    LOGLEVEL,               // text: Logger::applyLevels spec
+    RESTART
+};
+
+struct Command {
+    CommandId id = CommandId::NONE;
+    int32_t value = 0;
+    const char* text = nullptr;     // Points into the parsed buffer, not NUL terminated
+    size_t textLength = 0;
+    uint8_t blind = 0;              // Target blind on multi-blind boards (set by the transport)
+
+    Command() = default;
+    Command(CommandId commandId, int32_t commandValue = 0)
+        : id(commandId), value(commandValue) {}
+
+    // Plain moves (open/close/stop/position), the only commands MQTT accepts
+    // on command topics and the only ones that may be scheduled
+    bool isMotion() const;
+};
+
+class CommandParser {
+public:
+    // Parse NAME or NAME:argument (surrounding whitespace ignored).
+    // False for unknown names, a missing/unexpected argument or an out-of-range value.
+    static bool parse(const char* data, size_t length, Command& out);
+
+    // Unsigned decimal of at most 9 digits, no larger than maxValue
+    static bool parseNumber(const char* data, size_t length, int32_t maxValue, int32_t& out);
+
+    // Canonical upper-case name ("POSITION"), "" for NONE
+    static const char* name(CommandId id);
+
+    // NAME or NAME:argument into buffer (for logs and responses); returns buffer
+    static const char* format(const Command& command, char* buffer, size_t size);
+};
+
+#endif // COMMAND_H
@@ -9,6 +9,15 @@
 #define FIRMWARE_VERSION "1.0.6"
 #define DEVICE_NAME_PREFIX "FAMEBlinds"
 
+// ============================================================================
+// Boot Configuration
+// ============================================================================
+
+// Production boot (setup complete): no serial wait, WiFi before everything
+// else, BLE never initialized. Development boots keep the old order.
+#define BOOT_SERIAL_WAIT_MS 3000        // USB host wait, development boots only
+#define BOOT_MAX_PHASES 12              // Timing marks kept for /info
+
 // ============================================================================
 // Pin Definitions (XIAO ESP32-C3 + Bus Servo Adapter)
 // ============================================================================
@@ -20,6 +29,34 @@
 // Hall sensor pin for home position detection
 #define HALL_SENSOR_PIN 4  // D2 on XIAO (GPIO4)
 
+// Signal must stay LOW this long with no edge at all to count as a trigger.
+// The sensor is a solid-state Hall switch with built-in hysteresis, so there
+// is no contact bounce to outlast, only short noise spikes on the wire and
+// chatter while the field crosses the threshold. Both show up as edges (the
+// ISR sees both directions) and restart the window, so 5 ms of unbroken LOW
+// is already far longer than either. Home is taken from the first edge, so
+// the window only delays confirmation; the old 100 ms kept the blind parked
+// on an unconfirmed edge twenty times longer for no extra certainty.
+#define HALL_DEBOUNCE_US 5000
+
+// ============================================================================
+// Multi-Blind Configuration
+// ============================================================================
+
+// Blinds driven from one board, each a servo on the shared bus with its own
+// hall sensor. Blind 0 is the primary blind and keeps the single-blind NVS
+// keys, HTTP endpoints and MQTT topics; blinds 1..n add an index suffix.
+#ifndef BLIND_COUNT
+#define BLIND_COUNT 1                   // 1-4 (or -DBLIND_COUNT=n in build_flags)
+#endif
+#define BLIND_MAX_COUNT 4
+#define BLIND_SERVO_IDS {1, 2, 3, 4}    // Default bus ID per blind (overridable in NVS)
+#define BLIND_HALL_PINS {HALL_SENSOR_PIN, 3, 5, 2}  // D2, D1, D3, D0 on XIAO
+
+#if BLIND_COUNT < 1 || BLIND_COUNT > BLIND_MAX_COUNT
+#error "BLIND_COUNT must be between 1 and BLIND_MAX_COUNT"
+#endif
+
 // ============================================================================
 // Servo Configuration
 // ============================================================================
@@ -34,6 +71,53 @@
 #define SERVO_SPEED 500
 #define SERVO_ACCELERATION 50
 
+// Servo probe (runs on the motion task, so boot doesn't wait for the bus)
+#define SERVO_PROBE_SETTLE_MS 100       // Bus settle time after Serial begin before the first ping
+#define SERVO_PROBE_RETRY_MS 500        // Spacing of ping attempts
+#define SERVO_PROBE_ATTEMPTS 3          // Then fall back to reconnect detection in update()
+
+// ============================================================================
+// Motion Task Configuration
+// ============================================================================
+
+// Motion control runs in its own FreeRTOS task so that sampling and limit
+// stopping do not depend on how busy loop() is
+#define MOTION_TASK_STACK_SIZE 4096
+#define MOTION_TASK_PRIORITY 11         // Above async_tcp (10) and loop() (1)
+#define MOTION_TASK_CORE 0              // ESP32-C3 has a single core
+#define MOTION_SAMPLE_INTERVAL_MS 15    // Position sampling while moving
+#define MOTION_IDLE_INTERVAL_MS 1000    // Connection check while stopped
+
+// Predictive limit stopping
+#define MOTION_STOP_LATENCY_MS 20       // Sample period + bus round trip before a stop takes effect
+#define MOTION_LIMIT_TOLERANCE 8        // Counts from a limit still treated as "at the limit"
+#define MOTION_VELOCITY_ALPHA 0.5f      // Smoothing factor for the sampled velocity
+#define MOTION_SETTLED_VELOCITY 20      // Counts/s below which the servo is considered at rest
+
+// Position-targeted moves (trapezoidal approach profile)
+#define MOTION_TARGET_TOLERANCE 8       // Counts from the target that count as arrived
+#define MOTION_APPROACH_MIN_SPEED 80    // Final approach speed (steps/s)
+#define MOTION_APPROACH_DECEL_FACTOR 0.5f  // Braking at this fraction of the servo ramp
+#define MOTION_APPROACH_DEFAULT_DECEL 5000.0f  // Steps/s^2 when the servo ramp is disabled (acc=0)
+#define MOTION_SPEED_UPDATE_STEP 20     // Only re-send WriteSpe when the profile changes by this much
+
+// Stall detection (servo load telemetry + position progress)
+#define MOTION_STALL_GRACE_MS 300       // Ramp-up after a move starts before stalls are judged
+#define MOTION_STALL_VELOCITY_FRACTION 0.2f  // Below this fraction of the commanded speed is "not moving"
+#define MOTION_STALL_LOAD 600           // |load| (0.1% of max torque) that marks a stalled sample
+#define MOTION_STALL_SAMPLES 4          // Consecutive loaded stall samples before stopping (~60ms)
+#define MOTION_STALL_STILL_MS 500       // No progress at any load for this long also stops
+#define MOTION_LOAD_ALPHA 0.3f          // Smoothing factor for the sampled load
+
+// Adaptive per-direction speed/acceleration (the configured speed is the ceiling)
+#define MOTION_ADAPT_LOAD_HIGH 500      // Peak smoothed load above this slows the next move
+#define MOTION_ADAPT_LOAD_LOW 250       // ...below this speeds it back up
+#define MOTION_ADAPT_SPEED_STEP 50      // Steps/s per completed move
+#define MOTION_ADAPT_MIN_SPEED 150      // Learned speed floor
+#define MOTION_ADAPT_ACCEL_STEP 5       // Acceleration register units per completed move
+#define MOTION_ADAPT_MIN_ACCEL 10       // Learned acceleration floor
+#define MOTION_ADAPT_MIN_MOVE_MS 1000   // Shorter moves never reach cruise and don't teach
+
 // ============================================================================
 // WiFi Configuration
 // ============================================================================
@@ -41,25 +125,112 @@
 #define WIFI_CONNECT_TIMEOUT_MS 15000
 #define WIFI_RECONNECT_INTERVAL_MS 5000
 #define WIFI_MAX_RECONNECT_ATTEMPTS 10
+#define WIFI_RSSI_PUBLISH_INTERVAL_MS 5000  // RSSI sampling for the state model
+
+// Fast reconnect: join the last good BSSID/channel directly (no scan) and reuse
+// the last address (no DHCP round trips); a full scan + DHCP is the fallback
+#define WIFI_FAST_CONNECT_TIMEOUT_MS 3000   // Fall back to a full connect after this
+#define WIFI_LEASE_CONFIRM_TIMEOUT_MS 30000 // Log if DHCP hasn't confirmed a reused lease by then
+
+// Provisioning scan (BLE): one channel at a time, non-blocking, results cached
+#define WIFI_SCAN_CHANNELS 13               // 2.4 GHz channels 1-13
+#define WIFI_SCAN_MS_PER_CHANNEL 120        // Active dwell per channel
+#define WIFI_SCAN_CHANNEL_TIMEOUT_MS 2000   // Give up on a channel that never completes
+#define WIFI_SCAN_MAX_NETWORKS 24           // Cache entries (weakest replaced when full)
+#define WIFI_SCAN_CACHE_TTL_MS 30000        // Replay results instead of rescanning
+#define WIFI_SCAN_PAGE_MIN 100              // Notification payload floor (MTU - 3)
+#define WIFI_SCAN_PAGE_MAX 509              // ... and ceiling (512-byte ATT MTU)
 
 // ============================================================================
 // MQTT Configuration
 // ============================================================================
 
 #define MQTT_PORT 1883
-#define MQTT_RECONNECT_INTERVAL_MS 5000
+#define MQTT_RECONNECT_INTERVAL_MS 5000   // First retry; doubles per failure
+#define MQTT_RECONNECT_MAX_MS 120000      // Backoff ceiling (jittered 50-100%)
+#define MQTT_SOCKET_TIMEOUT_SECONDS 5     // CONNACK / read timeout on the MQTT task
+#define MQTT_TASK_STACK_SIZE 6144         // Discovery JSON + command handling
+#define MQTT_TASK_PRIORITY 1              // Same as loop(); below async_tcp (10)
+#define MQTT_TASK_INTERVAL_MS 10          // Poll interval (woken early by publishes)
+#define MQTT_PUBLISH_QUEUE_LENGTH 8       // Outgoing messages buffered while offline
+#define MQTT_QUEUE_PAYLOAD_SIZE 32        // Max queued payload (state)
+
+// Telemetry (retained position + JSON attributes for Home Assistant)
+#define MQTT_TELEMETRY_INTERVAL_MS 500          // Live position/attributes while moving
+#define MQTT_TELEMETRY_IDLE_INTERVAL_MS 30000   // Servo voltage/temperature, RSSI drift at rest
+#define MQTT_ATTRIBUTES_BUFFER_SIZE 512         // Preallocated attributes payload
 #define MQTT_KEEPALIVE_SECONDS 60
+#define MQTT_BUFFER_SIZE 1024             // PubSubClient packet buffer (discovery payload)
+#define MQTT_DIAGNOSTICS_INTERVAL_MS 60000      // Performance counters to <prefix>/diagnostics
+#define MQTT_DIAGNOSTICS_BUFFER_SIZE 896        // Preallocated diagnostics payload
 
 // MQTT topic prefixes
 #define MQTT_TOPIC_PREFIX "famesmartblinds"
 #define MQTT_DISCOVERY_PREFIX "homeassistant"
 
+// Group commands: famesmartblinds/group/<name>/command reaches every member
+#define MQTT_GROUP_TOPIC_PREFIX MQTT_TOPIC_PREFIX "/group"
+#define MQTT_MAX_GROUPS 4                 // Group memberships per device
+#define MQTT_GROUP_NAME_LENGTH 24         // [a-z0-9_-], lowercased on save
+#define MQTT_SCHEDULE_MAX_AHEAD_MS 3600000  // Reject start times further ahead than this
+#define MQTT_SCHEDULE_LATE_MS 5000        // Start late commands up to this late, drop older ones
+
+// SNTP (wall clock for scheduled group starts and the on-device schedule)
+#define NTP_SERVER_PRIMARY "pool.ntp.org"
+#define NTP_SERVER_SECONDARY "time.google.com"
+#define NTP_VALID_EPOCH 1700000000UL      // Clock counts as synced once past this (Nov 2023)
+
+// ============================================================================
+// Schedule Configuration
+// ============================================================================
+
+// Time-of-day and sunrise/sunset rules run on the device (no broker needed)
+#define SCHEDULE_MAX_RULES 8
+#define SCHEDULE_SPEC_SIZE 384            // Stored rule text, ';'-separated
+#define SCHEDULE_TIMEZONE_SIZE 48         // POSIX TZ string ("CET-1CEST,M3.5.0,M10.5.0/3")
+#define SCHEDULE_DEFAULT_TIMEZONE "UTC0"
+#define SCHEDULE_LATE_LIMIT_S 300         // Events missed by more than this (clock step) are skipped
+#define SCHEDULE_RECHECK_S 21600          // Re-evaluate when no rule has an event in the coming week
+
 // ============================================================================
 // HTTP Server Configuration
 // ============================================================================
 
 #define HTTP_PORT 80
 
+// Pre-rendered /status JSON (shared by GET /status and SSE /events)
+#define STATUS_BUFFER_SIZE 1024         // Bytes for the rendered status document
+#define STATUS_RUNTIME_BUFFER_SIZE 768  // Bytes for the /info runtime block (uptime, telemetry, SSE)
+
+// SSE /events/delta - changed fields only, with periodic full keyframes
+#define STATUS_DELTA_BUFFER_SIZE 192    // Bytes for one rendered delta event
+#define STATUS_DELTA_KEYFRAME_MS 10000  // Full status resent at least this often
+
+// SSE per-client backpressure (/events)
+#define SSE_MAX_CLIENTS 6               // Tracked status clients; extra connections are closed
+#define SSE_MIN_INTERVAL_MS 50          // Position update interval for clients with an empty queue
+#define SSE_MAX_INTERVAL_MS 1000        // Longest interval for a slow client
+#define SSE_CLIENT_QUEUE_LIMIT 4        // Queued messages at which a client gets no new sends
+
+// ============================================================================
+// OTA Configuration
+// ============================================================================
+
+// Chunked OTA: chunks are received into RAM buffers and flashed by a writer
+// task, so receiving the next chunk overlaps with flashing the previous one
+#define OTA_MAX_IMAGE_SIZE 2000000      // Bytes (min_spiffs.csv app partition)
+#define OTA_CHUNK_SIZE 16384            // Negotiated chunk size if the heap allows
+#define OTA_MIN_CHUNK_SIZE 8192         // Fallback chunk size (and what older apps send)
+#define OTA_WINDOW 2                    // Chunks a client may have in flight
+#define OTA_SLOT_WAIT_MS 5              // Max wait for a free buffer (body callback runs on async_tcp)
+#define OTA_BUSY_RETRY_AFTER_S 1        // Retry-After on a 503 when every buffer is in use
+#define OTA_FINISH_RETRY_AFTER_S 1      // Retry-After on a 202 from /ota/end while the image is finished
+#define OTA_WRITER_STACK_SIZE 4096
+#define OTA_WRITER_PRIORITY 2           // Above loop() (1), below async_tcp (10)
+#define OTA_SESSION_TIMEOUT_MS 600000   // Idle session kept for /ota/begin?resume=1 (10 min)
+#define OTA_IMAGE_ID_LENGTH 40          // Max client-supplied image identifier
+#define OTA_MIN_FREE_HEAP 60000         // Heap left after chunk buffers (inflate needs ~44 KB)
+
 // ============================================================================
 // BLE Configuration
 // ============================================================================
@@ -79,6 +250,21 @@
 #define BLE_CHAR_WIFI_SCAN_TRIGGER_UUID "beb5483e-36e1-4688-b7f5-ea07361b26b0"
 #define BLE_CHAR_WIFI_SCAN_RESULTS_UUID "beb5483e-36e1-4688-b7f5-ea07361b26b1"
 
+// ============================================================================
+// Stored Setting Limits
+// ============================================================================
+
+// Longest accepted values; longer ones are refused (400 over HTTP, "*_error"
+// or "wifi_failed" over BLE) rather than cached truncated. RAM config cache
+// fields are one byte longer.
+#define WIFI_SSID_MAX_LENGTH 32             // 802.11 limit
+#define WIFI_PASSWORD_MAX_LENGTH 64         // WPA2 passphrase (63) or raw hex PSK (64)
+#define DEVICE_NAME_MAX_LENGTH 31
+#define DEVICE_PASSWORD_MAX_LENGTH 63
+#define MQTT_BROKER_MAX_LENGTH 63
+#define MQTT_USER_MAX_LENGTH 63
+#define MQTT_PASSWORD_MAX_LENGTH 63
+
 // ============================================================================
 // NVS Storage Keys
 // ============================================================================
@@ -99,6 +285,7 @@
 #define NVS_KEY_CALIBRATED "calibrated"
 #define NVS_KEY_AUTO_HOME "auto_home"
 #define NVS_KEY_SERVO_SPEED "servo_spd"
+#define NVS_KEY_DRIVE_PROFILE "drive_prof"  // Learned open/close DriveProfile pair
 
 // Power outage recovery keys
 #define NVS_KEY_WAS_MOVING "was_moving"
@@ -107,6 +294,20 @@
 // Setup state
 #define NVS_KEY_SETUP_COMPLETE "setup_done"
 #define NVS_KEY_ORIENTATION "orientation"
+#define NVS_KEY_MOTION_RECORD "motion"      // Position + target + moving flag blob
+#define NVS_KEY_LOG_LEVELS "log_levels"     // Runtime log level spec (servo=debug,...)
+#define NVS_KEY_MQTT_GROUPS "mqtt_groups"   // Comma-separated MQTT group names
+#define NVS_KEY_WIFI_FAST "wifi_fast"       // Last good BSSID/channel/lease blob
+#define NVS_KEY_WIFI_STATIC_IP "wifi_static" // Static IP: ip,gateway,subnet[,dns]
+#define NVS_KEY_POWER_MODE "power_mode"     // PowerMode (see POWER_MODE_DEFAULT)
+#define NVS_KEY_SCHEDULE "schedule"         // Schedule rules (Schedule::parseList text)
+#define NVS_KEY_LOCATION "location"         // "latitude,longitude" for sun rules
+#define NVS_KEY_TIMEZONE "timezone"         // POSIX TZ string for local schedule times
+
+// Write-behind cache for the motion record
+#define STORAGE_FLUSH_INTERVAL_MS 5000          // Minimum spacing of position-only flushes
+#define STORAGE_WEAR_BUDGET_PER_HOUR 120        // Motion record writes per hour before backing off
+#define STORAGE_WEAR_BACKOFF_INTERVAL_MS 60000  // Flush spacing once the budget is spent
 
 // ============================================================================
 // Timing Configuration
@@ -116,4 +317,29 @@
 #define STATUS_UPDATE_INTERVAL_MS 1000
 #define HEARTBEAT_INTERVAL_MS 30000
 
+// ============================================================================
+// Power Management
+// ============================================================================
+
+// Modes: 0 = performance (radio always on), 1 = balanced (modem sleep, the
+// default), 2 = low power (balanced + automatic light sleep and slower idle
+// polling). Commands run on the HTTP/MQTT tasks, so slower idle loops don't
+// delay them; only state fan-out waits for the next loop pass.
+#define POWER_MODE_DEFAULT 1
+#define POWER_IDLE_AFTER_MS 5000            // Stopped this long before idle intervals apply
+#define POWER_IDLE_LOOP_INTERVAL_MS 100     // loop() period while idle (low power)
+#define POWER_IDLE_SERVO_POLL_MS 5000       // Servo connection check while idle (low power)
+#define POWER_CPU_FREQ_MHZ 160              // Fixed: the servo UART is clocked from APB
+#define POWER_DUTY_WINDOW_MS 10000          // Duty cycle measurement window
+
+// ============================================================================
+// Performance Metrics
+// ============================================================================
+
+// Latency histograms (GET /metrics, MQTT diagnostics). Bucket bounds are in
+// microseconds; one extra bucket counts everything above the last bound.
+#define METRICS_BUCKET_BOUNDS_US {50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 1000000}
+#define METRICS_BUCKET_COUNT 14             // Bounds above + Inf
+#define METRICS_SECTION_SIZE 1536           // Largest rendered metric family (one histogram)
+
 #endif // CONFIG_H
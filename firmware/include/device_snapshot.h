@@ -0,0 +1,69 @@
+#ifndef DEVICE_SNAPSHOT_H
+#define DEVICE_SNAPSHOT_H
+
+#include <stdint.h>
+#include "config.h"
+
+// Value types of the central state model. Kept free of Arduino dependencies
+// so the documents rendered from a snapshot can be exercised off-target.
+
+// Snapshot of the servo's present-state registers, read in one bus transaction
+struct ServoTelemetry {
+    int position = 0;           // Raw position 0-4095
+    int speed = 0;              // Present speed (steps/s, signed)
+    int load = 0;               // Present load (0.1% of max torque, signed)
+    int voltage = 0;            // Supply voltage (0.1V units)
+    int temperature = 0;        // Degrees C
+    bool moving = false;        // Servo reports it is moving
+    unsigned long timestamp = 0;  // millis() when sampled
+    bool valid = false;         // False until the first successful read / after connection loss
+};
+
+// Summary of one blind on the bus (multi-blind boards report each one)
+struct BlindSummary {
+    const char* blindState = "unknown";
+    int32_t cumulativePosition = 0;
+    int32_t maxPosition = 0;
+    bool calibrated = false;
+    const char* calibrationState = "idle";
+    bool servoConnected = false;
+
+    // 0-100 (100 = open), -1 if not calibrated
+    int positionPercent() const;
+};
+
+// Everything the HTTP/MQTT/BLE front ends report, copied out in one piece
+struct DeviceStateSnapshot {
+    // Motion (published by ServoController)
+    const char* blindState = "unknown";     // Static strings from ServoController
+    int position = 0;                       // Raw servo position 0-4095
+    int32_t cumulativePosition = 0;
+    int32_t maxPosition = 0;
+    bool calibrated = false;
+    const char* calibrationState = "idle";
+
+    // WiFi (published by WifiManager)
+    bool wifiConnected = false;
+    char wifiSsid[33] = {0};
+    int wifiRssi = 0;
+    char wifiIp[16] = {0};
+
+    // Hall sensor (published by HallSensor)
+    bool hallRawState = true;               // HIGH = no magnet
+    bool hallTriggered = false;
+    uint32_t hallTriggerCount = 0;
+
+    // Servo (published by ServoController)
+    bool servoConnected = false;
+    ServoTelemetry servo;
+
+    // Every blind, the primary one (above) included
+    BlindSummary blinds[BLIND_COUNT];
+
+    uint32_t generation = 0;
+
+    // 0-100 (100 = open), -1 if not calibrated
+    int positionPercent() const;
+};
+
+#endif // DEVICE_SNAPSHOT_H
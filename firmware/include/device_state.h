@@ -0,0 +1,68 @@
+#ifndef DEVICE_STATE_H
+#define DEVICE_STATE_H
+
+#include <Arduino.h>
+#include <functional>
+#include <freertos/FreeRTOS.h>
+#include "config.h"
+#include "device_snapshot.h"
+
+// Change flags passed to observers (bitmask)
+enum StateChange : uint32_t {
+    STATE_CHANGE_MOTION      = 1 << 0,  // Blind state (open/closing/stopped...)
+    STATE_CHANGE_POSITION    = 1 << 1,  // Raw or cumulative position
+    STATE_CHANGE_CALIBRATION = 1 << 2,  // Calibrated flag, max position, calibration state
+    STATE_CHANGE_WIFI        = 1 << 3,  // Connection, SSID, IP, RSSI
+    STATE_CHANGE_HALL        = 1 << 4,  // Hall sensor pin / trigger count
+    STATE_CHANGE_SERVO       = 1 << 5,  // Servo connection and telemetry
+    STATE_CHANGE_BLINDS      = 1 << 6,  // Any entry of the per-blind summaries
+    STATE_CHANGE_ALL         = 0x7F
+};
+
+// Central state model. Producers publish complete values; only real changes
+// bump the generation and mark change flags. Observers run from dispatch()
+// on the main loop, so front ends never see calls from the motion task.
+class DeviceState {
+public:
+    using Observer = std::function<void(uint32_t changes, const DeviceStateSnapshot& state)>;
+
+    DeviceState();
+
+    // Producers (safe from any task)
+    void publishMotion(const char* blindState, int position, int32_t cumulativePosition,
+                       int32_t maxPosition, bool calibrated, const char* calibrationState);
+    void publishWifi(bool connected, const char* ssid, int rssi, const char* ip);
+    void publishHall(bool rawState, bool triggered, uint32_t triggerCount);
+    void publishServo(bool connected, const ServoTelemetry& telemetry);
+    void publishBlind(uint8_t blind, const BlindSummary& summary);
+
+    // Consumers
+    DeviceStateSnapshot snapshot() const;
+    uint32_t generation() const;
+
+    // Register an observer for the given change flags (call during setup)
+    bool subscribe(uint32_t mask, Observer observer);
+
+    // Deliver pending changes to observers (call from the main loop)
+    void dispatch();
+
+private:
+    static const int MAX_OBSERVERS = 8;
+
+    struct Subscription {
+        uint32_t mask;
+        Observer observer;
+    };
+
+    DeviceStateSnapshot _state;
+    uint32_t _pending;
+    Subscription _observers[MAX_OBSERVERS];
+    int _observerCount;
+    mutable portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+
+    void markChanged(uint32_t changes);  // Call with _mux held
+};
+
+extern DeviceState deviceState;
+
+#endif // DEVICE_STATE_H
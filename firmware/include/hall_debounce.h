@@ -0,0 +1,47 @@
+#ifndef HALL_DEBOUNCE_H
+#define HALL_DEBOUNCE_H
+
+#include <stdint.h>
+
+// Debounce state machine for the hall switch, fed with edge and poll times.
+// An edge that finds the pin LOW starts a candidate trigger timestamped at
+// that edge. Every later edge (either direction) restarts the stability
+// window, so a trigger is confirmed only after windowUs without any edge and
+// with the pin still LOW; a pin that settles HIGH instead rejects it.
+// Kept free of Arduino dependencies so it can be exercised off-target; the
+// caller serialises onEdge() (ISR) and poll() (task).
+class HallDebounce {
+public:
+    enum class Result : uint8_t {
+        IDLE,       // No candidate
+        WAITING,    // Candidate, signal not yet stable for the window
+        CONFIRMED,  // Stable LOW for the window - a real trigger
+        REJECTED    // Settled HIGH - noise or a magnet edge grazed
+    };
+
+    explicit HallDebounce(int64_t windowUs) : _windowUs(windowUs) { reset(); }
+
+    void reset();
+
+    // An edge at nowUs with the pin level read right after it. Returns true when
+    // it starts a new candidate (latch the position and wake the motion task).
+    bool onEdge(bool low, int64_t nowUs);
+
+    // Check the candidate against the current pin level. CONFIRMED and REJECTED
+    // end the candidate; edgeTimeUs() and bounces() stay valid until the next one.
+    Result poll(bool low, int64_t nowUs);
+
+    bool pending() const { return _pending; }
+    int64_t edgeTimeUs() const { return _edgeUs; }     // First edge of the candidate
+    uint16_t bounces() const { return _bounces; }      // Edges after the first
+    int64_t windowUs() const { return _windowUs; }
+
+private:
+    int64_t _windowUs;
+    bool _pending;
+    int64_t _edgeUs;
+    int64_t _lastChangeUs;
+    uint16_t _bounces;
+};
+
+#endif // HALL_DEBOUNCE_H
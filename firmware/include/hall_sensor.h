@@ -2,13 +2,17 @@
 #define HALL_SENSOR_H
 
 #include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "hall_debounce.h"
 
 class HallSensor {
 public:
     HallSensor();
 
     // Initialize the hall sensor on the specified pin with interrupt
-    void init(uint8_t pin);
+    // (publishState: report pin/trigger count to deviceState - primary blind only)
+    void init(uint8_t pin, bool publishState = true);
 
     // Returns true when magnet is detected (sensor reads LOW)
     bool isTriggered() const;
@@ -16,7 +20,7 @@ public:
     // Clear the triggered flag (call after handling the trigger)
     void clearTriggered();
 
-    // Update sensor state (processes interrupt flags with debouncing)
+    // Update sensor state (debounces captured edges against their timestamps)
     void update();
 
     // Get raw pin state (for debugging)
@@ -25,26 +29,55 @@ public:
     // Get trigger count (for debugging)
     uint32_t getTriggerCount() const;
 
+    // Edge capture
+    // The motion task publishes its latest cumulative position after every sample;
+    // the ISR latches it together with the esp_timer time of the edge and notifies
+    // the task so it can react without waiting for its next sampling period.
+    void setNotifyTask(TaskHandle_t task);
+    void setPositionSnapshot(int32_t cumulativePosition, float velocity);
+
+    // True between an edge being captured and it being confirmed or rejected
+    bool hasPendingEdge() const;
+
+    // Cumulative position at the confirmed edge (extrapolated to the edge time)
+    int32_t getTriggerPosition() const;
+
+    // Light sleep wake source. GPIO wakeup needs a level interrupt, which would
+    // storm the edge ISR, so the ISR is masked while armed. armWake() wakes on
+    // the opposite of the current level; disarmWake() restores the FALLING edge.
+    void armWake();
+    void disarmWake();
+    bool isWakeArmed() const { return _wakeArmed; }
+    int getWakeLevel() const { return _wakeLevel; }  // Pin level when armed
+
 private:
     uint8_t _pin;
     volatile bool _triggered;           // Confirmed trigger (after debounce)
-    volatile bool _interruptFlag;       // Raw interrupt received
     volatile uint32_t _triggerCount;
-    unsigned long _lastTriggerTime;
     bool _initialized;
+    bool _publishState;
+
+    // Captured edge (written by the ISR, _debounce only under _mux)
+    HallDebounce _debounce;
+    volatile bool _edgePending;         // Mirrors _debounce.pending() for lock-free readers
+    volatile int32_t _edgeSnapshotPosition;  // Position snapshot latched at the edge
+    volatile int64_t _edgeSnapshotTimeUs;    // When that snapshot was taken
 
-    // Debounce state machine
-    bool _pendingTrigger;               // Interrupt received, waiting for debounce
-    unsigned long _pendingTriggerTime;  // When the pending trigger started
+    // Position snapshot from the motion task
+    volatile int32_t _snapshotPosition;
+    volatile int64_t _snapshotTimeUs;
+    float _snapshotVelocity;            // Counts/s, only used in task context
 
-    // Debounce time in milliseconds - signal must be stable for this duration
-    static const unsigned long DEBOUNCE_MS = 100;
+    int32_t _triggerPosition;
+    TaskHandle_t _notifyTask;
+    bool _wakeArmed;
+    int _wakeLevel;
+    portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
 
-    // ISR handler - must be static
-    static void IRAM_ATTR isrHandler();
+    void debounceEdge();
 
-    // Pointer to the singleton instance for ISR access
-    static HallSensor* _instance;
+    // ISR handler - must be static, arg is the sensor instance
+    static void IRAM_ATTR isrHandler(void* arg);
 };
 
 #endif // HALL_SENSOR_H
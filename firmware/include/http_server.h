@@ -4,14 +4,26 @@
 #include <Arduino.h>
 #include <functional>
 #include <Update.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "device_state.h"
+#include "config.h"
+#include "ota_writer.h"
+#include "command.h"
+
+class AsyncEventSourceClient;
+struct StatusDocument;
 
 // Command callback type
-using HttpCommandCallback = std::function<void(const String& action)>;
+using HttpCommandCallback = std::function<void(const Command& command)>;
 
 // MQTT config callback type (broker, port, user, password)
 using HttpMqttConfigCallback = std::function<void(const String& broker, uint16_t port,
                                                    const String& user, const String& password)>;
 
+// MQTT group membership callback type (normalized comma-separated list)
+using HttpMqttGroupsCallback = std::function<void(const String& groups)>;
+
 class HttpServer {
 public:
     HttpServer();
@@ -34,15 +46,13 @@ public:
     // Set callback for MQTT configuration changes
     void onMqttConfig(HttpMqttConfigCallback callback);
 
-    // Update device state (for status endpoint)
-    void updateState(const char* state);
-    void updatePosition(int position);
-    void updateWifiInfo(const String& ssid, int rssi, const String& ip);
-    void updateCalibration(bool calibrated, int32_t cumulativePosition, int32_t maxPosition,
-                          const char* calibrationState);
-    void updateHallSensor(bool rawState, bool triggered, uint32_t triggerCount);
+    // Set callback for MQTT group membership changes
+    void onMqttGroups(HttpMqttGroupsCallback callback);
 
-    // SSE: Broadcast state to all connected clients (call from main loop when state changes)
+    // Subscribe to deviceState changes (call once during setup)
+    void attachState();
+
+    // SSE: Broadcast pending state changes to all clients (call from main loop)
     void broadcastStateIfChanged();
 
     // SSE: Broadcast a log entry to all connected clients
@@ -54,46 +64,85 @@ public:
     // SSE: Get number of connected log clients
     int getLogClientCount() const;
 
+    // SSE: Get number of connected delta clients (/events/delta)
+    int getDeltaClientCount() const;
+
+    // SSE: /events backpressure totals (safe from any task)
+    struct SseStats {
+        uint8_t clients;
+        uint16_t queueDepth;        // Messages queued in AsyncTCP across clients (last send)
+        uint16_t maxQueueDepth;     // Deepest queue of a connected client
+        uint32_t coalesced;         // Includes clients that have disconnected
+        uint32_t dropped;
+    };
+    SseStats getSseStats();
+
 private:
     bool _running;
     bool _pendingRestart = false;
     HttpCommandCallback _commandCallback;
     HttpMqttConfigCallback _mqttConfigCallback;
+    HttpMqttGroupsCallback _mqttGroupsCallback;
 
-    // Current state for status endpoint
-    String _currentState;
-    int _currentPosition;
-    String _wifiSsid;
-    int _wifiRssi;
-    String _wifiIp;
-
-    // Calibration state
-    bool _calibrated = false;
-    int32_t _cumulativePosition = 0;
-    int32_t _maxPosition = 0;
-    String _calibrationState = "idle";
-
-    // Hall sensor state
-    bool _hallRawState = true;  // HIGH = no magnet
-    bool _hallTriggered = false;
-    uint32_t _hallTriggerCount = 0;
-
-    // OTA update state
+    // OTA update state (multipart /update)
     bool _otaInProgress = false;
     size_t _otaReceived = 0;
     size_t _otaTotal = 0;
 
-    // SSE state tracking (for change detection)
-    String _lastBroadcastState;
-    int32_t _lastBroadcastPosition = -1;
-    String _lastBroadcastCalibrationState;
+    // Chunked OTA (/ota/*) buffering and flash writer task
+    OtaWriter _ota;
+
+    // Pre-rendered status JSON - re-rendered only when the generation changes
+    SemaphoreHandle_t _statusMutex = nullptr;
+
+    // SSE change tracking (set by the deviceState observer)
+    uint32_t _pendingBroadcast = 0;
     unsigned long _lastBroadcastTime = 0;
+    uint32_t _broadcastSeq = 1;     // Bumped once per batch of pending changes
+    uint32_t _urgentSeq = 0;        // Last seq with a state (not just position) change
+
+    // Per-client /events tracking. Each client is sent the latest status at a
+    // rate that backs off with its queue depth, so one slow client only
+    // coalesces its own updates.
+    struct SseClientSlot {
+        AsyncEventSourceClient* client;
+        uint32_t sentSeq;
+        unsigned long lastSend;
+        uint16_t queueDepth;
+        uint16_t maxQueueDepth;
+        uint32_t coalesced;         // Updates superseded by a later one
+        uint32_t dropped;           // Updates skipped with the queue at the limit
+        uint32_t droppedSeq;
+    };
+    SseClientSlot _sseClients[SSE_MAX_CLIENTS] = {};
+    SemaphoreHandle_t _sseMutex = nullptr;
+    uint32_t _sseCoalescedTotal = 0;    // Includes clients that have disconnected
+    uint32_t _sseDroppedTotal = 0;
+    uint32_t _deltaSentSeq = 0;
+
+    // Delta stream: fields are diffed against the last state sent
+    DeviceStateSnapshot _deltaBase = {};
+    uint32_t _deltaId = 0;
+    unsigned long _lastKeyframeTime = 0;
 
     void setupRoutes();
     void setupOTARoutes();
     void setupSSE();
-    String buildStatusJson();
+    const StatusDocument& currentStatus();  // Call with the status lock held
+    size_t copyStatus(uint32_t generation, uint8_t* buffer, size_t maxLen, size_t index);
+    void broadcastDelta(unsigned long now);
+    void sendStatusToClients(unsigned long now);
+    bool registerSseClient(AsyncEventSourceClient* client);
+    void unregisterSseClient(AsyncEventSourceClient* client);
+    void lockStatus();
+    void unlockStatus();
     String buildInfoJson();
+    String buildBlindsJson();
+    String buildGroupsJson();
+    String buildNetworkJson();
+    String buildPowerJson();
+    String buildScheduleJson();
+    String buildLocationJson();
 };
 
 #endif // HTTP_SERVER_H
@@ -0,0 +1,40 @@
+#ifndef LOG_ARGS_H
+#define LOG_ARGS_H
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define LOG_MAX_ARGS 8              // Arguments captured per record
+#define LOG_STRING_ARG_BYTES 48     // Space for copied %s arguments per record
+
+// Captured argument (type is recovered by re-parsing the format)
+union LogArg {
+    int32_t i;
+    int64_t ll;
+    double d;
+    const void* p;
+    uint16_t str;       // Offset into LogArgs::strings
+};
+
+// The arguments of one deferred log call: values are captured when the call
+// is made and formatted later by the drain task. %s arguments are copied
+// into strings, sharing LOG_STRING_ARG_BYTES between them; ones that do not
+// fit are cut short, and once it is full the rest print empty. Kept free of
+// Arduino dependencies so it can be exercised off-target.
+struct LogArgs {
+    uint8_t argCount;
+    uint8_t stringBytes;
+    LogArg args[LOG_MAX_ARGS];
+    char strings[LOG_STRING_ARG_BYTES];
+
+    // Capture what format consumes from ap. Stops at the first conversion it
+    // cannot type or once LOG_MAX_ARGS are taken.
+    void capture(const char* format, va_list ap);
+
+    // snprintf-like rendering of format with the captured arguments into out
+    // (always terminated). Conversions past the captured ones are shown verbatim.
+    size_t format(const char* format, char* out, size_t capacity) const;
+};
+
+#endif // LOG_ARGS_H
@@ -0,0 +1,53 @@
+#ifndef LOG_HISTORY_H
+#define LOG_HISTORY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Log buffer configuration
+#define LOG_BUFFER_SIZE 50      // Number of log entries to keep
+#define LOG_ENTRY_SIZE 128      // Max size of each log entry
+
+// Read position for streaming the log history (one per /logs response)
+struct LogCursor {
+    uint32_t nextSeq = 0;       // Next entry sequence number to emit
+    uint32_t firstSeq = 0;      // Oldest sequence available when the read started
+    uint8_t phase = 0;          // Header, entries, footer, done
+    bool needComma = false;
+    char pending[2 * LOG_ENTRY_SIZE + 48];  // Escaped piece not yet copied out
+    size_t pendingLen = 0;
+    size_t pendingPos = 0;
+};
+
+// Ring of the last LOG_BUFFER_SIZE formatted entries and the /logs document
+// streamed from it. Kept free of Arduino dependencies so it can be exercised
+// off-target; Logger serialises every call with its history mutex.
+class LogHistory {
+public:
+    LogHistory() { clear(); }
+
+    void add(const char* entry);
+
+    // Drop every entry; sequence numbers keep counting so ?since= stays valid
+    void clear();
+
+    // Stream as {"first":n,"logs":[...],"next":n}. Entries carry increasing
+    // sequence numbers; since=last "next" value returns only newer entries,
+    // and one at or past the next sequence number (from before a reboot)
+    // starts from the oldest entry.
+    // fill() returns 0 when complete; entries overwritten between two fill()
+    // calls are skipped.
+    void begin(LogCursor& cursor, uint32_t since) const;
+    size_t fill(LogCursor& cursor, uint8_t* buffer, size_t maxLen) const;
+
+private:
+    char _entries[LOG_BUFFER_SIZE][LOG_ENTRY_SIZE];
+    int _head;                  // Next write position
+    int _count;                 // Number of entries in buffer
+    uint32_t _nextSeq = 1;      // Sequence number of the next entry (only reset by a reboot)
+
+    uint32_t oldestSeq() const { return _nextSeq - _count; }
+    bool nextPiece(LogCursor& cursor) const;
+};
+
+#endif // LOG_HISTORY_H
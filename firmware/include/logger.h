@@ -2,11 +2,19 @@
 #define LOGGER_H
 
 #include <Arduino.h>
+#include <atomic>
 #include <functional>
-
-// Log buffer configuration
-#define LOG_BUFFER_SIZE 50      // Number of log entries to keep
-#define LOG_ENTRY_SIZE 128      // Max size of each log entry
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include "log_args.h"
+#include "log_history.h"
+
+// Deferred logging queue (producers capture args, the drain task formats)
+#define LOG_QUEUE_SLOTS 64          // Pending records (power of two)
+#define LOG_DRAIN_TASK_STACK 4096
+#define LOG_DRAIN_TASK_PRIORITY 1   // Below everything that logs
+#define LOG_DRAIN_INTERVAL_MS 50    // Maximum latency when no wakeup is pending
 
 // Callback type for SSE log broadcasting
 using LogBroadcastCallback = std::function<void(const char*)>;
@@ -21,9 +29,29 @@ enum class LogCategory {
     HTTP,
     NVS,
     HALL,
-    ERROR
+    ERROR,
+    COUNT       // Number of categories (not a category)
+};
+
+// Log severity, in increasing verbosity
+enum class LogLevel : uint8_t {
+    NONE = 0,
+    ERROR = 1,
+    WARN = 2,
+    INFO = 3,   // Default for the LOG_<CATEGORY> macros
+    DEBUG = 4,
+    TRACE = 5
 };
 
+// Compile-time threshold: calls above this level are removed entirely.
+// Set from platformio.ini (-DLOG_COMPILE_LEVEL=n, values as LogLevel).
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL 5
+#endif
+
+// Runtime default for every category
+#define LOG_DEFAULT_LEVEL LogLevel::INFO
+
 class Logger {
 public:
     static void init(unsigned long baudRate = 115200);
@@ -32,7 +60,12 @@ public:
     static void setLogBroadcastCallback(LogBroadcastCallback callback);
 
     // Main logging functions
+    // Formatting is deferred to the drain task: format must be a string literal
+    // (or otherwise outlive the call); %s arguments are copied immediately,
+    // LOG_STRING_ARG_BYTES for all of them together (see LogArgs).
     static void log(LogCategory category, const char* format, ...);
+    // Logged as "%s", so cut to LOG_STRING_ARG_BYTES - 1 characters; build
+    // longer messages from a literal format instead
     static void log(LogCategory category, const String& message);
 
     // Convenience methods for each category
@@ -46,45 +79,108 @@ public:
     static void hall(const char* format, ...);
     static void error(const char* format, ...);
 
-    // Enable/disable logging
+    // Enable/disable serial output (ring buffer and SSE are controlled by levels)
     static void setEnabled(bool enabled);
     static bool isEnabled();
 
+    // Runtime per-category levels
+    static bool shouldLog(LogCategory category, LogLevel level) {
+        return (uint8_t)level <= _levels[(int)category];
+    }
+    static void setLevel(LogCategory category, LogLevel level);
+    static LogLevel getLevel(LogCategory category);
+
+    // Apply a level spec such as "servo=debug,http=warn" or "*=info"
+    // Returns false (leaving levels unchanged) if any entry is not understood
+    static bool applyLevels(const String& spec);
+    static String getLevelsString();     // Same format, every category listed
+    static const char* getLevelName(LogLevel level);
+    static const char* getCategoryName(LogCategory category);
+    static bool parseLevel(const String& name, LogLevel& level);
+    static bool parseCategory(const String& name, LogCategory& category);
+
     // Wait for serial connection (useful during development)
     static void waitForSerial(unsigned long timeoutMs = 3000);
 
-    // Get buffered logs as JSON array string
-    static String getLogsJson();
+    // Stream buffered logs as {"first":n,"logs":[...],"next":n}
+    // Entries carry increasing sequence numbers; since=last "next" value
+    // returns only newer entries. fillLogsJson() returns 0 when complete.
+    static void beginLogsJson(LogCursor& cursor, uint32_t since = 0);
+    static size_t fillLogsJson(LogCursor& cursor, uint8_t* buffer, size_t maxLen);
 
     // Clear the log buffer
     static void clearBuffer();
 
+    // Records dropped because the queue was full
+    static uint32_t getDroppedCount();
+
 private:
-    static bool _enabled;
-    static char _buffer[256];
+    // One pending log call. sequence implements a bounded lock-free
+    // multi-producer queue (Vyukov): producers claim a slot with a CAS on
+    // _enqueuePos and publish it by storing pos + 1.
+    struct LogRecord {
+        std::atomic<uint32_t> sequence;
+        uint32_t timestamp;
+        const char* format;
+        LogCategory category;
+        LogArgs args;
+    };
 
-    // Ring buffer for log entries
-    static char _logBuffer[LOG_BUFFER_SIZE][LOG_ENTRY_SIZE];
-    static int _logHead;        // Next write position
-    static int _logCount;       // Number of entries in buffer
+    static bool _enabled;
+    static inline uint8_t _levels[(int)LogCategory::COUNT] = {
+        (uint8_t)LOG_DEFAULT_LEVEL, (uint8_t)LOG_DEFAULT_LEVEL, (uint8_t)LOG_DEFAULT_LEVEL,
+        (uint8_t)LOG_DEFAULT_LEVEL, (uint8_t)LOG_DEFAULT_LEVEL, (uint8_t)LOG_DEFAULT_LEVEL,
+        (uint8_t)LOG_DEFAULT_LEVEL, (uint8_t)LOG_DEFAULT_LEVEL, (uint8_t)LOG_DEFAULT_LEVEL
+    };
+
+    // Pending records
+    static LogRecord _queue[LOG_QUEUE_SLOTS];
+    static std::atomic<uint32_t> _enqueuePos;
+    static uint32_t _dequeuePos;            // Drain task only
+    static std::atomic<uint32_t> _dropped;
+    static bool _queueReady;
+    static TaskHandle_t _drainTask;
+
+    // Formatted entries (guarded by _historyMutex)
+    static LogHistory _history;
+    static SemaphoreHandle_t _historyMutex;
 
     // Callback for SSE broadcasting
     static LogBroadcastCallback _broadcastCallback;
 
     static const char* getCategoryPrefix(LogCategory category);
     static void logVa(LogCategory category, const char* format, va_list args);
+    static void emit(LogCategory category, const char* entry);
+    static void drainTask(void* param);
+    static void drain();
     static void addToBuffer(const char* entry);
 };
 
-// Macros for easy logging
-#define LOG_BOOT(...)  Logger::boot(__VA_ARGS__)
-#define LOG_WIFI(...)  Logger::wifi(__VA_ARGS__)
-#define LOG_BLE(...)   Logger::ble(__VA_ARGS__)
-#define LOG_MQTT(...)  Logger::mqtt(__VA_ARGS__)
-#define LOG_SERVO(...) Logger::servo(__VA_ARGS__)
-#define LOG_HTTP(...)  Logger::http(__VA_ARGS__)
-#define LOG_NVS(...)   Logger::nvs(__VA_ARGS__)
-#define LOG_HALL(...)  Logger::hall(__VA_ARGS__)
-#define LOG_ERROR(...) Logger::error(__VA_ARGS__)
+// Level-gated logging. Calls above LOG_COMPILE_LEVEL compile to nothing
+// (arguments included); the rest cost one table lookup when filtered at runtime.
+#define LOG_AT(category, level, ...) \
+    do { \
+        if constexpr ((int)(level) <= LOG_COMPILE_LEVEL) { \
+            if (Logger::shouldLog(category, level)) { \
+                Logger::log(category, __VA_ARGS__); \
+            } \
+        } \
+    } while (0)
+
+// Macros for easy logging (INFO level, errors at ERROR)
+#define LOG_BOOT(...)  LOG_AT(LogCategory::BOOT, LogLevel::INFO, __VA_ARGS__)
+#define LOG_WIFI(...)  LOG_AT(LogCategory::WIFI, LogLevel::INFO, __VA_ARGS__)
+#define LOG_BLE(...)   LOG_AT(LogCategory::BLE, LogLevel::INFO, __VA_ARGS__)
+#define LOG_MQTT(...)  LOG_AT(LogCategory::MQTT, LogLevel::INFO, __VA_ARGS__)
+#define LOG_SERVO(...) LOG_AT(LogCategory::SERVO, LogLevel::INFO, __VA_ARGS__)
+#define LOG_HTTP(...)  LOG_AT(LogCategory::HTTP, LogLevel::INFO, __VA_ARGS__)
+#define LOG_NVS(...)   LOG_AT(LogCategory::NVS, LogLevel::INFO, __VA_ARGS__)
+#define LOG_HALL(...)  LOG_AT(LogCategory::HALL, LogLevel::INFO, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(LogCategory::ERROR, LogLevel::ERROR, __VA_ARGS__)
+
+// Verbose logging for hot paths, e.g. LOG_DEBUG(SERVO, "...")
+#define LOG_WARN(category, ...)  LOG_AT(LogCategory::category, LogLevel::WARN, __VA_ARGS__)
+#define LOG_DEBUG(category, ...) LOG_AT(LogCategory::category, LogLevel::DEBUG, __VA_ARGS__)
+#define LOG_TRACE(category, ...) LOG_AT(LogCategory::category, LogLevel::TRACE, __VA_ARGS__)
 
 #endif // LOGGER_H
@@ -0,0 +1,84 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "buffer_writer.h"
+
+// Instrumented sections (one latency histogram each)
+enum class MetricTimer : uint8_t {
+    LOOP_WORK,      // One loop() pass, excluding its delay
+    LOOP_PERIOD,    // Start of one loop() pass to the next
+    MOTION_UPDATE,  // One motion task sample of one blind
+    SERVO_BUS,      // FeedBack() round trip on the servo bus
+    MQTT_SERVICE,   // One connected MQTT task pass (socket, queue, telemetry)
+    NVS_WRITE,      // One Preferences put (settings, motion record, WiFi record)
+    LOG_EMIT,       // Ring buffer + serial + SSE fan-out of one log entry
+    SSE_SEND,       // Queueing one event to SSE clients
+    COUNT
+};
+
+// Progress through a chunked GET /metrics response
+struct MetricsCursor {
+    uint8_t section = 0;
+    size_t length = 0;              // Rendered bytes of the current section
+    size_t offset = 0;              // ... already copied out
+    char text[METRICS_SECTION_SIZE];
+};
+
+// Lightweight on-device performance counters. Timers use the CPU cycle counter
+// (a register read, safe from any task) and feed fixed-bucket histograms; the
+// cost of record() is one short critical section. Exposed as Prometheus text
+// on GET /metrics and as a compact JSON document on MQTT <prefix>/diagnostics.
+class Metrics {
+public:
+    static void init();
+
+    static uint32_t start() { return ESP.getCycleCount(); }
+
+    // Elapsed time since start() (sections longer than ~26 s wrap at 160 MHz)
+    static void record(MetricTimer timer, uint32_t startCycles);
+    static void recordMicros(MetricTimer timer, uint32_t micros);
+
+    // Prometheus text, one metric family per section
+    static void beginPrometheus(MetricsCursor& cursor);
+    static size_t fillPrometheus(MetricsCursor& cursor, uint8_t* buffer, size_t maxLen);
+
+    // Compact summary for the MQTT diagnostics topic
+    static void renderJson(BufferWriter& out);
+
+private:
+    struct Histogram {
+        uint32_t buckets[METRICS_BUCKET_COUNT];   // Per bucket (not cumulative), last is +Inf
+        uint32_t count;
+        uint64_t sumMicros;
+        uint32_t maxMicros;
+    };
+
+    static Histogram _timers[(int)MetricTimer::COUNT];
+    static uint32_t _cyclesPerMicro;
+    static portMUX_TYPE _mux;
+
+    static void snapshot(MetricTimer timer, Histogram& out);
+    static void renderSection(uint8_t section, BufferWriter& out);
+    static void renderHistogram(MetricTimer timer, BufferWriter& out);
+    static void renderHeap(BufferWriter& out);
+    static void renderStacks(BufferWriter& out);
+    static void renderCounters(BufferWriter& out);
+};
+
+// Records the enclosing scope's duration
+class MetricScope {
+public:
+    explicit MetricScope(MetricTimer timer) : _timer(timer), _start(Metrics::start()) {}
+    ~MetricScope() { Metrics::record(_timer, _start); }
+
+    MetricScope(const MetricScope&) = delete;
+    MetricScope& operator=(const MetricScope&) = delete;
+
+private:
+    MetricTimer _timer;
+    uint32_t _start;
+};
+
+#endif // METRICS_H
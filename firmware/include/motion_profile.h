@@ -0,0 +1,157 @@
+#ifndef MOTION_PROFILE_H
+#define MOTION_PROFILE_H
+
+#include <stdint.h>
+
+// Kinematics helpers for the motion task.
+// Positions are in servo encoder counts (4096 per revolution), velocities in
+// counts per second. Kept free of Arduino dependencies so the maths can be
+// exercised off-target.
+class MotionProfile {
+public:
+    // Signed travel between two raw encoder readings (0-4095), taking the short
+    // way round so a 4095 -> 0 wrap counts as +1, not -4095
+    static int32_t encoderDelta(int32_t previousRaw, int32_t currentRaw);
+
+    // Position at an edge seen seconds after a sample, extrapolated at velocity
+    static int32_t extrapolate(int32_t position, float velocity, float seconds);
+
+    // Convert an STS acceleration register value (unit: 100 steps/s^2) to counts/s^2.
+    // A register value of 0 means "no ramp" on the servo, returned as 0.
+    static float accelerationFromRegister(uint8_t acc);
+
+    // Distance travelled from the moment a stop is decided until the servo is at rest:
+    // the command latency at the current speed plus the servo's own deceleration ramp.
+    static int32_t stoppingDistance(float velocity, float acceleration, uint32_t latencyMs);
+
+    // Exponential moving average used to smooth the sampled velocity
+    static float smoothVelocity(float previous, float sample, float alpha);
+
+    // Speed command for a position-targeted move (trapezoidal profile).
+    // The servo's own acceleration ramp provides the rising edge; this returns
+    // the cruise speed until the remaining distance calls for braking, then
+    // follows v = sqrt(2 * a * d) down to minSpeed so the move lands without hunting.
+    static uint16_t approachSpeed(int32_t distance, uint16_t cruiseSpeed, float deceleration,
+                                  uint16_t minSpeed);
+
+    // Braking rate for the approach: a fraction of the servo ramp (counts/s^2),
+    // or MOTION_APPROACH_DEFAULT_DECEL when the ramp is disabled
+    static float approachDeceleration(float acceleration);
+
+    // One sample of a position-targeted move. distance is the travel left in the
+    // direction of motion, commanded the speed last sent (0 = none yet). Returns 0
+    // once the move should stop (arrived, passed it, or within stopDistance - it
+    // never reverses), otherwise the speed to drive at; small profile changes keep
+    // commanded so only meaningful updates go out on the bus.
+    static uint16_t approachCommand(int32_t distance, int32_t stopDistance, uint16_t cruiseSpeed,
+                                    float deceleration, uint16_t commanded);
+};
+
+// Home-relative position and velocity tracked from raw encoder samples.
+// The servo reports one revolution; wraps are unfolded by taking the short way
+// between consecutive samples, so the motion task must sample at least twice
+// per half revolution.
+class PositionTracker {
+public:
+    PositionTracker() { reset(0); }
+
+    // Restore a position (e.g. from storage). The next sample only seeds the
+    // encoder reading, so whatever angle the servo reports then is not counted
+    // as travel.
+    void reset(int32_t position);
+
+    // One encoder sample (0-4095) at nowMicros. Samples under 1 ms apart move
+    // the position but not the velocity; after a gap of 2 s or more the
+    // velocity restarts from 0.
+    void update(int32_t raw, uint32_t nowMicros);
+
+    // Move the origin to a position in the current frame (a confirmed home edge)
+    void rebase(int32_t origin) { _position -= origin; }
+
+    int32_t position() const { return _position; }
+    float velocity() const { return _velocity; }    // Smoothed counts/s
+
+private:
+    int32_t _position;
+    int32_t _lastRaw;
+    uint32_t _lastMicros;
+    float _velocity;
+    bool _seeded;
+};
+
+// Power-outage recovery: drive home until the hall sensor confirms it, then
+// return to the position the interrupted move was heading for.
+class HomingRecovery {
+public:
+    enum class Step : uint8_t {
+        NONE,               // Keep going
+        RETURN_TO_TARGET,   // Home found, start closing toward target()
+        DONE_AT_HOME,       // Home found and the target was home
+        DONE_AT_TARGET      // Back at target(); stop
+    };
+
+    void start(int32_t target);
+    void cancel() { _active = false; _returning = false; }
+
+    bool active() const { return _active; }
+    bool returning() const { return _returning; }
+    int32_t target() const { return _target; }
+
+    // One motion sample. homeFound is only looked at while homing; position
+    // and stopDistance only while returning.
+    Step sample(bool homeFound, int32_t position, int32_t stopDistance);
+
+private:
+    int32_t _target = 0;
+    bool _active = false;
+    bool _returning = false;
+};
+
+// Learned drive settings for one direction of travel
+struct DriveProfile {
+    uint16_t speed;         // Steps/s
+    uint8_t acceleration;   // STS register units (100 steps/s^2)
+};
+
+// Load and velocity monitor for one move, fed once per motion sample.
+// Detects a stall (the servo driving against an obstruction) within a few
+// samples and records the load the move needed, which adapt() turns into a
+// faster or gentler profile for the next move in the same direction.
+// Loads are STS ReadLoad() magnitudes in 0.1% of maximum torque.
+class LoadMonitor {
+public:
+    LoadMonitor();
+
+    // Start of a move. Stalls are not judged until the servo ramp has had
+    // rampMs (or MOTION_STALL_GRACE_MS, if longer) to bring it up to speed.
+    void reset(uint32_t rampMs = 0);
+
+    // One sample: elapsedMs since reset(), smoothed velocity (counts/s), the
+    // speed last commanded (0 while deliberately stopped) and the raw load.
+    // Returns true once the move is stalled.
+    bool sample(uint32_t elapsedMs, float velocity, uint16_t commandedSpeed, int load);
+
+    bool stalled() const { return _stalled; }
+    int peakRampLoad() const { return _peakRamp; }      // Smoothed, while accelerating
+    int peakCruiseLoad() const { return _peakCruise; }  // Smoothed, after the ramp
+    int load() const { return (int)_load; }
+
+    // Next profile after a completed (not stalled) move: step speed down when
+    // the cruise load ran high and back up toward maxSpeed when it ran light,
+    // and acceleration likewise from the ramp load. maxAcceleration 0 (no ramp
+    // on the servo) leaves acceleration alone.
+    static DriveProfile adapt(const DriveProfile& current, uint16_t maxSpeed, uint8_t maxAcceleration,
+                              int peakRampLoad, int peakCruiseLoad);
+
+private:
+    uint32_t _graceMs;
+    float _load;
+    int _peakRamp;
+    int _peakCruise;
+    uint8_t _stallSamples;
+    uint32_t _stillSinceMs;
+    bool _still;
+    bool _stalled;
+};
+
+#endif // MOTION_PROFILE_H
@@ -3,44 +3,89 @@
 
 #include <Arduino.h>
 #include <functional>
-
-// Callback for received commands
-using MqttCommandCallback = std::function<void(const String& command)>;
-
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include "config.h"
+#include "device_state.h"
+#include "command.h"
+
+// Callback for received commands (runs on the MQTT task)
+using MqttCommandCallback = std::function<void(const Command& command)>;
+
+// Broker connection, subscriptions and publishing run on their own task, so a
+// slow or unreachable broker (blocking TCP connect + CONNACK) never stalls
+// loop(). The public methods only hand work to that task and return at once.
 class MqttClient {
 public:
     MqttClient();
 
-    // Initialize with broker info
+    // Set broker info (starts the MQTT task on first use; connects in the background)
     void init(const String& broker, uint16_t port = 1883,
               const String& user = "", const String& password = "");
 
     // Connection management
-    bool connect();
-    void disconnect();
-    void disable();  // Disconnect and clear config (disables MQTT)
-    bool isConnected();
+    bool connect();     // Retry now instead of waiting for the backoff (false if not configured)
+    void disable();     // Disconnect and clear config (disables MQTT)
+    bool isConnected() const;
     bool isEnabled() const;  // Returns true if broker is configured
 
-    // Update loop (handles reconnection, message processing)
-    void update();
-
     // Set command callback
     void onCommand(MqttCommandCallback callback);
 
-    // Publish state updates
-    void publishState(const char* state);
-    void publishAvailability(bool online);
+    // Publish position and attributes from deviceState changes (call once during setup)
+    void attachState();
 
-    // Publish Home Assistant discovery config
-    void publishDiscovery();
+    // Queue a state edge (retained; oldest queued message is dropped when full)
+    void publishState(const char* state);
 
     // Get topic names (for external use)
     String getCommandTopic() const;
     String getStateTopic() const;
     String getAvailabilityTopic() const;
+    String getAttributesTopic() const;
+    static String getGroupCommandTopic(const String& group);
+
+    // Re-read group membership from storage and resubscribe on the MQTT task
+    // (safe to call from other tasks)
+    void reloadGroups();
+
+    // Validate a comma-separated group list; writes the lowercased,
+    // de-duplicated form to normalized. Empty input is valid (no groups).
+    static bool normalizeGroups(const String& groups, String& normalized);
+
+    // Wall clock in ms since the epoch; false until SNTP has synced
+    static bool getEpochMillis(int64_t& nowMs);
+
+    // Publish queue statistics
+    uint32_t getDroppedPublishes() const { return _droppedPublishes; }
+    uint32_t getReconnectAttempts() const { return _reconnectAttempts; }
 
 private:
+    enum class OutgoingTopic : uint8_t {
+        STATE
+    };
+
+    struct Outgoing {
+        OutgoingTopic topic;
+        bool retain;
+        char payload[MQTT_QUEUE_PAYLOAD_SIZE];
+    };
+
+    struct Settings {
+        String broker;
+        uint16_t port;
+        String user;
+        String password;
+    };
+
+    // Written by init()/disable(), applied by the task (guarded by _settingsMutex)
+    Settings _pending;
+    bool _settingsPending;
+    SemaphoreHandle_t _settingsMutex;
+
+    // Owned by the MQTT task
     String _broker;
     uint16_t _port;
     String _user;
@@ -51,20 +96,88 @@ private:
 
     String _commandTopic;
     String _stateTopic;
+    String _setPositionTopic;
+    String _logLevelTopic;
+    String _positionTopic;
+    int _lastPublishedPosition;
+    String _attributesTopic;
+    String _diagnosticsTopic;
     String _availabilityTopic;
     String _discoveryTopic;
 
+    // Blinds 1..n: <prefix>/blind<n>/{command,set_position,state,position}
+    String _blindTopicPrefix;
+    const char* _lastBlindState[BLIND_COUNT];
+    int _lastBlindPosition[BLIND_COUNT];
+
     bool _initialized;
     bool _discoveryPublished;
+    volatile bool _enabled;
+    volatile bool _connected;
+    volatile bool _connectRequested;
 
-    unsigned long _lastReconnectAttempt;
+    // Reconnect backoff (exponential with jitter)
+    unsigned long _nextAttempt;
+    volatile uint32_t _reconnectAttempts;
     unsigned long _lastHeartbeat;
 
+    String _subscribedGroups;           // Comma-separated, as subscribed
+    volatile bool _groupsChanged;
+
+    // Scheduled start (group facades move together)
+    Command _scheduledCommand;          // id NONE if nothing is pending
+    int64_t _scheduledAt;               // Epoch ms
+
+    // Telemetry: changes collected from dispatch(), published rate limited by the task
+    uint32_t _pendingChanges;           // Guarded by _changeMux
+    portMUX_TYPE _changeMux = portMUX_INITIALIZER_UNLOCKED;
+    uint32_t _telemetryDirty;
+    unsigned long _lastTelemetry;
+    char _attributesBuffer[MQTT_ATTRIBUTES_BUFFER_SIZE];
+    unsigned long _lastDiagnostics;
+    char _diagnosticsBuffer[MQTT_DIAGNOSTICS_BUFFER_SIZE];
+
+    QueueHandle_t _publishQueue;
+    volatile uint32_t _droppedPublishes;
+    TaskHandle_t _taskHandle;
+
     MqttCommandCallback _commandCallback;
 
+    void enqueue(OutgoingTopic topic, const char* payload, bool retain);
+    void wake();
+
+    static void mqttTask(void* arg);
+    void run();
+    void applySettings();
+    void maintainConnection();
+    void service();
+    bool connectToBroker();
+    void disconnectFromBroker();
+    void scheduleReconnect();
+    void drainPublishQueue();
+    void publishTelemetry();
+    void publishPosition(int percent);  // 0-100 (100 = open)
+    void publishAttributes(const DeviceStateSnapshot& state);
+    void publishAvailability(bool online);
+    void publishDiagnostics();          // Metrics summary every MQTT_DIAGNOSTICS_INTERVAL_MS
+    void publishDiscovery();
+    void publishBlinds(const DeviceStateSnapshot& state);
+
     void buildTopics();
-    String buildDiscoveryPayload();
+    String blindTopic(uint8_t blind, const char* leaf) const;
+    int parseBlindTopic(const char* topic, const char*& leaf) const;  // -1 if not a blind topic
+    String buildDiscoveryPayload(uint8_t blind);
     void onMessage(const char* topic, const uint8_t* payload, unsigned int length);
+    void subscribeGroups();
+    void unsubscribeGroups();
+    bool isGroupCommandTopic(const char* topic) const;
+    bool parseCommand(const char* data, size_t length, Command& command, int64_t& at);
+    void dispatchCommand(const Command& command, int64_t at);
+    void runScheduledCommand();
+    void deliver(const Command& command);   // Fans ALL_BLINDS out to every blind
+
+    // Command::blind of group commands: the whole facade moves, so every blind
+    static const uint8_t ALL_BLINDS = 0xFF;
 
     static MqttClient* _instance;
     static void messageCallback(char* topic, uint8_t* payload, unsigned int length);
@@ -0,0 +1,112 @@
+#ifndef OTA_DECODER_H
+#define OTA_DECODER_H
+
+#include <Arduino.h>
+
+// Uploaded OTA files are either a plain app image (first byte 0xE9) or a
+// packed container produced by merge_firmware.py:
+//
+//   OtaPackedHeader (32 bytes, little endian)
+//   zlib stream of either
+//     OTA_PACKED_FULL:  the app image
+//     OTA_PACKED_DELTA: patch ops against the running app partition
+//       0x01 COPY   u32 sourceOffset, u32 length   (bytes from the running image)
+//       0x02 INSERT u32 length, <length bytes>
+//       0x00 END
+//
+// The decoder turns either form into the app image and streams it into the
+// inactive OTA slot with Update.begin()/Update.write().
+
+#define OTA_PACKED_MAGIC 0x4F425346UL   // "FSBO"
+#define OTA_PACKED_VERSION 1
+#define OTA_IMAGE_MAGIC 0xE9            // ESP app image header byte
+
+enum OtaPackedType : uint8_t {
+    OTA_PACKED_FULL = 1,
+    OTA_PACKED_DELTA = 2
+};
+
+struct __attribute__((packed)) OtaPackedHeader {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t type;               // OtaPackedType
+    uint16_t flags;             // Reserved (0)
+    uint32_t imageSize;         // Size of the decoded app image
+    uint32_t imageCrc;          // CRC32 of the decoded app image
+    uint32_t baseSize;          // Delta: bytes of the running image the patch was made against
+    uint32_t baseCrc;           // Delta: CRC32 of those bytes
+    uint32_t reserved[2];
+};
+
+enum class OtaImageFormat : uint8_t {
+    UNKNOWN,                    // Nothing received yet
+    RAW,
+    PACKED_FULL,
+    PACKED_DELTA
+};
+
+class OtaImageDecoder {
+public:
+    OtaImageDecoder();
+    ~OtaImageDecoder();
+
+    // Start a new upload of uploadSize bytes
+    void reset(size_t uploadSize);
+
+    // Free decompression buffers (also done by reset)
+    void release();
+
+    // Feed uploaded bytes in order; false on any error (see errorString)
+    bool feed(const uint8_t* data, size_t length);
+
+    // Check that the whole image was produced and matches its CRC
+    bool finish();
+
+    OtaImageFormat format() const { return _format; }
+    const char* formatName() const;
+    size_t imageSize() const { return _imageSize; }
+    size_t written() const { return _written; }
+    const char* errorString() const { return _error; }
+
+private:
+    enum PatchState : uint8_t {
+        PATCH_OP,
+        PATCH_ARGS,
+        PATCH_INSERT,
+        PATCH_DONE
+    };
+
+    struct Work;                // Inflater state + dictionary, heap allocated
+
+    size_t _uploadSize;
+    OtaImageFormat _format;
+    OtaPackedHeader _header;
+    size_t _headerBytes;
+    Work* _work;
+    size_t _dictOffset;
+    bool _inflateDone;
+
+    size_t _imageSize;
+    size_t _written;
+    uint32_t _crc;
+
+    PatchState _patchState;
+    uint8_t _patchOp;
+    uint8_t _args[8];
+    uint8_t _argBytes;
+    uint8_t _argsNeeded;
+    uint32_t _insertRemaining;
+
+    const char* _error;
+
+    bool fail(const char* message);
+    bool startPacked();
+    bool verifyBase();
+    bool inflate(const uint8_t* data, size_t length);
+    bool consume(const uint8_t* data, size_t length);
+    bool applyPatch(const uint8_t* data, size_t length);
+    bool copyFromBase(uint32_t offset, uint32_t length);
+    bool emit(const uint8_t* data, size_t length);
+};
+
+#endif // OTA_DECODER_H
@@ -0,0 +1,145 @@
+#ifndef OTA_WRITER_H
+#define OTA_WRITER_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include "config.h"
+#include "ota_decoder.h"
+
+// Result of handing a received chunk to the writer
+enum OtaSubmitResult {
+    OTA_SUBMIT_QUEUED,          // Will be flashed in index order
+    OTA_SUBMIT_DUPLICATE,       // Already flashed or queued (client retry) - ignored
+    OTA_SUBMIT_OUT_OF_WINDOW,   // Too far ahead of the next chunk to be flashed
+    OTA_SUBMIT_FAILED           // Session ended or a flash write failed
+};
+
+// Result of asking the writer to finish the image
+enum OtaEndResult {
+    OTA_END_PENDING,            // Writer task is still flashing or verifying
+    OTA_END_DONE,               // Image verified and set as the boot partition
+    OTA_END_FAILED,             // Chunks missing, a write failed or verification failed
+    OTA_END_NO_SESSION
+};
+
+// Double-buffered flash writer for the chunked OTA protocol.
+// HTTP body callbacks fill RAM buffers (slots); a writer task decodes them
+// (see OtaImageDecoder) and flashes them strictly in chunk index order. Slots are tied to a
+// session number so buffers from an aborted session are never touched.
+class OtaWriter {
+public:
+    OtaWriter();
+
+    // Start a session (partition check + buffer allocation; Update.begin runs
+    // once the first chunk shows the image format). chunkSize and window
+    // return what was negotiated - smaller than configured if the heap is short.
+    // imageId is an optional client-chosen identifier (e.g. image CRC) used to
+    // match a later resume request.
+    bool begin(size_t totalSize, const char* imageId, size_t& chunkSize, uint8_t& window);
+
+    // True if the active session is for the same image, so a client that lost
+    // its connection can carry on from committed() / nextIndex()
+    bool canResume(size_t totalSize, const char* imageId) const;
+
+    // Ask the writer task to finish and verify the image once every queued
+    // chunk is flashed. Never blocks (called from async_tcp): PENDING until the
+    // task is done, then the same DONE or FAILED on every call.
+    OtaEndResult end();
+
+    // Cancel the session and free the buffers
+    void abort();
+
+    // Get a free buffer for an incoming chunk (-1 on timeout or no session)
+    int acquire(uint32_t timeoutMs, uint32_t& session);
+
+    // Buffer for an acquired slot (nullptr if the session has ended)
+    uint8_t* buffer(int slot, uint32_t session);
+
+    // Give an acquired slot back without queueing it
+    void release(int slot, uint32_t session);
+
+    // Queue a filled slot for flashing; the slot is consumed in every case
+    OtaSubmitResult submit(int slot, uint32_t session, uint32_t index, size_t length);
+
+    bool isActive() const { return _active; }
+    bool isFinishing() const { return _endState == END_REQUESTED; }
+    bool hasError() const { return _error; }
+    const char* errorString() const { return _errorString; }
+
+    size_t chunkCapacity() const { return _chunkSize; }
+    uint8_t window() const { return _window; }
+    size_t total() const { return _total; }
+    size_t received() const { return _received; }      // Accepted into the queue
+    size_t committed() const { return _committed; }    // Written to flash
+    uint32_t nextIndex() const { return _nextIndex; }  // Next chunk to be flashed
+
+    // Raw / compressed / delta detection and decoded image progress
+    const OtaImageDecoder& decoder() const { return _decoder; }
+
+private:
+    enum SlotState : uint8_t {
+        SLOT_FREE,
+        SLOT_FILLING,   // Owned by an HTTP request
+        SLOT_READY,     // Waiting for its turn to be flashed
+        SLOT_WRITING
+    };
+
+    enum EndState : uint8_t {
+        END_NONE,
+        END_REQUESTED,  // /ota/end seen, the writer task finishes once idle
+        END_DONE,
+        END_FAILED
+    };
+
+    struct Slot {
+        uint8_t* data;
+        size_t length;
+        uint32_t index;
+        SlotState state;
+    };
+
+    static constexpr int MAX_SLOTS = OTA_WINDOW + 1;  // Window plus the one being flashed
+
+    Slot _slots[MAX_SLOTS];
+    int _slotCount;
+    size_t _chunkSize;
+    uint8_t _window;
+    uint32_t _session;
+
+    volatile bool _active;
+    volatile bool _error;
+    volatile EndState _endState;
+    char _errorString[64];
+
+    size_t _total;
+    char _imageId[OTA_IMAGE_ID_LENGTH + 1];
+    volatile unsigned long _lastActivity;
+    volatile size_t _received;
+    volatile size_t _committed;
+    volatile uint32_t _nextIndex;
+
+    OtaImageDecoder _decoder;           // Only used from the writer task while active
+
+    TaskHandle_t _taskHandle;
+    SemaphoreHandle_t _freeSlots;       // Counts free slots
+    SemaphoreHandle_t _updateMutex;     // Serializes Update.* between the task and HTTP
+    portMUX_TYPE _mux;
+
+    bool allocateBuffers(size_t chunkSize, int count, size_t reserve);
+    void freeBuffers();
+    void resetSlots();
+    void setError(const char* message);
+    int findNextReady();
+    bool hasFillingSlot();
+    bool idle();
+    void finishRequested();
+    void expireIdleSession();
+    void closeSession(bool wasActive);
+
+    static void writerTask(void* arg);
+    void writeQueued();
+};
+
+#endif // OTA_WRITER_H
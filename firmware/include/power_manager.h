@@ -0,0 +1,66 @@
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <Arduino.h>
+#include <esp_pm.h>
+#include "config.h"
+
+enum class PowerMode : uint8_t {
+    PERFORMANCE,    // Radio always on, fixed 10 ms loop
+    BALANCED,       // Modem sleep (wakes for every DTIM beacon)
+    LOW_POWER,      // Balanced + light sleep and slow polling while idle
+    COUNT
+};
+
+// Idle power handling between movements.
+// Low power mode only relaxes once the blind has been stopped for
+// POWER_IDLE_AFTER_MS: loop() and servo polling slow down, and (when the core
+// is built with CONFIG_PM_ENABLE + tickless idle) the CPU light-sleeps between
+// DTIM beacons, woken by WiFi traffic, timers and the hall GPIO.
+class PowerManager {
+public:
+    PowerManager();
+
+    // Apply the stored mode; light sleep is never used while BLE is up
+    void init(bool allowLightSleep);
+
+    // Change mode (persists; safe from any task, idle settings follow on the next update())
+    bool setMode(PowerMode mode);
+    PowerMode getMode() const { return _mode; }
+
+    static const char* modeName(PowerMode mode);
+    static bool parseMode(const String& name, PowerMode& mode);
+
+    // Call once per loop pass with the time that pass took; returns the delay before the next
+    uint32_t update(uint32_t loopBusyMicros);
+
+    // Diagnostics
+    bool isIdle() const { return _idle; }
+    bool isLightSleepAvailable() const { return _lightSleepAvailable; }
+    bool isLightSleepActive() const { return _sleepAllowed; }
+    float getDutyCycle() const { return _dutyCycle; }   // % of wall time in loop work + motion samples
+
+private:
+    volatile PowerMode _mode;
+    volatile bool _modeChanged;
+
+    bool _idle;
+    unsigned long _lastActive;
+    bool _lightSleepAvailable;
+    bool _sleepAllowed;                 // NO_LIGHT_SLEEP lock released
+    esp_pm_lock_handle_t _sleepLock;
+
+    // Duty cycle window
+    unsigned long _windowStart;
+    uint32_t _loopBusyMicros;
+    uint32_t _motionBusyStart;
+    float _dutyCycle;
+
+    void applyWifiSleep();
+    void applyIdle();
+    void configureLightSleep();
+    void updateWake();
+    void updateDutyCycle(unsigned long now, uint32_t loopBusyMicros);
+};
+
+#endif // POWER_MANAGER_H
@@ -0,0 +1,64 @@
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "command.h"
+
+// On-device schedule rules and the calendar/sun maths behind them.
+// Text form is "[days] when command [blind=N]", rules separated by ';':
+//   "weekdays 07:30 OPEN", "sat,sun 09:00 POSITION:60", "sunset-20 CLOSE blind=1"
+// days: daily (default), weekdays, weekends, or a list/range of sun..sat
+// when: HH:MM local time, or sunrise/sunset with an optional +/- minute offset
+// Only motion commands are accepted. Kept free of Arduino dependencies so it
+// can be exercised off-target; local time follows the process TZ.
+enum class ScheduleTrigger : uint8_t {
+    TIME,
+    SUNRISE,
+    SUNSET
+};
+
+struct ScheduleRule {
+    uint8_t days = 0x7F;            // Bit per weekday, bit 0 = Sunday (struct tm tm_wday)
+    ScheduleTrigger trigger = ScheduleTrigger::TIME;
+    int16_t minutes = 0;            // TIME: after local midnight; SUNRISE/SUNSET: offset
+    Command command;                // Motion command and its blind
+};
+
+struct GeoLocation {
+    float latitude = 0.0f;          // Degrees, north positive
+    float longitude = 0.0f;         // Degrees, east positive
+    bool valid = false;
+};
+
+class Schedule {
+public:
+    static bool parseRule(const char* data, size_t length, ScheduleRule& out);
+
+    // ';'-separated list, all or nothing: the rule count, or -1 if any rule is
+    // invalid or there are more than maxRules
+    static int parseList(const char* data, size_t length, ScheduleRule* rules, int maxRules);
+
+    // Canonical text of a rule (lower-case days/when, upper-case command); returns buffer
+    static const char* format(const ScheduleRule& rule, char* buffer, size_t size);
+
+    // "latitude,longitude" in decimal degrees; "" is a valid, unset location
+    static bool parseLocation(const char* data, size_t length, GeoLocation& out);
+
+    // Sunrise or sunset (zenith 90.833 degrees) on a calendar date, in minutes
+    // after UTC midnight of that date (may fall outside 0-1439 far from
+    // Greenwich). False when the sun doesn't rise or set that day.
+    static bool sunEvent(int year, int month, int day, const GeoLocation& location,
+                         bool sunrise, int32_t& minutesUtc);
+
+    // First firing strictly after `after` (epoch seconds), searching a week ahead.
+    // False when none falls in that week (sun rules in polar day or night, or
+    // without a location).
+    static bool nextOccurrence(const ScheduleRule& rule, int64_t after, const GeoLocation& location,
+                               int64_t& at);
+
+    // Days since 1970-01-01 of a proleptic Gregorian date
+    static int64_t daysFromCivil(int year, int month, int day);
+};
+
+#endif // SCHEDULE_H
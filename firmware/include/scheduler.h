@@ -0,0 +1,69 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+#include <functional>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "config.h"
+#include "command.h"
+#include "schedule.h"
+
+using ScheduleCommandCallback = std::function<void(const Command& command)>;
+
+// Runs the stored schedule rules from the device clock, so blinds keep their
+// routine without a hub, broker or network once SNTP has set the time.
+// Each rule's next firing is cached; service() costs one comparison until the
+// earliest of them is due. Nothing fires before the clock is valid, and
+// events missed by more than SCHEDULE_LATE_LIMIT_S (reboot, long outage,
+// clock step) are skipped rather than replayed.
+class Scheduler {
+public:
+    Scheduler();
+
+    // Load rules, location and timezone from storage and apply TZ
+    void init();
+
+    void onCommand(ScheduleCommandCallback callback) { _commandCallback = callback; }
+
+    // Replace all rules (';'-separated, "" clears); persists the canonical text.
+    // False leaves the current rules untouched.
+    bool setRules(const String& rules, String& normalized);
+
+    // "lat,lon" ("" = unset) and a POSIX TZ string such as "CET-1CEST,M3.5.0,M10.5.0/3"
+    bool setLocation(const String& location, const String& timezone);
+
+    // Call from loop(); fires due rules through the command callback
+    void service();
+
+    // Snapshot for the API: rules and their next firing (epoch seconds, 0 = none
+    // this week or clock not set). Returns the rule count.
+    int getRules(ScheduleRule* rules, int64_t* next, int maxRules);
+    GeoLocation getLocation();
+
+    uint32_t getFiredCount() const { return _fired; }
+    uint32_t getSkippedCount() const { return _skipped; }
+
+    static bool isValidTimezone(const String& timezone);
+
+private:
+    ScheduleRule _rules[SCHEDULE_MAX_RULES];
+    int64_t _next[SCHEDULE_MAX_RULES];  // 0 = nothing within a week, recheck at _recheckAt
+    int _count;
+    GeoLocation _location;
+    int64_t _recheckAt;
+
+    volatile bool _dirty;               // Rules, location or clock changed; recompute all
+    volatile uint32_t _nextAt;          // Earliest _next/_recheckAt (epoch seconds)
+    uint32_t _fired;
+    uint32_t _skipped;
+
+    SemaphoreHandle_t _mutex;
+    ScheduleCommandCallback _commandCallback;
+
+    void recompute(int64_t now);
+    void updateNextAt();
+    static void applyTimezone(const String& timezone);
+};
+
+#endif // SCHEDULER_H
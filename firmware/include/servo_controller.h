@@ -2,6 +2,12 @@
 #define SERVO_CONTROLLER_H
 
 #include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include "config.h"
+#include "device_state.h"
+#include "motion_profile.h"
 
 // Forward declaration
 class HallSensor;
@@ -37,24 +43,52 @@ class ServoController {
 public:
     ServoController();
 
-    // Initialize the servo controller
-    bool init(uint8_t servoId = 1, int rxPin = 20, int txPin = 21);
+    // Initialize the servo controller (opens the bus; the servo is pinged
+    // asynchronously by the motion task, so isConnected() is false until then).
+    // blind selects this controller's storage slot (0..BLIND_COUNT-1); all
+    // controllers share the one bus, mutex and motion task.
+    bool init(uint8_t servoId = 1, int rxPin = 20, int txPin = 21, uint8_t blind = 0);
+    uint8_t getBlind() const { return _blind; }
+
+    // Controller of a blind, nullptr until its startTask() has run
+    static ServoController* forBlind(uint8_t blind);
+    static bool anyMoving();
 
     // Set hall sensor and storage references (must be called after init)
     void setHallSensor(HallSensor* sensor);
+    HallSensor* getHallSensor() const { return _hallSensor; }
     void setStorage(Storage* storage);
 
+    // Start the motion control task (call once after init/setHallSensor/setStorage)
+    // The task samples position at MOTION_SAMPLE_INTERVAL_MS while moving and
+    // handles limits, calibration and recovery independently of loop(). The
+    // first call creates the task; later blinds join its round-robin schedule.
+    bool startTask();
+
+    // Connection check period while stopped, all blinds (commands and hall edges still wake the task)
+    static void setIdleInterval(uint32_t intervalMs);
+
+    // Time the motion task has spent sampling, in microseconds (wraps)
+    static uint32_t getBusyMicros() { return _busyMicros; }
+
     // Basic commands (force bypasses calibration limits)
     void open(bool force = false);
     void close(bool force = false);
     void stop();
 
+    // Position-targeted moves (require calibration)
+    // Cumulative position: 0 = home (open), maxPosition = bottom (closed)
+    // Percent follows Home Assistant: 100 = fully open, 0 = fully closed
+    bool moveToPosition(int32_t target);
+    bool moveToPercent(uint8_t percent);
+
     // Execute a command
     void execute(BlindCommand command);
 
     // State getters
     BlindState getState() const;
     const char* getStateString() const;
+    bool isMoving() const;
 
     // Servo status
     bool isConnected() const;
@@ -63,6 +97,9 @@ public:
     int getVoltage() const;
     int getTemperature() const;
 
+    // Latest cached telemetry sample (never touches the bus)
+    ServoTelemetry getTelemetry() const;
+
     // Calibration
     void startCalibration();
     void setBottomPosition();
@@ -75,9 +112,14 @@ public:
     int32_t getCumulativePosition() const;
     int32_t getMaxPosition() const;
     bool isCalibrated() const;
+    int getPositionPercent() const;  // 0-100 (100 = open), -1 if not calibrated
+    bool hasTarget() const;
+    int32_t getTargetPosition() const;
+    float getVelocity() const;  // Smoothed velocity in counts/s
 
-    // Update loop (call regularly)
-    void update();
+    // Stall detection and the learned per-direction drive profile
+    uint32_t getStallCount() const { return _stallCount; }
+    DriveProfile getDriveProfile(bool closing) const;
 
     // Set servo ID (for multi-servo setups)
     void setServoId(uint8_t id);
@@ -97,6 +139,7 @@ public:
     bool isRecovering() const;
 
 private:
+    uint8_t _blind;
     uint8_t _servoId;
     BlindState _state;
     bool _initialized;
@@ -107,7 +150,23 @@ private:
     bool _invertDirection;     // True for right-hand mount
 
     int _currentPosition;      // Raw servo position 0-4095
-    int _targetPosition;
+
+    // Position-targeted move
+    bool _hasTarget;
+    int32_t _targetPosition;   // Cumulative target position
+    uint16_t _commandedSpeed;  // Last profile speed sent to the servo
+
+    // Current move: speed/acceleration from the learned profile of its direction
+    uint16_t _moveSpeed;
+    uint8_t _moveAcceleration;
+    bool _moveClosing;
+    bool _moveActive;          // Load monitored and learned from when it ends
+    LoadMonitor _loadMonitor;
+    uint32_t _stallCount;
+
+    // Telemetry cache (written by the motion task, read from HTTP/MQTT tasks)
+    ServoTelemetry _telemetry;
+    mutable portMUX_TYPE _telemetryMux = portMUX_INITIALIZER_UNLOCKED;
 
     unsigned long _lastUpdateTime;
     unsigned long _movementStartTime;
@@ -118,8 +177,7 @@ private:
     CalibrationState _calibrationState;
     bool _calibrated;
     int32_t _maxPosition;           // Maximum position (bottom limit)
-    int32_t _cumulativePosition;    // Tracked position across rotations
-    int _lastRawPosition;           // For detecting wrap-around
+    PositionTracker _tracker;       // Position across rotations and smoothed velocity
     unsigned long _lastPositionSaveTime;
 
     // Movement timeout (stop if no position change detected)
@@ -130,16 +188,51 @@ private:
     // Power outage recovery
     bool _needsRecovery;                // Flag set on boot if recovery needed
     int32_t _recoveryTargetPosition;    // Position to return to after re-homing
-    bool _recoveryReturning;            // True when returning to target after home
+    HomingRecovery _recovery;           // Re-home, then return to the target
+
+    // Motion task (one for the bus, sampling each registered blind when it is due)
+    static ServoController* _blinds[BLIND_COUNT];
+    static TaskHandle_t _taskHandle;
+    static SemaphoreHandle_t _mutex;    // Recursive, shared by all blinds - commands arrive from
+                                        // HTTP, MQTT and BLE tasks and the bus is half duplex
+    TickType_t _nextSample;
+    unsigned long _lastTraceTime;
+    bool _settling;                     // Stop issued, waiting for the servo to come to rest
+    bool _hallStopIssued;               // Servo stopped on a hall edge that is still being debounced
+
+    static volatile uint32_t _idleIntervalMs;
+    static volatile uint32_t _busyMicros;
+
+    // Boot probe (motion task)
+    bool _probePending;
+    int _probeAttempts;
+    unsigned long _probeStart;
+    unsigned long _lastProbe;
+    bool _wheelMode;                    // WheelMode() has been sent
+    bool _recoveryDeferred;             // startRecovery() arrived before the probe finished
+
+    static void motionTask(void* param);
+    void wakeTask();
 
     // Internal methods
+    void update();                      // One motion sample (run by the motion task)
+    void probe(unsigned long now);      // Boot ping/WheelMode, one attempt per call when due
     void checkPowerOutageRecovery();    // Called during setStorage()
     void updateState();
-    bool pingServo();
-    void readServoStatus();
+    int32_t stopDistance() const;       // Travel until at rest from the current velocity
+    bool limitAhead(int32_t remaining) const;
+    bool checkHomeEdge();               // True once a hall edge is confirmed and home re-based
+    void updateApproach();              // Advance the target move profile by one sample
+    void publishState();                // Push motion/servo state to deviceState
+    BlindState restingState() const;    // OPEN/CLOSED at the limits, otherwise STOPPED
+    void checkSettled();
+    bool readServoStatus();             // Bulk telemetry read, returns false on bus error
     void updateCumulativePosition();
     void checkCalibrationLimits();
     void savePositionIfNeeded();
+    void beginMove(bool closing);       // Pick the direction's profile, reset the load monitor
+    void endMove();                     // Adapt the direction's profile from the finished move
+    bool checkStall();                  // Stops and returns true when the move has stalled
 };
 
 // Helper function to convert state to string
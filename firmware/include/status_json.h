@@ -0,0 +1,33 @@
+#ifndef STATUS_JSON_H
+#define STATUS_JSON_H
+
+#include <stdint.h>
+#include "buffer_writer.h"
+#include "device_snapshot.h"
+
+// SSE backpressure counters of one connected client
+struct SseClientStats {
+    uint16_t queueDepth;
+    uint16_t maxQueueDepth;
+    uint32_t coalesced;         // Updates superseded by a later one
+    uint32_t dropped;           // Updates skipped with the queue at the limit
+};
+
+// The /status document, also sent as the SSE keyframe. It holds only
+// published state, so the state generation can serve as its ETag; uptime,
+// telemetry samples and SSE counters go in the separate runtime block of
+// /info. Kept free of Arduino dependencies so the bytes the device serves can
+// be checked and benchmarked off-target.
+class StatusJson {
+public:
+    // False if the document did not fit
+    static bool render(BufferWriter& out, const DeviceStateSnapshot& state);
+
+    // coalesced/dropped are the totals of clients that have disconnected; the
+    // connected ones are added in. False if the block did not fit.
+    static bool renderRuntime(BufferWriter& out, const DeviceStateSnapshot& state,
+                              const SseClientStats* clients, int clientCount,
+                              uint32_t coalesced, uint32_t dropped, unsigned long uptime);
+};
+
+#endif // STATUS_JSON_H
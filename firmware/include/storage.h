@@ -2,17 +2,45 @@
 #define STORAGE_H
 
 #include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "config.h"
+#include "motion_profile.h"
+
+// Per-blind settings (blind 0 uses the original single-blind NVS keys)
+struct BlindConfig {
+    uint8_t servoId;
+    bool rightMount;
+    uint16_t servoSpeed;
+    int32_t maxPosition;
+    bool calibrated;
+    DriveProfile drive[2];      // Learned [opening, closing] profile, speed 0 = not learned yet
+};
 
 // Configuration structure stored in NVS
 struct DeviceConfig {
-    char wifiSsid[64];
-    char wifiPassword[64];
-    char deviceName[32];
-    char mqttBroker[64];
-    char mqttUser[32];
-    char mqttPassword[64];
+    char wifiSsid[WIFI_SSID_MAX_LENGTH + 1];
+    char wifiPassword[WIFI_PASSWORD_MAX_LENGTH + 1];
+    char deviceName[DEVICE_NAME_MAX_LENGTH + 1];
+    char mqttBroker[MQTT_BROKER_MAX_LENGTH + 1];
+    char mqttUser[MQTT_USER_MAX_LENGTH + 1];
+    char mqttPassword[MQTT_PASSWORD_MAX_LENGTH + 1];
+    char devicePassword[DEVICE_PASSWORD_MAX_LENGTH + 1];
+    char logLevels[128];
+    char mqttGroups[128];
+    char staticIp[72];
+    char schedule[SCHEDULE_SPEC_SIZE];
+    char location[40];
+    char timezone[SCHEDULE_TIMEZONE_SIZE];
     uint16_t mqttPort;
-    uint8_t servoId;
+
+    // Device settings
+    bool setupComplete;
+    uint8_t powerMode;
+    bool autoHome;
+
+    // Servo, orientation and calibration of each blind
+    BlindConfig blinds[BLIND_COUNT];
 
     // Default constructor
     DeviceConfig() {
@@ -22,8 +50,27 @@ struct DeviceConfig {
         memset(mqttBroker, 0, sizeof(mqttBroker));
         memset(mqttUser, 0, sizeof(mqttUser));
         memset(mqttPassword, 0, sizeof(mqttPassword));
+        memset(devicePassword, 0, sizeof(devicePassword));
+        memset(logLevels, 0, sizeof(logLevels));
+        memset(mqttGroups, 0, sizeof(mqttGroups));
+        memset(staticIp, 0, sizeof(staticIp));
+        memset(schedule, 0, sizeof(schedule));
+        memset(location, 0, sizeof(location));
+        memset(timezone, 0, sizeof(timezone));
         mqttPort = 1883;
-        servoId = 1;
+        setupComplete = false;
+        powerMode = POWER_MODE_DEFAULT;
+        autoHome = false;
+
+        const uint8_t servoIds[BLIND_MAX_COUNT] = BLIND_SERVO_IDS;
+        for (int i = 0; i < BLIND_COUNT; i++) {
+            blinds[i].servoId = servoIds[i];
+            blinds[i].rightMount = false;
+            blinds[i].servoSpeed = SERVO_SPEED;
+            blinds[i].maxPosition = 0;
+            blinds[i].calibrated = false;
+            memset(blinds[i].drive, 0, sizeof(blinds[i].drive));
+        }
     }
 
     bool hasWifiCredentials() const {
@@ -35,6 +82,41 @@ struct DeviceConfig {
     }
 };
 
+// Power outage recovery record, persisted as a single NVS blob so position,
+// target and moving flag are always written (and read back) together
+struct MotionRecord {
+    uint8_t version;
+    uint8_t flags;          // MOTION_RECORD_FLAG_*
+    uint16_t reserved;
+    int32_t position;       // Cumulative position
+    int32_t target;         // Target position of the last move
+    uint32_t writeCount;    // Lifetime writes of this record (wear indicator)
+    uint32_t checksum;      // CRC32 over the preceding fields
+};
+
+// Last successful WiFi association, persisted for fast reconnects.
+// Addresses are IPAddress values (uint32_t, network byte order); 0 = none.
+struct WifiFastRecord {
+    uint8_t version;
+    uint8_t channel;
+    uint8_t bssid[6];
+    uint32_t ip;
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+    uint32_t checksum;      // CRC32 over the preceding fields
+};
+
+// NVS write statistics
+struct StorageStats {
+    uint32_t nvsWrites;             // All NVS writes this boot
+    uint32_t motionWrites;          // Motion record flushes this boot
+    uint32_t motionWritesLifetime;  // Motion record flushes across reboots (all blinds)
+    uint32_t coalescedUpdates;      // Motion updates absorbed by the cache
+    uint32_t writesThisHour;        // Motion record flushes in the current wear window
+    bool wearLimited;               // Hourly budget exhausted - flushing at backoff interval
+};
+
 class Storage {
 public:
     Storage();
@@ -43,10 +125,15 @@ public:
     bool init();
 
     // Load/save entire config
+    // All settings are read from NVS once in init() and served from a RAM
+    // snapshot; setters write NVS and update the snapshot on success. Strings
+    // longer than their snapshot field are refused (false), never truncated.
     bool loadConfig(DeviceConfig& config);
     bool saveConfig(const DeviceConfig& config);
 
     // Individual value getters/setters
+    // Settings taking a blind index (0..BLIND_COUNT-1) are kept per blind;
+    // callers validate the index
     String getWifiSsid();
     String getWifiPassword();
     String getDeviceName();
@@ -54,40 +141,82 @@ public:
     String getMqttUser();
     String getMqttPassword();
     uint16_t getMqttPort();
-    uint8_t getServoId();
+    uint8_t getServoId(uint8_t blind = 0);
 
     bool setWifiCredentials(const String& ssid, const String& password);
     bool setDeviceName(const String& name);
     bool setDevicePassword(const String& password);
     String getDevicePassword();
+    bool hasDevicePassword();
+    bool checkDevicePassword(const String& candidate);  // True if none set or it matches
     bool setMqttConfig(const String& broker, uint16_t port = 1883,
                        const String& user = "", const String& password = "");
-    bool setServoId(uint8_t id);
+    bool setServoId(uint8_t id, uint8_t blind = 0);
 
     // Calibration data
-    int32_t getMaxPosition();
-    bool setMaxPosition(int32_t pos);
-    int32_t getCurrentPosition();
-    bool setCurrentPosition(int32_t pos);
-    bool isCalibrated();
-    bool setCalibrated(bool cal);
+    int32_t getMaxPosition(uint8_t blind = 0);
+    bool setMaxPosition(int32_t pos, uint8_t blind = 0);
+    int32_t getCurrentPosition(uint8_t blind = 0);
+    bool setCurrentPosition(int32_t pos, uint8_t blind = 0);
+    bool isCalibrated(uint8_t blind = 0);
+    bool setCalibrated(bool cal, uint8_t blind = 0);
     bool getAutoHome();
     bool setAutoHome(bool val);
 
     // Power outage recovery
-    bool getWasMoving();
-    bool setWasMoving(bool moving);
-    int32_t getTargetPosition();
-    bool setTargetPosition(int32_t pos);
+    // Position, target and moving flag are cached in RAM and written behind
+    // as one record per blind by flush(); setters never touch flash directly
+    bool getWasMoving(uint8_t blind = 0);
+    bool setWasMoving(bool moving, uint8_t blind = 0);
+    int32_t getTargetPosition(uint8_t blind = 0);
+    bool setTargetPosition(int32_t pos, uint8_t blind = 0);
+
+    // Write dirty cached values to NVS (call from the main loop, off the motion path)
+    // force writes immediately regardless of interval and wear budget; call it
+    // with force before ESP.restart(), nothing flushes from the shutdown path
+    void flush(bool force = false);
+    StorageStats getStats();
 
     // Device orientation (for servo direction)
-    String getOrientation();  // Returns "left" or "right"
-    bool setOrientation(const String& orientation);
-    bool isRightMount();  // Convenience method
+    String getOrientation(uint8_t blind = 0);  // Returns "left" or "right"
+    bool setOrientation(const String& orientation, uint8_t blind = 0);
+    bool isRightMount(uint8_t blind = 0);  // Convenience method
 
     // Servo speed (0-4095)
-    uint16_t getServoSpeed();
-    bool setServoSpeed(uint16_t speed);
+    uint16_t getServoSpeed(uint8_t blind = 0);
+    bool setServoSpeed(uint16_t speed, uint8_t blind = 0);  // Also restarts profile learning
+
+    // Learned drive profile per direction (cached; a change is written behind by flush())
+    DriveProfile getDriveProfile(bool closing, uint8_t blind = 0);
+    bool setDriveProfile(const DriveProfile& profile, bool closing, uint8_t blind = 0);
+
+    // Power mode (PowerMode value)
+    uint8_t getPowerMode();
+    bool setPowerMode(uint8_t mode);
+
+    // Runtime log levels (Logger::applyLevels spec)
+    String getLogLevels();
+    bool setLogLevels(const String& spec);
+
+    // MQTT group membership (comma-separated, see MqttClient::normalizeGroups)
+    String getMqttGroups();
+    bool setMqttGroups(const String& groups);
+
+    // WiFi fast reconnect record (cached in RAM; writes are skipped when unchanged)
+    bool getWifiFastRecord(WifiFastRecord& record);
+    bool setWifiFastRecord(const WifiFastRecord& record);
+    void clearWifiFastRecord();
+
+    // Static IP "ip,gateway,subnet[,dns]" (empty = DHCP)
+    String getStaticIp();
+    bool setStaticIp(const String& spec);
+
+    // On-device schedule: rule list (Schedule::parseList text), "lat,lon" and POSIX TZ
+    String getSchedule();
+    bool setSchedule(const String& rules);
+    String getLocation();
+    String getTimezone();
+    bool setLocation(const String& location, const String& timezone);
 
     // Setup state (BLE is only enabled until setup is complete)
     bool isSetupComplete();
@@ -106,6 +235,43 @@ public:
 private:
     bool _initialized;
 
+    // RAM snapshot of all settings (guarded by _configMutex)
+    DeviceConfig _config;
+    SemaphoreHandle_t _configMutex;
+
+    void loadCache();
+    void lockConfig();
+    void unlockConfig();
+    String cachedString(const char* value);
+
+    // Write-behind motion record of one blind
+    struct MotionSlot {
+        MotionRecord record;
+        bool dirty;
+        bool urgent;            // Moving flag changed - flush on the next call
+        unsigned long lastFlush;
+    };
+
+    MotionSlot _motion[BLIND_COUNT];
+    unsigned long _wearWindowStart;     // The wear budget is shared by all blinds
+    StorageStats _stats;
+    portMUX_TYPE _motionMux = portMUX_INITIALIZER_UNLOCKED;
+
+    void loadMotionRecord(uint8_t blind);
+    bool writeMotionRecord(const MotionRecord& record, uint8_t blind);
+    void flushMotion(uint8_t blind, unsigned long now, bool force);
+    void markMotionDirty(bool urgent, uint8_t blind);
+
+    bool _driveDirty[BLIND_COUNT];      // Learned drive profile awaiting flush()
+    void flushDriveProfile(uint8_t blind);
+    static uint32_t motionChecksum(const MotionRecord& record);
+
+    // WiFi fast reconnect record
+    WifiFastRecord _wifiFast;
+    bool _wifiFastValid;
+
+    void loadWifiFastRecord();
+
     // Internal helper methods
     String getString(const char* key, const char* defaultValue = "");
     bool setString(const char* key, const String& value);
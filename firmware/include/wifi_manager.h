@@ -3,6 +3,7 @@
 
 #include <Arduino.h>
 #include <functional>
+#include <IPAddress.h>
 
 // WiFi connection state
 enum class WifiState {
@@ -54,6 +55,14 @@ public:
     String getHostname() const;
     void setHostname(const String& hostname);
 
+    // How the last connection was made (for diagnostics)
+    bool wasFastConnect() const { return _lastConnectFast; }
+    unsigned long getLastConnectMs() const { return _lastConnectMs; }
+
+    // Parse "ip,gateway,subnet[,dns]" (dns defaults to the gateway)
+    static bool parseStaticIp(const String& spec, IPAddress& ip, IPAddress& gateway,
+                              IPAddress& subnet, IPAddress& dns);
+
 private:
     WifiState _state;
     String _ssid;
@@ -61,6 +70,7 @@ private:
     String _hostname;
 
     unsigned long _connectStartTime;
+    unsigned long _lastRssiPublish;
     unsigned long _lastReconnectAttempt;
     int _reconnectAttempts;
 
@@ -70,8 +80,27 @@ private:
 
     bool _isInitialConnection;  // True during first connection attempt after credentials set
 
+    // Fast reconnect
+    bool _fastAttempt;          // Current attempt targets the remembered BSSID/channel
+    bool _leaseReused;          // Address came from the record, DHCP not yet started
+    bool _leaseConfirming;      // DHCP running on the reused address, waiting for the ACK
+    bool _dhcpInPlace = false;  // lwIP client started outside esp_netif (stop before reconfiguring)
+    bool _lastConnectFast;
+    unsigned long _attemptStartTime;    // Unlike _connectStartTime, kept across the fallback
+    unsigned long _connectedAt;
+    unsigned long _lastConnectMs;
+    bool _mdnsStarted;
+
+    void begin();               // Fast path when a record exists, else full connect
+    void beginFull();
+    bool applyStaticIp();       // True if a static IP is configured (and applied)
+    void saveFastRecord();
+    void startLeaseConfirm();   // DHCP on the reused address without dropping it
+    void stopLeaseConfirm();
+    void startMdns();
     void handleConnectionResult();
     void startReconnect();
+    void publishState();  // Push connection info to deviceState
 };
 
 #endif // WIFI_MANAGER_H
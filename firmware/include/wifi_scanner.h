@@ -0,0 +1,58 @@
+#ifndef WIFI_SCANNER_H
+#define WIFI_SCANNER_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// One network in the scan cache
+struct WifiScanEntry {
+    char ssid[33];
+    uint32_t hash;          // FNV-1a of ssid, compared before the string
+    int8_t rssi;
+    uint8_t channel;
+    bool encrypted;
+    bool pending;           // Not yet streamed to the client
+};
+
+// Non-blocking WiFi scan for BLE provisioning.
+// Channels are scanned one at a time with the async scanNetworks(), so loop()
+// keeps running and results can be streamed as each channel completes.
+// Networks are merged by SSID into a fixed table (strongest reading kept),
+// which doubles as a cache: a request within WIFI_SCAN_CACHE_TTL_MS of the
+// last completed scan replays it instead of scanning again.
+class WifiScanner {
+public:
+    WifiScanner();
+
+    // Start scanning (or replay the cache while it is fresh)
+    void start();
+
+    // Collect finished channels and start the next one (call from loop)
+    void update();
+
+    bool isScanning() const { return _scanning; }
+    int count() const { return _count; }
+
+    // Compact JSON page of results not yet sent, at most size - 1 bytes:
+    //   {"i":<page>,"n":[{"s":"SSID","r":-65,"e":1},...],"d":<1 on the last page>}
+    // Returns 0 when there is nothing to send right now.
+    size_t nextPage(char* buffer, size_t size);
+
+private:
+    WifiScanEntry _entries[WIFI_SCAN_MAX_NETWORKS];
+    int _count;
+
+    bool _scanning;
+    bool _streaming;            // A client is waiting for pages
+    uint8_t _channel;
+    uint16_t _page;
+    unsigned long _channelStart;
+    unsigned long _completedAt;
+    bool _hasCache;
+
+    void startChannel();
+    void finish();
+    void merge(const uint8_t* ssid, int rssi, uint8_t channel, bool encrypted);
+};
+
+#endif // WIFI_SCANNER_H
@@ -2,7 +2,17 @@ Import("env")
 import re
 import os
 import shutil
+import struct
 import subprocess
+import zlib
+
+# Packed OTA container (see include/ota_decoder.h)
+OTA_PACKED_MAGIC = 0x4F425346  # "FSBO"
+OTA_PACKED_VERSION = 1
+OTA_PACKED_FULL = 1
+OTA_PACKED_DELTA = 2
+DELTA_BLOCK = 32      # Minimum match length for a COPY op
+DELTA_INDEX_STEP = 16 # Base offsets indexed (matches >= BLOCK + STEP are always found)
 
 def get_firmware_version():
     """Extract FIRMWARE_VERSION from config.h"""
@@ -30,6 +40,102 @@ def rename_app_firmware(source, target, env):
         size = os.path.getsize(firmware_dst)
         print(f"Created app-firmware-{version}.bin: {size:,} bytes")
 
+def pack_image(kind, image, payload, base=b""):
+    """Wrap a zlib-compressed payload in the header the device decoder expects"""
+    header = struct.pack("<IBBHIIII8x", OTA_PACKED_MAGIC, OTA_PACKED_VERSION, kind, 0,
+                         len(image), zlib.crc32(image) & 0xFFFFFFFF,
+                         len(base), zlib.crc32(base) & 0xFFFFFFFF if base else 0)
+    return header + zlib.compress(payload, 9)
+
+def make_delta_ops(base, image):
+    """COPY/INSERT ops that rebuild image from base (greedy block matching)"""
+    index = {}
+    for offset in range(0, len(base) - DELTA_BLOCK + 1, DELTA_INDEX_STEP):
+        index.setdefault(base[offset:offset + DELTA_BLOCK], offset)
+
+    ops = bytearray()
+    pending = bytearray()
+
+    def flush_insert():
+        if pending:
+            ops.extend(b"\x02" + struct.pack("<I", len(pending)) + pending)
+            pending.clear()
+
+    i = 0
+    n = len(image)
+    while i < n:
+        src = index.get(image[i:i + DELTA_BLOCK]) if i + DELTA_BLOCK <= n else None
+        if src is None:
+            pending.append(image[i])
+            i += 1
+            continue
+
+        # Grow the match backwards into pending literals, then forwards
+        back = 0
+        while back < len(pending) and src - back > 0 and base[src - back - 1] == image[i - back - 1]:
+            back += 1
+        if back:
+            del pending[-back:]
+        start_src, start = src - back, i - back
+
+        length = DELTA_BLOCK + back
+        while start + length + 64 <= n and start_src + length + 64 <= len(base) and \
+                image[start + length:start + length + 64] == base[start_src + length:start_src + length + 64]:
+            length += 64
+        while start + length < n and start_src + length < len(base) and \
+                image[start + length] == base[start_src + length]:
+            length += 1
+
+        flush_insert()
+        ops.extend(b"\x01" + struct.pack("<II", start_src, length))
+        i = start + length
+
+    flush_insert()
+    ops.extend(b"\x00")
+    return bytes(ops)
+
+def packed_firmware_action(source, target, env):
+    """Create compressed and delta OTA packages next to app-firmware-{version}.bin"""
+    build_dir = env.subst("$BUILD_DIR")
+    version = get_firmware_version()
+    firmware = os.path.join(build_dir, "firmware.bin")
+    if not os.path.exists(firmware):
+        return
+
+    with open(firmware, "rb") as f:
+        image = f.read()
+
+    compressed = os.path.join(build_dir, f"app-firmware-{version}-compressed.bin")
+    with open(compressed, "wb") as f:
+        f.write(pack_image(OTA_PACKED_FULL, image, image))
+    print(f"Created {os.path.basename(compressed)}: {os.path.getsize(compressed):,} bytes")
+
+    # Deltas from older app images left in the build dir, plus any listed in
+    # OTA_DELTA_BASE (os.pathsep separated paths)
+    bases = []
+    pattern = re.compile(r"^app-firmware-(.+)\.bin$")
+    for name in sorted(os.listdir(build_dir)):
+        match = pattern.match(name)
+        if match and match.group(1) != version and not name.endswith("-compressed.bin"):
+            bases.append((match.group(1), os.path.join(build_dir, name)))
+    for path in filter(None, os.environ.get("OTA_DELTA_BASE", "").split(os.pathsep)):
+        match = pattern.match(os.path.basename(path))
+        bases.append((match.group(1) if match else os.path.splitext(os.path.basename(path))[0], path))
+
+    for base_version, path in bases:
+        try:
+            with open(path, "rb") as f:
+                base = f.read()
+        except OSError as e:
+            print(f"Warning: Could not read delta base {path}: {e}")
+            continue
+        if base == image:
+            continue
+        delta = os.path.join(build_dir, f"app-delta-{base_version}-to-{version}.bin")
+        with open(delta, "wb") as f:
+            f.write(pack_image(OTA_PACKED_DELTA, image, make_delta_ops(base, image), base))
+        print(f"Created {os.path.basename(delta)}: {os.path.getsize(delta):,} bytes")
+
 def merge_bin_action(source, target, env):
     """Post-build action to create a merged firmware binary for initial setup"""
     build_dir = env.subst("$BUILD_DIR")
@@ -60,10 +166,12 @@ def merge_bin_action(source, target, env):
         print(f"Created setup-firmware-{version}.bin: {size:,} bytes")
         print(f"\nBuild outputs in {build_dir}:")
         print(f"  - app-firmware-{version}.bin    (for OTA updates)")
+        print(f"  - app-firmware-{version}-compressed.bin / app-delta-*-to-{version}.bin  (smaller OTA uploads)")
         print(f"  - setup-firmware-{version}.bin  (for initial device setup)")
     else:
         print(f"Error creating merged firmware: {result.stderr}")
 
 # Register post-build actions
 env.AddPostAction("$BUILD_DIR/firmware.bin", rename_app_firmware)
+env.AddPostAction("$BUILD_DIR/firmware.bin", packed_firmware_action)
 env.AddPostAction("$BUILD_DIR/firmware.bin", merge_bin_action)
@@ -364,10 +364,17 @@ void BleProvisioning::onWifiScanRequest(BleWifiScanCallback callback) {
     _wifiScanCallback = callback;
 }
 
-void BleProvisioning::setWifiScanResults(const String& results) {
+void BleProvisioning::notifyWifiScanResults(const char* data, size_t length) {
     if (!_initialized || !pCharWifiScanResults) return;
 
-    LOG_BLE("Setting WiFi scan results: %s", results.c_str());
-    pCharWifiScanResults->setValue(results.c_str());
+    LOG_DEBUG(BLE, "WiFi scan results (%u bytes): %s", (unsigned)length, data);
+    pCharWifiScanResults->setValue((uint8_t*)data, length);
     pCharWifiScanResults->notify();
 }
+
+size_t BleProvisioning::getNotifyPayloadSize() const {
+    if (!pServer || pServer->getConnectedCount() == 0) return 0;
+
+    uint16_t mtu = pServer->getPeerMTU(pServer->getConnId());
+    return mtu > 3 ? mtu - 3 : 0;
+}
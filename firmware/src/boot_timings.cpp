@@ -0,0 +1,49 @@
+#include "boot_timings.h"
+#include <string.h>
+
+BootTimings::Phase BootTimings::_phases[BOOT_MAX_PHASES];
+size_t BootTimings::_count = 0;
+bool BootTimings::_production = false;
+portMUX_TYPE BootTimings::_mux = portMUX_INITIALIZER_UNLOCKED;
+
+void BootTimings::setProductionMode(bool production) {
+    _production = production;
+}
+
+bool BootTimings::isProductionMode() {
+    return _production;
+}
+
+void BootTimings::mark(const char* phase) {
+    uint32_t now = millis();
+
+    portENTER_CRITICAL(&_mux);
+    bool seen = false;
+    for (size_t i = 0; i < _count && !seen; i++) {
+        seen = strcmp(_phases[i].name, phase) == 0;
+    }
+    if (!seen && _count < BOOT_MAX_PHASES) {
+        _phases[_count].name = phase;
+        _phases[_count].ms = now;
+        _count++;
+    }
+    portEXIT_CRITICAL(&_mux);
+}
+
+size_t BootTimings::count() {
+    portENTER_CRITICAL(&_mux);
+    size_t count = _count;
+    portEXIT_CRITICAL(&_mux);
+    return count;
+}
+
+bool BootTimings::get(size_t index, const char*& phase, uint32_t& ms) {
+    portENTER_CRITICAL(&_mux);
+    bool valid = index < _count;
+    if (valid) {
+        phase = _phases[index].name;
+        ms = _phases[index].ms;
+    }
+    portEXIT_CRITICAL(&_mux);
+    return valid;
+}
@@ -0,0 +1,79 @@
+#include "buffer_writer.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+BufferWriter::BufferWriter(char* buffer, size_t capacity)
+    : _buffer(buffer)
+    , _capacity(capacity)
+    , _length(0)
+    , _overflow(false)
+{
+    if (_capacity > 0) {
+        _buffer[0] = '\0';
+    }
+}
+
+void BufferWriter::reset() {
+    _length = 0;
+    _overflow = false;
+    if (_capacity > 0) {
+        _buffer[0] = '\0';
+    }
+}
+
+void BufferWriter::print(const char* text) {
+    append(text, strlen(text));
+}
+
+void BufferWriter::printf(const char* format, ...) {
+    if (_overflow || _capacity == 0) return;
+
+    size_t available = _capacity - _length;
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(_buffer + _length, available, format, args);
+    va_end(args);
+
+    if (written < 0 || (size_t)written >= available) {
+        // Truncated - keep what fit but flag it
+        _length = _capacity - 1;
+        _overflow = true;
+        return;
+    }
+    _length += written;
+}
+
+void BufferWriter::jsonString(const char* text) {
+    append("\"", 1);
+    for (const char* p = text; *p && !_overflow; p++) {
+        char c = *p;
+        switch (c) {
+            case '"':  append("\\\"", 2); break;
+            case '\\': append("\\\\", 2); break;
+            case '\n': append("\\n", 2); break;
+            case '\r': append("\\r", 2); break;
+            case '\t': append("\\t", 2); break;
+            default:
+                if ((uint8_t)c < 0x20) {
+                    printf("\\u%04x", (unsigned)(uint8_t)c);
+                } else {
+                    append(&c, 1);
+                }
+                break;
+        }
+    }
+    append("\"", 1);
+}
+
+void BufferWriter::append(const char* data, size_t len) {
+    if (_overflow || _capacity == 0) return;
+
+    if (_length + len >= _capacity) {
+        _overflow = true;
+        return;
+    }
+    memcpy(_buffer + _length, data, len);
+    _length += len;
+    _buffer[_length] = '\0';
+}
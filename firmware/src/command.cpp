@@ -0,0 +1,170 @@
+#include "command.h"
+#include <stdio.h>
+#include <string.h>
+
+enum ArgType : uint8_t {
+    ARG_NONE,
+    ARG_NUMBER,
+    ARG_TEXT
+};
+
+struct CommandSpec {
+    const char* name;
+    CommandId id;
+    ArgType arg;
+    int32_t maxValue;       // ARG_NUMBER only
+};
+
+// The single dispatch table: every transport resolves names here
+static const CommandSpec COMMANDS[] = {
+    {"OPEN",                CommandId::OPEN,                ARG_NONE,   0},
+    {"CLOSE",               CommandId::CLOSE,               ARG_NONE,   0},
+    {"STOP",                CommandId::STOP,                ARG_NONE,   0},
+    {"OPEN_FORCE",          CommandId::OPEN_FORCE,          ARG_NONE,   0},
+    {"CLOSE_FORCE",         CommandId::CLOSE_FORCE,         ARG_NONE,   0},
+    {"CALIBRATE_START",     CommandId::CALIBRATE_START,     ARG_NONE,   0},
+    {"CALIBRATE_SETBOTTOM", CommandId::CALIBRATE_SETBOTTOM, ARG_NONE,   0},
+    {"CALIBRATE_CANCEL",    CommandId::CALIBRATE_CANCEL,    ARG_NONE,   0},
+    {"POSITION",            CommandId::POSITION,            ARG_NUMBER, 100},
+    {"GOTO",                CommandId::GOTO,                ARG_NUMBER, 999999999},
+    {"SPEED",               CommandId::SPEED,               ARG_NUMBER, 4095},
+    {"LOGLEVEL",            CommandId::LOGLEVEL,            ARG_TEXT,   0},
+    {"RESTART",             CommandId::RESTART,             ARG_NONE,   0},
+};
+
+static const size_t COMMAND_COUNT = sizeof(COMMANDS) / sizeof(COMMANDS[0]);
+
+static bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static char toUpper(char c) {
+    return (c >= 'a' && c <= 'z') ? (char)(c - 'a' + 'A') : c;
+}
+
+static void trim(const char*& data, size_t& length) {
+    while (length > 0 && isSpace(data[0])) {
+        data++;
+        length--;
+    }
+    while (length > 0 && isSpace(data[length - 1])) {
+        length--;
+    }
+}
+
+// Case-insensitive match of data[0..length) against a NUL-terminated upper-case name
+static bool nameEquals(const char* data, size_t length, const char* name) {
+    for (size_t i = 0; i < length; i++) {
+        if (name[i] == '\0' || toUpper(data[i]) != name[i]) {
+            return false;
+        }
+    }
+    return name[length] == '\0';
+}
+
+static const CommandSpec* findSpec(CommandId id) {
+    for (size_t i = 0; i < COMMAND_COUNT; i++) {
+        if (COMMANDS[i].id == id) {
+            return &COMMANDS[i];
+        }
+    }
+    return nullptr;
+}
+
+bool Command::isMotion() const {
+    return id == CommandId::OPEN || id == CommandId::CLOSE || id == CommandId::STOP ||
+           id == CommandId::POSITION || id == CommandId::GOTO;
+}
+
+bool CommandParser::parse(const char* data, size_t length, Command& out) {
+    out = Command();
+    if (!data) {
+        return false;
+    }
+    trim(data, length);
+
+    const char* colon = (const char*)memchr(data, ':', length);
+    size_t nameLength = colon ? (size_t)(colon - data) : length;
+    const char* arg = colon ? colon + 1 : nullptr;
+    size_t argLength = colon ? length - nameLength - 1 : 0;
+    if (arg) {
+        trim(arg, argLength);
+    }
+
+    for (size_t i = 0; i < COMMAND_COUNT; i++) {
+        const CommandSpec& spec = COMMANDS[i];
+        if (!nameEquals(data, nameLength, spec.name)) {
+            continue;
+        }
+
+        switch (spec.arg) {
+            case ARG_NONE:
+                if (colon) {
+                    return false;
+                }
+                break;
+            case ARG_NUMBER:
+                if (!arg || !parseNumber(arg, argLength, spec.maxValue, out.value)) {
+                    return false;
+                }
+                break;
+            case ARG_TEXT:
+                if (!arg || argLength == 0) {
+                    return false;
+                }
+                out.text = arg;
+                out.textLength = argLength;
+                break;
+        }
+        out.id = spec.id;
+        return true;
+    }
+    return false;
+}
+
+bool CommandParser::parseNumber(const char* data, size_t length, int32_t maxValue, int32_t& out) {
+    if (!data) {
+        return false;
+    }
+    trim(data, length);
+    if (length == 0 || length > 9) {
+        return false;
+    }
+
+    int32_t value = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (data[i] < '0' || data[i] > '9') {
+            return false;
+        }
+        value = value * 10 + (data[i] - '0');
+    }
+    if (value > maxValue) {
+        return false;
+    }
+    out = value;
+    return true;
+}
+
+const char* CommandParser::name(CommandId id) {
+    const CommandSpec* spec = findSpec(id);
+    return spec ? spec->name : "";
+}
+
+const char* CommandParser::format(const Command& command, char* buffer, size_t size) {
+    if (size == 0) {
+        return buffer;
+    }
+
+    const CommandSpec* spec = findSpec(command.id);
+    if (!spec) {
+        snprintf(buffer, size, "UNKNOWN");
+    } else if (spec->arg == ARG_NUMBER) {
+        snprintf(buffer, size, "%s:%ld", spec->name, (long)command.value);
+    } else if (spec->arg == ARG_TEXT) {
+        snprintf(buffer, size, "%s:%.*s", spec->name, (int)command.textLength,
+                 command.text ? command.text : "");
+    } else {
+        snprintf(buffer, size, "%s", spec->name);
+    }
+    return buffer;
+}
@@ -0,0 +1,15 @@
+#include "device_snapshot.h"
+
+static int percentOf(bool calibrated, int32_t cumulativePosition, int32_t maxPosition) {
+    if (!calibrated || maxPosition <= 0) return -1;
+    int32_t pos = cumulativePosition < 0 ? 0 : cumulativePosition > maxPosition ? maxPosition : cumulativePosition;
+    return 100 - (int)(((int64_t)pos * 100 + maxPosition / 2) / maxPosition);
+}
+
+int DeviceStateSnapshot::positionPercent() const {
+    return percentOf(calibrated, cumulativePosition, maxPosition);
+}
+
+int BlindSummary::positionPercent() const {
+    return percentOf(calibrated, cumulativePosition, maxPosition);
+}
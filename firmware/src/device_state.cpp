@@ -0,0 +1,139 @@
+#include "device_state.h"
+
+DeviceState deviceState;
+
+DeviceState::DeviceState()
+    : _pending(0)
+    , _observerCount(0)
+{
+}
+
+void DeviceState::publishMotion(const char* blindState, int position, int32_t cumulativePosition,
+                                int32_t maxPosition, bool calibrated, const char* calibrationState) {
+    portENTER_CRITICAL(&_mux);
+    uint32_t changes = 0;
+
+    // State strings are static, but compare contents so equal literals match
+    if (strcmp(_state.blindState, blindState) != 0) {
+        _state.blindState = blindState;
+        changes |= STATE_CHANGE_MOTION;
+    }
+    if (_state.position != position || _state.cumulativePosition != cumulativePosition) {
+        _state.position = position;
+        _state.cumulativePosition = cumulativePosition;
+        changes |= STATE_CHANGE_POSITION;
+    }
+    if (_state.maxPosition != maxPosition || _state.calibrated != calibrated ||
+        strcmp(_state.calibrationState, calibrationState) != 0) {
+        _state.maxPosition = maxPosition;
+        _state.calibrated = calibrated;
+        _state.calibrationState = calibrationState;
+        changes |= STATE_CHANGE_CALIBRATION;
+    }
+
+    markChanged(changes);
+    portEXIT_CRITICAL(&_mux);
+}
+
+void DeviceState::publishWifi(bool connected, const char* ssid, int rssi, const char* ip) {
+    portENTER_CRITICAL(&_mux);
+    if (_state.wifiConnected != connected || _state.wifiRssi != rssi ||
+        strncmp(_state.wifiSsid, ssid, sizeof(_state.wifiSsid) - 1) != 0 ||
+        strncmp(_state.wifiIp, ip, sizeof(_state.wifiIp) - 1) != 0) {
+        _state.wifiConnected = connected;
+        _state.wifiRssi = rssi;
+        strncpy(_state.wifiSsid, ssid, sizeof(_state.wifiSsid) - 1);
+        strncpy(_state.wifiIp, ip, sizeof(_state.wifiIp) - 1);
+        markChanged(STATE_CHANGE_WIFI);
+    }
+    portEXIT_CRITICAL(&_mux);
+}
+
+void DeviceState::publishHall(bool rawState, bool triggered, uint32_t triggerCount) {
+    portENTER_CRITICAL(&_mux);
+    if (_state.hallRawState != rawState || _state.hallTriggered != triggered ||
+        _state.hallTriggerCount != triggerCount) {
+        _state.hallRawState = rawState;
+        _state.hallTriggered = triggered;
+        _state.hallTriggerCount = triggerCount;
+        markChanged(STATE_CHANGE_HALL);
+    }
+    portEXIT_CRITICAL(&_mux);
+}
+
+void DeviceState::publishServo(bool connected, const ServoTelemetry& telemetry) {
+    portENTER_CRITICAL(&_mux);
+    const ServoTelemetry& cur = _state.servo;
+    if (_state.servoConnected != connected || cur.valid != telemetry.valid ||
+        cur.speed != telemetry.speed || cur.load != telemetry.load ||
+        cur.voltage != telemetry.voltage || cur.temperature != telemetry.temperature ||
+        cur.moving != telemetry.moving) {
+        markChanged(STATE_CHANGE_SERVO);
+    }
+    _state.servoConnected = connected;
+    _state.servo = telemetry;
+    portEXIT_CRITICAL(&_mux);
+}
+
+void DeviceState::publishBlind(uint8_t blind, const BlindSummary& summary) {
+    if (blind >= BLIND_COUNT) return;
+
+    portENTER_CRITICAL(&_mux);
+    BlindSummary& cur = _state.blinds[blind];
+    if (strcmp(cur.blindState, summary.blindState) != 0 ||
+        cur.cumulativePosition != summary.cumulativePosition ||
+        cur.maxPosition != summary.maxPosition || cur.calibrated != summary.calibrated ||
+        strcmp(cur.calibrationState, summary.calibrationState) != 0 ||
+        cur.servoConnected != summary.servoConnected) {
+        cur = summary;
+        markChanged(STATE_CHANGE_BLINDS);
+    }
+    portEXIT_CRITICAL(&_mux);
+}
+
+DeviceStateSnapshot DeviceState::snapshot() const {
+    portENTER_CRITICAL(&_mux);
+    DeviceStateSnapshot copy = _state;
+    portEXIT_CRITICAL(&_mux);
+    return copy;
+}
+
+uint32_t DeviceState::generation() const {
+    portENTER_CRITICAL(&_mux);
+    uint32_t gen = _state.generation;
+    portEXIT_CRITICAL(&_mux);
+    return gen;
+}
+
+bool DeviceState::subscribe(uint32_t mask, Observer observer) {
+    if (_observerCount >= MAX_OBSERVERS) {
+        return false;
+    }
+    _observers[_observerCount].mask = mask;
+    _observers[_observerCount].observer = observer;
+    _observerCount++;
+    return true;
+}
+
+void DeviceState::dispatch() {
+    portENTER_CRITICAL(&_mux);
+    uint32_t changes = _pending;
+    _pending = 0;
+    portEXIT_CRITICAL(&_mux);
+
+    if (changes == 0) return;
+
+    DeviceStateSnapshot state = snapshot();
+    for (int i = 0; i < _observerCount; i++) {
+        uint32_t relevant = changes & _observers[i].mask;
+        if (relevant && _observers[i].observer) {
+            _observers[i].observer(relevant, state);
+        }
+    }
+}
+
+void DeviceState::markChanged(uint32_t changes) {
+    if (changes == 0) return;
+    _pending |= changes;
+    _state.generation++;
+}
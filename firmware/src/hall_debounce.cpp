@@ -0,0 +1,40 @@
+#include "hall_debounce.h"
+
+void HallDebounce::reset() {
+    _pending = false;
+    _edgeUs = 0;
+    _lastChangeUs = 0;
+    _bounces = 0;
+}
+
+bool HallDebounce::onEdge(bool low, int64_t nowUs) {
+    if (_pending) {
+        // Chatter around the switching point: wait for it to settle again
+        _lastChangeUs = nowUs;
+        if (_bounces < UINT16_MAX) {
+            _bounces++;
+        }
+        return false;
+    }
+    if (!low) {
+        return false;   // Magnet leaving, or a glitch already over when the ISR ran
+    }
+
+    _pending = true;
+    _edgeUs = nowUs;
+    _lastChangeUs = nowUs;
+    _bounces = 0;
+    return true;
+}
+
+HallDebounce::Result HallDebounce::poll(bool low, int64_t nowUs) {
+    if (!_pending) {
+        return Result::IDLE;
+    }
+    if (nowUs - _lastChangeUs < _windowUs) {
+        return Result::WAITING;
+    }
+
+    _pending = false;
+    return low ? Result::CONFIRMED : Result::REJECTED;
+}
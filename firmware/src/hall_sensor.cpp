@@ -1,31 +1,65 @@
 #include "hall_sensor.h"
+#include "config.h"
 #include "logger.h"
-
-HallSensor* HallSensor::_instance = nullptr;
+#include "device_state.h"
+#include "motion_profile.h"
+#include <esp_timer.h>
+#include <driver/gpio.h>
 
 HallSensor::HallSensor()
     : _pin(0)
     , _triggered(false)
-    , _interruptFlag(false)
     , _triggerCount(0)
-    , _lastTriggerTime(0)
     , _initialized(false)
-    , _pendingTrigger(false)
-    , _pendingTriggerTime(0)
+    , _publishState(true)
+    , _debounce(HALL_DEBOUNCE_US)
+    , _edgePending(false)
+    , _edgeSnapshotPosition(0)
+    , _edgeSnapshotTimeUs(0)
+    , _snapshotPosition(0)
+    , _snapshotTimeUs(0)
+    , _snapshotVelocity(0.0f)
+    , _triggerPosition(0)
+    , _notifyTask(nullptr)
+    , _wakeArmed(false)
+    , _wakeLevel(HIGH)
 {
 }
 
-void IRAM_ATTR HallSensor::isrHandler() {
-    if (_instance) {
-        // FALLING edge = HIGH -> LOW transition = magnet arriving
-        // Don't set _triggered here - let update() handle debouncing
-        _instance->_interruptFlag = true;
+void IRAM_ATTR HallSensor::isrHandler(void* arg) {
+    HallSensor* self = static_cast<HallSensor*>(arg);
+
+    // Confirmed: edges until clearTriggered() are the magnet passing or leaving
+    if (self->_triggered) return;
+
+    // Both edges interrupt. A LOW level starts a trigger (magnet arriving) and
+    // latches the position at its first edge; any edge after that is chatter
+    // that restarts the debounce window.
+    int64_t nowUs = esp_timer_get_time();
+    bool low = gpio_get_level((gpio_num_t)self->_pin) == 0;
+
+    portENTER_CRITICAL_ISR(&self->_mux);
+    bool captured = !self->_triggered && self->_debounce.onEdge(low, nowUs);
+    if (captured) {
+        self->_edgeSnapshotPosition = self->_snapshotPosition;
+        self->_edgeSnapshotTimeUs = self->_snapshotTimeUs;
+        self->_edgePending = true;
+    }
+    portEXIT_CRITICAL_ISR(&self->_mux);
+
+    // Wake the motion task so it can stop the servo immediately
+    if (captured && self->_notifyTask) {
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(self->_notifyTask, &woken);
+        if (woken) {
+            portYIELD_FROM_ISR();
+        }
     }
 }
 
-void HallSensor::init(uint8_t pin) {
+void HallSensor::init(uint8_t pin, bool publishState) {
     _pin = pin;
-    _instance = this;
+    _publishState = publishState;
 
     pinMode(_pin, INPUT);
 
@@ -35,18 +69,42 @@ void HallSensor::init(uint8_t pin) {
     // Check if magnet is already present at startup
     int initialReading = digitalRead(_pin);
     if (initialReading == LOW) {
-        // Magnet already present - start pending trigger for debounce
-        _pendingTrigger = true;
-        _pendingTriggerTime = millis();
+        // Magnet already present - treat as an edge now so it goes through debounce
+        int64_t nowUs = esp_timer_get_time();
+        _debounce.onEdge(true, nowUs);
+        _edgeSnapshotPosition = _snapshotPosition;
+        _edgeSnapshotTimeUs = nowUs;
+        _edgePending = true;
     }
 
-    // FALLING = HIGH -> LOW = magnet arriving
-    attachInterrupt(digitalPinToInterrupt(_pin), isrHandler, FALLING);
+    // CHANGE: falling = magnet arriving, and every edge feeds the debounce
+    // (one sensor per blind, so the ISR gets its instance)
+    attachInterruptArg(digitalPinToInterrupt(_pin), isrHandler, this, CHANGE);
 
     _initialized = true;
 
-    LOG_BOOT("Hall sensor initialized on pin %d (FALLING interrupt, initial: %s, raw=%d, debounce=%lums)",
-             _pin, initialReading == LOW ? "MAGNET PRESENT" : "no magnet", initialReading, DEBOUNCE_MS);
+    LOG_BOOT("Hall sensor initialized on pin %d (CHANGE interrupt, initial: %s, raw=%d, debounce=%lldus)",
+             _pin, initialReading == LOW ? "MAGNET PRESENT" : "no magnet", initialReading, (long long)HALL_DEBOUNCE_US);
+}
+
+void HallSensor::armWake() {
+    if (!_initialized) return;
+
+    gpio_num_t pin = (gpio_num_t)_pin;
+    _wakeLevel = digitalRead(_pin);
+    gpio_intr_disable(pin);
+    gpio_wakeup_enable(pin, _wakeLevel == LOW ? GPIO_INTR_HIGH_LEVEL : GPIO_INTR_LOW_LEVEL);
+    _wakeArmed = true;
+}
+
+void HallSensor::disarmWake() {
+    if (!_wakeArmed) return;
+
+    gpio_num_t pin = (gpio_num_t)_pin;
+    gpio_wakeup_disable(pin);
+    gpio_set_intr_type(pin, GPIO_INTR_ANYEDGE);  // CHANGE, as attached in init()
+    gpio_intr_enable(pin);
+    _wakeArmed = false;
 }
 
 bool HallSensor::isTriggered() const {
@@ -54,10 +112,11 @@ bool HallSensor::isTriggered() const {
 }
 
 void HallSensor::clearTriggered() {
+    portENTER_CRITICAL(&_mux);
     _triggered = false;
-    _interruptFlag = false;
-    _pendingTrigger = false;
-    _pendingTriggerTime = 0;
+    _debounce.reset();
+    _edgePending = false;
+    portEXIT_CRITICAL(&_mux);
 }
 
 bool HallSensor::getRawState() const {
@@ -69,42 +128,68 @@ uint32_t HallSensor::getTriggerCount() const {
     return _triggerCount;
 }
 
+void HallSensor::setNotifyTask(TaskHandle_t task) {
+    _notifyTask = task;
+}
+
+void HallSensor::setPositionSnapshot(int32_t cumulativePosition, float velocity) {
+    portENTER_CRITICAL(&_mux);
+    _snapshotPosition = cumulativePosition;
+    _snapshotTimeUs = esp_timer_get_time();
+    portEXIT_CRITICAL(&_mux);
+    _snapshotVelocity = velocity;
+}
+
+bool HallSensor::hasPendingEdge() const {
+    return _edgePending;
+}
+
+int32_t HallSensor::getTriggerPosition() const {
+    return _triggerPosition;
+}
+
 void HallSensor::update() {
     if (!_initialized) return;
 
-    unsigned long now = millis();
-    bool currentState = digitalRead(_pin);  // LOW = magnet present
-
-    // Handle new interrupt - start debounce period
-    if (_interruptFlag) {
-        _interruptFlag = false;
-        if (!_pendingTrigger && !_triggered) {
-            // Start a new pending trigger
-            _pendingTrigger = true;
-            _pendingTriggerTime = now;
-            LOG_SERVO("Hall sensor: potential trigger detected, starting debounce...");
-        }
+    debounceEdge();
+
+    // Cheap when nothing changed - deviceState only flags real changes
+    if (_publishState) {
+        deviceState.publishHall(digitalRead(_pin), _triggered, _triggerCount);
     }
+}
 
-    // Process pending trigger with debounce
-    if (_pendingTrigger && !_triggered) {
-        if (currentState == LOW) {
-            // Magnet still present - check if debounce period has elapsed
-            if (now - _pendingTriggerTime >= DEBOUNCE_MS) {
-                // Signal has been stable for debounce period - confirm trigger
-                _triggered = true;
-                _triggerCount++;
-                _lastTriggerTime = now;
-                _pendingTrigger = false;
-                LOG_SERVO("Hall sensor TRIGGERED (confirmed after %lums debounce, count: %u)",
-                         DEBOUNCE_MS, _triggerCount);
-            }
-        } else {
-            // Magnet no longer present - this was a false trigger, cancel it
-            LOG_SERVO("Hall sensor: false trigger rejected (signal unstable after %lums)",
-                     now - _pendingTriggerTime);
-            _pendingTrigger = false;
-            _pendingTriggerTime = 0;
-        }
+void HallSensor::debounceEdge() {
+    if (!_edgePending || _triggered) return;
+
+    // Level and result under the lock, so an edge landing in between cannot be
+    // judged against a stale window
+    portENTER_CRITICAL(&_mux);
+    int64_t nowUs = esp_timer_get_time();
+    bool low = gpio_get_level((gpio_num_t)_pin) == 0;  // LOW = magnet present
+    HallDebounce::Result result = _debounce.poll(low, nowUs);
+    int64_t edgeTimeUs = _debounce.edgeTimeUs();
+    uint16_t bounces = _debounce.bounces();
+    if (result == HallDebounce::Result::CONFIRMED) {
+        // Referenced to the first edge, so the result does not depend on how
+        // long confirmation took
+        float sinceSnapshot = (edgeTimeUs - _edgeSnapshotTimeUs) / 1000000.0f;
+        _triggerPosition = MotionProfile::extrapolate(_edgeSnapshotPosition, _snapshotVelocity, sinceSnapshot);
+        _triggerCount++;
+        _triggered = true;
     }
+    _edgePending = _debounce.pending();
+    portEXIT_CRITICAL(&_mux);
+
+    if (result == HallDebounce::Result::REJECTED) {
+        LOG_SERVO("Hall sensor: false trigger rejected (settled HIGH %lldus after edge, %u bounces)",
+                  nowUs - edgeTimeUs, bounces);
+        return;
+    }
+    if (result != HallDebounce::Result::CONFIRMED) {
+        return;  // Still inside the debounce window
+    }
+
+    LOG_SERVO("Hall sensor TRIGGERED (edge at pos %d, confirmed %lldus after edge, %u bounces, count: %u)",
+              _triggerPosition, nowUs - edgeTimeUs, bounces, _triggerCount);
 }
@@ -3,9 +3,20 @@
 #include "logger.h"
 #include "storage.h"
 #include "servo_controller.h"
+#include "buffer_writer.h"
+#include "status_json.h"
+#include "mqtt_client.h"
+#include "wifi_manager.h"
+#include "boot_timings.h"
+#include "power_manager.h"
+#include "command.h"
+#include "metrics.h"
+#include "scheduler.h"
 #include <ESPAsyncWebServer.h>
 #include <ArduinoJson.h>
 #include <Update.h>
+#include <esp_rom_crc.h>
+#include <memory>
 
 // Global server instance
 static AsyncWebServer server(HTTP_PORT);
@@ -15,15 +26,16 @@ static AsyncEventSource events("/events");
 
 // Forward declaration for auth helper
 extern Storage storage;
+extern WifiManager wifi;
+extern PowerManager power;
+extern Scheduler scheduler;
 
 // Authentication helper - checks X-Device-Password header
 // Returns true if auth passes (no password set, or correct password provided)
 // Returns false and sends 401 if auth fails
 static bool checkAuth(AsyncWebServerRequest *request) {
-    String storedPassword = storage.getDevicePassword();
-
-    // If no password is set, allow access
-    if (storedPassword.isEmpty()) {
+    // If no password is set, allow access (served from the RAM config cache)
+    if (!storage.hasDevicePassword()) {
         return true;
     }
 
@@ -34,8 +46,7 @@ static bool checkAuth(AsyncWebServerRequest *request) {
         return false;
     }
 
-    String providedPassword = request->header("X-Device-Password");
-    if (providedPassword != storedPassword) {
+    if (!storage.checkDevicePassword(request->header("X-Device-Password"))) {
         LOG_HTTP("Auth failed: incorrect password");
         request->send(401, "application/json", "{\"error\":\"Invalid password\"}");
         return false;
@@ -44,16 +55,95 @@ static bool checkAuth(AsyncWebServerRequest *request) {
     return true;
 }
 
+// Auth check for body callbacks, which run before the request handler and
+// must not send a response themselves (the handler calls checkAuth)
+static bool isAuthorized(AsyncWebServerRequest *request) {
+    if (!storage.hasDevicePassword()) {
+        return true;
+    }
+    return request->hasHeader("X-Device-Password") &&
+           storage.checkDevicePassword(request->header("X-Device-Password"));
+}
+
+// Blind selected by ?blind=N (query or form), 0 when absent. Sends 400 and
+// returns false for an index outside 0..BLIND_COUNT-1.
+static bool parseBlind(AsyncWebServerRequest *request, uint8_t& blind) {
+    blind = 0;
+    const AsyncWebParameter* param = nullptr;
+    if (request->hasParam("blind", true)) {
+        param = request->getParam("blind", true);
+    } else if (request->hasParam("blind")) {
+        param = request->getParam("blind");
+    }
+    if (!param) {
+        return true;
+    }
+
+    String value = param->value();
+    long index = value.toInt();
+    if (value.isEmpty() || (index == 0 && value != "0") || index < 0 || index >= BLIND_COUNT) {
+        request->send(400, "application/json", "{\"error\":\"Unknown blind\"}");
+        return false;
+    }
+    blind = (uint8_t)index;
+    return true;
+}
+
+// Sends 400 and returns false when a setting exceeds what storage accepts
+static bool checkLength(AsyncWebServerRequest *request, const char* name, const String& value, size_t maxLength) {
+    if (value.length() <= maxLength) {
+        return true;
+    }
+    LOG_HTTP("Rejected %s: %d bytes (max %d)", name, value.length(), (int)maxLength);
+    request->send(400, "application/json",
+                  String("{\"error\":\"") + name + " too long (max " + maxLength + " bytes)\"}");
+    return false;
+}
+
+static void sendSaveFailed(AsyncWebServerRequest *request) {
+    request->send(500, "application/json", "{\"error\":\"Failed to save settings\"}");
+}
+
+// Per-request state for /ota/chunk, kept in request->_tempObject
+struct OtaChunkContext {
+    int slot;               // OtaWriter buffer, -1 once released or submitted
+    uint32_t session;
+    uint32_t index;
+    uint32_t expectedCrc;
+    bool hasCrc;
+    size_t length;          // Bytes copied so far
+    int status;             // HTTP status for error
+    const char* error;      // nullptr while the chunk is good
+};
+
 // Separate SSE event source for log streaming (to avoid overwhelming device)
 static AsyncEventSource logEvents("/events/logs");
 
+// SSE event source sending only changed status fields ("delta") between
+// full "keyframe" documents
+static AsyncEventSource deltaEvents("/events/delta");
+static char deltaBuffer[STATUS_DELTA_BUFFER_SIZE];
+
+// The last two rendered status documents, each tagged with its state
+// generation and only touched under the status lock. A new generation is
+// rendered into the slot not being served, so a /status body that
+// AsyncWebServer is still reading (it copies out as the TCP window opens)
+// keeps its bytes until the state has moved twice. SSE sends read the current
+// slot directly; AsyncEventSource copies the message when it is queued.
+struct StatusDocument {
+    uint32_t generation;
+    size_t length;              // 0 until first rendered
+    char json[STATUS_BUFFER_SIZE];
+};
+static StatusDocument statusDocuments[2];
+static uint8_t statusCurrent = 0;
+
 HttpServer::HttpServer()
     : _running(false)
     , _commandCallback(nullptr)
-    , _currentState("unknown")
-    , _currentPosition(0)
-    , _wifiRssi(0)
 {
+    _statusMutex = xSemaphoreCreateMutex();
+    _sseMutex = xSemaphoreCreateRecursiveMutex();
 }
 
 void HttpServer::begin() {
@@ -95,32 +185,16 @@ void HttpServer::onMqttConfig(HttpMqttConfigCallback callback) {
     _mqttConfigCallback = callback;
 }
 
-void HttpServer::updateState(const char* state) {
-    _currentState = state;
-}
-
-void HttpServer::updatePosition(int position) {
-    _currentPosition = position;
-}
-
-void HttpServer::updateWifiInfo(const String& ssid, int rssi, const String& ip) {
-    _wifiSsid = ssid;
-    _wifiRssi = rssi;
-    _wifiIp = ip;
+void HttpServer::onMqttGroups(HttpMqttGroupsCallback callback) {
+    _mqttGroupsCallback = callback;
 }
 
-void HttpServer::updateCalibration(bool calibrated, int32_t cumulativePosition, int32_t maxPosition,
-                                   const char* calibrationState) {
-    _calibrated = calibrated;
-    _cumulativePosition = cumulativePosition;
-    _maxPosition = maxPosition;
-    _calibrationState = calibrationState;
-}
-
-void HttpServer::updateHallSensor(bool rawState, bool triggered, uint32_t triggerCount) {
-    _hallRawState = rawState;
-    _hallTriggered = triggered;
-    _hallTriggerCount = triggerCount;
+void HttpServer::attachState() {
+    // Runs on the main loop via deviceState.dispatch(); broadcastStateIfChanged() sends
+    deviceState.subscribe(STATE_CHANGE_MOTION | STATE_CHANGE_POSITION | STATE_CHANGE_CALIBRATION,
+        [this](uint32_t changes, const DeviceStateSnapshot&) {
+            _pendingBroadcast |= changes;
+        });
 }
 
 void HttpServer::setupRoutes() {
@@ -140,13 +214,39 @@ void HttpServer::setupRoutes() {
 
     // GET /status - Device status
     server.on("/status", HTTP_GET, [this](AsyncWebServerRequest *request) {
-        LOG_HTTP("GET /status");
-        request->send(200, "application/json", buildStatusJson());
+        LOG_DEBUG(HTTP, "GET /status");
+        // The document carries only published state, so the state generation
+        // tags it and a matching client is answered before anything is rendered
+        char etag[16];
+        snprintf(etag, sizeof(etag), "\"%08lx\"", (unsigned long)deviceState.generation());
+        if (request->hasHeader("If-None-Match") &&
+            strstr(request->header("If-None-Match").c_str(), etag)) {
+            AsyncWebServerResponse* response = request->beginResponse(304);
+            response->addHeader("ETag", etag);
+            request->send(response);
+            return;
+        }
+
+        // Body is copied out of the tagged slot as AsyncWebServer asks for it
+        lockStatus();
+        const StatusDocument& status = currentStatus();
+        uint32_t generation = status.generation;
+        size_t length = status.length;
+        unlockStatus();
+
+        snprintf(etag, sizeof(etag), "\"%08lx\"", (unsigned long)generation);
+        AsyncWebServerResponse* response = request->beginResponse("application/json", length,
+            [this, generation](uint8_t* buffer, size_t maxLen, size_t index) -> size_t {
+                return copyStatus(generation, buffer, maxLen, index);
+            });
+        response->addHeader("ETag", etag);
+        response->addHeader("Cache-Control", "no-cache");
+        request->send(response);
     });
 
     // GET /info - Device info
     server.on("/info", HTTP_GET, [this](AsyncWebServerRequest *request) {
-        LOG_HTTP("GET /info");
+        LOG_DEBUG(HTTP, "GET /info");
         request->send(200, "application/json", buildInfoJson());
     });
 
@@ -161,11 +261,10 @@ void HttpServer::setupRoutes() {
         [this](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
             // Body handler - auth check
             if (!checkAuth(request)) return;
-            String body = String((char*)data).substring(0, len);
-            LOG_HTTP("POST /command: %s", body.c_str());
+            LOG_HTTP("POST /command: %.*s", (int)len, (const char*)data);
 
             JsonDocument doc;
-            DeserializationError error = deserializeJson(doc, body);
+            DeserializationError error = deserializeJson(doc, data, len);
 
             if (error) {
                 LOG_HTTP("JSON parse error: %s", error.c_str());
@@ -173,23 +272,55 @@ void HttpServer::setupRoutes() {
                 return;
             }
 
-            String action = doc["action"] | "";
-            action.toUpperCase();
+            const char* action = doc["action"] | "";
+            Command command;
+
+            if (strcasecmp(action, "POSITION") == 0) {
+                // {"action":"POSITION","percent":50} or {"action":"POSITION","position":1200}
+                if (doc["percent"].is<int>()) {
+                    int percent = doc["percent"];
+                    if (percent < 0 || percent > 100) {
+                        request->send(400, "application/json", "{\"error\":\"Percent must be 0-100\"}");
+                        return;
+                    }
+                    command = Command(CommandId::POSITION, percent);
+                } else if (doc["position"].is<int>()) {
+                    int position = doc["position"];
+                    if (position < 0) {
+                        request->send(400, "application/json", "{\"error\":\"Position must be >= 0\"}");
+                        return;
+                    }
+                    command = Command(CommandId::GOTO, position);
+                } else {
+                    request->send(400, "application/json", "{\"error\":\"POSITION requires 'percent' or 'position'\"}");
+                    return;
+                }
+            } else if (!CommandParser::parse(action, strlen(action), command)) {
+                // Anything from the shared command table (OPEN, STOP, SPEED:800, ...)
+                request->send(400, "application/json", "{\"error\":\"Invalid action. Use OPEN, CLOSE, STOP, or POSITION\"}");
+                return;
+            }
 
-            if (action != "OPEN" && action != "CLOSE" && action != "STOP") {
-                request->send(400, "application/json", "{\"error\":\"Invalid action. Use OPEN, CLOSE, or STOP\"}");
+            // {"action":"OPEN","blind":1} on multi-blind boards
+            int blind = doc["blind"] | 0;
+            if (blind < 0 || blind >= BLIND_COUNT) {
+                request->send(400, "application/json", "{\"error\":\"Unknown blind\"}");
                 return;
             }
+            command.blind = (uint8_t)blind;
 
-            LOG_HTTP("Executing command: %s", action.c_str());
+            char name[48];
+            CommandParser::format(command, name, sizeof(name));
+            LOG_HTTP("Executing command: %s (blind %d)", name, blind);
 
+            // Text arguments (LOGLEVEL:...) point into doc, which outlives the call
             if (_commandCallback) {
-                _commandCallback(action);
+                _commandCallback(command);
             }
 
             JsonDocument response;
             response["success"] = true;
-            response["action"] = action;
+            response["action"] = name;
 
             String responseStr;
             serializeJson(response, responseStr);
@@ -205,9 +336,13 @@ void HttpServer::setupRoutes() {
     // POST /open - Quick open command (PROTECTED)
     server.on("/open", HTTP_POST, [this](AsyncWebServerRequest *request) {
         if (!checkAuth(request)) return;
-        LOG_HTTP("POST /open");
+        uint8_t blind;
+        if (!parseBlind(request, blind)) return;
+        LOG_HTTP("POST /open (blind %d)", blind);
         if (_commandCallback) {
-            _commandCallback("OPEN");
+            Command command(CommandId::OPEN);
+            command.blind = blind;
+            _commandCallback(command);
         }
         request->send(200, "application/json", "{\"success\":true,\"action\":\"OPEN\"}");
     });
@@ -215,9 +350,13 @@ void HttpServer::setupRoutes() {
     // POST /close - Quick close command (PROTECTED)
     server.on("/close", HTTP_POST, [this](AsyncWebServerRequest *request) {
         if (!checkAuth(request)) return;
-        LOG_HTTP("POST /close");
+        uint8_t blind;
+        if (!parseBlind(request, blind)) return;
+        LOG_HTTP("POST /close (blind %d)", blind);
         if (_commandCallback) {
-            _commandCallback("CLOSE");
+            Command command(CommandId::CLOSE);
+            command.blind = blind;
+            _commandCallback(command);
         }
         request->send(200, "application/json", "{\"success\":true,\"action\":\"CLOSE\"}");
     });
@@ -225,13 +364,94 @@ void HttpServer::setupRoutes() {
     // POST /stop - Quick stop command (PROTECTED)
     server.on("/stop", HTTP_POST, [this](AsyncWebServerRequest *request) {
         if (!checkAuth(request)) return;
-        LOG_HTTP("POST /stop");
+        uint8_t blind;
+        if (!parseBlind(request, blind)) return;
+        LOG_HTTP("POST /stop (blind %d)", blind);
         if (_commandCallback) {
-            _commandCallback("STOP");
+            Command command(CommandId::STOP);
+            command.blind = blind;
+            _commandCallback(command);
         }
         request->send(200, "application/json", "{\"success\":true,\"action\":\"STOP\"}");
     });
 
+    // POST /c/<command> - Command named in the path, no body (PROTECTED)
+    // e.g. /c/open, /c/position:40?blind=1; replies 204 without a JSON body
+    server.on("/c/*", HTTP_POST, [this](AsyncWebServerRequest *request) {
+        if (!checkAuth(request)) return;
+        uint8_t blind;
+        if (!parseBlind(request, blind)) return;
+
+        const String& url = request->url();
+        Command command;
+        if (url.length() <= 3 || !CommandParser::parse(url.c_str() + 3, url.length() - 3, command)) {
+            request->send(400, "application/json", "{\"error\":\"Unknown command\"}");
+            return;
+        }
+        LOG_HTTP("POST %s (blind %d)", url.c_str(), blind);
+        command.blind = blind;
+        if (_commandCallback) {
+            _commandCallback(command);
+        }
+        request->send(204);
+    });
+
+    // POST /position - Move to a position (PROTECTED)
+    // percent: 0-100 (100 = open, 0 = closed), or position: cumulative servo counts
+    server.on("/position", HTTP_POST, [this](AsyncWebServerRequest *request) {
+        if (!checkAuth(request)) return;
+        uint8_t blind;
+        if (!parseBlind(request, blind)) return;
+
+        Command command;
+        if (request->hasParam("percent", true) || request->hasParam("percent")) {
+            const AsyncWebParameter* param = request->hasParam("percent", true)
+                ? request->getParam("percent", true) : request->getParam("percent");
+            // Strict digits (toInt() would take "50abc" as 50)
+            const String& value = param->value();
+            int32_t percent;
+            if (!CommandParser::parseNumber(value.c_str(), value.length(), 100, percent)) {
+                request->send(400, "application/json", "{\"error\":\"Percent must be 0-100\"}");
+                return;
+            }
+            command = Command(CommandId::POSITION, percent);
+        } else if (request->hasParam("position", true) || request->hasParam("position")) {
+            const AsyncWebParameter* param = request->hasParam("position", true)
+                ? request->getParam("position", true) : request->getParam("position");
+            const String& value = param->value();
+            int32_t position;
+            if (!CommandParser::parseNumber(value.c_str(), value.length(), INT32_MAX, position)) {
+                request->send(400, "application/json", "{\"error\":\"Position must be a number >= 0\"}");
+                return;
+            }
+            command = Command(CommandId::GOTO, position);
+        } else {
+            request->send(400, "application/json", "{\"error\":\"Missing 'percent' or 'position' parameter\"}");
+            return;
+        }
+
+        if (!deviceState.snapshot().blinds[blind].calibrated) {
+            request->send(409, "application/json", "{\"error\":\"Not calibrated\"}");
+            return;
+        }
+        command.blind = blind;
+
+        char name[24];
+        CommandParser::format(command, name, sizeof(name));
+        LOG_HTTP("POST /position: %s (blind %d)", name, blind);
+        if (_commandCallback) {
+            _commandCallback(command);
+        }
+
+        JsonDocument response;
+        response["success"] = true;
+        response["action"] = name;
+
+        String responseStr;
+        serializeJson(response, responseStr);
+        request->send(200, "application/json", responseStr);
+    });
+
     // =====================
     // Calibration Endpoints
     // =====================
@@ -239,9 +459,13 @@ void HttpServer::setupRoutes() {
     // POST /calibrate/start - Begin calibration (find home) (PROTECTED)
     server.on("/calibrate/start", HTTP_POST, [this](AsyncWebServerRequest *request) {
         if (!checkAuth(request)) return;
-        LOG_HTTP("POST /calibrate/start");
+        uint8_t blind;
+        if (!parseBlind(request, blind)) return;
+        LOG_HTTP("POST /calibrate/start (blind %d)", blind);
         if (_commandCallback) {
-            _commandCallback("CALIBRATE_START");
+            Command command(CommandId::CALIBRATE_START);
+            command.blind = blind;
+            _commandCallback(command);
         }
         request->send(200, "application/json", "{\"success\":true,\"action\":\"CALIBRATE_START\"}");
     });
@@ -249,9 +473,13 @@ void HttpServer::setupRoutes() {
     // POST /calibrate/setbottom - Confirm bottom position (PROTECTED)
     server.on("/calibrate/setbottom", HTTP_POST, [this](AsyncWebServerRequest *request) {
         if (!checkAuth(request)) return;
-        LOG_HTTP("POST /calibrate/setbottom");
+        uint8_t blind;
+        if (!parseBlind(request, blind)) return;
+        LOG_HTTP("POST /calibrate/setbottom (blind %d)", blind);
         if (_commandCallback) {
-            _commandCallback("CALIBRATE_SETBOTTOM");
+            Command command(CommandId::CALIBRATE_SETBOTTOM);
+            command.blind = blind;
+            _commandCallback(command);
         }
         request->send(200, "application/json", "{\"success\":true,\"action\":\"CALIBRATE_SETBOTTOM\"}");
     });
@@ -259,9 +487,13 @@ void HttpServer::setupRoutes() {
     // POST /calibrate/cancel - Cancel calibration (PROTECTED)
     server.on("/calibrate/cancel", HTTP_POST, [this](AsyncWebServerRequest *request) {
         if (!checkAuth(request)) return;
-        LOG_HTTP("POST /calibrate/cancel");
+        uint8_t blind;
+        if (!parseBlind(request, blind)) return;
+        LOG_HTTP("POST /calibrate/cancel (blind %d)", blind);
         if (_commandCallback) {
-            _commandCallback("CALIBRATE_CANCEL");
+            Command command(CommandId::CALIBRATE_CANCEL);
+            command.blind = blind;
+            _commandCallback(command);
         }
         request->send(200, "application/json", "{\"success\":true,\"action\":\"CALIBRATE_CANCEL\"}");
     });
@@ -269,12 +501,15 @@ void HttpServer::setupRoutes() {
     // GET /calibrate/status - Get calibration state (PROTECTED)
     server.on("/calibrate/status", HTTP_GET, [this](AsyncWebServerRequest *request) {
         if (!checkAuth(request)) return;
-        LOG_HTTP("GET /calibrate/status");
+        uint8_t blind;
+        if (!parseBlind(request, blind)) return;
+        LOG_HTTP("GET /calibrate/status (blind %d)", blind);
         JsonDocument doc;
-        doc["calibrated"] = _calibrated;
-        doc["position"] = _cumulativePosition;
-        doc["maxPosition"] = _maxPosition;
-        doc["calibrationState"] = _calibrationState;
+        BlindSummary state = deviceState.snapshot().blinds[blind];
+        doc["calibrated"] = state.calibrated;
+        doc["position"] = state.cumulativePosition;
+        doc["maxPosition"] = state.maxPosition;
+        doc["calibrationState"] = state.calibrationState;
 
         String output;
         serializeJson(doc, output);
@@ -284,9 +519,13 @@ void HttpServer::setupRoutes() {
     // POST /open/force - Force open (bypass limits) (PROTECTED)
     server.on("/open/force", HTTP_POST, [this](AsyncWebServerRequest *request) {
         if (!checkAuth(request)) return;
-        LOG_HTTP("POST /open/force");
+        uint8_t blind;
+        if (!parseBlind(request, blind)) return;
+        LOG_HTTP("POST /open/force (blind %d)", blind);
         if (_commandCallback) {
-            _commandCallback("OPEN_FORCE");
+            Command command(CommandId::OPEN_FORCE);
+            command.blind = blind;
+            _commandCallback(command);
         }
         request->send(200, "application/json", "{\"success\":true,\"action\":\"OPEN_FORCE\"}");
     });
@@ -294,9 +533,13 @@ void HttpServer::setupRoutes() {
     // POST /close/force - Force close (bypass limits) (PROTECTED)
     server.on("/close/force", HTTP_POST, [this](AsyncWebServerRequest *request) {
         if (!checkAuth(request)) return;
-        LOG_HTTP("POST /close/force");
+        uint8_t blind;
+        if (!parseBlind(request, blind)) return;
+        LOG_HTTP("POST /close/force (blind %d)", blind);
         if (_commandCallback) {
-            _commandCallback("CLOSE_FORCE");
+            Command command(CommandId::CLOSE_FORCE);
+            command.blind = blind;
+            _commandCallback(command);
         }
         request->send(200, "application/json", "{\"success\":true,\"action\":\"CLOSE_FORCE\"}");
     });
@@ -306,10 +549,11 @@ void HttpServer::setupRoutes() {
         if (!checkAuth(request)) return;
         LOG_HTTP("GET /hall");
         JsonDocument doc;
-        doc["rawState"] = _hallRawState ? "HIGH" : "LOW";
-        doc["rawStateNote"] = _hallRawState ? "no magnet" : "magnet detected";
-        doc["triggered"] = _hallTriggered;
-        doc["triggerCount"] = _hallTriggerCount;
+        DeviceStateSnapshot state = deviceState.snapshot();
+        doc["rawState"] = state.hallRawState ? "HIGH" : "LOW";
+        doc["rawStateNote"] = state.hallRawState ? "no magnet" : "magnet detected";
+        doc["triggered"] = state.hallTriggered;
+        doc["triggerCount"] = state.hallTriggerCount;
 
         String output;
         serializeJson(doc, output);
@@ -341,8 +585,13 @@ void HttpServer::setupRoutes() {
             return;
         }
 
+        if (!checkLength(request, "Name", name, DEVICE_NAME_MAX_LENGTH)) return;
+
         LOG_HTTP("POST /name: %s", name.c_str());
-        storage.setDeviceName(name);
+        if (!storage.setDeviceName(name)) {
+            sendSaveFailed(request);
+            return;
+        }
 
         JsonDocument response;
         response["success"] = true;
@@ -364,8 +613,13 @@ void HttpServer::setupRoutes() {
         }
 
         // Empty password is allowed (disables auth)
+        if (!checkLength(request, "Password", password, DEVICE_PASSWORD_MAX_LENGTH)) return;
+
         LOG_HTTP("POST /password (length: %d)", password.length());
-        storage.setDevicePassword(password);
+        if (!storage.setDevicePassword(password)) {
+            sendSaveFailed(request);
+            return;
+        }
 
         JsonDocument response;
         response["success"] = true;
@@ -407,13 +661,22 @@ void HttpServer::setupRoutes() {
             password = request->getParam("password")->value();
         }
 
+        if (!checkLength(request, "Broker", broker, MQTT_BROKER_MAX_LENGTH) ||
+            !checkLength(request, "User", user, MQTT_USER_MAX_LENGTH) ||
+            !checkLength(request, "Password", password, MQTT_PASSWORD_MAX_LENGTH)) {
+            return;
+        }
+
         if (broker.isEmpty()) {
             LOG_HTTP("POST /mqtt - clearing MQTT configuration (disabled)");
         } else {
             LOG_HTTP("POST /mqtt: %s:%d", broker.c_str(), port);
         }
 
-        storage.setMqttConfig(broker, port, user, password);
+        if (!storage.setMqttConfig(broker, port, user, password)) {
+            sendSaveFailed(request);
+            return;
+        }
 
         // Notify callback to update MQTT client at runtime
         if (_mqttConfigCallback) {
@@ -434,6 +697,119 @@ void HttpServer::setupRoutes() {
         request->send(200, "application/json", responseStr);
     });
 
+    // GET /groups - MQTT group membership and clock sync (PROTECTED)
+    server.on("/groups", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        if (!checkAuth(request)) return;
+        LOG_HTTP("GET /groups");
+        request->send(200, "application/json", buildGroupsJson());
+    });
+
+    // POST /groups - Set MQTT group membership (PROTECTED)
+    // ?groups=floor3,east-facade  (empty clears)
+    server.on("/groups", HTTP_POST, [this](AsyncWebServerRequest *request) {
+        if (!checkAuth(request)) return;
+
+        String groups;
+        if (request->hasParam("groups", true)) {
+            groups = request->getParam("groups", true)->value();
+        } else if (request->hasParam("groups")) {
+            groups = request->getParam("groups")->value();
+        } else {
+            request->send(400, "application/json", "{\"error\":\"Missing 'groups' parameter\"}");
+            return;
+        }
+
+        String normalized;
+        if (!MqttClient::normalizeGroups(groups, normalized)) {
+            request->send(400, "application/json",
+                          String("{\"error\":\"Invalid groups. Use up to ") + MQTT_MAX_GROUPS +
+                          " comma-separated names of a-z, 0-9, _ and -\"}");
+            return;
+        }
+
+        LOG_HTTP("POST /groups: %s", normalized.c_str());
+        if (!storage.setMqttGroups(normalized)) {
+            sendSaveFailed(request);
+            return;
+        }
+        if (_mqttGroupsCallback) {
+            _mqttGroupsCallback(normalized);
+        }
+
+        request->send(200, "application/json", buildGroupsJson());
+    });
+
+    // GET /schedule - On-device schedule rules and their next firing (PROTECTED)
+    server.on("/schedule", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        if (!checkAuth(request)) return;
+        LOG_HTTP("GET /schedule");
+        request->send(200, "application/json", buildScheduleJson());
+    });
+
+    // POST /schedule - Replace all schedule rules (PROTECTED)
+    // ?rules=weekdays 07:30 OPEN;daily sunset-20 CLOSE blind=1  (empty clears)
+    server.on("/schedule", HTTP_POST, [this](AsyncWebServerRequest *request) {
+        if (!checkAuth(request)) return;
+
+        String rules;
+        if (request->hasParam("rules", true)) {
+            rules = request->getParam("rules", true)->value();
+        } else if (request->hasParam("rules")) {
+            rules = request->getParam("rules")->value();
+        } else {
+            request->send(400, "application/json", "{\"error\":\"Missing 'rules' parameter\"}");
+            return;
+        }
+
+        String normalized;
+        if (!scheduler.setRules(rules, normalized)) {
+            LOG_HTTP("POST /schedule - invalid rules: %s", rules.c_str());
+            request->send(400, "application/json",
+                          String("{\"error\":\"Invalid rules. Use up to ") + SCHEDULE_MAX_RULES +
+                          " ';'-separated '[days] HH:MM|sunrise[+-N]|sunset[+-N] OPEN|CLOSE|STOP|POSITION:n [blind=N]'\"}");
+            return;
+        }
+
+        LOG_HTTP("POST /schedule: %s", normalized.isEmpty() ? "(none)" : normalized.c_str());
+        request->send(200, "application/json", buildScheduleJson());
+    });
+
+    // GET /location - Location and timezone used by the schedule (PROTECTED)
+    server.on("/location", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        if (!checkAuth(request)) return;
+        LOG_HTTP("GET /location");
+        request->send(200, "application/json", buildLocationJson());
+    });
+
+    // POST /location - Set location and timezone (PROTECTED)
+    // ?latitude=51.5074&longitude=-0.1278&timezone=GMT0BST,M3.5.0/1,M10.5.0  (no latitude = unset)
+    server.on("/location", HTTP_POST, [this](AsyncWebServerRequest *request) {
+        if (!checkAuth(request)) return;
+
+        auto param = [request](const char* name) -> String {
+            if (request->hasParam(name, true)) return request->getParam(name, true)->value();
+            if (request->hasParam(name)) return request->getParam(name)->value();
+            return "";
+        };
+
+        String latitude = param("latitude");
+        String location = latitude.isEmpty() ? String() : latitude + "," + param("longitude");
+        String timezone = param("timezone");
+        if (timezone.isEmpty()) {
+            timezone = storage.getTimezone();
+        }
+
+        if (!scheduler.setLocation(location, timezone)) {
+            LOG_HTTP("POST /location - invalid: %s, %s", location.c_str(), timezone.c_str());
+            request->send(400, "application/json",
+                "{\"error\":\"Invalid location. Need latitude (-90..90), longitude (-180..180) and a POSIX timezone\"}");
+            return;
+        }
+
+        LOG_HTTP("POST /location: %s, %s", location.isEmpty() ? "unset" : location.c_str(), timezone.c_str());
+        request->send(200, "application/json", buildLocationJson());
+    });
+
     // POST /factory-reset - Factory reset the device (clear all settings) (PROTECTED)
     server.on("/factory-reset", HTTP_POST, [this](AsyncWebServerRequest *request) {
         if (!checkAuth(request)) return;
@@ -453,8 +829,22 @@ void HttpServer::setupRoutes() {
     server.on("/logs", HTTP_GET, [this](AsyncWebServerRequest *request) {
         if (!checkAuth(request)) return;
         LOG_HTTP("GET /logs");
-        String logsJson = Logger::getLogsJson();
-        request->send(200, "application/json", "{\"logs\":" + logsJson + "}");
+
+        // Stream entries straight into the send buffer; ?since=<next> from a
+        // previous response returns only entries logged after it
+        uint32_t since = 0;
+        if (request->hasParam("since")) {
+            since = strtoul(request->getParam("since")->value().c_str(), nullptr, 10);
+        }
+        auto cursor = std::make_shared<LogCursor>();
+        Logger::beginLogsJson(*cursor, since);
+
+        AsyncWebServerResponse* response = request->beginChunkedResponse("application/json",
+            [cursor](uint8_t* buffer, size_t maxLen, size_t index) -> size_t {
+                return Logger::fillLogsJson(*cursor, buffer, maxLen);
+            });
+        response->addHeader("Cache-Control", "no-store");
+        request->send(response);
     });
 
     // DELETE /logs - Clear device logs (PROTECTED)
@@ -465,6 +855,58 @@ void HttpServer::setupRoutes() {
         request->send(200, "application/json", "{\"success\":true,\"message\":\"Logs cleared\"}");
     });
 
+    // GET /loglevel - Get per-category log levels (PROTECTED)
+    server.on("/loglevel", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        if (!checkAuth(request)) return;
+        LOG_HTTP("GET /loglevel");
+
+        JsonDocument doc;
+        JsonObject levels = doc["levels"].to<JsonObject>();
+        for (int i = 0; i < (int)LogCategory::COUNT; i++) {
+            LogCategory category = (LogCategory)i;
+            levels[Logger::getCategoryName(category)] = Logger::getLevelName(Logger::getLevel(category));
+        }
+        doc["compileLevel"] = Logger::getLevelName((LogLevel)LOG_COMPILE_LEVEL);
+        doc["dropped"] = Logger::getDroppedCount();
+
+        String output;
+        serializeJson(doc, output);
+        request->send(200, "application/json", output);
+    });
+
+    // POST /loglevel - Set log levels (PROTECTED)
+    // ?levels=servo=debug,http=warn  or  ?category=servo&level=debug
+    server.on("/loglevel", HTTP_POST, [this](AsyncWebServerRequest *request) {
+        if (!checkAuth(request)) return;
+
+        String spec;
+        if (request->hasParam("levels", true)) {
+            spec = request->getParam("levels", true)->value();
+        } else if (request->hasParam("category", true) && request->hasParam("level", true)) {
+            spec = request->getParam("category", true)->value() + "=" +
+                   request->getParam("level", true)->value();
+        } else {
+            request->send(400, "application/json", "{\"error\":\"Missing 'levels' or 'category'/'level' parameters\"}");
+            return;
+        }
+
+        LOG_HTTP("POST /loglevel: %s", spec.c_str());
+        if (!Logger::applyLevels(spec)) {
+            request->send(400, "application/json",
+                          "{\"error\":\"Invalid level spec. Use category=level (none|error|warn|info|debug|trace)\"}");
+            return;
+        }
+        storage.setLogLevels(Logger::getLevelsString());
+
+        JsonDocument response;
+        response["success"] = true;
+        response["levels"] = Logger::getLevelsString();
+
+        String responseStr;
+        serializeJson(response, responseStr);
+        request->send(200, "application/json", responseStr);
+    });
+
     // POST /wifi - Set WiFi configuration (for reconfiguration) (PROTECTED)
     server.on("/wifi", HTTP_POST, [this](AsyncWebServerRequest *request) {
         if (!checkAuth(request)) return;
@@ -489,8 +931,16 @@ void HttpServer::setupRoutes() {
             return;
         }
 
+        if (!checkLength(request, "SSID", ssid, WIFI_SSID_MAX_LENGTH) ||
+            !checkLength(request, "Password", password, WIFI_PASSWORD_MAX_LENGTH)) {
+            return;
+        }
+
         LOG_HTTP("POST /wifi: %s", ssid.c_str());
-        storage.setWifiCredentials(ssid, password);
+        if (!storage.setWifiCredentials(ssid, password)) {
+            sendSaveFailed(request);
+            return;
+        }
 
         JsonDocument response;
         response["success"] = true;
@@ -502,9 +952,93 @@ void HttpServer::setupRoutes() {
         request->send(200, "application/json", responseStr);
     });
 
+    // GET /network - Addressing mode and how the last connection was made (PROTECTED)
+    server.on("/network", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        if (!checkAuth(request)) return;
+        LOG_HTTP("GET /network");
+        request->send(200, "application/json", buildNetworkJson());
+    });
+
+    // POST /network - Set a static IP (PROTECTED)
+    // ?ip=192.168.1.50&gateway=192.168.1.1&subnet=255.255.255.0[&dns=...]  (no ip = DHCP)
+    server.on("/network", HTTP_POST, [this](AsyncWebServerRequest *request) {
+        if (!checkAuth(request)) return;
+
+        auto param = [request](const char* name) -> String {
+            if (request->hasParam(name, true)) return request->getParam(name, true)->value();
+            if (request->hasParam(name)) return request->getParam(name)->value();
+            return "";
+        };
+
+        String spec;
+        String ip = param("ip");
+        if (!ip.isEmpty()) {
+            spec = ip + "," + param("gateway") + "," + param("subnet");
+            String dns = param("dns");
+            if (!dns.isEmpty()) {
+                spec += "," + dns;
+            }
+
+            IPAddress addr, gateway, subnet, dnsAddr;
+            if (!WifiManager::parseStaticIp(spec, addr, gateway, subnet, dnsAddr)) {
+                LOG_HTTP("POST /network - invalid static IP: %s", spec.c_str());
+                request->send(400, "application/json",
+                    "{\"error\":\"Invalid address. Need ip, gateway and subnet (dns optional)\"}");
+                return;
+            }
+        }
+
+        LOG_HTTP("POST /network: %s", spec.isEmpty() ? "dhcp" : spec.c_str());
+        if (!storage.setStaticIp(spec)) {
+            sendSaveFailed(request);
+            return;
+        }
+
+        JsonDocument response;
+        response["success"] = true;
+        response["mode"] = spec.isEmpty() ? "dhcp" : "static";
+        response["message"] = "Network settings saved. Restart device to apply.";
+
+        String responseStr;
+        serializeJson(response, responseStr);
+        request->send(200, "application/json", responseStr);
+    });
+
+    // GET /power - Power mode and measured duty cycle
+    server.on("/power", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        LOG_HTTP("GET /power");
+        request->send(200, "application/json", buildPowerJson());
+    });
+
+    // POST /power - Set power mode (PROTECTED)
+    // ?mode=performance|balanced|low
+    server.on("/power", HTTP_POST, [this](AsyncWebServerRequest *request) {
+        if (!checkAuth(request)) return;
+        String name;
+        if (request->hasParam("mode", true)) {
+            name = request->getParam("mode", true)->value();
+        } else if (request->hasParam("mode")) {
+            name = request->getParam("mode")->value();
+        }
+
+        PowerMode mode;
+        if (!PowerManager::parseMode(name, mode)) {
+            LOG_HTTP("POST /power - invalid mode: %s", name.c_str());
+            request->send(400, "application/json",
+                "{\"error\":\"Invalid mode. Use 'performance', 'balanced' or 'low'\"}");
+            return;
+        }
+
+        LOG_HTTP("POST /power: %s", PowerManager::modeName(mode));
+        power.setMode(mode);
+        request->send(200, "application/json", buildPowerJson());
+    });
+
     // POST /orientation - Set device orientation (left or right) (PROTECTED)
     server.on("/orientation", HTTP_POST, [this](AsyncWebServerRequest *request) {
         if (!checkAuth(request)) return;
+        uint8_t blind;
+        if (!parseBlind(request, blind)) return;
         String orientation = "";
         if (request->hasParam("orientation", false)) {
             orientation = request->getParam("orientation", false)->value();
@@ -520,12 +1054,14 @@ void HttpServer::setupRoutes() {
             return;
         }
 
-        LOG_HTTP("POST /orientation: %s", orientation.c_str());
-        storage.setOrientation(orientation);
+        LOG_HTTP("POST /orientation: %s (blind %d)", orientation.c_str(), blind);
+        storage.setOrientation(orientation, blind);
 
         // Update servo controller immediately
-        extern ServoController servo;
-        servo.setInvertDirection(orientation == "right");
+        ServoController* controller = ServoController::forBlind(blind);
+        if (controller) {
+            controller->setInvertDirection(orientation == "right");
+        }
 
         JsonDocument response;
         response["success"] = true;
@@ -539,8 +1075,10 @@ void HttpServer::setupRoutes() {
 
     // GET /orientation - Get current device orientation
     server.on("/orientation", HTTP_GET, [this](AsyncWebServerRequest *request) {
-        LOG_HTTP("GET /orientation");
-        String orientation = storage.getOrientation();
+        uint8_t blind;
+        if (!parseBlind(request, blind)) return;
+        LOG_HTTP("GET /orientation (blind %d)", blind);
+        String orientation = storage.getOrientation(blind);
 
         JsonDocument response;
         response["orientation"] = orientation;
@@ -553,6 +1091,8 @@ void HttpServer::setupRoutes() {
     // POST /speed - Set servo speed (0-4095) (PROTECTED)
     server.on("/speed", HTTP_POST, [this](AsyncWebServerRequest *request) {
         if (!checkAuth(request)) return;
+        uint8_t blind;
+        if (!parseBlind(request, blind)) return;
         if (!request->hasParam("value", true)) {
             request->send(400, "application/json", "{\"error\":\"Missing 'value' parameter\"}");
             return;
@@ -567,8 +1107,8 @@ void HttpServer::setupRoutes() {
             return;
         }
 
-        LOG_HTTP("POST /speed: %d", speed);
-        storage.setServoSpeed(speed);
+        LOG_HTTP("POST /speed: %d (blind %d)", speed, blind);
+        storage.setServoSpeed(speed, blind);
         // Speed will be applied on next movement command or after restart
 
         JsonDocument response;
@@ -582,8 +1122,10 @@ void HttpServer::setupRoutes() {
 
     // GET /speed - Get current servo speed
     server.on("/speed", HTTP_GET, [this](AsyncWebServerRequest *request) {
-        LOG_HTTP("GET /speed");
-        uint16_t speed = storage.getServoSpeed();
+        uint8_t blind;
+        if (!parseBlind(request, blind)) return;
+        LOG_HTTP("GET /speed (blind %d)", blind);
+        uint16_t speed = storage.getServoSpeed(blind);
 
         JsonDocument response;
         response["speed"] = speed;
@@ -592,31 +1134,86 @@ void HttpServer::setupRoutes() {
         serializeJson(response, responseStr);
         request->send(200, "application/json", responseStr);
     });
+
+    // GET /blinds - Every blind on the servo bus
+    server.on("/blinds", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        LOG_DEBUG(HTTP, "GET /blinds");
+        request->send(200, "application/json", buildBlindsJson());
+    });
+
+    // GET /metrics - Performance counters in Prometheus text format
+    // (unprotected like /status, so scrapers need no password header)
+    server.on("/metrics", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        LOG_DEBUG(HTTP, "GET /metrics");
+
+        // One metric family is rendered per chunk into the cursor's buffer
+        auto cursor = std::make_shared<MetricsCursor>();
+        Metrics::beginPrometheus(*cursor);
+
+        AsyncWebServerResponse* response = request->beginChunkedResponse("text/plain; version=0.0.4",
+            [cursor](uint8_t* buffer, size_t maxLen, size_t index) -> size_t {
+                return Metrics::fillPrometheus(*cursor, buffer, maxLen);
+            });
+        response->addHeader("Cache-Control", "no-store");
+        request->send(response);
+    });
 }
 
-String HttpServer::buildStatusJson() {
-    JsonDocument doc;
+const StatusDocument& HttpServer::currentStatus() {
+    const StatusDocument& current = statusDocuments[statusCurrent];
+    uint32_t generation = deviceState.generation();
+    if (current.length > 0 && current.generation == generation) {
+        return current;
+    }
 
-    doc["state"] = _currentState;
-    doc["position"] = _currentPosition;
+    // Tagged with the generation of the snapshot actually rendered
+    DeviceStateSnapshot state = deviceState.snapshot();
+    uint8_t next = current.length > 0 ? statusCurrent ^ 1 : statusCurrent;
+    StatusDocument& rendered = statusDocuments[next];
+    BufferWriter out(rendered.json, STATUS_BUFFER_SIZE);
+    if (!StatusJson::render(out, state)) {
+        LOG_ERROR("Status JSON exceeds %d byte buffer", STATUS_BUFFER_SIZE);
+    }
+    rendered.generation = state.generation;
+    rendered.length = out.length();
+    statusCurrent = next;
+    return rendered;
+}
 
-    JsonObject wifi = doc["wifi"].to<JsonObject>();
-    wifi["ssid"] = _wifiSsid;
-    wifi["rssi"] = _wifiRssi;
-    wifi["ip"] = _wifiIp;
+size_t HttpServer::copyStatus(uint32_t generation, uint8_t* buffer, size_t maxLen, size_t index) {
+    lockStatus();
+    const StatusDocument* document = nullptr;
+    for (const StatusDocument& slot : statusDocuments) {
+        if (slot.length > 0 && slot.generation == generation) {
+            document = &slot;
+        }
+    }
 
-    // Calibration info
-    JsonObject calibration = doc["calibration"].to<JsonObject>();
-    calibration["calibrated"] = _calibrated;
-    calibration["cumulativePosition"] = _cumulativePosition;
-    calibration["maxPosition"] = _maxPosition;
-    calibration["state"] = _calibrationState;
+    size_t n = 0;
+    if (document && index < document->length) {
+        n = min(maxLen, document->length - index);
+        memcpy(buffer, document->json + index, n);
+    }
+    unlockStatus();
 
-    doc["uptime"] = millis() / 1000;
+    if (!document) {
+        // Only if the state moved twice while one response was in flight; the
+        // document fits the first TCP window, so this takes a stalled client
+        LOG_WARN(HTTP, "Status %lu superseded mid-response", (unsigned long)generation);
+    }
+    return n;
+}
 
-    String output;
-    serializeJson(doc, output);
-    return output;
+void HttpServer::lockStatus() {
+    if (_statusMutex) {
+        xSemaphoreTake(_statusMutex, portMAX_DELAY);
+    }
+}
+
+void HttpServer::unlockStatus() {
+    if (_statusMutex) {
+        xSemaphoreGive(_statusMutex);
+    }
 }
 
 String HttpServer::buildInfoJson() {
@@ -629,17 +1226,60 @@ String HttpServer::buildInfoJson() {
     doc["hostname"] = storage.getDeviceName();
     doc["orientation"] = storage.getOrientation();
     doc["speed"] = storage.getServoSpeed();
+    doc["blinds"] = BLIND_COUNT;
 
     // WiFi info (SSID only, no password for security)
-    doc["wifiSsid"] = _wifiSsid;
+    doc["wifiSsid"] = deviceState.snapshot().wifiSsid;
 
     // MQTT info (broker, port, and username - no password for security)
     doc["mqttBroker"] = storage.getMqttBroker();
     doc["mqttPort"] = storage.getMqttPort();
     doc["mqttUser"] = storage.getMqttUser();
+    doc["mqttGroups"] = storage.getMqttGroups();
 
     // Authentication info - tells apps whether a password is required
-    doc["passwordRequired"] = !storage.getDevicePassword().isEmpty();
+    doc["passwordRequired"] = storage.hasDevicePassword();
+
+    // NVS wear statistics
+    StorageStats stats = storage.getStats();
+    JsonObject nvs = doc["storage"].to<JsonObject>();
+    nvs["nvsWrites"] = stats.nvsWrites;
+    nvs["motionWrites"] = stats.motionWrites;
+    nvs["motionWritesLifetime"] = stats.motionWritesLifetime;
+    nvs["coalescedUpdates"] = stats.coalescedUpdates;
+    nvs["writesThisHour"] = stats.writesThisHour;
+    nvs["wearLimited"] = stats.wearLimited;
+
+    // Uptime, servo telemetry and SSE backpressure, kept out of /status so
+    // its ETag only moves with the state
+    char runtime[STATUS_RUNTIME_BUFFER_SIZE];
+    BufferWriter out(runtime, sizeof(runtime));
+    SseClientStats clients[SSE_MAX_CLIENTS];
+    int clientCount = 0;
+    xSemaphoreTakeRecursive(_sseMutex, portMAX_DELAY);
+    for (int i = 0; i < SSE_MAX_CLIENTS; i++) {
+        const SseClientSlot& slot = _sseClients[i];
+        if (!slot.client) continue;
+        clients[clientCount++] = {slot.queueDepth, slot.maxQueueDepth, slot.coalesced, slot.dropped};
+    }
+    uint32_t coalesced = _sseCoalescedTotal;
+    uint32_t dropped = _sseDroppedTotal;
+    xSemaphoreGiveRecursive(_sseMutex);
+    if (StatusJson::renderRuntime(out, deviceState.snapshot(), clients, clientCount,
+                                  coalesced, dropped, millis() / 1000)) {
+        doc["runtime"] = serialized(out.c_str(), out.length());
+    }
+
+    // Boot phases in ms since reset (first occurrence only)
+    JsonObject boot = doc["boot"].to<JsonObject>();
+    boot["mode"] = BootTimings::isProductionMode() ? "production" : "setup";
+    boot["fastConnect"] = wifi.wasFastConnect();
+    JsonObject phases = boot["phases"].to<JsonObject>();
+    const char* phase;
+    uint32_t ms;
+    for (size_t i = 0; BootTimings::get(i, phase, ms); i++) {
+        phases[phase] = ms;
+    }
 
     JsonObject endpoints = doc["endpoints"].to<JsonObject>();
     endpoints["status"] = "GET /status";
@@ -648,7 +1288,190 @@ String HttpServer::buildInfoJson() {
     endpoints["open"] = "POST /open";
     endpoints["close"] = "POST /close";
     endpoints["stop"] = "POST /stop";
+    endpoints["fast_command"] = "POST /c/<command> (no body, 204)";
     endpoints["update"] = "POST /update (multipart firmware binary)";
+    endpoints["metrics"] = "GET /metrics (Prometheus text)";
+    endpoints["schedule"] = "GET|POST /schedule ?rules=<rule>;<rule>";
+    endpoints["location"] = "GET|POST /location ?latitude&longitude&timezone";
+
+    String output;
+    serializeJson(doc, output);
+    return output;
+}
+
+String HttpServer::buildBlindsJson() {
+    JsonDocument doc;
+    DeviceStateSnapshot state = deviceState.snapshot();
+
+    JsonArray blinds = doc["blinds"].to<JsonArray>();
+    for (uint8_t i = 0; i < BLIND_COUNT; i++) {
+        const BlindSummary& summary = state.blinds[i];
+        JsonObject blind = blinds.add<JsonObject>();
+        blind["blind"] = i;
+        blind["servoId"] = storage.getServoId(i);
+        blind["connected"] = summary.servoConnected;
+        blind["state"] = summary.blindState;
+        blind["calibrated"] = summary.calibrated;
+        blind["calibrationState"] = summary.calibrationState;
+        blind["cumulativePosition"] = summary.cumulativePosition;
+        blind["maxPosition"] = summary.maxPosition;
+        int percent = summary.positionPercent();
+        if (percent >= 0) {
+            blind["percent"] = percent;
+        }
+        blind["orientation"] = storage.getOrientation(i);
+        blind["speed"] = storage.getServoSpeed(i);
+
+        // Learned per-direction drive profile and stalls since boot
+        ServoController* controller = ServoController::forBlind(i);
+        if (controller) {
+            JsonObject drive = blind["drive"].to<JsonObject>();
+            DriveProfile opening = controller->getDriveProfile(false);
+            DriveProfile closing = controller->getDriveProfile(true);
+            drive["open"]["speed"] = opening.speed;
+            drive["open"]["acceleration"] = opening.acceleration;
+            drive["close"]["speed"] = closing.speed;
+            drive["close"]["acceleration"] = closing.acceleration;
+            blind["stalls"] = controller->getStallCount();
+        }
+    }
+
+    String output;
+    serializeJson(doc, output);
+    return output;
+}
+
+String HttpServer::buildGroupsJson() {
+    JsonDocument doc;
+
+    JsonArray groups = doc["groups"].to<JsonArray>();
+    JsonArray topics = doc["topics"].to<JsonArray>();
+    String list = storage.getMqttGroups();
+    int start = 0;
+    while (start < (int)list.length()) {
+        int comma = list.indexOf(',', start);
+        if (comma < 0) {
+            comma = list.length();
+        }
+        String name = list.substring(start, comma);
+        if (!name.isEmpty()) {
+            groups.add(name);
+            topics.add(MqttClient::getGroupCommandTopic(name));
+        }
+        start = comma + 1;
+    }
+
+    // Scheduled starts need SNTP; apps can compare against their own clock
+    int64_t now;
+    bool synced = MqttClient::getEpochMillis(now);
+    doc["timeSynced"] = synced;
+    if (synced) {
+        doc["time"] = now;
+    }
+
+    String output;
+    serializeJson(doc, output);
+    return output;
+}
+
+String HttpServer::buildPowerJson() {
+    JsonDocument doc;
+    doc["mode"] = PowerManager::modeName(power.getMode());
+    doc["idle"] = power.isIdle();
+    doc["lightSleepAvailable"] = power.isLightSleepAvailable();
+    doc["lightSleep"] = power.isLightSleepActive();
+    doc["dutyCycle"] = roundf(power.getDutyCycle() * 100.0f) / 100.0f;  // % over the last window
+
+    String output;
+    serializeJson(doc, output);
+    return output;
+}
+
+String HttpServer::buildNetworkJson() {
+    JsonDocument doc;
+
+    String spec = storage.getStaticIp();
+    doc["mode"] = spec.isEmpty() ? "dhcp" : "static";
+    IPAddress ip, gateway, subnet, dns;
+    if (!spec.isEmpty() && WifiManager::parseStaticIp(spec, ip, gateway, subnet, dns)) {
+        JsonObject config = doc["static"].to<JsonObject>();
+        config["ip"] = ip.toString();
+        config["gateway"] = gateway.toString();
+        config["subnet"] = subnet.toString();
+        config["dns"] = dns.toString();
+    }
+
+    doc["ip"] = wifi.getIPAddress();
+    doc["fastConnect"] = wifi.wasFastConnect();     // Last join skipped the scan
+    doc["lastConnectMs"] = wifi.getLastConnectMs();
+
+    WifiFastRecord record;
+    doc["fastConnectReady"] = storage.getWifiFastRecord(record);
+
+    String output;
+    serializeJson(doc, output);
+    return output;
+}
+
+String HttpServer::buildScheduleJson() {
+    JsonDocument doc;
+
+    ScheduleRule rules[SCHEDULE_MAX_RULES];
+    int64_t next[SCHEDULE_MAX_RULES];
+    int count = scheduler.getRules(rules, next, SCHEDULE_MAX_RULES);
+
+    JsonArray list = doc["rules"].to<JsonArray>();
+    char text[64];
+    for (int i = 0; i < count; i++) {
+        JsonObject rule = list.add<JsonObject>();
+        rule["rule"] = Schedule::format(rules[i], text, sizeof(text));
+        if (next[i] != 0) {
+            rule["next"] = next[i];       // Epoch seconds
+        }
+    }
+    doc["fired"] = scheduler.getFiredCount();
+    doc["skipped"] = scheduler.getSkippedCount();
+
+    // Rules only run once SNTP has set the clock
+    int64_t now;
+    bool synced = MqttClient::getEpochMillis(now);
+    doc["timeSynced"] = synced;
+    if (synced) {
+        doc["time"] = now;
+    }
+
+    String output;
+    serializeJson(doc, output);
+    return output;
+}
+
+String HttpServer::buildLocationJson() {
+    JsonDocument doc;
+
+    GeoLocation location = scheduler.getLocation();
+    if (location.valid) {
+        doc["latitude"] = location.latitude;
+        doc["longitude"] = location.longitude;
+    }
+    doc["timezone"] = storage.getTimezone();
+
+    // Today's sun times (local date), epoch seconds
+    time_t now = time(nullptr);
+    if (location.valid && now >= (time_t)NTP_VALID_EPOCH) {
+        struct tm local;
+        localtime_r(&now, &local);
+        int64_t midnightUtc = Schedule::daysFromCivil(local.tm_year + 1900, local.tm_mon + 1,
+                                                      local.tm_mday) * 86400;
+        int32_t minutes;
+        if (Schedule::sunEvent(local.tm_year + 1900, local.tm_mon + 1, local.tm_mday,
+                               location, true, minutes)) {
+            doc["sunrise"] = midnightUtc + minutes * 60;
+        }
+        if (Schedule::sunEvent(local.tm_year + 1900, local.tm_mon + 1, local.tm_mday,
+                               location, false, minutes)) {
+            doc["sunset"] = midnightUtc + minutes * 60;
+        }
+    }
 
     String output;
     serializeJson(doc, output);
@@ -746,8 +1569,16 @@ void HttpServer::setupOTARoutes() {
     // Chunked OTA Update Protocol
     // ========================================
     // 1. POST /ota/begin?size=TOTAL_SIZE - Initialize update
+    //    Response negotiates chunkSize and window (chunks allowed in flight)
+    //    &id=IMAGE_ID&resume=1 continues an existing session for the same
+    //    image from the returned offset/nextIndex instead of starting over
     // 2. POST /ota/chunk?index=N&crc=CRC32 - Send chunk (body is raw binary)
-    // 3. POST /ota/end - Finalize and verify
+    //    Each chunk is CRC-checked, buffered and flashed in index order by the
+    //    writer task; the response is sent once the chunk is queued
+    //    The uploaded file may be a plain app image or a compressed/delta
+    //    package from merge_firmware.py (see ota_decoder.h)
+    // 3. POST /ota/end - Finalize and verify on the writer task; 202 with
+    //    Retry-After until done, then 200 (restarts) or an error
     // 4. GET /ota/status - Check progress
     // ========================================
 
@@ -762,124 +1593,224 @@ void HttpServer::setupOTARoutes() {
         size_t totalSize = request->getParam("size")->value().toInt();
         LOG_HTTP("OTA begin: total size = %d bytes, free heap = %d", totalSize, ESP.getFreeHeap());
 
-        if (totalSize == 0 || totalSize > 2000000) {  // Max 2MB for OTA partition
+        if (totalSize == 0 || totalSize > OTA_MAX_IMAGE_SIZE) {
             request->send(400, "application/json", "{\"success\":false,\"error\":\"Invalid firmware size\"}");
             return;
         }
 
-        _otaInProgress = true;
-        _otaReceived = 0;
-        _otaTotal = totalSize;
+        String imageId = request->hasParam("id") ? request->getParam("id")->value() : String();
+        bool resume = request->hasParam("resume") && request->getParam("resume")->value() == "1";
 
-        if (!Update.begin(totalSize, U_FLASH)) {
-            LOG_HTTP("OTA begin failed: %s", Update.errorString());
-            _otaInProgress = false;
-            request->send(500, "application/json",
-                "{\"success\":false,\"error\":\"" + String(Update.errorString()) + "\"}");
-            return;
-        }
+        // Resume: keep the session a dropped client left behind if it is for the
+        // same image, and tell the client where to carry on
+        bool resumed = resume && _ota.canResume(totalSize, imageId.c_str());
+        size_t chunkSize = _ota.chunkCapacity();
+        uint8_t window = _ota.window();
 
-        LOG_HTTP("OTA Update.begin() successful");
+        if (resumed) {
+            LOG_HTTP("OTA resumed at chunk %u (%u of %u bytes flashed)",
+                     (unsigned)_ota.nextIndex(), (unsigned)_ota.committed(), (unsigned)totalSize);
+        } else {
+            if (!_ota.begin(totalSize, imageId.c_str(), chunkSize, window)) {
+                LOG_HTTP("OTA begin failed: %s", _ota.errorString());
+                request->send(500, "application/json",
+                    "{\"success\":false,\"error\":\"" + String(_ota.errorString()) + "\"}");
+                return;
+            }
+            LOG_HTTP("OTA session started");
+        }
 
         JsonDocument doc;
         doc["success"] = true;
-        doc["message"] = "OTA initialized";
+        doc["message"] = resumed ? "OTA resumed" : "OTA initialized";
         doc["totalSize"] = totalSize;
-        doc["chunkSize"] = 8192;  // Recommended chunk size (8KB fits in RAM easily)
+        doc["chunkSize"] = chunkSize;   // Largest accepted chunk; smaller chunks also work
+        doc["window"] = window;         // Chunks that may be in flight at once
+        doc["resumed"] = resumed;
+        doc["offset"] = resumed ? _ota.committed() : 0;     // Bytes flashed and verified
+        doc["nextIndex"] = resumed ? _ota.nextIndex() : 0;  // First chunk still needed
 
         String output;
         serializeJson(doc, output);
         request->send(200, "application/json", output);
     });
 
-    // POST /ota/chunk - Receive a chunk of firmware data
+    // POST /ota/chunk - Receive a chunk of firmware data (PROTECTED)
     server.on("/ota/chunk", HTTP_POST,
         [this](AsyncWebServerRequest *request) {
-            // Response sent after body is processed
-        },
-        nullptr,
-        [this](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
-            if (!_otaInProgress) {
+            // Runs once the whole body has been buffered
+            if (!checkAuth(request)) return;
+            OtaChunkContext* ctx = (OtaChunkContext*)request->_tempObject;
+            if (!ctx) {
+                request->send(400, "application/json", "{\"success\":false,\"error\":\"Empty chunk\"}");
                 return;
             }
 
-            // For chunked uploads, each request is one chunk
-            // index is offset within THIS request's body
-            if (index == 0) {
-                // Get expected CRC from query param
-                uint32_t expectedCrc = 0;
-                if (request->hasParam("crc")) {
-                    expectedCrc = strtoul(request->getParam("crc")->value().c_str(), NULL, 16);
-                }
+            if (!ctx->error && ctx->length != request->contentLength()) {
+                ctx->status = 400;
+                ctx->error = "Incomplete chunk";
+            }
 
-                // Store for verification after all data received
-                request->_tempObject = new uint32_t(expectedCrc);
+            uint8_t* buffer = ctx->error ? nullptr : _ota.buffer(ctx->slot, ctx->session);
+            if (!ctx->error && !buffer) {
+                ctx->status = 400;
+                ctx->error = "No OTA in progress";
             }
 
-            // Write data directly to flash
-            if (len > 0) {
-                size_t written = Update.write(data, len);
-                if (written != len) {
-                    LOG_HTTP("OTA chunk write failed: %s", Update.errorString());
-                    JsonDocument doc;
-                    doc["success"] = false;
-                    doc["error"] = Update.errorString();
-                    String output;
-                    serializeJson(doc, output);
-                    request->send(500, "application/json", output);
-                    return;
+            if (buffer && ctx->hasCrc) {
+                uint32_t crc = esp_rom_crc32_le(0, buffer, ctx->length);
+                if (crc != ctx->expectedCrc) {
+                    LOG_HTTP("OTA chunk %u CRC mismatch: expected %08x, got %08x",
+                             (unsigned)ctx->index, (unsigned)ctx->expectedCrc, (unsigned)crc);
+                    ctx->status = 400;
+                    ctx->error = "CRC mismatch";
                 }
-                _otaReceived += len;
             }
 
-            // When full chunk received
-            if (index + len >= total) {
-                // Clean up temp object
-                if (request->_tempObject) {
-                    delete (uint32_t*)request->_tempObject;
-                    request->_tempObject = nullptr;
+            if (ctx->error) {
+                _ota.release(ctx->slot, ctx->session);
+                ctx->slot = -1;
+                AsyncWebServerResponse* response = request->beginResponse(ctx->status, "application/json",
+                    "{\"success\":false,\"error\":\"" + String(ctx->error) + "\"}");
+                if (ctx->status == 503) {
+                    response->addHeader("Retry-After", String(OTA_BUSY_RETRY_AFTER_S));
                 }
+                request->send(response);
+                return;
+            }
 
-                LOG_HTTP("OTA chunk received: %d/%d bytes (%d%%)",
-                    _otaReceived, _otaTotal, (_otaReceived * 100) / _otaTotal);
+            OtaSubmitResult result = _ota.submit(ctx->slot, ctx->session, ctx->index, ctx->length);
+            ctx->slot = -1;  // Owned by the writer now
 
+            if (result == OTA_SUBMIT_OUT_OF_WINDOW) {
                 JsonDocument doc;
-                doc["success"] = true;
-                doc["received"] = _otaReceived;
-                doc["total"] = _otaTotal;
-                doc["progress"] = (_otaReceived * 100) / _otaTotal;
-
+                doc["success"] = false;
+                doc["error"] = "Chunk outside window";
+                doc["next"] = _ota.nextIndex();
                 String output;
                 serializeJson(doc, output);
-                request->send(200, "application/json", output);
+                request->send(409, "application/json", output);
+                return;
+            }
+
+            if (result == OTA_SUBMIT_FAILED || _ota.hasError()) {
+                LOG_HTTP("OTA chunk write failed: %s", _ota.errorString());
+                request->send(500, "application/json",
+                    "{\"success\":false,\"error\":\"" + String(_ota.errorString()) + "\"}");
+                return;
+            }
+
+            size_t received = _ota.received();
+            size_t total = _ota.total();
+            LOG_HTTP("OTA chunk %u %s: %d/%d bytes (%d%%)", (unsigned)ctx->index,
+                result == OTA_SUBMIT_DUPLICATE ? "duplicate" : "queued",
+                received, total, (received * 100) / total);
+
+            JsonDocument doc;
+            doc["success"] = true;
+            doc["received"] = received;
+            doc["committed"] = _ota.committed();
+            doc["total"] = total;
+            doc["progress"] = (received * 100) / total;
+
+            String output;
+            serializeJson(doc, output);
+            request->send(200, "application/json", output);
+        },
+        nullptr,
+        [this](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+            // For chunked uploads, each request is one chunk
+            // index is offset within THIS request's body
+            OtaChunkContext* ctx = (OtaChunkContext*)request->_tempObject;
+
+            if (index == 0) {
+                // Freed with free() by the request destructor
+                ctx = (OtaChunkContext*)calloc(1, sizeof(OtaChunkContext));
+                if (!ctx) return;
+                request->_tempObject = ctx;
+                ctx->slot = -1;
+                ctx->status = 200;
+
+                if (!isAuthorized(request)) {
+                    ctx->error = "Unauthorized";  // Handler sends the 401
+                } else if (!_ota.isActive()) {
+                    ctx->status = 400;
+                    ctx->error = "No OTA in progress";
+                } else if (!request->hasParam("index")) {
+                    ctx->status = 400;
+                    ctx->error = "Missing index parameter";
+                } else if (total > _ota.chunkCapacity()) {
+                    ctx->status = 413;
+                    ctx->error = "Chunk larger than negotiated chunkSize";
+                } else {
+                    ctx->index = strtoul(request->getParam("index")->value().c_str(), nullptr, 10);
+                    if (request->hasParam("crc")) {
+                        ctx->hasCrc = true;
+                        ctx->expectedCrc = strtoul(request->getParam("crc")->value().c_str(), nullptr, 16);
+                    }
+
+                    // Never block async_tcp: with every buffer queued or being
+                    // flashed the client gets a 503 and resends after Retry-After
+                    ctx->slot = _ota.acquire(OTA_SLOT_WAIT_MS, ctx->session);
+                    if (ctx->slot < 0) {
+                        ctx->status = 503;
+                        ctx->error = "OTA writer busy";
+                    } else {
+                        // Return the buffer if the client goes away mid-chunk
+                        request->onDisconnect([this, request]() {
+                            OtaChunkContext* c = (OtaChunkContext*)request->_tempObject;
+                            if (c && c->slot >= 0) {
+                                _ota.release(c->slot, c->session);
+                                c->slot = -1;
+                            }
+                        });
+                    }
+                }
+            }
+
+            if (!ctx || ctx->error || ctx->slot < 0) return;
+
+            uint8_t* buffer = _ota.buffer(ctx->slot, ctx->session);
+            if (!buffer || index + len > _ota.chunkCapacity()) {
+                ctx->status = 400;
+                ctx->error = buffer ? "Chunk larger than negotiated chunkSize" : "No OTA in progress";
+                return;
             }
+
+            memcpy(buffer + index, data, len);
+            ctx->length = index + len;
         }
     );
 
     // POST /ota/end - Finalize OTA update (PROTECTED)
+    // Flashing the last chunks and verifying the image run on the writer
+    // task; until it is done the client gets a 202 and posts again after
+    // Retry-After
     server.on("/ota/end", HTTP_POST, [this](AsyncWebServerRequest *request) {
         if (!checkAuth(request)) return;
-        if (!_otaInProgress) {
-            request->send(400, "application/json", "{\"success\":false,\"error\":\"No OTA in progress\"}");
-            return;
-        }
 
-        LOG_HTTP("OTA end: received %d of %d bytes", _otaReceived, _otaTotal);
+        switch (_ota.end()) {
+            case OTA_END_NO_SESSION:
+                request->send(400, "application/json", "{\"success\":false,\"error\":\"No OTA in progress\"}");
+                return;
 
-        _otaInProgress = false;
+            case OTA_END_PENDING: {
+                AsyncWebServerResponse* response = request->beginResponse(202, "application/json",
+                    "{\"success\":true,\"pending\":true,\"message\":\"Finishing update\"}");
+                response->addHeader("Retry-After", String(OTA_FINISH_RETRY_AFTER_S));
+                request->send(response);
+                return;
+            }
 
-        if (_otaReceived != _otaTotal) {
-            Update.abort();
-            LOG_HTTP("OTA aborted: incomplete upload");
-            request->send(400, "application/json", "{\"success\":false,\"error\":\"Incomplete upload\"}");
-            return;
-        }
+            case OTA_END_FAILED: {
+                bool incomplete = _ota.committed() != _ota.total();
+                request->send(incomplete ? 400 : 500, "application/json",
+                    "{\"success\":false,\"error\":\"" + String(_ota.errorString()) + "\"}");
+                return;
+            }
 
-        if (!Update.end(true)) {
-            LOG_HTTP("OTA end failed: %s", Update.errorString());
-            request->send(500, "application/json",
-                "{\"success\":false,\"error\":\"" + String(Update.errorString()) + "\"}");
-            return;
+            case OTA_END_DONE:
+                break;
         }
 
         LOG_HTTP("OTA Update.end() successful - firmware ready, restarting...");
@@ -891,11 +1822,8 @@ void HttpServer::setupOTARoutes() {
     // POST /ota/abort - Cancel OTA update (PROTECTED)
     server.on("/ota/abort", HTTP_POST, [this](AsyncWebServerRequest *request) {
         if (!checkAuth(request)) return;
-        if (_otaInProgress) {
-            Update.abort();
-            _otaInProgress = false;
-            _otaReceived = 0;
-            _otaTotal = 0;
+        if (_ota.isActive()) {
+            _ota.abort();
             LOG_HTTP("OTA aborted by user");
         }
         request->send(200, "application/json", "{\"success\":true,\"message\":\"OTA aborted\"}");
@@ -905,11 +1833,26 @@ void HttpServer::setupOTARoutes() {
     server.on("/ota/status", HTTP_GET, [this](AsyncWebServerRequest *request) {
         if (!checkAuth(request)) return;
         JsonDocument doc;
-        doc["inProgress"] = _otaInProgress;
-        doc["received"] = _otaReceived;
-        doc["total"] = _otaTotal;
-        if (_otaTotal > 0) {
-            doc["progress"] = (_otaReceived * 100) / _otaTotal;
+        doc["inProgress"] = _ota.isActive();
+        doc["received"] = _ota.received();
+        doc["committed"] = _ota.committed();
+        doc["total"] = _ota.total();
+        if (_ota.total() > 0) {
+            doc["progress"] = (_ota.received() * 100) / _ota.total();
+        }
+        if (_ota.isActive()) {
+            doc["chunkSize"] = _ota.chunkCapacity();
+            doc["window"] = _ota.window();
+            doc["nextIndex"] = _ota.nextIndex();
+        }
+        if (_ota.isActive()) {
+            doc["finishing"] = _ota.isFinishing();
+            doc["format"] = _ota.decoder().formatName();   // raw, compressed or delta
+            doc["imageSize"] = _ota.decoder().imageSize();
+            doc["imageWritten"] = _ota.decoder().written();
+        }
+        if (_ota.hasError()) {
+            doc["error"] = _ota.errorString();
         }
         doc["freeHeap"] = ESP.getFreeHeap();
 
@@ -925,42 +1868,50 @@ void HttpServer::setupSSE() {
     // Configure SSE event source for status updates (PROTECTED)
     // Use authorizeConnect to check auth before allowing connection
     events.authorizeConnect([](AsyncWebServerRequest *request) {
-        String storedPassword = storage.getDevicePassword();
-        if (storedPassword.isEmpty()) {
+        if (!storage.hasDevicePassword()) {
             return true;  // No password set, allow
         }
         if (!request->hasHeader("X-Device-Password")) {
             LOG_HTTP("SSE /events auth failed: missing header");
             return false;
         }
-        if (request->header("X-Device-Password") != storedPassword) {
+        if (!storage.checkDevicePassword(request->header("X-Device-Password"))) {
             LOG_HTTP("SSE /events auth failed: wrong password");
             return false;
         }
         return true;
     });
 
-    events.onConnect([](AsyncEventSourceClient *client) {
+    events.onConnect([this](AsyncEventSourceClient *client) {
         if (client->lastId()) {
             LOG_HTTP("SSE status client reconnected, last ID: %u", client->lastId());
         } else {
             LOG_HTTP("SSE status client connected");
         }
-        // Send initial state on connect
+        if (!registerSseClient(client)) {
+            LOG_WARN(HTTP, "SSE status client limit (%d) reached, closing", SSE_MAX_CLIENTS);
+            client->close();
+            return;
+        }
+        // Send initial state on connect; the status follows from the main loop
         client->send("connected", "open", millis());
     });
 
+    events.onDisconnect([this](AsyncEventSourceClient *client) {
+        unregisterSseClient(client);
+        LOG_HTTP("SSE status client disconnected");
+    });
+
     // Configure separate SSE event source for log streaming (PROTECTED)
     logEvents.authorizeConnect([](AsyncWebServerRequest *request) {
-        String storedPassword = storage.getDevicePassword();
-        if (storedPassword.isEmpty()) {
+        if (!storage.hasDevicePassword()) {
             return true;  // No password set, allow
         }
         if (!request->hasHeader("X-Device-Password")) {
             LOG_HTTP("SSE /events/logs auth failed: missing header");
             return false;
         }
-        if (request->header("X-Device-Password") != storedPassword) {
+        if (!storage.checkDevicePassword(request->header("X-Device-Password"))) {
             LOG_HTTP("SSE /events/logs auth failed: wrong password");
             return false;
         }
@@ -976,46 +1927,237 @@ void HttpServer::setupSSE() {
         client->send("connected", "open", millis());
     });
 
-    // Add both event sources to server
+    // Configure delta event source (PROTECTED, same auth as /events)
+    deltaEvents.authorizeConnect([](AsyncWebServerRequest *request) {
+        if (!storage.hasDevicePassword()) {
+            return true;  // No password set, allow
+        }
+        if (!request->hasHeader("X-Device-Password")) {
+            LOG_HTTP("SSE /events/delta auth failed: missing header");
+            return false;
+        }
+        if (!storage.checkDevicePassword(request->header("X-Device-Password"))) {
+            LOG_HTTP("SSE /events/delta auth failed: wrong password");
+            return false;
+        }
+        return true;
+    });
+
+    deltaEvents.onConnect([this](AsyncEventSourceClient *client) {
+        LOG_HTTP("SSE delta client connected");
+        // New clients start from a full keyframe; later deltas apply on top of it
+        lockStatus();
+        client->send(currentStatus().json, "keyframe", _deltaId);
+        unlockStatus();
+    });
+
+    // Add all event sources to server
     server.addHandler(&events);
     server.addHandler(&logEvents);
+    server.addHandler(&deltaEvents);
 
-    LOG_HTTP("SSE endpoints configured: /events (status), /events/logs (logs)");
+    LOG_HTTP("SSE endpoints configured: /events (status), /events/logs (logs), /events/delta (deltas)");
 }
 
 void HttpServer::broadcastStateIfChanged() {
     // Only broadcast if there are connected clients
-    if (events.count() == 0) return;
+    if (events.count() == 0 && deltaEvents.count() == 0) {
+        _pendingBroadcast = 0;
+        return;
+    }
 
-    // Check if anything changed
-    bool stateChanged = (_currentState != _lastBroadcastState);
-    bool positionChanged = (_cumulativePosition != _lastBroadcastPosition);
-    bool calibrationChanged = (_calibrationState != _lastBroadcastCalibrationState);
+    unsigned long now = millis();
 
-    if (!stateChanged && !positionChanged && !calibrationChanged) {
-        return;  // Nothing changed, don't broadcast
+    // Periodic keyframe so delta clients recover from anything they missed
+    if (deltaEvents.count() > 0 && now - _lastKeyframeTime >= STATUS_DELTA_KEYFRAME_MS) {
+        _lastKeyframeTime = now;
+        _deltaBase = deviceState.snapshot();
+        MetricScope timer(MetricTimer::SSE_SEND);
+        lockStatus();
+        deltaEvents.send(currentStatus().json, "keyframe", ++_deltaId);
+        unlockStatus();
     }
 
-    // Rate limit broadcasts to prevent overwhelming multiple clients
-    // State changes (open/close/stop) are sent immediately
-    // Position-only changes during movement are throttled to 50ms min interval
-    unsigned long now = millis();
-    if (!stateChanged && !calibrationChanged && positionChanged) {
-        // Position-only change - throttle to avoid flooding
-        if (now - _lastBroadcastTime < 50) {
-            return;  // Skip this update, next one will include the change
+    // Fold pending changes into a new sequence number; clients behind it
+    // get the latest status when their own rate allows
+    if (_pendingBroadcast != 0) {
+        _broadcastSeq++;
+        if (_pendingBroadcast & ~STATE_CHANGE_POSITION) {
+            _urgentSeq = _broadcastSeq;  // State changes (open/close/stop) skip the throttle
+        }
+        _pendingBroadcast = 0;
+    }
+
+    if (events.count() > 0) {
+        sendStatusToClients(now);
+    }
+
+    // Delta stream is tiny, so it keeps the shared 50ms throttle
+    if (deltaEvents.count() == 0) {
+        _deltaSentSeq = _broadcastSeq;  // New clients start from a keyframe
+    } else if (_deltaSentSeq != _broadcastSeq &&
+               (_deltaSentSeq < _urgentSeq || now - _lastBroadcastTime >= SSE_MIN_INTERVAL_MS)) {
+        _deltaSentSeq = _broadcastSeq;
+        _lastBroadcastTime = now;
+        broadcastDelta(now);
+    }
+}
+
+void HttpServer::sendStatusToClients(unsigned long now) {
+    xSemaphoreTakeRecursive(_sseMutex, portMAX_DELAY);
+    for (int i = 0; i < SSE_MAX_CLIENTS; i++) {
+        SseClientSlot& slot = _sseClients[i];
+        if (!slot.client || slot.sentSeq == _broadcastSeq) continue;
+
+        size_t depth = slot.client->packetsWaiting();
+        slot.queueDepth = depth;
+        if (depth > slot.maxQueueDepth) {
+            slot.maxQueueDepth = depth;
+        }
+
+        if (depth >= SSE_CLIENT_QUEUE_LIMIT) {
+            // Queue full - wait for it to drain, the latest state goes out then
+            if (slot.droppedSeq != _broadcastSeq) {
+                slot.droppedSeq = _broadcastSeq;
+                slot.dropped++;
+            }
+            continue;
+        }
+
+        // Interval doubles with every queued message: 50, 100, 200... ms
+        unsigned long interval = min((unsigned long)SSE_MIN_INTERVAL_MS << depth,
+                                     (unsigned long)SSE_MAX_INTERVAL_MS);
+        bool urgent = slot.sentSeq < _urgentSeq;
+        if (!urgent && now - slot.lastSend < interval) {
+            continue;  // Coalesce - the next send carries the latest state
+        }
+
+        if (slot.sentSeq != 0 && _broadcastSeq - slot.sentSeq > 1) {
+            slot.coalesced += _broadcastSeq - slot.sentSeq - 1;
+        }
+        // Re-rendered only on the first send after a change
+        uint32_t start = Metrics::start();
+        lockStatus();
+        slot.client->send(currentStatus().json, "status", millis());
+        unlockStatus();
+        Metrics::record(MetricTimer::SSE_SEND, start);
+        slot.sentSeq = _broadcastSeq;
+        slot.lastSend = now;
+    }
+    xSemaphoreGiveRecursive(_sseMutex);
+}
+
+HttpServer::SseStats HttpServer::getSseStats() {
+    SseStats stats = {};
+    xSemaphoreTakeRecursive(_sseMutex, portMAX_DELAY);
+    stats.coalesced = _sseCoalescedTotal;
+    stats.dropped = _sseDroppedTotal;
+    for (int i = 0; i < SSE_MAX_CLIENTS; i++) {
+        const SseClientSlot& slot = _sseClients[i];
+        if (!slot.client) continue;
+        stats.clients++;
+        stats.queueDepth += slot.queueDepth;
+        stats.maxQueueDepth = max(stats.maxQueueDepth, slot.maxQueueDepth);
+        stats.coalesced += slot.coalesced;
+        stats.dropped += slot.dropped;
+    }
+    xSemaphoreGiveRecursive(_sseMutex);
+    return stats;
+}
+
+bool HttpServer::registerSseClient(AsyncEventSourceClient* client) {
+    bool registered = false;
+    xSemaphoreTakeRecursive(_sseMutex, portMAX_DELAY);
+    for (int i = 0; i < SSE_MAX_CLIENTS; i++) {
+        if (!_sseClients[i].client) {
+            _sseClients[i] = {};
+            _sseClients[i].client = client;
+            registered = true;
+            break;
         }
     }
+    xSemaphoreGiveRecursive(_sseMutex);
+    return registered;
+}
 
-    // Update tracking
-    _lastBroadcastState = _currentState;
-    _lastBroadcastPosition = _cumulativePosition;
-    _lastBroadcastCalibrationState = _calibrationState;
-    _lastBroadcastTime = now;
+void HttpServer::unregisterSseClient(AsyncEventSourceClient* client) {
+    xSemaphoreTakeRecursive(_sseMutex, portMAX_DELAY);
+    for (int i = 0; i < SSE_MAX_CLIENTS; i++) {
+        SseClientSlot& slot = _sseClients[i];
+        if (slot.client == client) {
+            _sseCoalescedTotal += slot.coalesced;
+            _sseDroppedTotal += slot.dropped;
+            slot = {};
+            break;
+        }
+    }
+    xSemaphoreGiveRecursive(_sseMutex);
+}
 
-    // Build and send status JSON to all clients
-    String json = buildStatusJson();
-    events.send(json.c_str(), "status", millis());
+void HttpServer::broadcastDelta(unsigned long now) {
+    DeviceStateSnapshot state = deviceState.snapshot();
+    const DeviceStateSnapshot& base = _deltaBase;
+    BufferWriter out(deltaBuffer, sizeof(deltaBuffer));
+
+    // Short keys, only for fields that differ from the last state sent:
+    // s=state p=position c=cumulativePosition m=maxPosition
+    // pct=percent k=calibrated cs=calibration state
+    out.print("{");
+    bool first = true;
+    auto key = [&](const char* name) {
+        out.print(first ? "\"" : ",\"");
+        out.print(name);
+        out.print("\":");
+        first = false;
+    };
+
+    if (strcmp(state.blindState, base.blindState ? base.blindState : "") != 0) {
+        key("s");
+        out.jsonString(state.blindState);
+    }
+    if (state.position != base.position) {
+        key("p");
+        out.printf("%d", state.position);
+    }
+    if (state.cumulativePosition != base.cumulativePosition) {
+        key("c");
+        out.printf("%ld", (long)state.cumulativePosition);
+    }
+    if (state.maxPosition != base.maxPosition) {
+        key("m");
+        out.printf("%ld", (long)state.maxPosition);
+    }
+    if (state.positionPercent() != base.positionPercent()) {
+        key("pct");
+        out.printf("%d", state.positionPercent());
+    }
+    if (state.calibrated != base.calibrated) {
+        key("k");
+        out.print(state.calibrated ? "1" : "0");
+    }
+    if (strcmp(state.calibrationState, base.calibrationState ? base.calibrationState : "") != 0) {
+        key("cs");
+        out.jsonString(state.calibrationState);
+    }
+    out.print("}");
+
+    _deltaBase = state;
+    if (first) {
+        return;  // Changes were reverted before we got here
+    }
+
+    if (out.overflowed()) {
+        // Shouldn't happen with short keys; fall back to a full document
+        _lastKeyframeTime = now;
+        MetricScope timer(MetricTimer::SSE_SEND);
+        lockStatus();
+        deltaEvents.send(currentStatus().json, "keyframe", ++_deltaId);
+        unlockStatus();
+        return;
+    }
+
+    MetricScope timer(MetricTimer::SSE_SEND);
+    deltaEvents.send(out.c_str(), "delta", ++_deltaId);
 }
 
 void HttpServer::broadcastLog(const char* logEntry) {
@@ -1023,6 +2165,7 @@ void HttpServer::broadcastLog(const char* logEntry) {
     if (logEvents.count() == 0) return;
 
     // Send log entry to log stream clients only
+    MetricScope timer(MetricTimer::SSE_SEND);
     logEvents.send(logEntry, "log", millis());
 }
 
@@ -1033,3 +2176,7 @@ int HttpServer::getEventClientCount() const {
 int HttpServer::getLogClientCount() const {
     return logEvents.count();
 }
+
+int HttpServer::getDeltaClientCount() const {
+    return deltaEvents.count();
+}
@@ -0,0 +1,209 @@
+#include "log_args.h"
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+
+// One printf conversion, as far as argument capture is concerned
+enum class ArgKind { NONE, INT, LONG, SIZE, LONGLONG, DOUBLE, STRING, POINTER, INVALID };
+
+struct FormatSpec {
+    const char* start;      // '%'
+    const char* end;        // One past the conversion character
+    int stars;              // '*' width/precision arguments (consume ints)
+    ArgKind kind;
+};
+
+// Parse the conversion at p (which points at '%'). Returns false at end of string.
+bool parseSpec(const char* p, FormatSpec& spec) {
+    spec.start = p;
+    spec.stars = 0;
+    spec.kind = ArgKind::INVALID;
+    p++;
+
+    if (*p == '%') {
+        spec.kind = ArgKind::NONE;
+        spec.end = p + 1;
+        return true;
+    }
+
+    while (*p && strchr("-+ #0", *p)) p++;                  // Flags
+    if (*p == '*') { spec.stars++; p++; }                    // Width
+    while (*p >= '0' && *p <= '9') p++;
+    if (*p == '.') {                                         // Precision
+        p++;
+        if (*p == '*') { spec.stars++; p++; }
+        while (*p >= '0' && *p <= '9') p++;
+    }
+
+    int longs = 0;
+    bool size = false;
+    while (*p && strchr("hlzjt", *p)) {                      // Length modifiers
+        if (*p == 'l') longs++;
+        if (*p == 'j') longs = 2;
+        if (*p == 'z' || *p == 't') size = true;
+        p++;
+    }
+
+    if (!*p) {
+        spec.end = p;
+        return false;
+    }
+
+    switch (*p) {
+        case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+            spec.kind = longs >= 2 ? ArgKind::LONGLONG
+                      : longs == 1 ? ArgKind::LONG
+                      : size ? ArgKind::SIZE : ArgKind::INT;
+            break;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+            spec.kind = ArgKind::DOUBLE;
+            break;
+        case 's':
+            spec.kind = ArgKind::STRING;
+            break;
+        case 'p':
+            spec.kind = ArgKind::POINTER;
+            break;
+        default:
+            spec.kind = ArgKind::INVALID;
+            break;
+    }
+    spec.end = p + 1;
+    return true;
+}
+
+// snprintf a single conversion with its '*' arguments
+template <typename T>
+int formatOne(char* out, size_t cap, const char* spec, int stars, const int* starArgs, T value) {
+    switch (stars) {
+        case 0:  return snprintf(out, cap, spec, value);
+        case 1:  return snprintf(out, cap, spec, starArgs[0], value);
+        default: return snprintf(out, cap, spec, starArgs[0], starArgs[1], value);
+    }
+}
+
+} // namespace
+
+void LogArgs::capture(const char* format, va_list ap) {
+    argCount = 0;
+    stringBytes = 0;
+
+    for (const char* p = format; *p; ) {
+        if (*p != '%') {
+            p++;
+            continue;
+        }
+
+        FormatSpec spec;
+        if (!parseSpec(p, spec)) break;
+        p = spec.end;
+
+        if (spec.kind == ArgKind::NONE) continue;
+        if (spec.kind == ArgKind::INVALID) break;  // Can't know the argument type - stop here
+
+        // Width/precision stars plus the value itself
+        if (argCount + spec.stars + 1 > LOG_MAX_ARGS) break;
+        for (int i = 0; i < spec.stars; i++) {
+            args[argCount++].i = va_arg(ap, int);
+        }
+
+        LogArg& arg = args[argCount++];
+        switch (spec.kind) {
+            case ArgKind::INT:      arg.i = va_arg(ap, int); break;
+            case ArgKind::LONG:     arg.i = (int32_t)va_arg(ap, long); break;
+            case ArgKind::SIZE:     arg.i = (int32_t)va_arg(ap, size_t); break;
+            case ArgKind::LONGLONG: arg.ll = va_arg(ap, long long); break;
+            case ArgKind::DOUBLE:   arg.d = va_arg(ap, double); break;
+            case ArgKind::POINTER:  arg.p = va_arg(ap, void*); break;
+            case ArgKind::STRING: {
+                // Copy now - the caller's buffer (often a temporary String) won't survive
+                const char* str = va_arg(ap, const char*);
+                if (!str) str = "(null)";
+                size_t room = LOG_STRING_ARG_BYTES - stringBytes;
+                if (room <= 1) {
+                    // Full: show it empty. The last byte is always the previous
+                    // argument's terminator (or is set here), never past the array.
+                    arg.str = LOG_STRING_ARG_BYTES - 1;
+                    strings[LOG_STRING_ARG_BYTES - 1] = '\0';
+                    stringBytes = LOG_STRING_ARG_BYTES;
+                    break;
+                }
+                size_t len = strnlen(str, room - 1);
+                arg.str = stringBytes;
+                memcpy(strings + stringBytes, str, len);
+                strings[stringBytes + len] = '\0';
+                stringBytes += len + 1;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
+size_t LogArgs::format(const char* format, char* out, size_t capacity) const {
+    size_t len = 0;
+    int argIndex = 0;
+
+    auto advance = [&](int written) {
+        if (written > 0) {
+            len += (size_t)written;
+            if (len >= capacity) len = capacity - 1;
+        }
+    };
+
+    for (const char* p = format; *p && len < capacity - 1; ) {
+        if (*p != '%') {
+            out[len++] = *p++;
+            continue;
+        }
+
+        FormatSpec spec;
+        bool complete = parseSpec(p, spec);
+        size_t specLen = spec.end - spec.start;
+        p = spec.end;
+
+        if (spec.kind == ArgKind::NONE) {
+            out[len++] = '%';
+            continue;
+        }
+
+        // Arguments past what was captured (or unknown conversions) are shown verbatim
+        if (!complete || spec.kind == ArgKind::INVALID || specLen >= 16 ||
+            argIndex + spec.stars + 1 > argCount) {
+            size_t n = specLen < capacity - 1 - len ? specLen : capacity - 1 - len;
+            memcpy(out + len, spec.start, n);
+            len += n;
+            if (!complete || spec.kind == ArgKind::INVALID) break;
+            continue;
+        }
+
+        char specText[16];
+        memcpy(specText, spec.start, specLen);
+        specText[specLen] = '\0';
+
+        int starArgs[2] = {0, 0};
+        for (int i = 0; i < spec.stars; i++) {
+            starArgs[i] = args[argIndex++].i;
+        }
+
+        const LogArg& arg = args[argIndex++];
+        char* dst = out + len;
+        size_t room = capacity - len;
+        switch (spec.kind) {
+            case ArgKind::INT:      advance(formatOne(dst, room, specText, spec.stars, starArgs, (int)arg.i)); break;
+            case ArgKind::LONG:     advance(formatOne(dst, room, specText, spec.stars, starArgs, (long)arg.i)); break;
+            case ArgKind::SIZE:     advance(formatOne(dst, room, specText, spec.stars, starArgs, (size_t)(uint32_t)arg.i)); break;
+            case ArgKind::LONGLONG: advance(formatOne(dst, room, specText, spec.stars, starArgs, (long long)arg.ll)); break;
+            case ArgKind::DOUBLE:   advance(formatOne(dst, room, specText, spec.stars, starArgs, arg.d)); break;
+            case ArgKind::POINTER:  advance(formatOne(dst, room, specText, spec.stars, starArgs, arg.p)); break;
+            case ArgKind::STRING:   advance(formatOne(dst, room, specText, spec.stars, starArgs,
+                                                      (const char*)(strings + arg.str))); break;
+            default: break;
+        }
+    }
+
+    out[len] = '\0';
+    return len;
+}
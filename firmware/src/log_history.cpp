@@ -0,0 +1,116 @@
+#include "log_history.h"
+#include <stdio.h>
+#include <string.h>
+
+void LogHistory::add(const char* entry) {
+    strncpy(_entries[_head], entry, LOG_ENTRY_SIZE - 1);
+    _entries[_head][LOG_ENTRY_SIZE - 1] = '\0';
+    _head = (_head + 1) % LOG_BUFFER_SIZE;
+    _nextSeq++;
+    if (_count < LOG_BUFFER_SIZE) {
+        _count++;
+    }
+}
+
+void LogHistory::clear() {
+    _head = 0;
+    _count = 0;
+    memset(_entries, 0, sizeof(_entries));
+}
+
+void LogHistory::begin(LogCursor& cursor, uint32_t since) const {
+    // Numbering starts at 1 on every boot, so a cursor at or past the next
+    // entry was handed out before a restart: read from the oldest entry
+    if (since >= _nextSeq) {
+        since = 0;
+    }
+
+    uint32_t oldest = oldestSeq();
+    cursor.firstSeq = oldest;
+    cursor.nextSeq = (since + 1 > oldest) ? since + 1 : oldest;
+    cursor.phase = 0;
+    cursor.needComma = false;
+    cursor.pendingLen = 0;
+    cursor.pendingPos = 0;
+}
+
+size_t LogHistory::fill(LogCursor& cursor, uint8_t* buffer, size_t maxLen) const {
+    size_t written = 0;
+
+    while (written < maxLen) {
+        if (cursor.pendingPos >= cursor.pendingLen) {
+            if (!nextPiece(cursor)) break;  // Done
+        }
+        size_t n = cursor.pendingLen - cursor.pendingPos;
+        if (n > maxLen - written) {
+            n = maxLen - written;
+        }
+        memcpy(buffer + written, cursor.pending + cursor.pendingPos, n);
+        cursor.pendingPos += n;
+        written += n;
+    }
+
+    return written;
+}
+
+bool LogHistory::nextPiece(LogCursor& cursor) const {
+    cursor.pendingPos = 0;
+    cursor.pendingLen = 0;
+
+    switch (cursor.phase) {
+        case 0:
+            cursor.pendingLen = snprintf(cursor.pending, sizeof(cursor.pending),
+                                         "{\"first\":%u,\"logs\":[", (unsigned)cursor.firstSeq);
+            cursor.phase = 1;
+            return true;
+
+        case 1: {
+            // Entries overwritten since the last call are skipped by jumping to
+            // the oldest one still present
+            uint32_t oldest = oldestSeq();
+            if (cursor.nextSeq < oldest) {
+                cursor.nextSeq = oldest;
+            }
+            if (cursor.nextSeq >= _nextSeq) {
+                cursor.phase = 2;
+                return nextPiece(cursor);
+            }
+
+            int start = (_count < LOG_BUFFER_SIZE) ? 0 : _head;
+            int idx = (start + (int)(cursor.nextSeq - oldest)) % LOG_BUFFER_SIZE;
+
+            char* out = cursor.pending;
+            size_t len = 0;
+            if (cursor.needComma) out[len++] = ',';
+            out[len++] = '"';
+
+            // Escape the log entry for JSON
+            for (const char* entry = _entries[idx]; *entry; entry++) {
+                char c = *entry;
+                if (c == '"') { out[len++] = '\\'; out[len++] = '"'; }
+                else if (c == '\\') { out[len++] = '\\'; out[len++] = '\\'; }
+                else if (c == '\n') { out[len++] = '\\'; out[len++] = 'n'; }
+                else if (c == '\r') { out[len++] = '\\'; out[len++] = 'r'; }
+                else if (c == '\t') { out[len++] = '\\'; out[len++] = 't'; }
+                else if (c >= 32 && c < 127) out[len++] = c;
+                // Skip other control characters
+            }
+
+            out[len++] = '"';
+            cursor.pendingLen = len;
+            cursor.needComma = true;
+            cursor.nextSeq++;
+            return true;
+        }
+
+        case 2:
+            // "next" is the cursor for the following ?since= request
+            cursor.pendingLen = snprintf(cursor.pending, sizeof(cursor.pending),
+                                         "],\"next\":%u}", (unsigned)(cursor.nextSeq - 1));
+            cursor.phase = 3;
+            return true;
+
+        default:
+            return false;
+    }
+}
@@ -1,24 +1,49 @@
 #include "logger.h"
+#include "metrics.h"
 #include <stdarg.h>
 
 bool Logger::_enabled = true;
-char Logger::_buffer[256];
 
-// Ring buffer storage
-char Logger::_logBuffer[LOG_BUFFER_SIZE][LOG_ENTRY_SIZE];
-int Logger::_logHead = 0;
-int Logger::_logCount = 0;
+// Deferred record queue
+Logger::LogRecord Logger::_queue[LOG_QUEUE_SLOTS];
+std::atomic<uint32_t> Logger::_enqueuePos(0);
+uint32_t Logger::_dequeuePos = 0;
+std::atomic<uint32_t> Logger::_dropped(0);
+bool Logger::_queueReady = false;
+TaskHandle_t Logger::_drainTask = nullptr;
+
+// Formatted history
+LogHistory Logger::_history;
+SemaphoreHandle_t Logger::_historyMutex = nullptr;
 
 // SSE broadcast callback
 LogBroadcastCallback Logger::_broadcastCallback = nullptr;
 
+static_assert((LOG_QUEUE_SLOTS & (LOG_QUEUE_SLOTS - 1)) == 0, "LOG_QUEUE_SLOTS must be a power of two");
+
 void Logger::setLogBroadcastCallback(LogBroadcastCallback callback) {
     _broadcastCallback = callback;
 }
 
 void Logger::init(unsigned long baudRate) {
     Serial.begin(baudRate);
+
+    if (!_historyMutex) {
+        _historyMutex = xSemaphoreCreateMutex();
+    }
     clearBuffer();
+
+    for (uint32_t i = 0; i < LOG_QUEUE_SLOTS; i++) {
+        _queue[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    _enqueuePos.store(0, std::memory_order_relaxed);
+    _dequeuePos = 0;
+    _queueReady = true;
+
+    if (!_drainTask) {
+        xTaskCreate(drainTask, "log", LOG_DRAIN_TASK_STACK, nullptr,
+                    LOG_DRAIN_TASK_PRIORITY, &_drainTask);
+    }
 }
 
 void Logger::waitForSerial(unsigned long timeoutMs) {
@@ -26,8 +51,10 @@ void Logger::waitForSerial(unsigned long timeoutMs) {
     while (!Serial && (millis() - start) < timeoutMs) {
         delay(10);
     }
-    // Small delay to ensure serial is fully ready
-    delay(100);
+    // Small delay to ensure serial is fully ready (nothing to wait for without a host)
+    if (Serial) {
+        delay(100);
+    }
 }
 
 void Logger::setEnabled(bool enabled) {
@@ -38,6 +65,121 @@ bool Logger::isEnabled() {
     return _enabled;
 }
 
+void Logger::setLevel(LogCategory category, LogLevel level) {
+    if ((int)category < 0 || category >= LogCategory::COUNT) return;
+    _levels[(int)category] = (uint8_t)level;
+}
+
+LogLevel Logger::getLevel(LogCategory category) {
+    if ((int)category < 0 || category >= LogCategory::COUNT) return LogLevel::NONE;
+    return (LogLevel)_levels[(int)category];
+}
+
+const char* Logger::getLevelName(LogLevel level) {
+    switch (level) {
+        case LogLevel::NONE:  return "none";
+        case LogLevel::ERROR: return "error";
+        case LogLevel::WARN:  return "warn";
+        case LogLevel::INFO:  return "info";
+        case LogLevel::DEBUG: return "debug";
+        case LogLevel::TRACE: return "trace";
+        default:              return "unknown";
+    }
+}
+
+const char* Logger::getCategoryName(LogCategory category) {
+    switch (category) {
+        case LogCategory::BOOT:  return "boot";
+        case LogCategory::WIFI:  return "wifi";
+        case LogCategory::BLE:   return "ble";
+        case LogCategory::MQTT:  return "mqtt";
+        case LogCategory::SERVO: return "servo";
+        case LogCategory::HTTP:  return "http";
+        case LogCategory::NVS:   return "nvs";
+        case LogCategory::HALL:  return "hall";
+        case LogCategory::ERROR: return "error";
+        default:                 return "unknown";
+    }
+}
+
+bool Logger::parseLevel(const String& name, LogLevel& level) {
+    for (int i = (int)LogLevel::NONE; i <= (int)LogLevel::TRACE; i++) {
+        if (name.equalsIgnoreCase(getLevelName((LogLevel)i))) {
+            level = (LogLevel)i;
+            return true;
+        }
+    }
+    // Numeric levels as used by LOG_COMPILE_LEVEL
+    if (name.length() == 1 && name[0] >= '0' && name[0] <= '5') {
+        level = (LogLevel)(name[0] - '0');
+        return true;
+    }
+    return false;
+}
+
+bool Logger::parseCategory(const String& name, LogCategory& category) {
+    for (int i = 0; i < (int)LogCategory::COUNT; i++) {
+        if (name.equalsIgnoreCase(getCategoryName((LogCategory)i))) {
+            category = (LogCategory)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Logger::applyLevels(const String& spec) {
+    uint8_t levels[(int)LogCategory::COUNT];
+    memcpy(levels, _levels, sizeof(levels));
+
+    int start = 0;
+    while (start < (int)spec.length()) {
+        int comma = spec.indexOf(',', start);
+        if (comma < 0) comma = spec.length();
+
+        String entry = spec.substring(start, comma);
+        entry.trim();
+        start = comma + 1;
+        if (entry.isEmpty()) continue;
+
+        int eq = entry.indexOf('=');
+        if (eq <= 0) return false;
+
+        String name = entry.substring(0, eq);
+        String value = entry.substring(eq + 1);
+        name.trim();
+        value.trim();
+
+        LogLevel level;
+        if (!parseLevel(value, level)) return false;
+
+        if (name == "*" || name.equalsIgnoreCase("all")) {
+            memset(levels, (uint8_t)level, sizeof(levels));
+        } else {
+            LogCategory category;
+            if (!parseCategory(name, category)) return false;
+            levels[(int)category] = (uint8_t)level;
+        }
+    }
+
+    memcpy(_levels, levels, sizeof(levels));
+    return true;
+}
+
+String Logger::getLevelsString() {
+    String spec;
+    for (int i = 0; i < (int)LogCategory::COUNT; i++) {
+        if (i > 0) spec += ",";
+        spec += getCategoryName((LogCategory)i);
+        spec += "=";
+        spec += getLevelName((LogLevel)_levels[i]);
+    }
+    return spec;
+}
+
+uint32_t Logger::getDroppedCount() {
+    return _dropped.load(std::memory_order_relaxed);
+}
+
 const char* Logger::getCategoryPrefix(LogCategory category) {
     switch (category) {
         case LogCategory::BOOT:  return "[BOOT]";
@@ -54,72 +196,121 @@ const char* Logger::getCategoryPrefix(LogCategory category) {
 }
 
 void Logger::addToBuffer(const char* entry) {
-    strncpy(_logBuffer[_logHead], entry, LOG_ENTRY_SIZE - 1);
-    _logBuffer[_logHead][LOG_ENTRY_SIZE - 1] = '\0';
-    _logHead = (_logHead + 1) % LOG_BUFFER_SIZE;
-    if (_logCount < LOG_BUFFER_SIZE) {
-        _logCount++;
-    }
+    xSemaphoreTake(_historyMutex, portMAX_DELAY);
+    _history.add(entry);
+    xSemaphoreGive(_historyMutex);
 }
 
 void Logger::clearBuffer() {
-    _logHead = 0;
-    _logCount = 0;
-    memset(_logBuffer, 0, sizeof(_logBuffer));
-}
-
-String Logger::getLogsJson() {
-    String json = "[";
-
-    // Calculate start position for reading (oldest entry)
-    int start = (_logCount < LOG_BUFFER_SIZE) ? 0 : _logHead;
-
-    for (int i = 0; i < _logCount; i++) {
-        int idx = (start + i) % LOG_BUFFER_SIZE;
-        if (i > 0) json += ",";
-
-        // Escape the log entry for JSON
-        json += "\"";
-        const char* entry = _logBuffer[idx];
-        while (*entry) {
-            char c = *entry++;
-            if (c == '"') json += "\\\"";
-            else if (c == '\\') json += "\\\\";
-            else if (c == '\n') json += "\\n";
-            else if (c == '\r') json += "\\r";
-            else if (c == '\t') json += "\\t";
-            else if (c >= 32 && c < 127) json += c;
-            // Skip other control characters
-        }
-        json += "\"";
-    }
+    if (_historyMutex) xSemaphoreTake(_historyMutex, portMAX_DELAY);
+    _history.clear();
+    if (_historyMutex) xSemaphoreGive(_historyMutex);
+}
+
+void Logger::beginLogsJson(LogCursor& cursor, uint32_t since) {
+    xSemaphoreTake(_historyMutex, portMAX_DELAY);
+    _history.begin(cursor, since);
+    xSemaphoreGive(_historyMutex);
+}
 
-    json += "]";
-    return json;
+size_t Logger::fillLogsJson(LogCursor& cursor, uint8_t* buffer, size_t maxLen) {
+    // One chunk is a few escaped entries copied into the response buffer
+    xSemaphoreTake(_historyMutex, portMAX_DELAY);
+    size_t written = _history.fill(cursor, buffer, maxLen);
+    xSemaphoreGive(_historyMutex);
+    return written;
 }
 
 void Logger::logVa(LogCategory category, const char* format, va_list args) {
-    vsnprintf(_buffer, sizeof(_buffer), format, args);
+    if (!_queueReady) return;
+
+    // Claim a slot without blocking; drop the record if the queue is full
+    uint32_t pos = _enqueuePos.load(std::memory_order_relaxed);
+    LogRecord* record;
+    for (;;) {
+        record = &_queue[pos & (LOG_QUEUE_SLOTS - 1)];
+        uint32_t seq = record->sequence.load(std::memory_order_acquire);
+        int32_t diff = (int32_t)(seq - pos);
+        if (diff == 0) {
+            if (_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            pos = _enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    record->timestamp = millis();
+    record->category = category;
+    record->format = format;
+    record->args.capture(format, args);
 
-    unsigned long timestamp = millis();
+    record->sequence.store(pos + 1, std::memory_order_release);
 
-    // Format the full log entry
-    char fullEntry[LOG_ENTRY_SIZE];
-    snprintf(fullEntry, sizeof(fullEntry), "%8lu %s %s",
-             timestamp, getCategoryPrefix(category), _buffer);
+    if (_drainTask) {
+        xTaskNotifyGive(_drainTask);
+    }
+}
+
+void Logger::emit(LogCategory category, const char* entry) {
+    MetricScope timer(MetricTimer::LOG_EMIT);
 
     // Add to ring buffer
-    addToBuffer(fullEntry);
+    addToBuffer(entry);
 
     // Also output to serial if enabled
     if (_enabled && Serial) {
-        Serial.println(fullEntry);
+        Serial.println(entry);
     }
 
     // Broadcast via SSE if callback is set
     // Skip HTTP logs to avoid recursive feedback (HTTP handlers log, which would broadcast, etc.)
     if (_broadcastCallback && category != LogCategory::HTTP) {
-        _broadcastCallback(fullEntry);
+        _broadcastCallback(entry);
+    }
+}
+
+void Logger::drain() {
+    static uint32_t reportedDrops = 0;
+    char entry[LOG_ENTRY_SIZE];
+
+    for (;;) {
+        LogRecord& record = _queue[_dequeuePos & (LOG_QUEUE_SLOTS - 1)];
+        uint32_t seq = record.sequence.load(std::memory_order_acquire);
+        if (seq != _dequeuePos + 1) {
+            break;  // Empty (or the producer is still filling the slot)
+        }
+
+        // Format the full log entry
+        int prefixLen = snprintf(entry, sizeof(entry), "%8lu %s ",
+                                 (unsigned long)record.timestamp, getCategoryPrefix(record.category));
+        if (prefixLen < 0 || prefixLen >= (int)sizeof(entry)) prefixLen = sizeof(entry) - 1;
+        record.args.format(record.format, entry + prefixLen, sizeof(entry) - prefixLen);
+        LogCategory category = record.category;
+
+        // Release the slot before the (slow) serial/SSE output
+        record.sequence.store(_dequeuePos + LOG_QUEUE_SLOTS, std::memory_order_release);
+        _dequeuePos++;
+
+        emit(category, entry);
+    }
+
+    uint32_t dropped = _dropped.load(std::memory_order_relaxed);
+    if (dropped != reportedDrops) {
+        snprintf(entry, sizeof(entry), "%8lu %s %u log messages dropped (queue full)",
+                 millis(), getCategoryPrefix(LogCategory::ERROR), (unsigned)(dropped - reportedDrops));
+        reportedDrops = dropped;
+        emit(LogCategory::ERROR, entry);
+    }
+}
+
+void Logger::drainTask(void* param) {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(LOG_DRAIN_INTERVAL_MS));
+        drain();
     }
 }
 
@@ -135,6 +326,7 @@ void Logger::log(LogCategory category, const String& message) {
 }
 
 void Logger::boot(const char* format, ...) {
+    if (!shouldLog(LogCategory::BOOT, LogLevel::INFO)) return;
     va_list args;
     va_start(args, format);
     logVa(LogCategory::BOOT, format, args);
@@ -142,6 +334,7 @@ void Logger::boot(const char* format, ...) {
 }
 
 void Logger::wifi(const char* format, ...) {
+    if (!shouldLog(LogCategory::WIFI, LogLevel::INFO)) return;
     va_list args;
     va_start(args, format);
     logVa(LogCategory::WIFI, format, args);
@@ -149,6 +342,7 @@ void Logger::wifi(const char* format, ...) {
 }
 
 void Logger::ble(const char* format, ...) {
+    if (!shouldLog(LogCategory::BLE, LogLevel::INFO)) return;
     va_list args;
     va_start(args, format);
     logVa(LogCategory::BLE, format, args);
@@ -156,6 +350,7 @@ void Logger::ble(const char* format, ...) {
 }
 
 void Logger::mqtt(const char* format, ...) {
+    if (!shouldLog(LogCategory::MQTT, LogLevel::INFO)) return;
     va_list args;
     va_start(args, format);
     logVa(LogCategory::MQTT, format, args);
@@ -163,6 +358,7 @@ void Logger::mqtt(const char* format, ...) {
 }
 
 void Logger::servo(const char* format, ...) {
+    if (!shouldLog(LogCategory::SERVO, LogLevel::INFO)) return;
     va_list args;
     va_start(args, format);
     logVa(LogCategory::SERVO, format, args);
@@ -170,6 +366,7 @@ void Logger::servo(const char* format, ...) {
 }
 
 void Logger::http(const char* format, ...) {
+    if (!shouldLog(LogCategory::HTTP, LogLevel::INFO)) return;
     va_list args;
     va_start(args, format);
     logVa(LogCategory::HTTP, format, args);
@@ -177,6 +374,7 @@ void Logger::http(const char* format, ...) {
 }
 
 void Logger::nvs(const char* format, ...) {
+    if (!shouldLog(LogCategory::NVS, LogLevel::INFO)) return;
     va_list args;
     va_start(args, format);
     logVa(LogCategory::NVS, format, args);
@@ -184,6 +382,7 @@ void Logger::nvs(const char* format, ...) {
 }
 
 void Logger::hall(const char* format, ...) {
+    if (!shouldLog(LogCategory::HALL, LogLevel::INFO)) return;
     va_list args;
     va_start(args, format);
     logVa(LogCategory::HALL, format, args);
@@ -191,6 +390,7 @@ void Logger::hall(const char* format, ...) {
 }
 
 void Logger::error(const char* format, ...) {
+    if (!shouldLog(LogCategory::ERROR, LogLevel::ERROR)) return;
     va_list args;
     va_start(args, format);
     logVa(LogCategory::ERROR, format, args);
@@ -1,7 +1,5 @@
 #include <Arduino.h>
 #include <WiFi.h>
-#include <vector>
-#include <algorithm>
 #include "config.h"
 #include "logger.h"
 #include "storage.h"
@@ -10,16 +8,31 @@
 #include "wifi_manager.h"
 #include "http_server.h"
 #include "mqtt_client.h"
+#include "command.h"
 #include "ble_provisioning.h"
+#include "wifi_scanner.h"
+#include "device_state.h"
+#include "boot_timings.h"
+#include "power_manager.h"
+#include "metrics.h"
+#include "scheduler.h"
 
 // Global instances
 Storage storage;
-ServoController servo;
+ServoController servo;          // Primary blind (blind 0)
 HallSensor hallSensor;
+#if BLIND_COUNT > 1
+// Further blinds on the same servo bus
+ServoController extraServos[BLIND_COUNT - 1];
+HallSensor extraHallSensors[BLIND_COUNT - 1];
+#endif
 WifiManager wifi;
 HttpServer httpServer;
 MqttClient mqtt;
 BleProvisioning ble;
+WifiScanner wifiScanner;
+PowerManager power;
+Scheduler scheduler;
 
 // Device configuration
 DeviceConfig config;
@@ -28,32 +41,37 @@ DeviceConfig config;
 bool wifiWasConnected = false;
 
 // Forward declarations
-void handleCommand(const String& command);
+void setupCallbacks();
+void setupMotion();
+void setupBlind(uint8_t blind, ServoController& controller, HallSensor& sensor, uint8_t hallPin);
+void setupBle();
+void startWifi();
+void handleCommand(const Command& command);
 void onWifiConnected(const String& ip);
 void onWifiDisconnected();
 void onWifiConnectionFailed();
 void onBleWifiConfig(const String& ssid, const String& password);
 void onBleMqttConfig(const String& broker, uint16_t port);
 void onHttpMqttConfig(const String& broker, uint16_t port, const String& user, const String& password);
+void onHttpMqttGroups(const String& groups);
 void onBleDeviceName(const String& name);
 void onBleDevicePassword(const String& password);
 void onBleOrientation(const String& orientation);
 void onBleCommand(const String& command);
 void onBleWifiScanRequest();
-void performWifiScan();
+void streamWifiScanResults();
 void updateBleStatus();
 
 // Flag to request WiFi scan from main loop (avoid blocking BLE stack)
 volatile bool wifiScanRequested = false;
 
+// RESTART command (any transport); loop() restarts so the caller's task can reply first
+volatile bool restartRequested = false;
+
 void setup() {
     // Initialize USB serial for debugging
     Logger::init(115200);
-    Logger::waitForSerial(3000);
-
-    LOG_BOOT("========================================");
-    LOG_BOOT("FAME Smart Blinds v%s starting...", FIRMWARE_VERSION);
-    LOG_BOOT("========================================");
+    Metrics::init();
 
     // Initialize storage
     if (!storage.init()) {
@@ -63,48 +81,144 @@ void setup() {
     // Load configuration
     storage.loadConfig(config);
 
+    // Restore runtime log levels
+    String logLevels = storage.getLogLevels();
+    if (!logLevels.isEmpty() && !Logger::applyLevels(logLevels)) {
+        LOG_ERROR("Ignoring invalid stored log levels: %s", logLevels.c_str());
+    }
+
+    // Stored schedule and timezone (rules wait for the clock before firing)
+    scheduler.init();
+
+    // BLE is only used for initial setup - disabled after WiFi is configured.
+    // A configured unit boots in production mode: no wait for a USB host, WiFi
+    // and HTTP first, servo probed in the background and BLE left off entirely.
+    bool setupComplete = storage.isSetupComplete();
+    BootTimings::setProductionMode(setupComplete);
+    if (!setupComplete) {
+        Logger::waitForSerial(BOOT_SERIAL_WAIT_MS);
+    }
+    BootTimings::mark("storage");
+
+    LOG_BOOT("========================================");
+    LOG_BOOT("FAME Smart Blinds v%s starting (%s boot)...", FIRMWARE_VERSION,
+             setupComplete ? "production" : "setup");
+    LOG_BOOT("========================================");
+
     LOG_BOOT("Device ID: %s", Storage::getDeviceId().c_str());
     LOG_BOOT("MAC Address: %s", Storage::getMacAddress().c_str());
     LOG_BOOT("Stored device name: '%s' (first char: %d)", config.deviceName, (int)config.deviceName[0]);
 
-    // Initialize hall sensor for home position detection
-    hallSensor.init(HALL_SENSOR_PIN);
-    LOG_BOOT("Hall sensor initialized on pin %d", HALL_SENSOR_PIN);
+    // Front ends first so everything is wired before WiFi can come up
+    setupCallbacks();
 
-    // Initialize servo controller
-    uint8_t servoId = config.servoId > 0 ? config.servoId : DEFAULT_SERVO_ID;
-    if (servo.init(servoId, SERVO_RX_PIN, SERVO_TX_PIN)) {
-        LOG_SERVO("Servo initialized successfully");
+    if (setupComplete) {
+        startWifi();
+        setupMotion();
+        LOG_BLE("BLE disabled - setup complete, use WiFi for management");
     } else {
-        LOG_ERROR("Servo initialization failed - will retry");
+        setupMotion();
+        // IMPORTANT: Initialize BLE BEFORE WiFi on ESP32-C3
+        setupBle();
+        startWifi();
+    }
+
+    // Idle power handling (light sleep only when BLE provisioning is off)
+    power.init(setupComplete);
+
+    // Start power outage recovery if needed (deferred by the servo until its probe finishes)
+    for (uint8_t blind = 0; blind < BLIND_COUNT; blind++) {
+        ServoController* controller = ServoController::forBlind(blind);
+        if (controller && controller->needsRecovery()) {
+            LOG_BOOT("Starting power outage recovery of blind %d...", blind);
+            controller->startRecovery();
+        }
     }
 
+    BootTimings::mark("setup");
+    LOG_BOOT("Setup complete (%lu ms)", millis());
+    LOG_BOOT("----------------------------------------");
+}
+
+void setupCallbacks() {
+    wifi.onConnected(onWifiConnected);
+    wifi.onDisconnected(onWifiDisconnected);
+    wifi.onConnectionFailed(onWifiConnectionFailed);
+
+    // Set HTTP command callback
+    httpServer.onCommand(handleCommand);
+
+    // Set HTTP MQTT config callback
+    httpServer.onMqttConfig(onHttpMqttConfig);
+    httpServer.onMqttGroups(onHttpMqttGroups);
+
+    // Set up log broadcast callback (for SSE log streaming)
+    Logger::setLogBroadcastCallback([](const char* logEntry) {
+        httpServer.broadcastLog(logEntry);
+    });
+
+    // Set MQTT command callback
+    mqtt.onCommand(handleCommand);
+
+    // On-device schedule goes through the same dispatcher
+    scheduler.onCommand(handleCommand);
+
+    // Front ends react to state model changes (delivered from loop via dispatch)
+    httpServer.attachState();
+    mqtt.attachState();  // Live position + attributes, rate limited on the MQTT task
+    deviceState.subscribe(STATE_CHANGE_MOTION, [](uint32_t, const DeviceStateSnapshot& state) {
+        mqtt.publishState(state.blindState);
+    });
+    deviceState.subscribe(STATE_CHANGE_WIFI, [](uint32_t, const DeviceStateSnapshot&) {
+        updateBleStatus();
+    });
+}
+
+void setupMotion() {
+    const uint8_t hallPins[BLIND_MAX_COUNT] = BLIND_HALL_PINS;
+
+    setupBlind(0, servo, hallSensor, hallPins[0]);
+#if BLIND_COUNT > 1
+    for (uint8_t blind = 1; blind < BLIND_COUNT; blind++) {
+        setupBlind(blind, extraServos[blind - 1], extraHallSensors[blind - 1], hallPins[blind]);
+    }
+#endif
+    BootTimings::mark("motion");
+}
+
+void setupBlind(uint8_t blind, ServoController& controller, HallSensor& sensor, uint8_t hallPin) {
+    // Initialize hall sensor for home position detection (only the primary one feeds deviceState)
+    sensor.init(hallPin, blind == 0);
+    LOG_BOOT("Blind %d: hall sensor initialized on pin %d", blind, hallPin);
+
+    // Initialize servo controller (the servo itself is probed by the motion task)
+    uint8_t servoId = config.blinds[blind].servoId > 0 ? config.blinds[blind].servoId : DEFAULT_SERVO_ID;
+    controller.init(servoId, SERVO_RX_PIN, SERVO_TX_PIN, blind);
+
     // Wire up hall sensor and storage to servo controller
-    servo.setHallSensor(&hallSensor);
-    servo.setStorage(&storage);
+    controller.setHallSensor(&sensor);
+    controller.setStorage(&storage);
 
     // Check for and start power outage recovery if needed
-    if (servo.needsRecovery()) {
-        LOG_BOOT("Power outage recovery needed - will start after init complete");
+    if (controller.needsRecovery()) {
+        LOG_BOOT("Blind %d: power outage recovery needed - will start after init complete", blind);
     }
 
     // Load orientation setting for direction inversion
-    bool isRightMount = storage.isRightMount();
-    servo.setInvertDirection(isRightMount);
-    LOG_BOOT("Orientation: %s mount", isRightMount ? "right" : "left");
+    bool isRightMount = storage.isRightMount(blind);
+    controller.setInvertDirection(isRightMount);
+    LOG_BOOT("Blind %d: orientation %s mount", blind, isRightMount ? "right" : "left");
 
     // Load speed setting
-    uint16_t speed = storage.getServoSpeed();
-    servo.setSpeed(speed);
-    LOG_BOOT("Servo speed: %d", speed);
+    uint16_t speed = storage.getServoSpeed(blind);
+    controller.setSpeed(speed);
+    LOG_BOOT("Blind %d: servo speed %d", blind, speed);
 
-    // BLE is only used for initial setup - disabled after WiFi is configured
-    // This simplifies the architecture and reduces power consumption
-    bool setupComplete = storage.isSetupComplete();
-    LOG_BLE("Setup complete flag: %s", setupComplete ? "true" : "false");
+    // Motion control (servo sampling, limits, hall handling) runs in the shared motion task
+    controller.startTask();
+}
 
-    // IMPORTANT: Initialize BLE BEFORE WiFi on ESP32-C3
-    // Initialize BLE provisioning (needed even if not advertising, for potential factory reset)
+void setupBle() {
     String fullDeviceName = storage.getDeviceName();
     LOG_BLE("Using BLE name: '%s'", fullDeviceName.c_str());
     ble.init(fullDeviceName);
@@ -124,34 +238,13 @@ void setup() {
     ble.onCommand(onBleCommand);
     ble.onWifiScanRequest(onBleWifiScanRequest);
 
-    // Only start BLE advertising if setup is not complete
-    // After initial setup, all device management is done over WiFi/HTTP
-    if (!setupComplete) {
-        ble.startAdvertising();
-        LOG_BLE("BLE advertising started - device in setup mode");
-    } else {
-        LOG_BLE("BLE disabled - setup complete, use WiFi for management");
-    }
+    ble.startAdvertising();
+    LOG_BLE("BLE advertising started - device in setup mode");
+    BootTimings::mark("ble");
+}
 
-    // Now initialize WiFi manager (after BLE is running)
+void startWifi() {
     wifi.init();
-    wifi.onConnected(onWifiConnected);
-    wifi.onDisconnected(onWifiDisconnected);
-    wifi.onConnectionFailed(onWifiConnectionFailed);
-
-    // Set HTTP command callback
-    httpServer.onCommand(handleCommand);
-
-    // Set HTTP MQTT config callback
-    httpServer.onMqttConfig(onHttpMqttConfig);
-
-    // Set up log broadcast callback (for SSE log streaming)
-    Logger::setLogBroadcastCallback([](const char* logEntry) {
-        httpServer.broadcastLog(logEntry);
-    });
-
-    // Set MQTT command callback
-    mqtt.onCommand(handleCommand);
 
     // Try to connect to WiFi if credentials are stored
     if (config.hasWifiCredentials()) {
@@ -160,56 +253,55 @@ void setup() {
     } else {
         LOG_WIFI("No WiFi credentials stored");
     }
-
-    // Start power outage recovery if needed (after all initialization is complete)
-    if (servo.needsRecovery()) {
-        LOG_BOOT("Starting power outage recovery...");
-        servo.startRecovery();
-    }
-
-    LOG_BOOT("Setup complete");
-    LOG_BOOT("----------------------------------------");
+    BootTimings::mark("wifi_start");
 }
 
 void loop() {
     static unsigned long lastStatusUpdate = 0;
+    static unsigned long lastLoopStart = 0;
     unsigned long now = millis();
+    unsigned long loopStart = micros();
+
+    if (lastLoopStart) {
+        Metrics::recordMicros(MetricTimer::LOOP_PERIOD, loopStart - lastLoopStart);
+    }
+    lastLoopStart = loopStart;
 
-    // Check for pending restart (from HTTP request - allows response to be sent first)
-    if (httpServer.isRestartPending()) {
+    // Check for pending restart (HTTP request or RESTART command - allows the reply to be sent first)
+    if (httpServer.isRestartPending() || restartRequested) {
         LOG_BOOT("Restart pending - restarting in 500ms...");
         delay(500);  // Allow HTTP response to be fully sent
+        storage.flush(true);  // Pending position; esp_restart() is no place for NVS commits
         ESP.restart();
     }
 
     // Check for pending WiFi scan request (from BLE callback)
-    // Must run in main loop to avoid blocking BLE stack
+    // Started here to keep the BLE stack free; channels are scanned in the background
     if (wifiScanRequested) {
         wifiScanRequested = false;
-        performWifiScan();
+        ble.updateStatus("wifi_scanning");
+        wifiScanner.start();
     }
+    wifiScanner.update();
+    streamWifiScanResults();
 
     // Update all managers
+    // (servo and hall sensor are serviced by the motion task)
     wifi.update();
-    hallSensor.update();
-    servo.update();
 
-    // Update MQTT if enabled
-    if (mqtt.isEnabled()) {
-        mqtt.update();
-    }
+    // Fire due schedule rules (one comparison until the next is due)
+    scheduler.service();
 
-    // Update HTTP server with current state every loop (for responsive polling)
+    // Write back cached position/moving state (coalesced, off the motion task)
+    storage.flush();
+
+    // MQTT runs on its own task (a slow broker can't stall the loop)
+
+    // Deliver state changes published by the motion task, WiFi and hall sensor
+    deviceState.dispatch();
+
+    // Broadcast state changes to SSE clients (for cross-device sync)
     if (wifi.isConnected()) {
-        httpServer.updateState(servo.getStateString());
-        httpServer.updatePosition(servo.getCurrentPosition());
-        httpServer.updateWifiInfo(wifi.getSSID(), wifi.getRSSI(), wifi.getIPAddress());
-        httpServer.updateCalibration(servo.isCalibrated(), servo.getCumulativePosition(),
-                                    servo.getMaxPosition(), servo.getCalibrationStateString());
-        httpServer.updateHallSensor(hallSensor.getRawState(), hallSensor.isTriggered(),
-                                   hallSensor.getTriggerCount());
-
-        // Broadcast state changes to SSE clients (for cross-device sync)
         httpServer.broadcastStateIfChanged();
     }
 
@@ -241,59 +333,100 @@ void loop() {
         updateBleStatus();
     }
 
-    delay(LOOP_INTERVAL_MS);
+    // Slower passes (and light sleep) once idle in low power mode
+    uint32_t loopBusy = micros() - loopStart;
+    Metrics::recordMicros(MetricTimer::LOOP_WORK, loopBusy);
+    delay(power.update(loopBusy));
 }
 
-void handleCommand(const String& command) {
-    LOG_SERVO("Handling command: %s", command.c_str());
-
-    String cmd = command;
-    cmd.toUpperCase();
-
-    if (cmd == "OPEN") {
-        servo.open();
-        // Immediately update HTTP server state so polling gets current state
-        httpServer.updateState(servo.getStateString());
-        mqtt.publishState(servo.getStateString());
-    } else if (cmd == "CLOSE") {
-        servo.close();
-        httpServer.updateState(servo.getStateString());
-        mqtt.publishState(servo.getStateString());
-    } else if (cmd == "STOP") {
-        servo.stop();
-        httpServer.updateState(servo.getStateString());
-        mqtt.publishState(servo.getStateString());
-    } else if (cmd == "OPEN_FORCE") {
-        servo.open(true);
-        httpServer.updateState(servo.getStateString());
-        mqtt.publishState(servo.getStateString());
-    } else if (cmd == "CLOSE_FORCE") {
-        servo.close(true);
-        httpServer.updateState(servo.getStateString());
-        mqtt.publishState(servo.getStateString());
-    } else if (cmd == "CALIBRATE_START") {
-        servo.startCalibration();
-        httpServer.updateState(servo.getStateString());
-    } else if (cmd == "CALIBRATE_SETBOTTOM") {
-        servo.setBottomPosition();
-    } else if (cmd == "CALIBRATE_CANCEL") {
-        servo.cancelCalibration();
-        httpServer.updateState(servo.getStateString());
-    } else if (cmd == "RESTART") {
-        LOG_BOOT("Restart command received - restarting in 2 seconds...");
-        ble.updateStatus("restarting");
-        delay(2000);
-        ESP.restart();
-    } else {
-        LOG_ERROR("Unknown command: %s", command.c_str());
+void handleCommand(const Command& command) {
+    char name[48];
+    CommandParser::format(command, name, sizeof(name));
+    LOG_SERVO("Handling command: %s (blind %d)", name, command.blind);
+
+    ServoController* target = ServoController::forBlind(command.blind);
+    if (!target) {
+        LOG_ERROR("Command for unknown blind %d: %s", command.blind, name);
+        return;
+    }
+
+    switch (command.id) {
+        case CommandId::OPEN:
+            target->open();
+            break;
+        case CommandId::CLOSE:
+            target->close();
+            break;
+        case CommandId::STOP:
+            target->stop();
+            break;
+        case CommandId::OPEN_FORCE:
+            target->open(true);
+            break;
+        case CommandId::CLOSE_FORCE:
+            target->close(true);
+            break;
+        case CommandId::CALIBRATE_START:
+            target->startCalibration();
+            break;
+        case CommandId::CALIBRATE_SETBOTTOM:
+            target->setBottomPosition();
+            break;
+        case CommandId::CALIBRATE_CANCEL:
+            target->cancelCalibration();
+            break;
+        case CommandId::POSITION:
+            // Percent (100 = open, 0 = closed), range checked by the parser
+            if (!target->moveToPercent((uint8_t)command.value)) {
+                LOG_ERROR("Position command rejected: %s", name);
+            }
+            break;
+        case CommandId::GOTO:
+            if (!target->moveToPosition(command.value)) {
+                LOG_ERROR("Position command rejected: %s", name);
+            }
+            break;
+        case CommandId::SPEED:
+            // Applied on the next movement command
+            storage.setServoSpeed((uint16_t)command.value, command.blind);
+            break;
+        case CommandId::LOGLEVEL: {
+            // servo=debug,http=warn (persisted)
+            String spec;
+            spec.concat(command.text, command.textLength);
+            if (!Logger::applyLevels(spec)) {
+                LOG_ERROR("Invalid log level spec: %s", spec.c_str());
+                return;
+            }
+            storage.setLogLevels(Logger::getLevelsString());
+            LOG_BOOT("Log levels: %s", Logger::getLevelsString().c_str());
+            break;
+        }
+        case CommandId::RESTART:
+            // Never restart from here: HTTP and MQTT commands arrive on their
+            // network tasks, which would stall and never send the reply
+            LOG_BOOT("Restart command received");
+            ble.updateStatus("restarting");
+            restartRequested = true;
+            break;
+        default:
+            LOG_ERROR("Unknown command: %s", name);
+            break;
     }
 }
 
 void onWifiConnected(const String& ip) {
     LOG_WIFI("WiFi connected callback - IP: %s", ip.c_str());
 
+    BootTimings::mark("wifi");
+
     // Start HTTP server
     httpServer.begin();
+    BootTimings::mark("http");
+
+    // Wall clock for scheduled group commands and the on-device schedule
+    // (configTime() would reset TZ to UTC)
+    configTzTime(storage.getTimezone().c_str(), NTP_SERVER_PRIMARY, NTP_SERVER_SECONDARY);
 
     // Initialize and connect MQTT if configured
     if (config.hasMqttConfig()) {
@@ -341,7 +474,10 @@ void onBleWifiConfig(const String& ssid, const String& password) {
     LOG_BLE("Received WiFi config - SSID: %s", ssid.c_str());
 
     // Save to storage (will be overwritten if user retries with correct password)
-    storage.setWifiCredentials(ssid, password);
+    if (!storage.setWifiCredentials(ssid, password)) {
+        ble.updateStatus("wifi_failed");
+        return;
+    }
 
     // Update config struct
     strncpy(config.wifiSsid, ssid.c_str(), sizeof(config.wifiSsid) - 1);
@@ -362,7 +498,10 @@ void onBleMqttConfig(const String& broker, uint16_t port) {
     LOG_BLE("Received MQTT config - Broker: %s:%d", broker.c_str(), port);
 
     // Save to storage
-    storage.setMqttConfig(broker, port);
+    if (!storage.setMqttConfig(broker, port)) {
+        ble.updateStatus("mqtt_error");
+        return;
+    }
 
     // Update config struct
     strncpy(config.mqttBroker, broker.c_str(), sizeof(config.mqttBroker) - 1);
@@ -403,11 +542,20 @@ void onHttpMqttConfig(const String& broker, uint16_t port,
     }
 }
 
+void onHttpMqttGroups(const String& groups) {
+    LOG_HTTP("MQTT groups changed: %s", groups.isEmpty() ? "(none)" : groups.c_str());
+    // Resubscribes on the MQTT task
+    mqtt.reloadGroups();
+}
+
 void onBleDeviceName(const String& name) {
     LOG_BLE("Received device name: %s", name.c_str());
 
     // Save to storage
-    storage.setDeviceName(name);
+    if (!storage.setDeviceName(name)) {
+        ble.updateStatus("name_error");
+        return;
+    }
 
     // Update config struct
     strncpy(config.deviceName, name.c_str(), sizeof(config.deviceName) - 1);
@@ -423,7 +571,10 @@ void onBleDevicePassword(const String& password) {
     LOG_BLE("Received device password (length: %d)", password.length());
 
     // Save to storage
-    storage.setDevicePassword(password);
+    if (!storage.setDevicePassword(password)) {
+        ble.updateStatus("password_error");
+        return;
+    }
 
     // Notify via BLE
     ble.updateStatus("password_saved");
@@ -456,7 +607,12 @@ void onBleOrientation(const String& orientation) {
 
 void onBleCommand(const String& command) {
     LOG_BLE("Received BLE command: %s", command.c_str());
-    handleCommand(command);
+    Command parsed;
+    if (!CommandParser::parse(command.c_str(), command.length(), parsed)) {
+        LOG_ERROR("Unknown command: %s", command.c_str());
+        return;
+    }
+    handleCommand(parsed);
 }
 
 void updateBleStatus() {
@@ -494,86 +650,13 @@ void onBleWifiScanRequest() {
     wifiScanRequested = true;
 }
 
-void performWifiScan() {
-    LOG_BLE("========== WIFI NETWORK SCAN START ==========");
-
-    // Notify that scan is starting
-    ble.updateStatus("wifi_scanning");
-
-    // Perform WiFi scan (blocking, typically takes 1-3 seconds)
-    LOG_BLE("Calling WiFi.scanNetworks()...");
-    int numNetworks = WiFi.scanNetworks(false, false);
-
-    LOG_BLE("WiFi scan complete - found %d networks", numNetworks);
-
-    // Build compact JSON response
-    // Format: {"n":[{"s":"SSID","r":-65,"e":1},...]}
-    // s=ssid, r=rssi, e=encrypted (1=secured, 0=open)
-    String json = "{\"n\":[";
-
-    // Sort networks by signal strength and limit to 15 strongest
-    // First, collect unique networks (filter duplicates by SSID)
-    struct Network {
-        String ssid;
-        int rssi;
-        bool encrypted;
-    };
-    std::vector<Network> networks;
-
-    for (int i = 0; i < numNetworks; i++) {
-        String ssid = WiFi.SSID(i);
-        if (ssid.isEmpty()) continue;  // Skip hidden networks
-
-        // Check for duplicate SSID (keep stronger signal)
-        bool isDuplicate = false;
-        for (auto& n : networks) {
-            if (n.ssid == ssid) {
-                if (WiFi.RSSI(i) > n.rssi) {
-                    n.rssi = WiFi.RSSI(i);
-                }
-                isDuplicate = true;
-                break;
-            }
-        }
+void streamWifiScanResults() {
+    // One page per loop pass, each sized to the client's negotiated MTU
+    static char page[WIFI_SCAN_PAGE_MAX + 1];
 
-        if (!isDuplicate) {
-            Network net;
-            net.ssid = ssid;
-            net.rssi = WiFi.RSSI(i);
-            net.encrypted = WiFi.encryptionType(i) != WIFI_AUTH_OPEN;
-            networks.push_back(net);
-        }
+    size_t pageSize = constrain(ble.getNotifyPayloadSize(), (size_t)WIFI_SCAN_PAGE_MIN, (size_t)WIFI_SCAN_PAGE_MAX);
+    size_t length = wifiScanner.nextPage(page, pageSize + 1);
+    if (length > 0) {
+        ble.notifyWifiScanResults(page, length);
     }
-
-    // Sort by signal strength (strongest first)
-    std::sort(networks.begin(), networks.end(), [](const Network& a, const Network& b) {
-        return a.rssi > b.rssi;
-    });
-
-    // Build JSON with up to 15 networks
-    int count = 0;
-    for (const auto& net : networks) {
-        if (count >= 15) break;
-        if (count > 0) json += ",";
-
-        // Escape special characters in SSID for JSON
-        String escapedSsid = net.ssid;
-        escapedSsid.replace("\\", "\\\\");
-        escapedSsid.replace("\"", "\\\"");
-
-        json += "{\"s\":\"" + escapedSsid + "\",\"r\":" + String(net.rssi) +
-                ",\"e\":" + (net.encrypted ? "1" : "0") + "}";
-        count++;
-    }
-
-    json += "]}";
-
-    // Clean up scan results
-    WiFi.scanDelete();
-
-    LOG_BLE("WiFi scan results JSON (%d bytes): %s", json.length(), json.c_str());
-
-    // Send results via BLE characteristic (will notify connected client)
-    ble.setWifiScanResults(json);
-    LOG_BLE("========== WIFI NETWORK SCAN END ==========");
 }
@@ -0,0 +1,265 @@
+#include "metrics.h"
+#include "logger.h"
+#include "storage.h"
+#include "http_server.h"
+#include "mqtt_client.h"
+#include "power_manager.h"
+#include <freertos/task.h>
+
+extern Storage storage;
+extern HttpServer httpServer;
+extern MqttClient mqtt;
+extern PowerManager power;
+
+Metrics::Histogram Metrics::_timers[(int)MetricTimer::COUNT] = {};
+uint32_t Metrics::_cyclesPerMicro = POWER_CPU_FREQ_MHZ;
+portMUX_TYPE Metrics::_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static const uint32_t BUCKET_BOUNDS_US[] = METRICS_BUCKET_BOUNDS_US;
+static_assert(sizeof(BUCKET_BOUNDS_US) / sizeof(BUCKET_BOUNDS_US[0]) + 1 == METRICS_BUCKET_COUNT,
+              "METRICS_BUCKET_COUNT must be the number of bounds + 1");
+
+static const char* const TIMER_NAMES[] = {
+    "loop_work", "loop_period", "motion_update", "servo_bus",
+    "mqtt_service", "nvs_write", "log_emit", "sse_send"
+};
+static_assert(sizeof(TIMER_NAMES) / sizeof(TIMER_NAMES[0]) == (int)MetricTimer::COUNT,
+              "TIMER_NAMES must match MetricTimer");
+
+static const char* const TIMER_HELP[] = {
+    "Duration of one loop() pass, excluding its delay",
+    "Time from the start of one loop() pass to the next",
+    "Duration of one motion task sample of one blind",
+    "Servo bus status read round trip",
+    "Duration of one connected MQTT task pass",
+    "Duration of one NVS write",
+    "Duration of writing one log entry to the buffer, serial and SSE",
+    "Duration of queueing one SSE event"
+};
+
+// Tasks whose stack high-water mark is reported (absent ones are skipped)
+static const char* const STACK_TASKS[] = {
+    "loopTask", "async_tcp", "motion", "mqtt", "log", "ota_writer"
+};
+
+// Sections of the Prometheus document, rendered one per chunk
+enum : uint8_t {
+    SECTION_INFO,
+    SECTION_HEAP,
+    SECTION_STACKS,
+    SECTION_COUNTERS,
+    SECTION_TIMERS,     // One per MetricTimer
+    SECTION_END = SECTION_TIMERS + (uint8_t)MetricTimer::COUNT
+};
+
+void Metrics::init() {
+    _cyclesPerMicro = ESP.getCpuFreqMHz();
+}
+
+void Metrics::record(MetricTimer timer, uint32_t startCycles) {
+    recordMicros(timer, (ESP.getCycleCount() - startCycles) / _cyclesPerMicro);
+}
+
+void Metrics::recordMicros(MetricTimer timer, uint32_t micros) {
+    size_t bucket = 0;
+    while (bucket < METRICS_BUCKET_COUNT - 1 && micros > BUCKET_BOUNDS_US[bucket]) {
+        bucket++;
+    }
+
+    portENTER_CRITICAL(&_mux);
+    Histogram& histogram = _timers[(int)timer];
+    histogram.buckets[bucket]++;
+    histogram.count++;
+    histogram.sumMicros += micros;
+    if (micros > histogram.maxMicros) {
+        histogram.maxMicros = micros;
+    }
+    portEXIT_CRITICAL(&_mux);
+}
+
+void Metrics::snapshot(MetricTimer timer, Histogram& out) {
+    portENTER_CRITICAL(&_mux);
+    out = _timers[(int)timer];
+    portEXIT_CRITICAL(&_mux);
+}
+
+void Metrics::beginPrometheus(MetricsCursor& cursor) {
+    cursor.section = 0;
+    cursor.length = 0;
+    cursor.offset = 0;
+}
+
+size_t Metrics::fillPrometheus(MetricsCursor& cursor, uint8_t* buffer, size_t maxLen) {
+    size_t written = 0;
+
+    while (written < maxLen) {
+        if (cursor.offset == cursor.length) {
+            // Each section is rendered as the previous one finishes, so a scrape
+            // never holds more than one section of text
+            if (cursor.section >= SECTION_END) {
+                break;
+            }
+            BufferWriter out(cursor.text, sizeof(cursor.text));
+            renderSection(cursor.section++, out);
+            if (out.overflowed()) {
+                LOG_ERROR("Metrics section %d exceeds %d bytes", cursor.section - 1, METRICS_SECTION_SIZE);
+            }
+            cursor.length = out.length();
+            cursor.offset = 0;
+            continue;
+        }
+
+        size_t chunk = min(cursor.length - cursor.offset, maxLen - written);
+        memcpy(buffer + written, cursor.text + cursor.offset, chunk);
+        cursor.offset += chunk;
+        written += chunk;
+    }
+
+    return written;
+}
+
+void Metrics::renderSection(uint8_t section, BufferWriter& out) {
+    switch (section) {
+        case SECTION_INFO:
+            out.print("# HELP fsb_info Firmware build\n# TYPE fsb_info gauge\n");
+            out.printf("fsb_info{version=\"%s\",blinds=\"%d\"} 1\n", FIRMWARE_VERSION, BLIND_COUNT);
+            out.print("# HELP fsb_uptime_seconds Time since boot\n# TYPE fsb_uptime_seconds counter\n");
+            out.printf("fsb_uptime_seconds %lu\n", millis() / 1000);
+            break;
+        case SECTION_HEAP:
+            renderHeap(out);
+            break;
+        case SECTION_STACKS:
+            renderStacks(out);
+            break;
+        case SECTION_COUNTERS:
+            renderCounters(out);
+            break;
+        default:
+            if (section < SECTION_END) {
+                renderHistogram((MetricTimer)(section - SECTION_TIMERS), out);
+            }
+            break;
+    }
+}
+
+void Metrics::renderHistogram(MetricTimer timer, BufferWriter& out) {
+    Histogram histogram;
+    snapshot(timer, histogram);
+    const char* name = TIMER_NAMES[(int)timer];
+
+    out.printf("# HELP fsb_%s_seconds %s\n# TYPE fsb_%s_seconds histogram\n",
+               name, TIMER_HELP[(int)timer], name);
+
+    // Prometheus buckets are cumulative; bounds printed in seconds
+    uint32_t cumulative = 0;
+    for (size_t i = 0; i < METRICS_BUCKET_COUNT - 1; i++) {
+        cumulative += histogram.buckets[i];
+        out.printf("fsb_%s_seconds_bucket{le=\"%g\"} %lu\n",
+                   name, BUCKET_BOUNDS_US[i] / 1e6, (unsigned long)cumulative);
+    }
+    out.printf("fsb_%s_seconds_bucket{le=\"+Inf\"} %lu\n", name, (unsigned long)histogram.count);
+    out.printf("fsb_%s_seconds_sum %llu.%06llu\n", name,
+               (unsigned long long)(histogram.sumMicros / 1000000),
+               (unsigned long long)(histogram.sumMicros % 1000000));
+    out.printf("fsb_%s_seconds_count %lu\n", name, (unsigned long)histogram.count);
+    out.printf("# TYPE fsb_%s_max_seconds gauge\nfsb_%s_max_seconds %lu.%06lu\n", name, name,
+               (unsigned long)(histogram.maxMicros / 1000000), (unsigned long)(histogram.maxMicros % 1000000));
+}
+
+void Metrics::renderHeap(BufferWriter& out) {
+    uint32_t free = ESP.getFreeHeap();
+    uint32_t largest = ESP.getMaxAllocHeap();
+
+    out.print("# HELP fsb_heap_free_bytes Free heap\n# TYPE fsb_heap_free_bytes gauge\n");
+    out.printf("fsb_heap_free_bytes %lu\n", (unsigned long)free);
+    out.print("# HELP fsb_heap_min_free_bytes Lowest free heap since boot\n# TYPE fsb_heap_min_free_bytes gauge\n");
+    out.printf("fsb_heap_min_free_bytes %lu\n", (unsigned long)ESP.getMinFreeHeap());
+    out.print("# HELP fsb_heap_largest_block_bytes Largest allocatable block\n# TYPE fsb_heap_largest_block_bytes gauge\n");
+    out.printf("fsb_heap_largest_block_bytes %lu\n", (unsigned long)largest);
+    out.print("# HELP fsb_heap_fragmentation_ratio 1 - largest block / free heap\n# TYPE fsb_heap_fragmentation_ratio gauge\n");
+    out.printf("fsb_heap_fragmentation_ratio %.3f\n", free ? 1.0f - (float)largest / free : 0.0f);
+}
+
+void Metrics::renderStacks(BufferWriter& out) {
+    // ESP-IDF reports stack sizes in bytes
+    out.print("# HELP fsb_task_stack_free_bytes Lowest free stack since the task started\n"
+              "# TYPE fsb_task_stack_free_bytes gauge\n");
+    for (const char* name : STACK_TASKS) {
+        TaskHandle_t task = xTaskGetHandle(name);
+        if (task) {
+            out.printf("fsb_task_stack_free_bytes{task=\"%s\"} %u\n", name,
+                       (unsigned)uxTaskGetStackHighWaterMark(task));
+        }
+    }
+}
+
+void Metrics::renderCounters(BufferWriter& out) {
+    StorageStats nvs = storage.getStats();
+    HttpServer::SseStats sse = httpServer.getSseStats();
+
+    out.print("# TYPE fsb_nvs_writes_total counter\n");
+    out.printf("fsb_nvs_writes_total %lu\n", (unsigned long)nvs.nvsWrites);
+    out.print("# TYPE fsb_nvs_motion_writes_total counter\n");
+    out.printf("fsb_nvs_motion_writes_total %lu\n", (unsigned long)nvs.motionWrites);
+    out.print("# TYPE fsb_nvs_coalesced_updates_total counter\n");
+    out.printf("fsb_nvs_coalesced_updates_total %lu\n", (unsigned long)nvs.coalescedUpdates);
+
+    out.print("# TYPE fsb_sse_clients gauge\n");
+    out.printf("fsb_sse_clients %u\n", (unsigned)sse.clients);
+    out.print("# HELP fsb_sse_queue_depth Messages queued in AsyncTCP for /events clients\n"
+              "# TYPE fsb_sse_queue_depth gauge\n");
+    out.printf("fsb_sse_queue_depth %u\n", (unsigned)sse.queueDepth);
+    out.print("# TYPE fsb_sse_queue_depth_max gauge\n");
+    out.printf("fsb_sse_queue_depth_max %u\n", (unsigned)sse.maxQueueDepth);
+    out.print("# HELP fsb_sse_dropped_total Status updates skipped for a full client queue\n"
+              "# TYPE fsb_sse_dropped_total counter\n");
+    out.printf("fsb_sse_dropped_total %lu\n", (unsigned long)sse.dropped);
+    out.print("# TYPE fsb_sse_coalesced_total counter\n");
+    out.printf("fsb_sse_coalesced_total %lu\n", (unsigned long)sse.coalesced);
+
+    out.print("# TYPE fsb_mqtt_dropped_publishes_total counter\n");
+    out.printf("fsb_mqtt_dropped_publishes_total %lu\n", (unsigned long)mqtt.getDroppedPublishes());
+    out.print("# TYPE fsb_mqtt_reconnect_attempts gauge\n");
+    out.printf("fsb_mqtt_reconnect_attempts %lu\n", (unsigned long)mqtt.getReconnectAttempts());
+    out.print("# TYPE fsb_log_dropped_total counter\n");
+    out.printf("fsb_log_dropped_total %lu\n", (unsigned long)Logger::getDroppedCount());
+    out.print("# HELP fsb_duty_cycle_percent Time in loop work and motion samples (10 s window)\n"
+              "# TYPE fsb_duty_cycle_percent gauge\n");
+    out.printf("fsb_duty_cycle_percent %.1f\n", power.getDutyCycle());
+}
+
+void Metrics::renderJson(BufferWriter& out) {
+    uint32_t free = ESP.getFreeHeap();
+    out.printf("{\"uptime\":%lu,\"heap\":{\"free\":%lu,\"min\":%lu,\"block\":%lu}",
+               millis() / 1000, (unsigned long)free, (unsigned long)ESP.getMinFreeHeap(),
+               (unsigned long)ESP.getMaxAllocHeap());
+
+    // Per timer: samples, mean and worst case in microseconds
+    out.print(",\"timers\":{");
+    for (int i = 0; i < (int)MetricTimer::COUNT; i++) {
+        Histogram histogram;
+        snapshot((MetricTimer)i, histogram);
+        uint32_t mean = histogram.count ? (uint32_t)(histogram.sumMicros / histogram.count) : 0;
+        out.printf("%s\"%s\":[%lu,%lu,%lu]", i ? "," : "", TIMER_NAMES[i],
+                   (unsigned long)histogram.count, (unsigned long)mean, (unsigned long)histogram.maxMicros);
+    }
+
+    out.print("},\"stacks\":{");
+    bool first = true;
+    for (const char* name : STACK_TASKS) {
+        TaskHandle_t task = xTaskGetHandle(name);
+        if (task) {
+            out.printf("%s\"%s\":%u", first ? "" : ",", name, (unsigned)uxTaskGetStackHighWaterMark(task));
+            first = false;
+        }
+    }
+
+    StorageStats nvs = storage.getStats();
+    HttpServer::SseStats sse = httpServer.getSseStats();
+    out.printf("},\"nvs_writes\":%lu,\"sse_queue_max\":%u,\"sse_dropped\":%lu,\"mqtt_dropped\":%lu"
+               ",\"log_dropped\":%lu,\"duty\":%.1f}",
+               (unsigned long)nvs.nvsWrites, (unsigned)sse.maxQueueDepth, (unsigned long)sse.dropped,
+               (unsigned long)mqtt.getDroppedPublishes(), (unsigned long)Logger::getDroppedCount(),
+               power.getDutyCycle());
+}
@@ -0,0 +1,231 @@
+#include "motion_profile.h"
+#include "config.h"
+#include <math.h>
+#include <stdlib.h>
+
+int32_t MotionProfile::encoderDelta(int32_t previousRaw, int32_t currentRaw) {
+    int32_t delta = currentRaw - previousRaw;
+    if (delta > 2048) delta -= 4096;
+    if (delta < -2048) delta += 4096;
+    return delta;
+}
+
+int32_t MotionProfile::extrapolate(int32_t position, float velocity, float seconds) {
+    return position + (int32_t)lroundf(velocity * seconds);
+}
+
+float MotionProfile::accelerationFromRegister(uint8_t acc) {
+    return acc * 100.0f;
+}
+
+int32_t MotionProfile::stoppingDistance(float velocity, float acceleration, uint32_t latencyMs) {
+    float speed = fabsf(velocity);
+
+    // Travel while the stop command is still on its way to the servo
+    float distance = speed * (latencyMs / 1000.0f);
+
+    // Travel during the servo's deceleration ramp (v^2 / 2a)
+    if (acceleration > 0.0f) {
+        distance += (speed * speed) / (2.0f * acceleration);
+    }
+
+    return (int32_t)ceilf(distance);
+}
+
+float MotionProfile::smoothVelocity(float previous, float sample, float alpha) {
+    return previous + alpha * (sample - previous);
+}
+
+uint16_t MotionProfile::approachSpeed(int32_t distance, uint16_t cruiseSpeed, float deceleration,
+                                      uint16_t minSpeed) {
+    if (minSpeed > cruiseSpeed) {
+        minSpeed = cruiseSpeed;
+    }
+    if (distance <= 0 || deceleration <= 0.0f) {
+        return minSpeed;
+    }
+
+    float braking = sqrtf(2.0f * deceleration * distance);
+    if (braking >= cruiseSpeed) {
+        return cruiseSpeed;
+    }
+    if (braking <= minSpeed) {
+        return minSpeed;
+    }
+    return (uint16_t)braking;
+}
+
+float MotionProfile::approachDeceleration(float acceleration) {
+    return acceleration > 0.0f ? acceleration * MOTION_APPROACH_DECEL_FACTOR : MOTION_APPROACH_DEFAULT_DECEL;
+}
+
+uint16_t MotionProfile::approachCommand(int32_t distance, int32_t stopDistance, uint16_t cruiseSpeed,
+                                        float deceleration, uint16_t commanded) {
+    if (distance <= MOTION_TARGET_TOLERANCE / 2 || distance <= stopDistance) {
+        return 0;
+    }
+
+    uint16_t speed = approachSpeed(distance - stopDistance, cruiseSpeed, deceleration,
+                                   MOTION_APPROACH_MIN_SPEED);
+
+    // The final approach speed always goes out so the move lands on it
+    if (commanded != 0 && abs((int)speed - (int)commanded) < MOTION_SPEED_UPDATE_STEP &&
+        speed != MOTION_APPROACH_MIN_SPEED) {
+        return commanded;
+    }
+    return speed;
+}
+
+void PositionTracker::reset(int32_t position) {
+    _position = position;
+    _lastRaw = 0;
+    _lastMicros = 0;
+    _velocity = 0.0f;
+    _seeded = false;
+}
+
+void PositionTracker::update(int32_t raw, uint32_t nowMicros) {
+    if (!_seeded) {
+        _lastRaw = raw;
+        _lastMicros = nowMicros;
+        _seeded = true;
+        return;
+    }
+
+    // Delta with wrap-around handling (4095 -> 0 or 0 -> 4095)
+    int32_t delta = MotionProfile::encoderDelta(_lastRaw, raw);
+    _position += delta;
+    _lastRaw = raw;
+
+    uint32_t dt = nowMicros - _lastMicros;
+    if (dt < 1000) {
+        return;  // Back-to-back read (e.g. from stop()) - too short to be meaningful
+    }
+    _lastMicros = nowMicros;
+
+    if (dt < 2000000UL) {
+        float sample = delta * 1000000.0f / dt;
+        _velocity = MotionProfile::smoothVelocity(_velocity, sample, MOTION_VELOCITY_ALPHA);
+    } else {
+        _velocity = 0.0f;
+    }
+}
+
+void HomingRecovery::start(int32_t target) {
+    _target = target;
+    _active = true;
+    _returning = false;
+}
+
+HomingRecovery::Step HomingRecovery::sample(bool homeFound, int32_t position, int32_t stopDistance) {
+    if (!_active) {
+        return Step::NONE;
+    }
+
+    if (!_returning) {
+        if (!homeFound) {
+            return Step::NONE;
+        }
+        if (_target > 0) {
+            _returning = true;
+            return Step::RETURN_TO_TARGET;
+        }
+        _active = false;
+        return Step::DONE_AT_HOME;
+    }
+
+    // Stop early enough to land on the target
+    if (_target - position <= stopDistance) {
+        _active = false;
+        _returning = false;
+        return Step::DONE_AT_TARGET;
+    }
+    return Step::NONE;
+}
+
+LoadMonitor::LoadMonitor() {
+    reset();
+}
+
+void LoadMonitor::reset(uint32_t rampMs) {
+    _graceMs = rampMs > MOTION_STALL_GRACE_MS ? rampMs : MOTION_STALL_GRACE_MS;
+    _load = 0.0f;
+    _peakRamp = 0;
+    _peakCruise = 0;
+    _stallSamples = 0;
+    _stillSinceMs = 0;
+    _still = false;
+    _stalled = false;
+}
+
+bool LoadMonitor::sample(uint32_t elapsedMs, float velocity, uint16_t commandedSpeed, int load) {
+    _load += MOTION_LOAD_ALPHA * (abs(load) - _load);
+
+    // Not driving (stop ramp, hall debounce pause) - nothing to judge
+    if (commandedSpeed == 0) {
+        _stallSamples = 0;
+        _still = false;
+        return _stalled;
+    }
+
+    if (elapsedMs < _graceMs) {
+        if ((int)_load > _peakRamp) _peakRamp = (int)_load;
+        return _stalled;
+    }
+    if ((int)_load > _peakCruise) _peakCruise = (int)_load;
+
+    bool slow = fabsf(velocity) < commandedSpeed * MOTION_STALL_VELOCITY_FRACTION;
+
+    // Driving hard without getting anywhere
+    if (slow && abs(load) >= MOTION_STALL_LOAD) {
+        if (++_stallSamples >= MOTION_STALL_SAMPLES) {
+            _stalled = true;
+        }
+    } else {
+        _stallSamples = 0;
+    }
+
+    // No progress at any load: the servo's overload protection may have cut
+    // torque, after which the load reads low
+    if (!slow) {
+        _still = false;
+    } else if (!_still) {
+        _still = true;
+        _stillSinceMs = elapsedMs;
+    } else if (elapsedMs - _stillSinceMs >= MOTION_STALL_STILL_MS) {
+        _stalled = true;
+    }
+
+    return _stalled;
+}
+
+DriveProfile LoadMonitor::adapt(const DriveProfile& current, uint16_t maxSpeed, uint8_t maxAcceleration,
+                                int peakRampLoad, int peakCruiseLoad) {
+    DriveProfile next = current;
+    uint16_t minSpeed = maxSpeed < MOTION_ADAPT_MIN_SPEED ? maxSpeed : MOTION_ADAPT_MIN_SPEED;
+
+    if (peakCruiseLoad > MOTION_ADAPT_LOAD_HIGH) {
+        next.speed = current.speed > minSpeed + MOTION_ADAPT_SPEED_STEP
+                         ? current.speed - MOTION_ADAPT_SPEED_STEP : minSpeed;
+    } else if (peakCruiseLoad < MOTION_ADAPT_LOAD_LOW) {
+        next.speed = current.speed + MOTION_ADAPT_SPEED_STEP;
+    }
+    if (next.speed > maxSpeed) next.speed = maxSpeed;
+    if (next.speed < minSpeed) next.speed = minSpeed;
+
+    if (maxAcceleration == 0) {
+        next.acceleration = 0;
+        return next;
+    }
+    uint8_t minAcceleration = maxAcceleration < MOTION_ADAPT_MIN_ACCEL ? maxAcceleration : MOTION_ADAPT_MIN_ACCEL;
+    int acceleration = current.acceleration;
+    if (peakRampLoad > MOTION_ADAPT_LOAD_HIGH) {
+        acceleration -= MOTION_ADAPT_ACCEL_STEP;
+    } else if (peakRampLoad < MOTION_ADAPT_LOAD_LOW) {
+        acceleration += MOTION_ADAPT_ACCEL_STEP;
+    }
+    if (acceleration > maxAcceleration) acceleration = maxAcceleration;
+    if (acceleration < minAcceleration) acceleration = minAcceleration;
+    next.acceleration = (uint8_t)acceleration;
+    return next;
+}
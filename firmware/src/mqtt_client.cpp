@@ -2,9 +2,14 @@
 #include "config.h"
 #include "logger.h"
 #include "storage.h"
+#include "buffer_writer.h"
+#include "command.h"
+#include "boot_timings.h"
+#include "metrics.h"
 #include <WiFi.h>
 #include <PubSubClient.h>
 #include <ArduinoJson.h>
+#include <sys/time.h>
 
 extern Storage storage;
 
@@ -15,23 +20,192 @@ static PubSubClient mqttClient(wifiClient);
 // Static instance pointer for callback
 MqttClient* MqttClient::_instance = nullptr;
 
+// Call fn for each non-empty name in a comma-separated group list
+template <typename F>
+static void forEachGroup(const String& groups, F fn) {
+    int start = 0;
+    while (start < (int)groups.length()) {
+        int comma = groups.indexOf(',', start);
+        if (comma < 0) {
+            comma = groups.length();
+        }
+        String name = groups.substring(start, comma);
+        name.trim();
+        if (!name.isEmpty()) {
+            fn(name);
+        }
+        start = comma + 1;
+    }
+}
+
 MqttClient::MqttClient()
-    : _port(MQTT_PORT)
+    : _settingsPending(false)
+    , _port(MQTT_PORT)
+    , _lastPublishedPosition(-1)
     , _initialized(false)
     , _discoveryPublished(false)
-    , _lastReconnectAttempt(0)
+    , _enabled(false)
+    , _connected(false)
+    , _connectRequested(false)
+    , _nextAttempt(0)
+    , _reconnectAttempts(0)
     , _lastHeartbeat(0)
+    , _groupsChanged(false)
+    , _scheduledAt(0)
+    , _pendingChanges(0)
+    , _telemetryDirty(0)
+    , _lastTelemetry(0)
+    , _lastDiagnostics(0)
+    , _droppedPublishes(0)
+    , _taskHandle(nullptr)
     , _commandCallback(nullptr)
 {
+    for (int i = 0; i < BLIND_COUNT; i++) {
+        _lastBlindState[i] = nullptr;
+        _lastBlindPosition[i] = -1;
+    }
     _instance = this;
+    _settingsMutex = xSemaphoreCreateMutex();
+    _publishQueue = xQueueCreate(MQTT_PUBLISH_QUEUE_LENGTH, sizeof(Outgoing));
 }
 
 void MqttClient::init(const String& broker, uint16_t port,
                       const String& user, const String& password) {
-    _broker = broker;
-    _port = port;
-    _user = user;
-    _password = password;
+    xSemaphoreTake(_settingsMutex, portMAX_DELAY);
+    _pending.broker = broker;
+    _pending.port = port;
+    _pending.user = user;
+    _pending.password = password;
+    _settingsPending = true;
+    xSemaphoreGive(_settingsMutex);
+
+    _enabled = !broker.isEmpty();
+
+    if (!_taskHandle) {
+        BaseType_t result = xTaskCreate(mqttTask, "mqtt", MQTT_TASK_STACK_SIZE,
+                                        this, MQTT_TASK_PRIORITY, &_taskHandle);
+        if (result != pdPASS) {
+            LOG_ERROR("Failed to start MQTT task");
+            _taskHandle = nullptr;
+            _enabled = false;
+            return;
+        }
+    }
+    wake();
+}
+
+void MqttClient::buildTopics() {
+    String prefix = String(MQTT_TOPIC_PREFIX) + "/" + _deviceId;
+
+    _commandTopic = prefix + "/command";
+    _stateTopic = prefix + "/state";
+    _setPositionTopic = prefix + "/set_position";
+    _logLevelTopic = prefix + "/log_level";
+    _positionTopic = prefix + "/position";
+    _attributesTopic = prefix + "/attributes";
+    _diagnosticsTopic = prefix + "/diagnostics";
+    _availabilityTopic = prefix + "/availability";
+    _discoveryTopic = String(MQTT_DISCOVERY_PREFIX) + "/cover/famesmartblinds_" + _deviceId + "/config";
+    _blindTopicPrefix = prefix + "/blind";
+}
+
+String MqttClient::blindTopic(uint8_t blind, const char* leaf) const {
+    return _blindTopicPrefix + blind + "/" + leaf;
+}
+
+int MqttClient::parseBlindTopic(const char* topic, const char*& leaf) const {
+    // <prefix>/blind<n>/<leaf>, n in 1..BLIND_COUNT-1
+    size_t prefixLength = _blindTopicPrefix.length();
+    if (strncmp(topic, _blindTopicPrefix.c_str(), prefixLength) != 0) {
+        return -1;
+    }
+    const char* number = topic + prefixLength;
+    const char* slash = strchr(number, '/');
+    int32_t blind;
+    if (!slash || !CommandParser::parseNumber(number, slash - number, BLIND_COUNT - 1, blind) || blind == 0) {
+        return -1;
+    }
+    leaf = slash + 1;
+    return blind;
+}
+
+bool MqttClient::connect() {
+    if (!_enabled) {
+        LOG_MQTT("Cannot connect: not initialized or no broker configured");
+        return false;
+    }
+    _connectRequested = true;
+    wake();
+    return true;
+}
+
+void MqttClient::disable() {
+    LOG_MQTT("Disabling MQTT client");
+    init("", MQTT_PORT, "", "");
+}
+
+bool MqttClient::isConnected() const {
+    return _connected;
+}
+
+bool MqttClient::isEnabled() const {
+    return _enabled;
+}
+
+void MqttClient::wake() {
+    if (_taskHandle) {
+        xTaskNotifyGive(_taskHandle);
+    }
+}
+
+void MqttClient::mqttTask(void* arg) {
+    static_cast<MqttClient*>(arg)->run();
+}
+
+void MqttClient::run() {
+    for (;;) {
+        applySettings();
+
+        if (_initialized) {
+            runScheduledCommand();
+            if (mqttClient.connected()) {
+                MetricScope timer(MetricTimer::MQTT_SERVICE);
+                service();
+            } else {
+                maintainConnection();
+            }
+        }
+
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(MQTT_TASK_INTERVAL_MS));
+    }
+}
+
+void MqttClient::applySettings() {
+    if (!_settingsPending) {
+        return;
+    }
+
+    xSemaphoreTake(_settingsMutex, portMAX_DELAY);
+    Settings settings = _pending;
+    _settingsPending = false;
+    xSemaphoreGive(_settingsMutex);
+
+    disconnectFromBroker();
+
+    _broker = settings.broker;
+    _port = settings.port;
+    _user = settings.user;
+    _password = settings.password;
+    _subscribedGroups = "";
+    _scheduledCommand = Command();
+    _discoveryPublished = false;
+    _reconnectAttempts = 0;
+
+    if (_broker.isEmpty()) {
+        _initialized = false;
+        LOG_MQTT("MQTT disabled");
+        return;
+    }
 
     _deviceId = Storage::getDeviceId();
     _deviceName = storage.getDeviceName();
@@ -46,29 +220,77 @@ void MqttClient::init(const String& broker, uint16_t port,
     mqttClient.setServer(_broker.c_str(), _port);
     mqttClient.setCallback(messageCallback);
     mqttClient.setKeepAlive(MQTT_KEEPALIVE_SECONDS);
+    mqttClient.setSocketTimeout(MQTT_SOCKET_TIMEOUT_SECONDS);
+    mqttClient.setBufferSize(MQTT_BUFFER_SIZE);  // Discovery payload exceeds the 256-byte default
 
     _initialized = true;
+    _connectRequested = true;
 }
 
-void MqttClient::buildTopics() {
-    String prefix = String(MQTT_TOPIC_PREFIX) + "/" + _deviceId;
+void MqttClient::maintainConnection() {
+    if (_connected) {
+        _connected = false;
+        LOG_WARN(MQTT, "Connection to broker lost, state: %d", mqttClient.state());
+        scheduleReconnect();
+    }
 
-    _commandTopic = prefix + "/command";
-    _stateTopic = prefix + "/state";
-    _availabilityTopic = prefix + "/availability";
-    _discoveryTopic = String(MQTT_DISCOVERY_PREFIX) + "/cover/famesmartblinds_" + _deviceId + "/config";
+    // Don't burn backoff steps while there is no network to reach the broker over
+    if (!WiFi.isConnected()) {
+        return;
+    }
+    if (!_connectRequested && (long)(millis() - _nextAttempt) < 0) {
+        return;
+    }
+    _connectRequested = false;
+
+    if (connectToBroker()) {
+        _reconnectAttempts = 0;
+    } else {
+        scheduleReconnect();
+    }
 }
 
-bool MqttClient::connect() {
-    if (!_initialized || _broker.isEmpty()) {
-        LOG_MQTT("Cannot connect: not initialized or no broker configured");
-        return false;
+void MqttClient::scheduleReconnect() {
+    // 5s, 10s, 20s ... capped, then a random 50-100% of that so a fleet
+    // doesn't reconnect in lockstep after a broker restart
+    uint32_t shift = min((uint32_t)_reconnectAttempts, (uint32_t)8);
+    uint32_t ceiling = min((uint32_t)MQTT_RECONNECT_INTERVAL_MS << shift, (uint32_t)MQTT_RECONNECT_MAX_MS);
+    uint32_t wait = ceiling / 2 + esp_random() % (ceiling / 2 + 1);
+
+    _reconnectAttempts = _reconnectAttempts + 1;
+    _nextAttempt = millis() + wait;
+    LOG_MQTT("Next MQTT connection attempt in %lu ms", (unsigned long)wait);
+}
+
+void MqttClient::service() {
+    if (!_connected) {
+        _connected = true;
     }
 
-    if (mqttClient.connected()) {
-        return true;
+    if (_groupsChanged) {
+        _groupsChanged = false;
+        unsubscribeGroups();
+        subscribeGroups();
+    }
+
+    mqttClient.loop();
+    drainPublishQueue();
+    publishTelemetry();
+
+    // Send periodic heartbeat
+    unsigned long now = millis();
+    if (now - _lastHeartbeat >= HEARTBEAT_INTERVAL_MS) {
+        _lastHeartbeat = now;
+        publishAvailability(true);
     }
 
+    if (now - _lastDiagnostics >= MQTT_DIAGNOSTICS_INTERVAL_MS) {
+        _lastDiagnostics = now;
+        publishDiagnostics();
+    }
+}
+
+bool MqttClient::connectToBroker() {
     LOG_MQTT("Connecting to MQTT broker: %s:%d", _broker.c_str(), _port);
 
     String clientId = "famesmartblinds_" + _deviceId;
@@ -85,6 +307,9 @@ bool MqttClient::connect() {
 
     if (connected) {
         LOG_MQTT("Connected to MQTT broker");
+        BootTimings::mark("mqtt");
+        _connected = true;
+        _lastHeartbeat = millis();
 
         // Publish availability
         publishAvailability(true);
@@ -96,6 +321,37 @@ bool MqttClient::connect() {
             LOG_ERROR("Failed to subscribe to command topic");
         }
 
+        if (mqttClient.subscribe(_setPositionTopic.c_str())) {
+            LOG_MQTT("Subscribed to: %s", _setPositionTopic.c_str());
+        } else {
+            LOG_ERROR("Failed to subscribe to set_position topic");
+        }
+
+        for (uint8_t blind = 1; blind < BLIND_COUNT; blind++) {
+            String command = blindTopic(blind, "command");
+            String setPosition = blindTopic(blind, "set_position");
+            if (mqttClient.subscribe(command.c_str()) && mqttClient.subscribe(setPosition.c_str())) {
+                LOG_MQTT("Subscribed to: %s, %s", command.c_str(), setPosition.c_str());
+            } else {
+                LOG_ERROR("Failed to subscribe to blind %d topics", blind);
+            }
+            _lastBlindState[blind] = nullptr;
+            _lastBlindPosition[blind] = -1;
+        }
+
+        // Re-publish retained position and attributes after reconnect
+        _lastPublishedPosition = -1;
+        _telemetryDirty = STATE_CHANGE_ALL;
+
+        if (mqttClient.subscribe(_logLevelTopic.c_str())) {
+            LOG_MQTT("Subscribed to: %s", _logLevelTopic.c_str());
+        } else {
+            LOG_ERROR("Failed to subscribe to log_level topic");
+        }
+
+        _groupsChanged = false;
+        subscribeGroups();
+
         // Publish Home Assistant discovery
         if (!_discoveryPublished) {
             publishDiscovery();
@@ -109,72 +365,189 @@ bool MqttClient::connect() {
     }
 }
 
-void MqttClient::disconnect() {
+void MqttClient::disconnectFromBroker() {
     if (mqttClient.connected()) {
         publishAvailability(false);
         mqttClient.disconnect();
         LOG_MQTT("Disconnected from MQTT broker");
     }
+    _connected = false;
 }
 
-void MqttClient::disable() {
-    LOG_MQTT("Disabling MQTT client");
-    disconnect();
-    _broker = "";
-    _port = MQTT_PORT;
-    _user = "";
-    _password = "";
-    _initialized = false;
-    _discoveryPublished = false;
+void MqttClient::onCommand(MqttCommandCallback callback) {
+    _commandCallback = callback;
+}
+
+void MqttClient::enqueue(OutgoingTopic topic, const char* payload, bool retain) {
+    if (!_enabled || !_publishQueue) {
+        return;
+    }
+
+    Outgoing message;
+    message.topic = topic;
+    message.retain = retain;
+    strncpy(message.payload, payload, sizeof(message.payload) - 1);
+    message.payload[sizeof(message.payload) - 1] = '\0';
+
+    if (xQueueSend(_publishQueue, &message, 0) != pdTRUE) {
+        // Full (broker unreachable): the newest state matters more than the oldest
+        Outgoing oldest;
+        xQueueReceive(_publishQueue, &oldest, 0);
+        _droppedPublishes = _droppedPublishes + 1;
+        xQueueSend(_publishQueue, &message, 0);
+    }
+    wake();
 }
 
-bool MqttClient::isConnected() {
-    return mqttClient.connected();
+void MqttClient::drainPublishQueue() {
+    Outgoing message;
+    while (xQueuePeek(_publishQueue, &message, 0) == pdTRUE) {
+        const String& topic = _stateTopic;  // Only state edges are queued
+        if (!mqttClient.publish(topic.c_str(), message.payload, message.retain)) {
+            LOG_WARN(MQTT, "Publish to %s failed, keeping it queued", topic.c_str());
+            return;
+        }
+        xQueueReceive(_publishQueue, &message, 0);
+    }
 }
 
-bool MqttClient::isEnabled() const {
-    return _initialized && !_broker.isEmpty();
+void MqttClient::attachState() {
+    // Runs on the main loop via deviceState.dispatch(); the MQTT task publishes
+    deviceState.subscribe(STATE_CHANGE_ALL, [this](uint32_t changes, const DeviceStateSnapshot&) {
+        portENTER_CRITICAL(&_changeMux);
+        _pendingChanges |= changes;
+        portEXIT_CRITICAL(&_changeMux);
+        wake();
+    });
 }
 
-void MqttClient::update() {
-    if (!_initialized || _broker.isEmpty()) {
+void MqttClient::publishState(const char* state) {
+    if (!_enabled) {
         return;
     }
 
-    if (!mqttClient.connected()) {
-        unsigned long now = millis();
-        if (now - _lastReconnectAttempt >= MQTT_RECONNECT_INTERVAL_MS) {
-            _lastReconnectAttempt = now;
-            connect();
-        }
+    LOG_MQTT("Publishing state: %s", state);
+    enqueue(OutgoingTopic::STATE, state, true);
+}
+
+void MqttClient::publishTelemetry() {
+    portENTER_CRITICAL(&_changeMux);
+    _telemetryDirty |= _pendingChanges;
+    _pendingChanges = 0;
+    portEXIT_CRITICAL(&_changeMux);
+
+    if (!_telemetryDirty) {
+        return;
+    }
+
+    // Edges go out at once; movement is batched to one publish per interval,
+    // and telemetry-only drift (voltage, temperature, RSSI) far less often
+    unsigned long interval;
+    if (_telemetryDirty & (STATE_CHANGE_MOTION | STATE_CHANGE_CALIBRATION | STATE_CHANGE_HALL)) {
+        interval = 0;
+    } else if (_telemetryDirty & (STATE_CHANGE_POSITION | STATE_CHANGE_BLINDS)) {
+        interval = MQTT_TELEMETRY_INTERVAL_MS;
     } else {
-        mqttClient.loop();
+        interval = MQTT_TELEMETRY_IDLE_INTERVAL_MS;
+    }
+
+    unsigned long now = millis();
+    if (now - _lastTelemetry < interval) {
+        return;
+    }
+    _lastTelemetry = now;
+    _telemetryDirty = 0;
+
+    DeviceStateSnapshot state = deviceState.snapshot();
+    publishPosition(state.positionPercent());
+    publishAttributes(state);
+    publishBlinds(state);
+}
+
+void MqttClient::publishBlinds(const DeviceStateSnapshot& state) {
+    // The primary blind goes through the state queue and publishPosition()
+    for (uint8_t blind = 1; blind < BLIND_COUNT; blind++) {
+        const BlindSummary& summary = state.blinds[blind];
 
-        // Send periodic heartbeat
-        unsigned long now = millis();
-        if (now - _lastHeartbeat >= HEARTBEAT_INTERVAL_MS) {
-            _lastHeartbeat = now;
-            publishAvailability(true);
+        if (!_lastBlindState[blind] || strcmp(_lastBlindState[blind], summary.blindState) != 0) {
+            if (mqttClient.publish(blindTopic(blind, "state").c_str(), summary.blindState, true)) {
+                _lastBlindState[blind] = summary.blindState;
+            }
+        }
+
+        int percent = summary.positionPercent();
+        if (percent >= 0 && percent != _lastBlindPosition[blind]) {
+            char payload[8];
+            snprintf(payload, sizeof(payload), "%d", percent);
+            if (mqttClient.publish(blindTopic(blind, "position").c_str(), payload, true)) {
+                _lastBlindPosition[blind] = percent;
+            }
         }
     }
 }
 
-void MqttClient::onCommand(MqttCommandCallback callback) {
-    _commandCallback = callback;
+void MqttClient::publishPosition(int percent) {
+    if (percent < 0 || percent == _lastPublishedPosition) {
+        return;
+    }
+
+    char payload[8];
+    snprintf(payload, sizeof(payload), "%d", percent);
+    LOG_DEBUG(MQTT, "Publishing position: %s", payload);
+    if (mqttClient.publish(_positionTopic.c_str(), payload, true)) {
+        _lastPublishedPosition = percent;
+    }
 }
 
-void MqttClient::publishState(const char* state) {
-    if (!mqttClient.connected()) {
+void MqttClient::publishAttributes(const DeviceStateSnapshot& state) {
+    // Flat keys so they show up directly as Home Assistant entity attributes
+    BufferWriter out(_attributesBuffer, sizeof(_attributesBuffer));
+
+    out.print("{\"state\":");
+    out.jsonString(state.blindState);
+    out.printf(",\"cumulative_position\":%ld,\"max_position\":%ld",
+               (long)state.cumulativePosition, (long)state.maxPosition);
+    out.printf(",\"calibrated\":%s,\"calibration_state\":", state.calibrated ? "true" : "false");
+    out.jsonString(state.calibrationState);
+
+    out.printf(",\"servo_connected\":%s", state.servoConnected ? "true" : "false");
+    if (state.servo.valid) {
+        out.printf(",\"servo_speed\":%d,\"servo_load\":%d,\"servo_voltage\":%d.%d,\"servo_temperature\":%d",
+                   state.servo.speed, state.servo.load,
+                   state.servo.voltage / 10, state.servo.voltage % 10,
+                   state.servo.temperature);
+    }
+
+    out.printf(",\"hall_triggered\":%s,\"hall_trigger_count\":%lu",
+               state.hallTriggered ? "true" : "false", (unsigned long)state.hallTriggerCount);
+    out.printf(",\"wifi_rssi\":%d,\"uptime\":%lu}", state.wifiRssi, millis() / 1000);
+
+    if (out.overflowed()) {
+        LOG_ERROR("MQTT attributes exceed %d bytes", MQTT_ATTRIBUTES_BUFFER_SIZE);
         return;
     }
 
-    LOG_MQTT("Publishing state: %s", state);
-    mqttClient.publish(_stateTopic.c_str(), state, true);
+    LOG_TRACE(MQTT, "Publishing attributes: %s", out.c_str());
+    mqttClient.publish(_attributesTopic.c_str(), out.c_str(), true);
+}
+
+void MqttClient::publishDiagnostics() {
+    // Not retained: a stale snapshot from a device that went away isn't useful
+    BufferWriter out(_diagnosticsBuffer, sizeof(_diagnosticsBuffer));
+    Metrics::renderJson(out);
+
+    if (out.overflowed()) {
+        LOG_ERROR("MQTT diagnostics exceed %d bytes", MQTT_DIAGNOSTICS_BUFFER_SIZE);
+        return;
+    }
+
+    LOG_TRACE(MQTT, "Publishing diagnostics: %s", out.c_str());
+    mqttClient.publish(_diagnosticsTopic.c_str(), out.c_str(), false);
 }
 
 void MqttClient::publishAvailability(bool online) {
-    if (!mqttClient.connected() && online) {
-        return;  // Can't publish online if not connected
+    if (!mqttClient.connected()) {
+        return;
     }
 
     const char* payload = online ? "online" : "offline";
@@ -187,30 +560,52 @@ void MqttClient::publishDiscovery() {
         return;
     }
 
-    String payload = buildDiscoveryPayload();
+    // One cover entity per blind, all under the same HA device
+    for (uint8_t blind = 0; blind < BLIND_COUNT; blind++) {
+        String topic = blind == 0 ? _discoveryTopic
+            : String(MQTT_DISCOVERY_PREFIX) + "/cover/famesmartblinds_" + _deviceId + "_" + blind + "/config";
+        String payload = buildDiscoveryPayload(blind);
 
-    LOG_MQTT("Publishing HA discovery to: %s", _discoveryTopic.c_str());
-    LOG_MQTT("Payload size: %d bytes", payload.length());
+        LOG_MQTT("Publishing HA discovery to: %s", topic.c_str());
+        LOG_MQTT("Payload size: %d bytes", payload.length());
 
-    if (mqttClient.publish(_discoveryTopic.c_str(), payload.c_str(), true)) {
-        LOG_MQTT("HA discovery published successfully");
-    } else {
-        LOG_ERROR("Failed to publish HA discovery");
+        if (mqttClient.publish(topic.c_str(), payload.c_str(), true)) {
+            LOG_MQTT("HA discovery published successfully");
+        } else {
+            LOG_ERROR("Failed to publish HA discovery");
+        }
     }
 }
 
-String MqttClient::buildDiscoveryPayload() {
+String MqttClient::buildDiscoveryPayload(uint8_t blind) {
     JsonDocument doc;
 
-    // Basic config
-    doc["name"] = _deviceName;
-    doc["unique_id"] = "famesmartblinds_" + Storage::getMacAddress();
+    // Basic config (the primary blind keeps its single-blind identity)
+    if (blind == 0) {
+        doc["name"] = _deviceName;
+        doc["unique_id"] = "famesmartblinds_" + Storage::getMacAddress();
+    } else {
+        doc["name"] = _deviceName + " " + (blind + 1);
+        doc["unique_id"] = "famesmartblinds_" + Storage::getMacAddress() + "_" + blind;
+    }
     doc["device_class"] = "blind";
 
     // Topics
-    doc["command_topic"] = _commandTopic;
-    doc["state_topic"] = _stateTopic;
+    if (blind == 0) {
+        doc["command_topic"] = _commandTopic;
+        doc["state_topic"] = _stateTopic;
+        doc["set_position_topic"] = _setPositionTopic;
+        doc["position_topic"] = _positionTopic;
+        doc["json_attributes_topic"] = _attributesTopic;
+    } else {
+        doc["command_topic"] = blindTopic(blind, "command");
+        doc["state_topic"] = blindTopic(blind, "state");
+        doc["set_position_topic"] = blindTopic(blind, "set_position");
+        doc["position_topic"] = blindTopic(blind, "position");
+    }
     doc["availability_topic"] = _availabilityTopic;
+    doc["position_open"] = 100;
+    doc["position_closed"] = 0;
 
     // Payloads
     doc["payload_open"] = "OPEN";
@@ -254,23 +649,279 @@ String MqttClient::getAvailabilityTopic() const {
     return _availabilityTopic;
 }
 
-void MqttClient::onMessage(const char* topic, const uint8_t* payload, unsigned int length) {
-    String message;
-    message.reserve(length + 1);
-    for (unsigned int i = 0; i < length; i++) {
-        message += (char)payload[i];
+String MqttClient::getAttributesTopic() const {
+    return _attributesTopic;
+}
+
+String MqttClient::getGroupCommandTopic(const String& group) {
+    return String(MQTT_GROUP_TOPIC_PREFIX) + "/" + group + "/command";
+}
+
+void MqttClient::reloadGroups() {
+    _groupsChanged = true;
+}
+
+bool MqttClient::normalizeGroups(const String& groups, String& normalized) {
+    normalized = "";
+    int count = 0;
+    bool valid = true;
+
+    forEachGroup(groups, [&](String name) {
+        name.toLowerCase();
+        if (name.length() > MQTT_GROUP_NAME_LENGTH) {
+            valid = false;
+            return;
+        }
+        // Topic wildcards and separators would reach the wrong devices
+        for (unsigned int i = 0; i < name.length(); i++) {
+            char c = name[i];
+            if (!isAlphaNumeric(c) && c != '_' && c != '-') {
+                valid = false;
+                return;
+            }
+        }
+        if (("," + normalized + ",").indexOf("," + name + ",") >= 0) {
+            return;  // Duplicate
+        }
+        if (++count > MQTT_MAX_GROUPS) {
+            valid = false;
+            return;
+        }
+        if (!normalized.isEmpty()) {
+            normalized += ",";
+        }
+        normalized += name;
+    });
+
+    return valid;
+}
+
+bool MqttClient::getEpochMillis(int64_t& nowMs) {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    if (tv.tv_sec < (time_t)NTP_VALID_EPOCH) {
+        return false;
     }
+    nowMs = (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+    return true;
+}
 
-    LOG_MQTT("Received on %s: %s", topic, message.c_str());
+void MqttClient::subscribeGroups() {
+    _subscribedGroups = "";
+    forEachGroup(storage.getMqttGroups(), [this](const String& name) {
+        String topic = getGroupCommandTopic(name);
+        if (mqttClient.subscribe(topic.c_str())) {
+            LOG_MQTT("Subscribed to: %s", topic.c_str());
+            if (!_subscribedGroups.isEmpty()) {
+                _subscribedGroups += ",";
+            }
+            _subscribedGroups += name;
+        } else {
+            LOG_ERROR("Failed to subscribe to group topic: %s", topic.c_str());
+        }
+    });
+}
 
-    if (String(topic) == _commandTopic) {
-        message.toUpperCase();
-        if (message == "OPEN" || message == "CLOSE" || message == "STOP") {
-            if (_commandCallback) {
-                _commandCallback(message);
+void MqttClient::unsubscribeGroups() {
+    forEachGroup(_subscribedGroups, [](const String& name) {
+        String topic = getGroupCommandTopic(name);
+        mqttClient.unsubscribe(topic.c_str());
+        LOG_MQTT("Unsubscribed from: %s", topic.c_str());
+    });
+    _subscribedGroups = "";
+}
+
+bool MqttClient::isGroupCommandTopic(const char* topic) const {
+    // famesmartblinds/group/<name>/command, <name> one of _subscribedGroups
+    static const char prefix[] = MQTT_GROUP_TOPIC_PREFIX "/";
+    static const char suffix[] = "/command";
+    if (strncmp(topic, prefix, sizeof(prefix) - 1) != 0) {
+        return false;
+    }
+    const char* name = topic + sizeof(prefix) - 1;
+    const char* slash = strchr(name, '/');
+    if (!slash || strcmp(slash, suffix) != 0) {
+        return false;
+    }
+    size_t nameLength = slash - name;
+
+    const char* group = _subscribedGroups.c_str();
+    while (*group) {
+        const char* comma = strchr(group, ',');
+        size_t length = comma ? (size_t)(comma - group) : strlen(group);
+        if (length == nameLength && strncmp(group, name, length) == 0) {
+            return true;
+        }
+        if (!comma) {
+            break;
+        }
+        group = comma + 1;
+    }
+    return false;
+}
+
+bool MqttClient::parseCommand(const char* data, size_t length, Command& command, int64_t& at) {
+    at = 0;
+
+    size_t start = 0;
+    while (start < length && isspace((unsigned char)data[start])) {
+        start++;
+    }
+
+    if (start < length && data[start] == '{') {
+        // {"command":"CLOSE","at":1760000000000} or {"position":40,"at":...}
+        JsonDocument doc;
+        if (deserializeJson(doc, data, length)) {
+            return false;
+        }
+        if (doc["position"].is<int>()) {
+            int percent = doc["position"];
+            if (percent < 0 || percent > 100) {
+                return false;
             }
+            command = Command(CommandId::POSITION, percent);
         } else {
-            LOG_MQTT("Unknown command: %s", message.c_str());
+            const char* name = doc["command"] | "";
+            if (!CommandParser::parse(name, strlen(name), command)) {
+                return false;
+            }
+        }
+
+        // Start time in epoch ms; seconds (optionally fractional) are accepted too
+        double when = doc["at"] | 0.0;
+        if (when > 0 && when < 1e11) {
+            when *= 1000.0;
+        }
+        at = (int64_t)when;
+    } else if (!CommandParser::parse(data, length, command)) {
+        return false;
+    }
+
+    // Moves only - no text arguments, so the command outlives the payload buffer
+    return command.isMotion();
+}
+
+void MqttClient::dispatchCommand(const Command& command, int64_t at) {
+    char name[24];
+    CommandParser::format(command, name, sizeof(name));
+
+    // Any newer command replaces a start that is still pending
+    if (_scheduledCommand.id != CommandId::NONE) {
+        char pending[24];
+        LOG_MQTT("Cancelling scheduled command: %s",
+                 CommandParser::format(_scheduledCommand, pending, sizeof(pending)));
+        _scheduledCommand = Command();
+    }
+
+    if (at > 0) {
+        int64_t now;
+        if (!getEpochMillis(now)) {
+            LOG_WARN(MQTT, "Clock not synced, running %s immediately", name);
+        } else {
+            int64_t wait = at - now;
+            if (wait > MQTT_SCHEDULE_MAX_AHEAD_MS) {
+                LOG_WARN(MQTT, "Ignoring %s: start is %ld s ahead", name, (long)(wait / 1000));
+                return;
+            }
+            if (wait < -MQTT_SCHEDULE_LATE_MS) {
+                LOG_WARN(MQTT, "Ignoring stale %s: start was %ld ms ago", name, (long)-wait);
+                return;
+            }
+            if (wait > 0) {
+                _scheduledCommand = command;
+                _scheduledAt = at;
+                LOG_MQTT("Scheduled %s in %ld ms", name, (long)wait);
+                return;
+            }
+            if (wait < 0) {
+                LOG_MQTT("Scheduled %s arrived %ld ms late", name, (long)-wait);
+            }
+        }
+    }
+
+    deliver(command);
+}
+
+void MqttClient::deliver(const Command& command) {
+    if (!_commandCallback) {
+        return;
+    }
+    if (command.blind != ALL_BLINDS) {
+        _commandCallback(command);
+        return;
+    }
+
+    Command each = command;
+    for (uint8_t blind = 0; blind < BLIND_COUNT; blind++) {
+        each.blind = blind;
+        _commandCallback(each);
+    }
+}
+
+void MqttClient::runScheduledCommand() {
+    if (_scheduledCommand.id == CommandId::NONE) {
+        return;
+    }
+
+    int64_t now;
+    if (getEpochMillis(now) && now < _scheduledAt) {
+        return;
+    }
+
+    Command command = _scheduledCommand;
+    _scheduledCommand = Command();
+
+    char name[24];
+    LOG_MQTT("Starting scheduled command: %s", CommandParser::format(command, name, sizeof(name)));
+    deliver(command);
+}
+
+void MqttClient::onMessage(const char* topic, const uint8_t* payload, unsigned int length) {
+    // Parsed in place from PubSubClient's buffer (no per-message String copies)
+    const char* text = (const char*)payload;
+    LOG_MQTT("Received on %s: %.*s", topic, (int)length, text);
+
+    const char* leaf = nullptr;
+    int blind = 0;
+    bool group = false;
+    if (_commandTopic == topic) {
+        leaf = "command";
+    } else if (_setPositionTopic == topic) {
+        leaf = "set_position";
+    } else if (isGroupCommandTopic(topic)) {
+        leaf = "command";
+        group = true;
+    } else {
+        blind = parseBlindTopic(topic, leaf);
+    }
+
+    if (blind >= 0 && leaf && strcmp(leaf, "command") == 0) {
+        // OPEN / CLOSE / STOP, or JSON with an optional synchronized start time
+        Command command;
+        int64_t at;
+        if (parseCommand(text, length, command, at)) {
+            command.blind = group ? ALL_BLINDS : (uint8_t)blind;
+            dispatchCommand(command, at);
+        } else {
+            LOG_MQTT("Unknown command: %.*s", (int)length, text);
+        }
+    } else if (blind >= 0 && leaf && strcmp(leaf, "set_position") == 0) {
+        // HA sends 0-100 (position_closed..position_open)
+        int32_t percent;
+        if (!CommandParser::parseNumber(text, length, 100, percent)) {
+            LOG_MQTT("Invalid set_position payload: %.*s", (int)length, text);
+            return;
+        }
+        Command command(CommandId::POSITION, percent);
+        command.blind = (uint8_t)blind;
+        dispatchCommand(command, 0);
+    } else if (_logLevelTopic == topic) {
+        // Payload: servo=debug,http=warn (validated by the command handler)
+        Command command(CommandId::LOGLEVEL);
+        command.text = text;
+        command.textLength = length;
+        if (length > 0 && _commandCallback) {
+            _commandCallback(command);
         }
     }
 }
@@ -0,0 +1,327 @@
+#include "ota_decoder.h"
+#include "logger.h"
+#include <Update.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include <esp_rom_crc.h>
+
+// ROM copy of miniz (tinfl) - no inflate code in the app image
+#if __has_include(<esp32c3/rom/miniz.h>)
+#include <esp32c3/rom/miniz.h>
+#else
+#include <rom/miniz.h>
+#endif
+
+struct OtaImageDecoder::Work {
+    tinfl_decompressor inflator;
+    uint8_t dict[TINFL_LZ_DICT_SIZE];   // Inflate output window (must be 32 KB)
+    uint8_t copyBuffer[1024];           // Flash reads for COPY ops / base CRC
+};
+
+static uint32_t readLe32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+OtaImageDecoder::OtaImageDecoder()
+    : _work(nullptr)
+{
+    reset(0);
+}
+
+OtaImageDecoder::~OtaImageDecoder() {
+    release();
+}
+
+void OtaImageDecoder::reset(size_t uploadSize) {
+    release();
+    _uploadSize = uploadSize;
+    _format = OtaImageFormat::UNKNOWN;
+    memset(&_header, 0, sizeof(_header));
+    _headerBytes = 0;
+    _dictOffset = 0;
+    _inflateDone = false;
+    _imageSize = 0;
+    _written = 0;
+    _crc = 0;
+    _patchState = PATCH_OP;
+    _patchOp = 0;
+    _argBytes = 0;
+    _argsNeeded = 0;
+    _insertRemaining = 0;
+    _error = nullptr;
+}
+
+void OtaImageDecoder::release() {
+    free(_work);
+    _work = nullptr;
+}
+
+const char* OtaImageDecoder::formatName() const {
+    switch (_format) {
+        case OtaImageFormat::RAW:          return "raw";
+        case OtaImageFormat::PACKED_FULL:  return "compressed";
+        case OtaImageFormat::PACKED_DELTA: return "delta";
+        default:                           return "unknown";
+    }
+}
+
+bool OtaImageDecoder::fail(const char* message) {
+    if (!_error) {
+        _error = message;
+        LOG_ERROR("OTA decode failed: %s", message);
+    }
+    return false;
+}
+
+bool OtaImageDecoder::feed(const uint8_t* data, size_t length) {
+    if (_error) return false;
+
+    if (_format == OtaImageFormat::UNKNOWN && length > 0) {
+        if (data[0] == OTA_IMAGE_MAGIC) {
+            // Plain image - written through unchanged, as before
+            _format = OtaImageFormat::RAW;
+            _imageSize = _uploadSize;
+            if (!Update.begin(_imageSize, U_FLASH)) {
+                return fail(Update.errorString());
+            }
+        } else {
+            // Collect the container header (may straddle chunks)
+            size_t take = min(length, sizeof(_header) - _headerBytes);
+            memcpy((uint8_t*)&_header + _headerBytes, data, take);
+            _headerBytes += take;
+            data += take;
+            length -= take;
+            if (_headerBytes < sizeof(_header)) {
+                return true;
+            }
+            if (!startPacked()) {
+                return false;
+            }
+        }
+    }
+
+    if (length == 0) return true;
+
+    if (_format == OtaImageFormat::RAW) {
+        return emit(data, length);
+    }
+    return inflate(data, length);
+}
+
+bool OtaImageDecoder::startPacked() {
+    if (_header.magic != OTA_PACKED_MAGIC) {
+        return fail("Not a firmware image");
+    }
+    if (_header.version != OTA_PACKED_VERSION) {
+        return fail("Unsupported packed image version");
+    }
+    if (_header.type != OTA_PACKED_FULL && _header.type != OTA_PACKED_DELTA) {
+        return fail("Unknown packed image type");
+    }
+
+    const esp_partition_t* target = esp_ota_get_next_update_partition(nullptr);
+    if (!target || _header.imageSize == 0 || _header.imageSize > target->size) {
+        return fail("Image does not fit the OTA partition");
+    }
+
+    _work = (Work*)malloc(sizeof(Work));
+    if (!_work) {
+        return fail("Not enough memory to decompress");
+    }
+    tinfl_init(&_work->inflator);
+
+    _format = _header.type == OTA_PACKED_DELTA ? OtaImageFormat::PACKED_DELTA
+                                               : OtaImageFormat::PACKED_FULL;
+    _imageSize = _header.imageSize;
+
+    if (_format == OtaImageFormat::PACKED_DELTA && !verifyBase()) {
+        return false;
+    }
+
+    if (!Update.begin(_imageSize, U_FLASH)) {
+        return fail(Update.errorString());
+    }
+
+    LOG_HTTP("OTA %s image: %u bytes uploaded for a %u byte image",
+             formatName(), (unsigned)_uploadSize, (unsigned)_imageSize);
+    return true;
+}
+
+bool OtaImageDecoder::verifyBase() {
+    // A patch only makes sense against the exact image it was diffed from
+    const esp_partition_t* running = esp_ota_get_running_partition();
+    if (!running || _header.baseSize == 0 || _header.baseSize > running->size) {
+        return fail("Patch base does not fit the running partition");
+    }
+
+    uint32_t crc = 0;
+    for (uint32_t offset = 0; offset < _header.baseSize; offset += sizeof(_work->copyBuffer)) {
+        size_t n = min((size_t)(_header.baseSize - offset), sizeof(_work->copyBuffer));
+        if (esp_partition_read(running, offset, _work->copyBuffer, n) != ESP_OK) {
+            return fail("Failed to read running firmware");
+        }
+        crc = esp_rom_crc32_le(crc, _work->copyBuffer, n);
+    }
+
+    if (crc != _header.baseCrc) {
+        return fail("Patch does not match the running firmware");
+    }
+    return true;
+}
+
+bool OtaImageDecoder::inflate(const uint8_t* data, size_t length) {
+    while (!_inflateDone) {
+        size_t inBytes = length;
+        size_t outBytes = TINFL_LZ_DICT_SIZE - _dictOffset;
+        tinfl_status status = tinfl_decompress(&_work->inflator, data, &inBytes,
+                                               _work->dict, _work->dict + _dictOffset, &outBytes,
+                                               TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_HAS_MORE_INPUT);
+        data += inBytes;
+        length -= inBytes;
+
+        if (outBytes > 0) {
+            if (!consume(_work->dict + _dictOffset, outBytes)) {
+                return false;
+            }
+            _dictOffset = (_dictOffset + outBytes) & (TINFL_LZ_DICT_SIZE - 1);
+        }
+
+        if (status < TINFL_STATUS_DONE) {
+            return fail("Corrupt compressed data");
+        }
+        if (status == TINFL_STATUS_DONE) {
+            _inflateDone = true;
+        } else if (status == TINFL_STATUS_NEEDS_MORE_INPUT && length == 0) {
+            break;  // Wait for the next chunk
+        }
+        // TINFL_STATUS_HAS_MORE_OUTPUT: dictionary wrapped, keep going
+    }
+    return true;
+}
+
+bool OtaImageDecoder::consume(const uint8_t* data, size_t length) {
+    if (_format == OtaImageFormat::PACKED_DELTA) {
+        return applyPatch(data, length);
+    }
+    return emit(data, length);
+}
+
+bool OtaImageDecoder::applyPatch(const uint8_t* data, size_t length) {
+    while (length > 0) {
+        switch (_patchState) {
+            case PATCH_OP:
+                _patchOp = *data++;
+                length--;
+                _argBytes = 0;
+                if (_patchOp == 0x00) {
+                    _patchState = PATCH_DONE;
+                } else if (_patchOp == 0x01) {
+                    _argsNeeded = 8;
+                    _patchState = PATCH_ARGS;
+                } else if (_patchOp == 0x02) {
+                    _argsNeeded = 4;
+                    _patchState = PATCH_ARGS;
+                } else {
+                    return fail("Invalid patch op");
+                }
+                break;
+
+            case PATCH_ARGS: {
+                size_t take = min(length, (size_t)(_argsNeeded - _argBytes));
+                memcpy(_args + _argBytes, data, take);
+                _argBytes += take;
+                data += take;
+                length -= take;
+                if (_argBytes < _argsNeeded) break;
+
+                if (_patchOp == 0x01) {
+                    if (!copyFromBase(readLe32(_args), readLe32(_args + 4))) {
+                        return false;
+                    }
+                    _patchState = PATCH_OP;
+                } else {
+                    _insertRemaining = readLe32(_args);
+                    _patchState = _insertRemaining > 0 ? PATCH_INSERT : PATCH_OP;
+                }
+                break;
+            }
+
+            case PATCH_INSERT: {
+                size_t take = min(length, (size_t)_insertRemaining);
+                if (!emit(data, take)) {
+                    return false;
+                }
+                _insertRemaining -= take;
+                data += take;
+                length -= take;
+                if (_insertRemaining == 0) {
+                    _patchState = PATCH_OP;
+                }
+                break;
+            }
+
+            case PATCH_DONE:
+                return fail("Data after end of patch");
+        }
+    }
+    return true;
+}
+
+bool OtaImageDecoder::copyFromBase(uint32_t offset, uint32_t length) {
+    if (offset > _header.baseSize || length > _header.baseSize - offset) {
+        return fail("Patch copy outside the base image");
+    }
+
+    const esp_partition_t* running = esp_ota_get_running_partition();
+    while (length > 0) {
+        size_t n = min((size_t)length, sizeof(_work->copyBuffer));
+        if (esp_partition_read(running, offset, _work->copyBuffer, n) != ESP_OK) {
+            return fail("Failed to read running firmware");
+        }
+        if (!emit(_work->copyBuffer, n)) {
+            return false;
+        }
+        offset += n;
+        length -= n;
+    }
+    return true;
+}
+
+bool OtaImageDecoder::emit(const uint8_t* data, size_t length) {
+    if (length > _imageSize - _written) {
+        return fail("Image larger than declared");
+    }
+
+    if (_format != OtaImageFormat::RAW) {
+        _crc = esp_rom_crc32_le(_crc, data, length);
+    }
+
+    if (Update.write(const_cast<uint8_t*>(data), length) != length) {
+        return fail(Update.errorString());
+    }
+    _written += length;
+    return true;
+}
+
+bool OtaImageDecoder::finish() {
+    if (_error) return false;
+
+    if (_format == OtaImageFormat::UNKNOWN) {
+        return fail("No image data received");
+    }
+    if (_format != OtaImageFormat::RAW) {
+        if (!_inflateDone) {
+            return fail("Compressed data truncated");
+        }
+        if (_format == OtaImageFormat::PACKED_DELTA && _patchState != PATCH_DONE) {
+            return fail("Patch truncated");
+        }
+        if (_crc != _header.imageCrc) {
+            return fail("Image CRC mismatch");
+        }
+    }
+    if (_written != _imageSize) {
+        return fail("Image incomplete");
+    }
+    return true;
+}
@@ -0,0 +1,453 @@
+#include "ota_writer.h"
+#include "logger.h"
+#include <Update.h>
+#include <esp_ota_ops.h>
+
+OtaWriter::OtaWriter()
+    : _slotCount(0)
+    , _chunkSize(0)
+    , _window(0)
+    , _session(0)
+    , _active(false)
+    , _error(false)
+    , _endState(END_NONE)
+    , _total(0)
+    , _received(0)
+    , _committed(0)
+    , _nextIndex(0)
+    , _taskHandle(nullptr)
+    , _mux(portMUX_INITIALIZER_UNLOCKED)
+{
+    memset(_slots, 0, sizeof(_slots));
+    _errorString[0] = '\0';
+    _imageId[0] = '\0';
+    _lastActivity = 0;
+    _freeSlots = xSemaphoreCreateCounting(MAX_SLOTS, 0);
+    _updateMutex = xSemaphoreCreateMutex();
+}
+
+bool OtaWriter::begin(size_t totalSize, const char* imageId, size_t& chunkSize, uint8_t& window) {
+    if (_active) {
+        LOG_HTTP("OTA: previous session replaced");
+        abort();
+    }
+
+    if (!_taskHandle) {
+        BaseType_t result = xTaskCreate(writerTask, "ota_writer", OTA_WRITER_STACK_SIZE,
+                                        this, OTA_WRITER_PRIORITY, &_taskHandle);
+        if (result != pdPASS) {
+            _taskHandle = nullptr;
+            setError("Failed to start writer task");
+            return false;
+        }
+    }
+
+    // Prefer large chunks with a full window, then fall back as the heap allows.
+    // The last resort keeps no reserve, so only raw images may fit.
+    if (!allocateBuffers(OTA_CHUNK_SIZE, MAX_SLOTS, OTA_MIN_FREE_HEAP) &&
+        !allocateBuffers(OTA_MIN_CHUNK_SIZE, MAX_SLOTS, OTA_MIN_FREE_HEAP) &&
+        !allocateBuffers(OTA_MIN_CHUNK_SIZE, 2, 0)) {
+        setError("Not enough memory for OTA buffers");
+        return false;
+    }
+
+    // Uploads are at most the image size (compressed and delta files are smaller)
+    const esp_partition_t* target = esp_ota_get_next_update_partition(nullptr);
+    if (!target || totalSize > target->size) {
+        freeBuffers();
+        setError(target ? "Firmware too large for OTA partition" : "No OTA partition");
+        return false;
+    }
+
+    _decoder.reset(totalSize);
+    _total = totalSize;
+    strncpy(_imageId, imageId ? imageId : "", OTA_IMAGE_ID_LENGTH);
+    _imageId[OTA_IMAGE_ID_LENGTH] = '\0';
+    _lastActivity = millis();
+    _received = 0;
+    _committed = 0;
+    _nextIndex = 0;
+    _error = false;
+    _endState = END_NONE;
+    _errorString[0] = '\0';
+    _session++;
+    resetSlots();
+    _active = true;
+
+    chunkSize = _chunkSize;
+    window = _window;
+    LOG_HTTP("OTA session %u: %u bytes, %u byte chunks, window %u",
+            (unsigned)_session, (unsigned)totalSize, (unsigned)_chunkSize, _window);
+    return true;
+}
+
+OtaEndResult OtaWriter::end() {
+    switch (_endState) {
+        case END_DONE:
+            return OTA_END_DONE;
+        case END_FAILED:
+            return OTA_END_FAILED;
+        case END_REQUESTED:
+            return OTA_END_PENDING;
+        case END_NONE:
+            break;
+    }
+    if (!_active) {
+        return OTA_END_NO_SESSION;
+    }
+
+    LOG_HTTP("OTA end: received %u of %u bytes, finishing", (unsigned)_received, (unsigned)_total);
+    _endState = END_REQUESTED;
+    xTaskNotifyGive(_taskHandle);
+    return OTA_END_PENDING;
+}
+
+void OtaWriter::abort() {
+    // Holding the mutex means the writer task is not inside Update.write()
+    xSemaphoreTake(_updateMutex, portMAX_DELAY);
+    bool wasActive = _active;
+    _active = false;
+    _endState = END_NONE;
+    closeSession(wasActive);
+}
+
+// Caller holds _updateMutex and has cleared _active; gives the mutex back
+void OtaWriter::closeSession(bool wasActive) {
+    if (wasActive && _decoder.format() != OtaImageFormat::UNKNOWN) {
+        Update.abort();  // Only begun once the first chunk was decoded
+    }
+    _decoder.release();
+    xSemaphoreGive(_updateMutex);
+
+    freeBuffers();
+}
+
+bool OtaWriter::canResume(size_t totalSize, const char* imageId) const {
+    if (!_active || _error || totalSize != _total) {
+        return false;
+    }
+    // Without an id on both sides, a matching size is all we can check
+    return strncmp(_imageId, imageId ? imageId : "", OTA_IMAGE_ID_LENGTH) == 0;
+}
+
+int OtaWriter::acquire(uint32_t timeoutMs, uint32_t& session) {
+    if (!_active) return -1;
+    _lastActivity = millis();
+
+    if (xSemaphoreTake(_freeSlots, pdMS_TO_TICKS(timeoutMs)) != pdTRUE) {
+        return -1;
+    }
+
+    int slot = -1;
+    portENTER_CRITICAL(&_mux);
+    if (_active) {
+        for (int i = 0; i < _slotCount; i++) {
+            if (_slots[i].state == SLOT_FREE) {
+                _slots[i].state = SLOT_FILLING;
+                _slots[i].length = 0;
+                slot = i;
+                break;
+            }
+        }
+    }
+    session = _session;
+    portEXIT_CRITICAL(&_mux);
+
+    if (slot < 0) {
+        xSemaphoreGive(_freeSlots);  // Session ended while waiting
+    }
+    return slot;
+}
+
+uint8_t* OtaWriter::buffer(int slot, uint32_t session) {
+    if (!_active || session != _session || slot < 0 || slot >= _slotCount) {
+        return nullptr;
+    }
+    return _slots[slot].data;
+}
+
+void OtaWriter::release(int slot, uint32_t session) {
+    bool released = false;
+
+    portENTER_CRITICAL(&_mux);
+    if (session == _session && slot >= 0 && slot < _slotCount &&
+        _slots[slot].state == SLOT_FILLING) {
+        _slots[slot].state = SLOT_FREE;
+        released = true;
+    }
+    portEXIT_CRITICAL(&_mux);
+
+    if (released) {
+        xSemaphoreGive(_freeSlots);
+    }
+}
+
+OtaSubmitResult OtaWriter::submit(int slot, uint32_t session, uint32_t index, size_t length) {
+    if (!_active || _error || session != _session) {
+        release(slot, session);
+        return OTA_SUBMIT_FAILED;
+    }
+
+    OtaSubmitResult result = OTA_SUBMIT_QUEUED;
+
+    portENTER_CRITICAL(&_mux);
+    if (index < _nextIndex) {
+        result = OTA_SUBMIT_DUPLICATE;
+    } else if (index >= _nextIndex + _slotCount) {
+        result = OTA_SUBMIT_OUT_OF_WINDOW;
+    } else {
+        for (int i = 0; i < _slotCount; i++) {
+            if ((_slots[i].state == SLOT_READY || _slots[i].state == SLOT_WRITING) &&
+                _slots[i].index == index) {
+                result = OTA_SUBMIT_DUPLICATE;
+                break;
+            }
+        }
+    }
+
+    if (result == OTA_SUBMIT_QUEUED) {
+        _slots[slot].index = index;
+        _slots[slot].length = length;
+        _slots[slot].state = SLOT_READY;
+        _received += length;
+    }
+    portEXIT_CRITICAL(&_mux);
+
+    if (result != OTA_SUBMIT_QUEUED) {
+        release(slot, session);
+        return result;
+    }
+
+    _lastActivity = millis();
+    xTaskNotifyGive(_taskHandle);
+    return result;
+}
+
+bool OtaWriter::allocateBuffers(size_t chunkSize, int count, size_t reserve) {
+    freeBuffers();
+
+    // Leave room for the rest of the system (and the inflater, if needed)
+    if (ESP.getFreeHeap() < chunkSize * count + reserve) {
+        return false;
+    }
+
+    for (int i = 0; i < count; i++) {
+        _slots[i].data = (uint8_t*)malloc(chunkSize);
+        if (!_slots[i].data) {
+            freeBuffers();
+            return false;
+        }
+    }
+
+    _slotCount = count;
+    _chunkSize = chunkSize;
+    _window = count - 1;
+    return true;
+}
+
+void OtaWriter::freeBuffers() {
+    uint8_t* buffers[MAX_SLOTS];
+
+    portENTER_CRITICAL(&_mux);
+    for (int i = 0; i < MAX_SLOTS; i++) {
+        buffers[i] = _slots[i].data;
+        _slots[i] = {};
+    }
+    _slotCount = 0;
+    portEXIT_CRITICAL(&_mux);
+
+    for (int i = 0; i < MAX_SLOTS; i++) {
+        free(buffers[i]);
+    }
+
+    // Drain the free-slot count; resetSlots() refills it for the next session
+    while (xSemaphoreTake(_freeSlots, 0) == pdTRUE) {
+    }
+}
+
+void OtaWriter::resetSlots() {
+    portENTER_CRITICAL(&_mux);
+    for (int i = 0; i < _slotCount; i++) {
+        _slots[i].state = SLOT_FREE;
+        _slots[i].length = 0;
+    }
+    portEXIT_CRITICAL(&_mux);
+
+    while (xSemaphoreTake(_freeSlots, 0) == pdTRUE) {
+    }
+    for (int i = 0; i < _slotCount; i++) {
+        xSemaphoreGive(_freeSlots);
+    }
+}
+
+void OtaWriter::setError(const char* message) {
+    strncpy(_errorString, message, sizeof(_errorString) - 1);
+    _errorString[sizeof(_errorString) - 1] = '\0';
+    _error = true;
+}
+
+int OtaWriter::findNextReady() {
+    int slot = -1;
+    portENTER_CRITICAL(&_mux);
+    for (int i = 0; i < _slotCount; i++) {
+        if (_slots[i].state == SLOT_READY && _slots[i].index == _nextIndex) {
+            _slots[i].state = SLOT_WRITING;
+            slot = i;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&_mux);
+    return slot;
+}
+
+// Caller holds _mux
+bool OtaWriter::hasFillingSlot() {
+    for (int i = 0; i < _slotCount; i++) {
+        if (_slots[i].state == SLOT_FILLING) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// True if no queued chunk can make progress
+bool OtaWriter::idle() {
+    bool busy = false;
+    portENTER_CRITICAL(&_mux);
+    for (int i = 0; i < _slotCount; i++) {
+        if (_slots[i].state == SLOT_WRITING ||
+            (_slots[i].state == SLOT_READY && _slots[i].index == _nextIndex)) {
+            busy = true;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&_mux);
+    return !busy;
+}
+
+void OtaWriter::finishRequested() {
+    // Runs after writeQueued(), so a requested end sees every chunk that was
+    // queued before it; one submitted meanwhile is flashed on the next wake
+    if (_endState != END_REQUESTED || !idle()) {
+        return;
+    }
+
+    xSemaphoreTake(_updateMutex, portMAX_DELAY);
+    if (!_active) {
+        xSemaphoreGive(_updateMutex);  // Aborted or replaced meanwhile
+        return;
+    }
+
+    if (_error || _committed != _total) {
+        if (!_error) {
+            setError("Incomplete upload");
+        }
+        LOG_HTTP("OTA end failed: %s (%u of %u bytes flashed)", _errorString,
+                (unsigned)_committed, (unsigned)_total);
+        _active = false;
+        _endState = END_FAILED;
+        closeSession(true);
+        return;
+    }
+
+    bool ok = _decoder.finish();
+    if (!ok) {
+        setError(_decoder.errorString());
+        if (_decoder.format() != OtaImageFormat::UNKNOWN) {
+            Update.abort();
+        }
+    } else if (!Update.end(true)) {
+        setError(Update.errorString());
+        ok = false;
+    }
+    _active = false;
+    _decoder.release();
+    xSemaphoreGive(_updateMutex);
+
+    freeBuffers();
+    if (ok) {
+        LOG_HTTP("OTA image verified (%u bytes)", (unsigned)_total);
+    } else {
+        LOG_HTTP("OTA end failed: %s", _errorString);
+    }
+    _endState = ok ? END_DONE : END_FAILED;
+}
+
+void OtaWriter::expireIdleSession() {
+    // The session (and its buffers) is kept across dropped connections so the
+    // client can resume; give the memory back once nobody has come back for it.
+    if (!_active || millis() - _lastActivity < OTA_SESSION_TIMEOUT_MS) {
+        return;
+    }
+
+    // Never while a request owns a buffer. The check and ending the session
+    // share one critical section: acquire() tests _active under _mux, so once
+    // it is cleared here no request can start filling a buffer being freed.
+    xSemaphoreTake(_updateMutex, portMAX_DELAY);
+    bool expired = false;
+    portENTER_CRITICAL(&_mux);
+    if (_active && millis() - _lastActivity >= OTA_SESSION_TIMEOUT_MS && !hasFillingSlot()) {
+        _active = false;
+        _endState = END_NONE;
+        expired = true;
+    }
+    portEXIT_CRITICAL(&_mux);
+
+    if (!expired) {
+        xSemaphoreGive(_updateMutex);
+        return;
+    }
+
+    LOG_HTTP("OTA session %u expired after %lu s idle (%u of %u bytes flashed)",
+             (unsigned)_session, (unsigned long)(OTA_SESSION_TIMEOUT_MS / 1000),
+             (unsigned)_committed, (unsigned)_total);
+    closeSession(true);
+}
+
+void OtaWriter::writerTask(void* arg) {
+    OtaWriter* self = static_cast<OtaWriter*>(arg);
+    for (;;) {
+        // Wake at least once a second to expire abandoned sessions
+        if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000)) > 0) {
+            self->writeQueued();
+        }
+        self->finishRequested();
+        self->expireIdleSession();
+    }
+}
+
+void OtaWriter::writeQueued() {
+    // Flash every chunk that is next in line; out-of-order chunks wait in
+    // their slot until the gap before them is filled
+    for (;;) {
+        xSemaphoreTake(_updateMutex, portMAX_DELAY);
+        if (!_active) {
+            xSemaphoreGive(_updateMutex);
+            return;
+        }
+
+        int slot = findNextReady();
+        if (slot < 0) {
+            xSemaphoreGive(_updateMutex);
+            return;
+        }
+
+        Slot& s = _slots[slot];
+        if (!_error) {
+            if (!_decoder.feed(s.data, s.length)) {
+                setError(_decoder.errorString());
+                LOG_ERROR("OTA flash write failed at chunk %u: %s", (unsigned)s.index, _errorString);
+            } else {
+                _committed += s.length;
+            }
+        }
+
+        portENTER_CRITICAL(&_mux);
+        s.state = SLOT_FREE;
+        _nextIndex++;
+        portEXIT_CRITICAL(&_mux);
+        xSemaphoreGive(_updateMutex);
+
+        xSemaphoreGive(_freeSlots);
+    }
+}
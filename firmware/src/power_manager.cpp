@@ -0,0 +1,198 @@
+#include "power_manager.h"
+#include "logger.h"
+#include "storage.h"
+#include "servo_controller.h"
+#include "hall_sensor.h"
+#include <WiFi.h>
+#include <esp_sleep.h>
+
+extern Storage storage;
+
+static const char* const MODE_NAMES[] = {"performance", "balanced", "low"};
+
+// Every blind's hall sensor is a wake source, since any blind can be moved by hand
+static HallSensor* wakeSensor(uint8_t blind) {
+    ServoController* controller = ServoController::forBlind(blind);
+    return controller ? controller->getHallSensor() : nullptr;
+}
+
+static void setWakeArmed(bool armed) {
+    for (uint8_t blind = 0; blind < BLIND_COUNT; blind++) {
+        HallSensor* sensor = wakeSensor(blind);
+        if (!sensor) continue;
+        if (armed) {
+            sensor->armWake();
+        } else {
+            sensor->disarmWake();
+        }
+    }
+}
+
+PowerManager::PowerManager()
+    : _mode((PowerMode)POWER_MODE_DEFAULT)
+    , _modeChanged(true)
+    , _idle(false)
+    , _lastActive(0)
+    , _lightSleepAvailable(false)
+    , _sleepAllowed(false)
+    , _sleepLock(nullptr)
+    , _windowStart(0)
+    , _loopBusyMicros(0)
+    , _motionBusyStart(0)
+    , _dutyCycle(0.0f)
+{
+}
+
+void PowerManager::init(bool allowLightSleep) {
+    uint8_t stored = storage.getPowerMode();
+    _mode = stored < (uint8_t)PowerMode::COUNT ? (PowerMode)stored : (PowerMode)POWER_MODE_DEFAULT;
+    _modeChanged = true;
+    _lastActive = millis();
+    _windowStart = _lastActive;
+    _motionBusyStart = ServoController::getBusyMicros();
+
+    if (allowLightSleep) {
+        configureLightSleep();
+    }
+    applyWifiSleep();
+
+    LOG_BOOT("Power mode: %s (light sleep %s)", modeName(_mode),
+             _lightSleepAvailable ? "available" : "unavailable");
+}
+
+void PowerManager::configureLightSleep() {
+#if CONFIG_PM_ENABLE && CONFIG_FREERTOS_USE_TICKLESS_IDLE
+    // Held whenever sleeping isn't wanted; released only while idle in low power mode
+    if (esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "idle", &_sleepLock) != ESP_OK) {
+        LOG_WARN(BOOT, "Power: could not create sleep lock");
+        return;
+    }
+    esp_pm_lock_acquire(_sleepLock);
+
+    // No frequency scaling - the 1 Mbaud servo UART divider assumes full APB clock
+    esp_pm_config_esp32c3_t pm;
+    pm.max_freq_mhz = POWER_CPU_FREQ_MHZ;
+    pm.min_freq_mhz = POWER_CPU_FREQ_MHZ;
+    pm.light_sleep_enable = true;
+    esp_err_t err = esp_pm_configure(&pm);
+    if (err != ESP_OK) {
+        LOG_WARN(BOOT, "Power: light sleep not supported (%d)", err);
+        return;
+    }
+
+    esp_sleep_enable_gpio_wakeup();
+    _lightSleepAvailable = true;
+#else
+    LOG_DEBUG(BOOT, "Power: core built without CONFIG_PM_ENABLE/tickless idle - modem sleep only");
+#endif
+}
+
+bool PowerManager::setMode(PowerMode mode) {
+    if (mode >= PowerMode::COUNT) {
+        return false;
+    }
+
+    LOG_BOOT("Power mode: %s", modeName(mode));
+    _mode = mode;
+    _modeChanged = true;
+    applyWifiSleep();
+    return storage.setPowerMode((uint8_t)mode);
+}
+
+const char* PowerManager::modeName(PowerMode mode) {
+    return mode < PowerMode::COUNT ? MODE_NAMES[(int)mode] : "unknown";
+}
+
+bool PowerManager::parseMode(const String& name, PowerMode& mode) {
+    for (int i = 0; i < (int)PowerMode::COUNT; i++) {
+        if (name.equalsIgnoreCase(MODE_NAMES[i])) {
+            mode = (PowerMode)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+void PowerManager::applyWifiSleep() {
+    // Modem sleep keeps the association and wakes for every DTIM beacon, so
+    // buffered TCP/MQTT traffic is delivered at the AP's beacon interval
+    wifi_ps_type_t ps = _mode == PowerMode::PERFORMANCE ? WIFI_PS_NONE : WIFI_PS_MIN_MODEM;
+    if (!WiFi.setSleep(ps)) {
+        LOG_WARN(WIFI, "Could not set WiFi power save %d (required while BLE is active)", ps);
+    }
+}
+
+uint32_t PowerManager::update(uint32_t loopBusyMicros) {
+    unsigned long now = millis();
+
+    if (ServoController::anyMoving()) {
+        _lastActive = now;
+    }
+
+    bool idle = now - _lastActive >= POWER_IDLE_AFTER_MS;
+    if (idle != _idle || _modeChanged) {
+        _idle = idle;
+        _modeChanged = false;
+        applyIdle();
+    }
+
+    updateWake();
+    updateDutyCycle(now, loopBusyMicros);
+
+    return _idle && _mode == PowerMode::LOW_POWER ? POWER_IDLE_LOOP_INTERVAL_MS : LOOP_INTERVAL_MS;
+}
+
+void PowerManager::applyIdle() {
+    bool relaxed = _idle && _mode == PowerMode::LOW_POWER;
+
+    ServoController::setIdleInterval(relaxed ? POWER_IDLE_SERVO_POLL_MS : MOTION_IDLE_INTERVAL_MS);
+
+    bool sleep = relaxed && _lightSleepAvailable;
+    if (sleep != _sleepAllowed) {
+        _sleepAllowed = sleep;
+        if (sleep) {
+            setWakeArmed(true);
+            esp_pm_lock_release(_sleepLock);
+        } else {
+            esp_pm_lock_acquire(_sleepLock);
+            setWakeArmed(false);
+        }
+        LOG_DEBUG(BOOT, "Power: light sleep %s", sleep ? "enabled" : "disabled");
+    }
+}
+
+void PowerManager::updateWake() {
+    for (uint8_t blind = 0; blind < BLIND_COUNT; blind++) {
+        HallSensor* sensor = wakeSensor(blind);
+        if (!sensor || !sensor->isWakeArmed() || sensor->getRawState() == sensor->getWakeLevel()) {
+            continue;
+        }
+
+        // Woken by a hall pin: a magnet arriving means that blind is being moved by hand,
+        // so stay awake (edge interrupts restored) for a full idle period
+        if (sensor->getRawState() == LOW) {
+            _lastActive = millis();
+            _idle = false;
+            applyIdle();
+            return;
+        }
+        sensor->armWake();  // Re-arm for the next change
+    }
+}
+
+void PowerManager::updateDutyCycle(unsigned long now, uint32_t loopBusyMicros) {
+    _loopBusyMicros += loopBusyMicros;
+
+    unsigned long elapsed = now - _windowStart;
+    if (elapsed < POWER_DUTY_WINDOW_MS) {
+        return;
+    }
+
+    uint32_t motionBusy = ServoController::getBusyMicros();
+    uint32_t busy = _loopBusyMicros + (motionBusy - _motionBusyStart);
+    _dutyCycle = busy / (elapsed * 10.0f);  // us / (ms * 1000) * 100%
+
+    _windowStart = now;
+    _loopBusyMicros = 0;
+    _motionBusyStart = motionBusy;
+}
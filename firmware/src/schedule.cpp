@@ -0,0 +1,396 @@
+#include "schedule.h"
+#include "config.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const char* const DAY_NAMES[] = {"sun", "mon", "tue", "wed", "thu", "fri", "sat"};
+
+static const uint8_t DAYS_ALL = 0x7F;
+static const uint8_t DAYS_WEEKDAYS = 0x3E;    // mon-fri
+static const uint8_t DAYS_WEEKENDS = 0x41;    // sat, sun
+
+static const int32_t MAX_SUN_OFFSET = 720;    // Minutes either side of the event
+
+static bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static char toLower(char c) {
+    return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+}
+
+// Case-insensitive match of data[0..length) against a NUL-terminated lower-case word
+static bool wordEquals(const char* data, size_t length, const char* word) {
+    for (size_t i = 0; i < length; i++) {
+        if (word[i] == '\0' || toLower(data[i]) != word[i]) {
+            return false;
+        }
+    }
+    return word[length] == '\0';
+}
+
+// Next whitespace-separated token from data[*pos..length)
+static bool nextToken(const char* data, size_t length, size_t& pos, const char*& token, size_t& tokenLength) {
+    while (pos < length && isSpace(data[pos])) {
+        pos++;
+    }
+    if (pos >= length) {
+        return false;
+    }
+    token = data + pos;
+    while (pos < length && !isSpace(data[pos])) {
+        pos++;
+    }
+    tokenLength = (size_t)(data + pos - token);
+    return true;
+}
+
+static int dayIndex(const char* data, size_t length) {
+    for (int i = 0; i < 7; i++) {
+        if (wordEquals(data, length, DAY_NAMES[i])) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// daily | weekdays | weekends | comma list of days and day ranges (mon-fri, fri-mon)
+static bool parseDays(const char* data, size_t length, uint8_t& days) {
+    if (wordEquals(data, length, "daily")) {
+        days = DAYS_ALL;
+        return true;
+    }
+    if (wordEquals(data, length, "weekdays")) {
+        days = DAYS_WEEKDAYS;
+        return true;
+    }
+    if (wordEquals(data, length, "weekends")) {
+        days = DAYS_WEEKENDS;
+        return true;
+    }
+
+    days = 0;
+    size_t start = 0;
+    while (start <= length) {
+        const char* comma = (const char*)memchr(data + start, ',', length - start);
+        size_t end = comma ? (size_t)(comma - data) : length;
+        const char* item = data + start;
+        size_t itemLength = end - start;
+
+        const char* dash = (const char*)memchr(item, '-', itemLength);
+        if (dash) {
+            int from = dayIndex(item, (size_t)(dash - item));
+            int to = dayIndex(dash + 1, itemLength - (size_t)(dash - item) - 1);
+            if (from < 0 || to < 0) {
+                return false;
+            }
+            for (int day = from;; day = (day + 1) % 7) {
+                days |= (uint8_t)(1 << day);
+                if (day == to) break;
+            }
+        } else {
+            int day = dayIndex(item, itemLength);
+            if (day < 0) {
+                return false;
+            }
+            days |= (uint8_t)(1 << day);
+        }
+
+        if (!comma) break;
+        start = end + 1;
+    }
+    return days != 0;
+}
+
+// HH:MM | sunrise[+-N] | sunset[+-N]
+static bool parseWhen(const char* data, size_t length, ScheduleTrigger& trigger, int16_t& minutes) {
+    const char* colon = (const char*)memchr(data, ':', length);
+    if (colon) {
+        int32_t hours, mins;
+        size_t hourLength = (size_t)(colon - data);
+        size_t minLength = length - hourLength - 1;
+        if (hourLength < 1 || hourLength > 2 || minLength != 2 ||
+            !CommandParser::parseNumber(data, hourLength, 23, hours) ||
+            !CommandParser::parseNumber(colon + 1, minLength, 59, mins)) {
+            return false;
+        }
+        trigger = ScheduleTrigger::TIME;
+        minutes = (int16_t)(hours * 60 + mins);
+        return true;
+    }
+
+    size_t nameLength = 0;
+    while (nameLength < length && data[nameLength] != '+' && data[nameLength] != '-') {
+        nameLength++;
+    }
+    if (wordEquals(data, nameLength, "sunrise")) {
+        trigger = ScheduleTrigger::SUNRISE;
+    } else if (wordEquals(data, nameLength, "sunset")) {
+        trigger = ScheduleTrigger::SUNSET;
+    } else {
+        return false;
+    }
+
+    minutes = 0;
+    if (nameLength < length) {
+        int32_t offset;
+        if (!CommandParser::parseNumber(data + nameLength + 1, length - nameLength - 1, MAX_SUN_OFFSET, offset)) {
+            return false;
+        }
+        minutes = (int16_t)(data[nameLength] == '-' ? -offset : offset);
+    }
+    return true;
+}
+
+bool Schedule::parseRule(const char* data, size_t length, ScheduleRule& out) {
+    ScheduleRule rule;
+    size_t pos = 0;
+    const char* token;
+    size_t tokenLength;
+
+    // Days are optional: a rule may start with its time
+    if (!nextToken(data, length, pos, token, tokenLength)) {
+        return false;
+    }
+    if (!parseWhen(token, tokenLength, rule.trigger, rule.minutes)) {
+        if (!parseDays(token, tokenLength, rule.days) ||
+            !nextToken(data, length, pos, token, tokenLength) ||
+            !parseWhen(token, tokenLength, rule.trigger, rule.minutes)) {
+            return false;
+        }
+    }
+
+    if (!nextToken(data, length, pos, token, tokenLength) ||
+        !CommandParser::parse(token, tokenLength, rule.command) || !rule.command.isMotion()) {
+        return false;
+    }
+
+    if (nextToken(data, length, pos, token, tokenLength)) {
+        int32_t blind;
+        if (tokenLength < 7 || !wordEquals(token, 6, "blind=") ||
+            !CommandParser::parseNumber(token + 6, tokenLength - 6, BLIND_COUNT - 1, blind)) {
+            return false;
+        }
+        rule.command.blind = (uint8_t)blind;
+        if (nextToken(data, length, pos, token, tokenLength)) {
+            return false;
+        }
+    }
+
+    out = rule;
+    return true;
+}
+
+int Schedule::parseList(const char* data, size_t length, ScheduleRule* rules, int maxRules) {
+    int count = 0;
+    size_t start = 0;
+    while (start < length) {
+        const char* separator = (const char*)memchr(data + start, ';', length - start);
+        size_t end = separator ? (size_t)(separator - data) : length;
+
+        // Skip empty entries ("a;;b", a trailing ';')
+        size_t first = start;
+        while (first < end && isSpace(data[first])) {
+            first++;
+        }
+        if (first < end) {
+            if (count >= maxRules || !parseRule(data + first, end - first, rules[count])) {
+                return -1;
+            }
+            count++;
+        }
+        start = end + 1;
+    }
+    return count;
+}
+
+const char* Schedule::format(const ScheduleRule& rule, char* buffer, size_t size) {
+    if (size == 0) {
+        return buffer;
+    }
+
+    char days[32];
+    if (rule.days == DAYS_ALL) {
+        snprintf(days, sizeof(days), "daily");
+    } else if (rule.days == DAYS_WEEKDAYS) {
+        snprintf(days, sizeof(days), "weekdays");
+    } else if (rule.days == DAYS_WEEKENDS) {
+        snprintf(days, sizeof(days), "weekends");
+    } else {
+        size_t used = 0;
+        days[0] = '\0';
+        for (int i = 0; i < 7; i++) {
+            if (rule.days & (1 << i)) {
+                used += snprintf(days + used, sizeof(days) - used, "%s%s", used ? "," : "", DAY_NAMES[i]);
+            }
+        }
+    }
+
+    char when[16];
+    if (rule.trigger == ScheduleTrigger::TIME) {
+        snprintf(when, sizeof(when), "%02d:%02d", rule.minutes / 60, rule.minutes % 60);
+    } else {
+        const char* name = rule.trigger == ScheduleTrigger::SUNRISE ? "sunrise" : "sunset";
+        if (rule.minutes) {
+            snprintf(when, sizeof(when), "%s%+d", name, rule.minutes);
+        } else {
+            snprintf(when, sizeof(when), "%s", name);
+        }
+    }
+
+    char command[32];
+    CommandParser::format(rule.command, command, sizeof(command));
+    if (rule.command.blind) {
+        snprintf(buffer, size, "%s %s %s blind=%d", days, when, command, rule.command.blind);
+    } else {
+        snprintf(buffer, size, "%s %s %s", days, when, command);
+    }
+    return buffer;
+}
+
+bool Schedule::parseLocation(const char* data, size_t length, GeoLocation& out) {
+    char text[40];
+    while (length > 0 && isSpace(data[0])) {
+        data++;
+        length--;
+    }
+    if (length == 0) {
+        out = GeoLocation();
+        return true;
+    }
+    if (length >= sizeof(text)) {
+        return false;
+    }
+    memcpy(text, data, length);
+    text[length] = '\0';
+
+    char* end;
+    double latitude = strtod(text, &end);
+    if (end == text || *end != ',') {
+        return false;
+    }
+    char* lonStart = end + 1;
+    double longitude = strtod(lonStart, &end);
+    while (isSpace(*end)) {
+        end++;
+    }
+    if (end == lonStart || *end != '\0' || latitude < -90.0 || latitude > 90.0 ||
+        longitude < -180.0 || longitude > 180.0) {
+        return false;
+    }
+
+    out.latitude = (float)latitude;
+    out.longitude = (float)longitude;
+    out.valid = true;
+    return true;
+}
+
+int64_t Schedule::daysFromCivil(int year, int month, int day) {
+    // Howard Hinnant's days_from_civil
+    year -= month <= 2;
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    int64_t yearOfEra = year - era * 400;
+    int64_t dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+bool Schedule::sunEvent(int year, int month, int day, const GeoLocation& location,
+                        bool sunrise, int32_t& minutesUtc) {
+    // Almanac for Computers (1990) sunrise equation, good to about a minute
+    const double toRad = M_PI / 180.0;
+    const double zenith = 90.833;
+
+    int dayOfYear = (int)(daysFromCivil(year, month, day) - daysFromCivil(year, 1, 1)) + 1;
+    double lngHour = location.longitude / 15.0;
+    double approx = sunrise ? 6.0 : 18.0;
+    double t = dayOfYear + (approx - lngHour) / 24.0;
+
+    // Sun's mean anomaly and true longitude
+    double meanAnomaly = 0.9856 * t - 3.289;
+    double trueLongitude = meanAnomaly + 1.916 * sin(meanAnomaly * toRad) +
+                           0.020 * sin(2.0 * meanAnomaly * toRad) + 282.634;
+    trueLongitude = fmod(trueLongitude + 360.0, 360.0);
+
+    // Right ascension, in the same quadrant as the true longitude, in hours
+    double rightAscension = atan(0.91764 * tan(trueLongitude * toRad)) / toRad;
+    rightAscension = fmod(rightAscension + 360.0, 360.0);
+    rightAscension += floor(trueLongitude / 90.0) * 90.0 - floor(rightAscension / 90.0) * 90.0;
+    rightAscension /= 15.0;
+
+    double sinDeclination = 0.39782 * sin(trueLongitude * toRad);
+    double cosDeclination = cos(asin(sinDeclination));
+    double cosHourAngle = (cos(zenith * toRad) - sinDeclination * sin(location.latitude * toRad)) /
+                          (cosDeclination * cos(location.latitude * toRad));
+    if (cosHourAngle > 1.0 || cosHourAngle < -1.0) {
+        return false;   // Polar night or midnight sun
+    }
+
+    double hourAngle = acos(cosHourAngle) / toRad;
+    if (sunrise) {
+        hourAngle = 360.0 - hourAngle;
+    }
+    hourAngle /= 15.0;
+
+    double localMean = hourAngle + rightAscension - 0.06571 * t - 6.622;
+    double universal = localMean - lngHour;
+
+    // Keep the event on this date's side of the day boundary, not 24h away
+    double expected = approx - lngHour;
+    while (universal - expected > 12.0) universal -= 24.0;
+    while (universal - expected < -12.0) universal += 24.0;
+
+    minutesUtc = (int32_t)lround(universal * 60.0);
+    return true;
+}
+
+bool Schedule::nextOccurrence(const ScheduleRule& rule, int64_t after, const GeoLocation& location,
+                              int64_t& at) {
+    if (rule.trigger != ScheduleTrigger::TIME && !location.valid) {
+        return false;
+    }
+
+    time_t now = (time_t)after;
+    struct tm today;
+    localtime_r(&now, &today);
+
+    // Eight days so today's passed time is found again a week out
+    for (int offset = 0; offset <= 7; offset++) {
+        struct tm day = today;
+        day.tm_mday += offset;
+        day.tm_hour = 12;
+        day.tm_min = 0;
+        day.tm_sec = 0;
+        day.tm_isdst = -1;
+        mktime(&day);   // Normalises the date and fills in tm_wday
+
+        if (!(rule.days & (1 << day.tm_wday))) {
+            continue;
+        }
+
+        int64_t candidate;
+        if (rule.trigger == ScheduleTrigger::TIME) {
+            day.tm_hour = rule.minutes / 60;
+            day.tm_min = rule.minutes % 60;
+            day.tm_isdst = -1;
+            candidate = (int64_t)mktime(&day);
+        } else {
+            int32_t minutesUtc;
+            if (!sunEvent(day.tm_year + 1900, day.tm_mon + 1, day.tm_mday, location,
+                          rule.trigger == ScheduleTrigger::SUNRISE, minutesUtc)) {
+                continue;
+            }
+            candidate = daysFromCivil(day.tm_year + 1900, day.tm_mon + 1, day.tm_mday) * 86400 +
+                        (int64_t)(minutesUtc + rule.minutes) * 60;
+        }
+
+        if (candidate > after) {
+            at = candidate;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,211 @@
+#include "scheduler.h"
+#include "logger.h"
+#include "storage.h"
+#include <time.h>
+
+extern Storage storage;
+
+Scheduler::Scheduler()
+    : _count(0)
+    , _recheckAt(0)
+    , _dirty(true)
+    , _nextAt(0)
+    , _fired(0)
+    , _skipped(0)
+    , _mutex(nullptr) {
+    memset(_next, 0, sizeof(_next));
+}
+
+void Scheduler::init() {
+    if (!_mutex) {
+        _mutex = xSemaphoreCreateMutex();
+    }
+
+    applyTimezone(storage.getTimezone());
+
+    String location = storage.getLocation();
+    if (!Schedule::parseLocation(location.c_str(), location.length(), _location)) {
+        LOG_ERROR("Ignoring stored location: %s", location.c_str());
+        _location = GeoLocation();
+    }
+
+    String rules = storage.getSchedule();
+    int count = Schedule::parseList(rules.c_str(), rules.length(), _rules, SCHEDULE_MAX_RULES);
+    if (count < 0) {
+        LOG_ERROR("Ignoring stored schedule: %s", rules.c_str());
+        count = 0;
+    }
+    _count = count;
+    _dirty = true;
+
+    LOG_BOOT("Schedule: %d rule(s), location %s, TZ %s", _count,
+             _location.valid ? location.c_str() : "unset", storage.getTimezone().c_str());
+}
+
+bool Scheduler::setRules(const String& rules, String& normalized) {
+    ScheduleRule parsed[SCHEDULE_MAX_RULES];
+    int count = Schedule::parseList(rules.c_str(), rules.length(), parsed, SCHEDULE_MAX_RULES);
+    if (count < 0) {
+        return false;
+    }
+
+    normalized = "";
+    char buffer[64];
+    for (int i = 0; i < count; i++) {
+        if (i > 0) {
+            normalized += ";";
+        }
+        normalized += Schedule::format(parsed[i], buffer, sizeof(buffer));
+    }
+    if (normalized.length() >= SCHEDULE_SPEC_SIZE) {
+        return false;
+    }
+
+    if (!storage.setSchedule(normalized)) {
+        return false;
+    }
+
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    memcpy(_rules, parsed, sizeof(ScheduleRule) * count);
+    _count = count;
+    _dirty = true;
+    xSemaphoreGive(_mutex);
+    return true;
+}
+
+bool Scheduler::setLocation(const String& location, const String& timezone) {
+    GeoLocation parsed;
+    if (!Schedule::parseLocation(location.c_str(), location.length(), parsed) ||
+        !isValidTimezone(timezone)) {
+        return false;
+    }
+
+    if (!storage.setLocation(location, timezone)) {
+        return false;
+    }
+    applyTimezone(timezone);
+
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    _location = parsed;
+    _dirty = true;
+    xSemaphoreGive(_mutex);
+    return true;
+}
+
+bool Scheduler::isValidTimezone(const String& timezone) {
+    if (timezone.isEmpty() || timezone.length() >= SCHEDULE_TIMEZONE_SIZE) {
+        return false;
+    }
+    // POSIX TZ: a zone name (letters, or <+03> quoted form) then offsets and rules
+    char first = timezone[0];
+    if (!isalpha(first) && first != '<') {
+        return false;
+    }
+    for (size_t i = 0; i < timezone.length(); i++) {
+        char c = timezone[i];
+        if (!isalnum(c) && !strchr("<>+-:,./", c)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Scheduler::applyTimezone(const String& timezone) {
+    setenv("TZ", timezone.c_str(), 1);
+    tzset();
+}
+
+void Scheduler::service() {
+    time_t now = time(nullptr);
+    if (now < (time_t)NTP_VALID_EPOCH) {
+        return;     // No clock yet; the first valid pass recomputes from scratch
+    }
+    if (!_dirty && (uint32_t)now < _nextAt) {
+        return;
+    }
+
+    Command due[SCHEDULE_MAX_RULES];
+    int dueCount = 0;
+
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    if (_dirty) {
+        // Start from now: events before a reboot, edit or first sync are not replayed
+        _dirty = false;
+        recompute(now);
+    } else {
+        for (int i = 0; i < _count; i++) {
+            if (_next[i] == 0 || _next[i] > now) {
+                continue;
+            }
+
+            char text[64];
+            Schedule::format(_rules[i], text, sizeof(text));
+            int64_t late = now - _next[i];
+            if (late <= SCHEDULE_LATE_LIMIT_S) {
+                LOG_SERVO("Schedule: %s", text);
+                due[dueCount++] = _rules[i].command;
+                _fired++;
+            } else {
+                LOG_WARN(SERVO, "Schedule: skipped %s (%lds late)", text, (long)late);
+                _skipped++;
+            }
+
+            if (!Schedule::nextOccurrence(_rules[i], now, _location, _next[i])) {
+                _next[i] = 0;
+            }
+        }
+        if (_recheckAt != 0 && _recheckAt <= now) {
+            recompute(now);
+        }
+        updateNextAt();
+    }
+    xSemaphoreGive(_mutex);
+
+    for (int i = 0; i < dueCount; i++) {
+        if (_commandCallback) {
+            _commandCallback(due[i]);
+        }
+    }
+}
+
+// Caller holds _mutex
+void Scheduler::recompute(int64_t now) {
+    _recheckAt = 0;
+    for (int i = 0; i < _count; i++) {
+        if (!Schedule::nextOccurrence(_rules[i], now, _location, _next[i])) {
+            // Sun rule in polar day/night or without a location: look again later
+            _next[i] = 0;
+            _recheckAt = now + SCHEDULE_RECHECK_S;
+        }
+    }
+    updateNextAt();
+}
+
+// Caller holds _mutex
+void Scheduler::updateNextAt() {
+    int64_t earliest = _recheckAt != 0 ? _recheckAt : INT64_MAX;
+    for (int i = 0; i < _count; i++) {
+        if (_next[i] != 0 && _next[i] < earliest) {
+            earliest = _next[i];
+        }
+    }
+    _nextAt = earliest > (int64_t)UINT32_MAX ? UINT32_MAX : (uint32_t)earliest;
+}
+
+int Scheduler::getRules(ScheduleRule* rules, int64_t* next, int maxRules) {
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    int count = _count < maxRules ? _count : maxRules;
+    for (int i = 0; i < count; i++) {
+        rules[i] = _rules[i];
+        next[i] = _dirty ? 0 : _next[i];
+    }
+    xSemaphoreGive(_mutex);
+    return count;
+}
+
+GeoLocation Scheduler::getLocation() {
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    GeoLocation location = _location;
+    xSemaphoreGive(_mutex);
+    return location;
+}
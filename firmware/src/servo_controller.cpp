@@ -3,6 +3,9 @@
 #include "logger.h"
 #include "hall_sensor.h"
 #include "storage.h"
+#include "motion_profile.h"
+#include "boot_timings.h"
+#include "metrics.h"
 #include <SCServo.h>
 
 // Global servo instance (SCServo library uses global serial)
@@ -16,8 +19,30 @@ static SMS_STS servo;
 #define S_RXD 20  // D7
 #define S_TXD 21  // D6
 
+namespace {
+// Scoped recursive lock on the controller mutex
+class MotionLock {
+public:
+    explicit MotionLock(SemaphoreHandle_t mutex) : _mutex(mutex) {
+        if (_mutex) xSemaphoreTakeRecursive(_mutex, portMAX_DELAY);
+    }
+    ~MotionLock() {
+        if (_mutex) xSemaphoreGiveRecursive(_mutex);
+    }
+private:
+    SemaphoreHandle_t _mutex;
+};
+}
+
+ServoController* ServoController::_blinds[BLIND_COUNT] = {};
+TaskHandle_t ServoController::_taskHandle = nullptr;
+SemaphoreHandle_t ServoController::_mutex = nullptr;
+volatile uint32_t ServoController::_idleIntervalMs = MOTION_IDLE_INTERVAL_MS;
+volatile uint32_t ServoController::_busyMicros = 0;
+
 ServoController::ServoController()
-    : _servoId(DEFAULT_SERVO_ID)
+    : _blind(0)
+    , _servoId(DEFAULT_SERVO_ID)
     , _state(BlindState::UNKNOWN)
     , _initialized(false)
     , _connected(false)
@@ -25,7 +50,14 @@ ServoController::ServoController()
     , _acceleration(SERVO_ACCELERATION)
     , _invertDirection(false)
     , _currentPosition(0)
+    , _hasTarget(false)
     , _targetPosition(0)
+    , _commandedSpeed(0)
+    , _moveSpeed(SERVO_SPEED)
+    , _moveAcceleration(SERVO_ACCELERATION)
+    , _moveClosing(false)
+    , _moveActive(false)
+    , _stallCount(0)
     , _lastUpdateTime(0)
     , _movementStartTime(0)
     , _hallSensor(nullptr)
@@ -33,12 +65,19 @@ ServoController::ServoController()
     , _calibrationState(CalibrationState::IDLE)
     , _calibrated(false)
     , _maxPosition(0)
-    , _cumulativePosition(0)
-    , _lastRawPosition(0)
     , _lastPositionSaveTime(0)
     , _needsRecovery(false)
     , _recoveryTargetPosition(0)
-    , _recoveryReturning(false)
+    , _nextSample(0)
+    , _lastTraceTime(0)
+    , _settling(false)
+    , _hallStopIssued(false)
+    , _probePending(false)
+    , _probeAttempts(0)
+    , _probeStart(0)
+    , _lastProbe(0)
+    , _wheelMode(false)
+    , _recoveryDeferred(false)
 {
 }
 
@@ -50,91 +89,262 @@ void ServoController::setStorage(Storage* storage) {
     _storage = storage;
     if (_storage) {
         // Load calibration data from storage
-        _calibrated = _storage->isCalibrated();
-        _maxPosition = _storage->getMaxPosition();
-        _cumulativePosition = _storage->getCurrentPosition();
-        LOG_SERVO("Loaded calibration: calibrated=%s, maxPos=%d, curPos=%d",
-                  _calibrated ? "true" : "false", _maxPosition, _cumulativePosition);
+        _calibrated = _storage->isCalibrated(_blind);
+        _maxPosition = _storage->getMaxPosition(_blind);
+        _tracker.reset(_storage->getCurrentPosition(_blind));
+        LOG_SERVO("Blind %d loaded calibration: calibrated=%s, maxPos=%d, curPos=%d",
+                  _blind, _calibrated ? "true" : "false", _maxPosition, _tracker.position());
 
         // Check for power outage recovery
         checkPowerOutageRecovery();
     }
 }
 
-bool ServoController::init(uint8_t servoId, int rxPin, int txPin) {
+bool ServoController::init(uint8_t servoId, int rxPin, int txPin, uint8_t blind) {
     _servoId = servoId;
+    _blind = blind;
 
-    LOG_SERVO("Initializing servo ID %d using %s at %d baud", servoId, SERVO_SERIAL_NAME, SERVO_BAUD_RATE);
+    LOG_SERVO("Initializing blind %d: servo ID %d using %s at %d baud",
+              blind, servoId, SERVO_SERIAL_NAME, SERVO_BAUD_RATE);
     LOG_SERVO("Speed: %d, Acceleration: %d", _speed, _acceleration);
 
-    // Initialize serial for servo communication
-    // For XIAO ESP32-C3 with Bus Servo Adapter:
-    // - Use Serial0 with explicit pins D6=TX (GPIO21), D7=RX (GPIO20)
-    // - 1Mbaud, 8N1
-    // ESP32 variant: specify RX/TX pins explicitly
-    SERVO_SERIAL.begin(SERVO_BAUD_RATE, SERIAL_8N1);
-    servo.pSerial = &SERVO_SERIAL;
+    // The bus is opened once and shared by every blind
+    if (!_mutex) {
+        _mutex = xSemaphoreCreateRecursiveMutex();
+
+        // Initialize serial for servo communication
+        // For XIAO ESP32-C3 with Bus Servo Adapter:
+        // - Use Serial0 with explicit pins D6=TX (GPIO21), D7=RX (GPIO20)
+        // - 1Mbaud, 8N1
+        // ESP32 variant: specify RX/TX pins explicitly
+        SERVO_SERIAL.begin(SERVO_BAUD_RATE, SERIAL_8N1);
+        servo.pSerial = &SERVO_SERIAL;
+    }
 
-    delay(1000);  // Give serial time to initialize (per FTServo examples)
+    // The ping runs on the motion task (see probe()) so boot never waits on the bus
+    _probePending = true;
+    _probeAttempts = 0;
+    _probeStart = millis();
+    _lastProbe = 0;
 
-    LOG_SERVO("%s initialized, attempting to ping servo...", SERVO_SERIAL_NAME);
+    LOG_SERVO("%s initialized, servo probe scheduled", SERVO_SERIAL_NAME);
+    return true;
+}
 
-    // Try to ping the servo using Ping() + getLastError() like the SDK example
-    for (int attempt = 0; attempt < 3; attempt++) {
-        //int lastError = servo.getLastError();
-        //LOG_SERVO("Ping(%d) returned %d, getLastError()=%d", _servoId, pingResult, lastError);
+void ServoController::probe(unsigned long now) {
+    // Give serial time to initialize (per FTServo examples), then ping at intervals
+    if (now - _probeStart < SERVO_PROBE_SETTLE_MS) {
+        return;
+    }
+    if (_probeAttempts > 0 && now - _lastProbe < SERVO_PROBE_RETRY_MS) {
+        return;
+    }
+    _lastProbe = now;
+    _probeAttempts++;
 
-        if (servo.Ping(_servoId) != -1) {
-            // No error - servo responded
-            _initialized = true;
-            _connected = true;
-            LOG_SERVO("Servo ID %d connected on attempt %d", _servoId, attempt + 1);
+    if (servo.Ping(_servoId) != -1) {
+        // No error - servo responded
+        _connected = true;
+        LOG_SERVO("Servo ID %d connected on attempt %d (%lu ms after init)",
+                  _servoId, _probeAttempts, now - _probeStart);
 
-            // Put servo in wheel mode for continuous rotation (per WriteSpe example)
-            servo.WheelMode(_servoId);
-            LOG_SERVO("WheelMode(%d) called", _servoId);
+        // Put servo in wheel mode for continuous rotation (per WriteSpe example)
+        servo.WheelMode(_servoId);
+        _wheelMode = true;
+        LOG_SERVO("WheelMode(%d) called", _servoId);
 
-            _state = BlindState::STOPPED;
-            return true;
+        _state = BlindState::STOPPED;
+    } else if (_probeAttempts < SERVO_PROBE_ATTEMPTS) {
+        LOG_SERVO("Ping attempt %d failed, retrying...", _probeAttempts);
+        return;
+    } else {
+        LOG_ERROR("Failed to communicate with servo ID %d after %d attempts", _servoId, _probeAttempts);
+        _connected = false;  // update() keeps checking and picks it up when it answers
+    }
+
+    _probePending = false;
+    _initialized = true;
+    if (_blind == 0) {
+        BootTimings::mark("servo");
+    }
+    publishState();
+
+    if (_recoveryDeferred) {
+        _recoveryDeferred = false;
+        startRecovery();
+    }
+}
+
+bool ServoController::startTask() {
+    if (_blind >= BLIND_COUNT) {
+        LOG_ERROR("Blind %d out of range (BLIND_COUNT %d)", _blind, BLIND_COUNT);
+        return false;
+    }
+    if (_blinds[_blind] == this) {
+        return true;
+    }
+
+    {
+        MotionLock guard(_mutex);
+        _nextSample = xTaskGetTickCount();
+        _blinds[_blind] = this;
+    }
+
+    if (!_taskHandle) {
+        BaseType_t result = xTaskCreatePinnedToCore(motionTask, "motion", MOTION_TASK_STACK_SIZE,
+                                                    nullptr, MOTION_TASK_PRIORITY, &_taskHandle,
+                                                    MOTION_TASK_CORE);
+        if (result != pdPASS) {
+            LOG_ERROR("Failed to start motion task");
+            _taskHandle = nullptr;
+            _blinds[_blind] = nullptr;
+            return false;
         }
-        LOG_SERVO("Ping attempt %d failed, retrying...", attempt + 1);
-        delay(500);
+
+        LOG_SERVO("Motion task started (priority %d, %dms sampling while moving)",
+                  MOTION_TASK_PRIORITY, MOTION_SAMPLE_INTERVAL_MS);
+    } else {
+        xTaskNotifyGive(_taskHandle);
     }
 
-    LOG_ERROR("Failed to communicate with servo ID %d after 3 attempts", _servoId);
-    _initialized = true;  // Still mark as initialized, we'll retry later
-    _connected = false;
-    return false;
+    // Hall edges notify the motion task directly from the ISR
+    if (_hallSensor) {
+        _hallSensor->setNotifyTask(_taskHandle);
+    }
+
+    LOG_SERVO("Blind %d (servo ID %d) added to the motion schedule", _blind, _servoId);
+    return true;
 }
 
-bool ServoController::pingServo() {
-    // Use Ping() + getLastError() like the SDK example
-    servo.Ping(_servoId);
-    if (!servo.getLastError()) {
-        // Servo responded, try to read position
-        int pos = servo.ReadPos(_servoId);
-        if (pos >= 0 && pos <= 4095) {
-            _currentPosition = pos;
+ServoController* ServoController::forBlind(uint8_t blind) {
+    return blind < BLIND_COUNT ? _blinds[blind] : nullptr;
+}
+
+bool ServoController::anyMoving() {
+    for (int i = 0; i < BLIND_COUNT; i++) {
+        if (_blinds[i] && _blinds[i]->isMoving()) {
+            return true;
         }
-        return true;
     }
     return false;
 }
 
-void ServoController::readServoStatus() {
-    int pos = servo.ReadPos(_servoId);
-    LOG_SERVO("readServoStatus: pos=%d for ID %d", pos, _servoId);
-    if (pos != -1 && pos >= 0 && pos <= 4095) {
-        _currentPosition = pos;
-        _connected = true;
-    } else {
-        _connected = false;
+void ServoController::motionTask(void* param) {
+    bool notified = true;
+
+    for (;;) {
+        // Round-robin over the blinds, each on its own fixed-rate schedule. Samples
+        // stay one FeedBack() per blind rather than a SyncRead: not every STS
+        // firmware answers it, and one missing reply would stall all blinds.
+        TickType_t wait = portMAX_DELAY;
+        for (int i = 0; i < BLIND_COUNT; i++) {
+            ServoController* self = _blinds[i];
+            if (!self) {
+                continue;
+            }
+
+            // A notification (command or hall edge) samples every blind straight away
+            TickType_t start = xTaskGetTickCount();
+            if (notified || (int32_t)(start - self->_nextSample) >= 0) {
+                unsigned long startMicros = micros();
+                self->update();
+                uint32_t elapsed = micros() - startMicros;
+                _busyMicros += elapsed;
+                Metrics::recordMicros(MetricTimer::MOTION_UPDATE, elapsed);
+
+                TickType_t period = pdMS_TO_TICKS(self->isMoving() || self->_probePending
+                                                      ? MOTION_SAMPLE_INTERVAL_MS : _idleIntervalMs);
+                self->_nextSample = start + period;
+            }
+
+            int32_t remaining = (int32_t)(self->_nextSample - xTaskGetTickCount());
+            TickType_t due = remaining > 0 ? (TickType_t)remaining : 0;
+            if (due < wait) {
+                wait = due;
+            }
+        }
+
+        notified = ulTaskNotifyTake(pdTRUE, wait) > 0;
+    }
+}
+
+void ServoController::setIdleInterval(uint32_t intervalMs) {
+    _idleIntervalMs = intervalMs;
+}
+
+void ServoController::wakeTask() {
+    publishState();
+    if (_taskHandle) {
+        xTaskNotifyGive(_taskHandle);
+    }
+}
+
+void ServoController::publishState() {
+    // The primary blind also fills the single-blind fields every front end reads
+    if (_blind == 0) {
+        deviceState.publishMotion(getStateString(), _currentPosition, _tracker.position(),
+                                  _maxPosition, _calibrated, getCalibrationStateString());
+        deviceState.publishServo(_connected, getTelemetry());
     }
+
+    BlindSummary summary;
+    summary.blindState = getStateString();
+    summary.cumulativePosition = _tracker.position();
+    summary.maxPosition = _maxPosition;
+    summary.calibrated = _calibrated;
+    summary.calibrationState = getCalibrationStateString();
+    summary.servoConnected = _connected;
+    deviceState.publishBlind(_blind, summary);
+}
+
+bool ServoController::readServoStatus() {
+    // One bus transaction: FeedBack() reads the whole present-state register block
+    // (position, speed, load, voltage, temperature, moving) into the library cache,
+    // and the Read*(-1) calls below decode from that cache without touching the bus.
+    // A successful read doubles as the connection check, so no separate Ping().
+    uint32_t start = Metrics::start();
+    int result = servo.FeedBack(_servoId);
+    Metrics::record(MetricTimer::SERVO_BUS, start);
+    if (result == -1) {
+        return false;
+    }
+
+    int pos = servo.ReadPos(-1);
+    if (pos < 0 || pos > 4095) {
+        return false;
+    }
+
+    ServoTelemetry sample;
+    sample.position = pos;
+    sample.speed = servo.ReadSpeed(-1);
+    sample.load = servo.ReadLoad(-1);
+    sample.voltage = servo.ReadVoltage(-1);
+    sample.temperature = servo.ReadTemper(-1);
+    sample.moving = servo.ReadMove(-1) > 0;
+    sample.timestamp = millis();
+    sample.valid = true;
+
+    portENTER_CRITICAL(&_telemetryMux);
+    _telemetry = sample;
+    portEXIT_CRITICAL(&_telemetryMux);
+
+    _currentPosition = pos;
+
+    // Trace at the old 100ms cadence - the motion task samples much faster
+    if (sample.timestamp - _lastTraceTime >= 100) {
+        _lastTraceTime = sample.timestamp;
+        LOG_TRACE(SERVO, "readServoStatus: pos=%d spd=%d load=%d for ID %d",
+                  pos, sample.speed, sample.load, _servoId);
+    }
+
+    return true;
 }
 
 void ServoController::open(bool force) {
+    MotionLock guard(_mutex);
+
     LOG_SERVO("open() called: calibrated=%s, force=%s, cumPos=%d",
-              _calibrated ? "true" : "false", force ? "true" : "false", _cumulativePosition);
+              _calibrated ? "true" : "false", force ? "true" : "false", _tracker.position());
 
     if (!_initialized) {
         LOG_ERROR("Servo not initialized");
@@ -142,45 +352,52 @@ void ServoController::open(bool force) {
     }
 
     // Check calibration limits (OPEN = toward home, position decreasing toward 0)
-    if (_calibrated && !force && _cumulativePosition <= 0) {
-        LOG_SERVO("BLOCKED: Already at home position, ignoring OPEN command (cumPos=%d)", _cumulativePosition);
+    if (_calibrated && !force && _tracker.position() <= MOTION_LIMIT_TOLERANCE) {
+        LOG_SERVO("BLOCKED: Already at home position, ignoring OPEN command (cumPos=%d)", _tracker.position());
         _state = BlindState::STOPPED;
         return;
     }
 
     // Reload speed from storage in case it was changed
     if (_storage) {
-        _speed = _storage->getServoSpeed();
+        _speed = _storage->getServoSpeed(_blind);
     }
 
-    LOG_SERVO("Opening blind (servo ID %d, connected: %s, force: %s, speed: %d)",
-              _servoId, _connected ? "yes" : "no", force ? "yes" : "no", _speed);
+    beginMove(false);
+    LOG_SERVO("Opening blind (servo ID %d, connected: %s, force: %s, speed: %d, acc: %d)",
+              _servoId, _connected ? "yes" : "no", force ? "yes" : "no", _moveSpeed, _moveAcceleration);
 
     _state = BlindState::OPENING;
-    _movementStartTime = millis();
+    _settling = false;
+    _hasTarget = false;
 
     // Persist moving state for power outage recovery (target = home = 0)
     if (_storage && _calibrated && !force) {
-        _storage->setTargetPosition(0);
-        _storage->setWasMoving(true);
+        _storage->setTargetPosition(0, _blind);
+        _storage->setWasMoving(true, _blind);
     }
 
     // Use wheel mode for continuous rotation
     // OPEN = move toward home
     // Direction is inverted for right-hand mount
-    int16_t actualSpeed = _invertDirection ? -_speed : _speed;
-    int result = servo.WriteSpe(_servoId, actualSpeed, _acceleration);
-    LOG_SERVO("WriteSpe(%d, %d, %d) returned %d (invert=%s)", _servoId, actualSpeed, _acceleration, result, _invertDirection ? "yes" : "no");
+    int16_t actualSpeed = _invertDirection ? -_moveSpeed : _moveSpeed;
+    int result = servo.WriteSpe(_servoId, actualSpeed, _moveAcceleration);
+    LOG_SERVO("WriteSpe(%d, %d, %d) returned %d (invert=%s)", _servoId, actualSpeed, _moveAcceleration, result, _invertDirection ? "yes" : "no");
+
+    // Switch the motion task to fast sampling straight away
+    wakeTask();
 }
 
 void ServoController::close(bool force) {
+    MotionLock guard(_mutex);
+
     if (!_initialized) {
         LOG_ERROR("Servo not initialized");
         return;
     }
 
     // Check calibration limits (CLOSE = toward bottom, position increasing toward maxPosition)
-    if (_calibrated && !force && _cumulativePosition >= _maxPosition) {
+    if (_calibrated && !force && _tracker.position() >= _maxPosition - MOTION_LIMIT_TOLERANCE) {
         LOG_SERVO("Already at max position, ignoring CLOSE command");
         _state = BlindState::STOPPED;
         return;
@@ -188,29 +405,35 @@ void ServoController::close(bool force) {
 
     // Reload speed from storage in case it was changed
     if (_storage) {
-        _speed = _storage->getServoSpeed();
+        _speed = _storage->getServoSpeed(_blind);
     }
 
-    LOG_SERVO("Closing blind (servo ID %d, connected: %s, force: %s, speed: %d)",
-              _servoId, _connected ? "yes" : "no", force ? "yes" : "no", _speed);
+    beginMove(true);
+    LOG_SERVO("Closing blind (servo ID %d, connected: %s, force: %s, speed: %d, acc: %d)",
+              _servoId, _connected ? "yes" : "no", force ? "yes" : "no", _moveSpeed, _moveAcceleration);
 
     _state = BlindState::CLOSING;
-    _movementStartTime = millis();
+    _settling = false;
+    _hasTarget = false;
 
     // Persist moving state for power outage recovery (target = bottom = maxPosition)
     if (_storage && _calibrated && !force) {
-        _storage->setTargetPosition(_maxPosition);
-        _storage->setWasMoving(true);
+        _storage->setTargetPosition(_maxPosition, _blind);
+        _storage->setWasMoving(true, _blind);
     }
 
     // CLOSE = move toward bottom (opposite direction from open)
     // Direction is inverted for right-hand mount
-    int16_t actualSpeed = _invertDirection ? _speed : -_speed;
-    int result = servo.WriteSpe(_servoId, actualSpeed, _acceleration);
-    LOG_SERVO("WriteSpe(%d, %d, %d) returned %d (invert=%s)", _servoId, actualSpeed, _acceleration, result, _invertDirection ? "yes" : "no");
+    int16_t actualSpeed = _invertDirection ? _moveSpeed : -_moveSpeed;
+    int result = servo.WriteSpe(_servoId, actualSpeed, _moveAcceleration);
+    LOG_SERVO("WriteSpe(%d, %d, %d) returned %d (invert=%s)", _servoId, actualSpeed, _moveAcceleration, result, _invertDirection ? "yes" : "no");
+
+    wakeTask();
 }
 
 void ServoController::stop() {
+    MotionLock guard(_mutex);
+
     if (!_initialized) {
         LOG_ERROR("Servo not initialized");
         return;
@@ -219,20 +442,134 @@ void ServoController::stop() {
     LOG_SERVO("Stopping blind (servo ID %d, connected: %s)", _servoId, _connected ? "yes" : "no");
 
     // Stop the servo by setting speed to 0
-    int result = servo.WriteSpe(_servoId, 0, _acceleration);
-    LOG_SERVO("WriteSpe(%d, 0, %d) returned %d", _servoId, _acceleration, result);
+    int result = servo.WriteSpe(_servoId, 0, _moveAcceleration);
+    LOG_SERVO("WriteSpe(%d, 0, %d) returned %d", _servoId, _moveAcceleration, result);
 
     _state = BlindState::STOPPED;
+    _hasTarget = false;
     readServoStatus();
+    updateCumulativePosition();
+    endMove();
+
+    // Keep sampling until the deceleration ramp has finished so tracking stays exact
+    _settling = true;
+    _hallStopIssued = false;
 
     // Save position and clear moving flag on stop
     if (_storage && _calibrated) {
-        _storage->setCurrentPosition(_cumulativePosition);
-        _storage->setWasMoving(false);
+        _storage->setCurrentPosition(_tracker.position(), _blind);
+        _storage->setWasMoving(false, _blind);
+    }
+
+    publishState();
+}
+
+bool ServoController::moveToPosition(int32_t target) {
+    MotionLock guard(_mutex);
+
+    if (!_initialized) {
+        LOG_ERROR("Servo not initialized");
+        return false;
+    }
+
+    if (!_calibrated || _maxPosition <= 0) {
+        LOG_ERROR("Cannot move to position: not calibrated");
+        return false;
+    }
+
+    if (isCalibrating() || _state == BlindState::RECOVERING) {
+        LOG_ERROR("Cannot move to position while calibrating or recovering");
+        return false;
+    }
+
+    target = constrain(target, (int32_t)0, _maxPosition);
+    int32_t remaining = target - _tracker.position();
+
+    if (abs(remaining) <= MOTION_TARGET_TOLERANCE) {
+        LOG_SERVO("Already at target position %d (cumPos=%d)", target, _tracker.position());
+        return true;
+    }
+
+    // Reload speed from storage in case it was changed
+    if (_storage) {
+        _speed = _storage->getServoSpeed(_blind);
+    }
+
+    beginMove(remaining > 0);
+    _targetPosition = target;
+    _hasTarget = true;
+    _commandedSpeed = 0;
+    _state = remaining > 0 ? BlindState::CLOSING : BlindState::OPENING;
+    _settling = false;
+
+    LOG_SERVO("Moving to position %d from %d (speed: %d, acc: %d)",
+              target, _tracker.position(), _moveSpeed, _moveAcceleration);
+
+    // Persist moving state for power outage recovery
+    if (_storage) {
+        _storage->setTargetPosition(target, _blind);
+        _storage->setWasMoving(true, _blind);
     }
+
+    updateApproach();
+    wakeTask();
+    return true;
+}
+
+bool ServoController::moveToPercent(uint8_t percent) {
+    if (percent > 100) {
+        LOG_ERROR("Invalid position percent: %d", percent);
+        return false;
+    }
+
+    // 100% = open = home (0), 0% = closed = maxPosition
+    int32_t target = (int32_t)(((int64_t)(100 - percent) * _maxPosition + 50) / 100);
+    return moveToPosition(target);
+}
+
+void ServoController::updateApproach() {
+    bool closing = (_state == BlindState::CLOSING);
+    int32_t remaining = _targetPosition - _tracker.position();
+    int32_t distance = closing ? remaining : -remaining;  // Travel left in the direction of motion
+
+    float accel = MotionProfile::accelerationFromRegister(_moveAcceleration);
+    uint16_t speed = MotionProfile::approachCommand(distance, stopDistance(), _moveSpeed,
+                                                    MotionProfile::approachDeceleration(accel),
+                                                    _commandedSpeed);
+
+    // Arrived (or passed it) - stop without reversing so the move never hunts
+    if (speed == 0) {
+        LOG_SERVO("Target %d reached: cumPos=%d, vel=%d", _targetPosition, _tracker.position(),
+                  (int)_tracker.velocity());
+        stop();
+        _state = restingState();
+        return;
+    }
+    if (speed == _commandedSpeed) {
+        return;
+    }
+
+    _commandedSpeed = speed;
+    int16_t actualSpeed;
+    if (closing) {
+        actualSpeed = _invertDirection ? speed : -speed;
+    } else {
+        actualSpeed = _invertDirection ? -speed : speed;
+    }
+    servo.WriteSpe(_servoId, actualSpeed, _moveAcceleration);
+}
+
+BlindState ServoController::restingState() const {
+    if (_calibrated) {
+        if (_tracker.position() <= MOTION_LIMIT_TOLERANCE) return BlindState::OPEN;
+        if (_tracker.position() >= _maxPosition - MOTION_LIMIT_TOLERANCE) return BlindState::CLOSED;
+    }
+    return BlindState::STOPPED;
 }
 
 void ServoController::execute(BlindCommand command) {
+    MotionLock guard(_mutex);
+
     switch (command) {
         case BlindCommand::OPEN:
             open();
@@ -254,6 +591,11 @@ const char* ServoController::getStateString() const {
     return blindStateToString(_state);
 }
 
+bool ServoController::isMoving() const {
+    return _state == BlindState::OPENING || _state == BlindState::CLOSING ||
+           _state == BlindState::RECOVERING || _settling;
+}
+
 bool ServoController::isConnected() const {
     return _connected;
 }
@@ -262,126 +604,166 @@ int ServoController::getCurrentPosition() const {
     return _currentPosition;
 }
 
+ServoTelemetry ServoController::getTelemetry() const {
+    portENTER_CRITICAL(&_telemetryMux);
+    ServoTelemetry snapshot = _telemetry;
+    portEXIT_CRITICAL(&_telemetryMux);
+    return snapshot;
+}
+
+// Cached values from the last bus sample - safe to call from any task
 int ServoController::getLoad() const {
     if (!_connected) return 0;
-    return servo.ReadLoad(_servoId);
+    return getTelemetry().load;
 }
 
 int ServoController::getVoltage() const {
     if (!_connected) return 0;
-    return servo.ReadVoltage(_servoId);
+    return getTelemetry().voltage;
 }
 
 int ServoController::getTemperature() const {
     if (!_connected) return 0;
-    return servo.ReadTemper(_servoId);
+    return getTelemetry().temperature;
 }
 
 void ServoController::update() {
+    MotionLock guard(_mutex);
+
     unsigned long now = millis();
+    _lastUpdateTime = now;
 
-    // Update every 100ms when moving/recovering, 1000ms when stopped
-    bool isMoving = (_state == BlindState::OPENING || _state == BlindState::CLOSING || _state == BlindState::RECOVERING);
-    unsigned long updateInterval = isMoving ? 100 : 1000;
+    // Debounce captured hall edges (the ISR wakes this task on an edge)
+    if (_hallSensor) {
+        _hallSensor->update();
+    }
 
-    if (now - _lastUpdateTime < updateInterval) {
+    if (_probePending) {
+        probe(now);
         return;
     }
-    _lastUpdateTime = now;
 
-    // Re-check connection periodically
-    if (!pingServo()) {
+    // Single telemetry read per sample (also serves as the connection check)
+    if (!readServoStatus()) {
         if (_connected) {
             LOG_ERROR("Lost connection to servo ID %d", _servoId);
             _connected = false;
+
+            portENTER_CRITICAL(&_telemetryMux);
+            _telemetry.valid = false;
+            portEXIT_CRITICAL(&_telemetryMux);
         }
+        publishState();
         return;
     }
 
     if (!_connected) {
         LOG_SERVO("Reconnected to servo ID %d", _servoId);
         _connected = true;
-    }
 
-    readServoStatus();
+        // Never answered the boot probe, so its mode was never set
+        if (!_wheelMode) {
+            servo.WheelMode(_servoId);
+            _wheelMode = true;
+            if (_state == BlindState::UNKNOWN) {
+                _state = BlindState::STOPPED;
+            }
+        }
+    }
 
     // Update cumulative position tracking
     updateCumulativePosition();
 
+    // Publish the sample for the hall ISR to latch on the next edge
+    if (_hallSensor) {
+        _hallSensor->setPositionSnapshot(_tracker.position(), _tracker.velocity());
+    }
+
     // Check calibration during FINDING_HOME state
     if (_calibrationState == CalibrationState::FINDING_HOME && _hallSensor) {
-        if (_hallSensor->isTriggered()) {
-            LOG_SERVO("Hall sensor triggered - HOME position found!");
+        if (checkHomeEdge()) {
+            LOG_SERVO("Hall sensor triggered - HOME position found! (overshoot %d)", -_tracker.position());
             stop();
-            _cumulativePosition = 0;  // This is now home
-            _lastRawPosition = _currentPosition;
             _calibrationState = CalibrationState::AT_HOME;
 
-            // Save home position
+            // Save home-relative position
             if (_storage) {
-                _storage->setCurrentPosition(0);
+                _storage->setCurrentPosition(_tracker.position(), _blind);
             }
         }
     }
 
     // Handle power outage recovery state machine
     if (_state == BlindState::RECOVERING && _hallSensor) {
-        if (!_recoveryReturning) {
-            // Phase 1: Moving toward home, waiting for hall sensor
-            if (_hallSensor->isTriggered()) {
-                LOG_SERVO("Recovery: HOME position found!");
-                // Stop and reset position
-                servo.WriteSpe(_servoId, 0, _acceleration);
-                _cumulativePosition = 0;
-                _lastRawPosition = _currentPosition;
+        // Phase 1 waits for the hall sensor; phase 2 stops early enough to land on the target
+        bool homeFound = !_recovery.returning() && checkHomeEdge();
+        if (homeFound) {
+            LOG_SERVO("Recovery: HOME position found! (overshoot %d)", -_tracker.position());
+            if (_storage) {
+                _storage->setCurrentPosition(_tracker.position(), _blind);
+            }
+        }
 
-                if (_storage) {
-                    _storage->setCurrentPosition(0);
-                }
+        switch (_recovery.sample(homeFound, _tracker.position(), stopDistance())) {
+            case HomingRecovery::Step::RETURN_TO_TARGET: {
+                LOG_SERVO("Recovery: Returning to position %d", _recovery.target());
+                // Start closing toward target
+                beginMove(true);
+                int16_t actualSpeed = _invertDirection ? _moveSpeed : -_moveSpeed;
+                servo.WriteSpe(_servoId, actualSpeed, _moveAcceleration);
+                break;
+            }
 
-                // Now return to target position
-                if (_recoveryTargetPosition > 0) {
-                    LOG_SERVO("Recovery: Returning to position %d", _recoveryTargetPosition);
-                    _recoveryReturning = true;
-                    // Start closing toward target
-                    int16_t actualSpeed = _invertDirection ? _speed : -_speed;
-                    servo.WriteSpe(_servoId, actualSpeed, _acceleration);
-                    _movementStartTime = millis();
-                } else {
-                    // Target was home, we're done
-                    LOG_SERVO("Recovery: Complete (target was home)");
-                    _state = BlindState::OPEN;
-                    _needsRecovery = false;
-                    _recoveryReturning = false;
-                    if (_storage) {
-                        _storage->setWasMoving(false);
-                    }
+            case HomingRecovery::Step::DONE_AT_HOME:
+                LOG_SERVO("Recovery: Complete (target was home)");
+                endMove();
+                _state = BlindState::OPEN;
+                _settling = true;
+                _needsRecovery = false;
+                if (_storage) {
+                    _storage->setWasMoving(false, _blind);
                 }
-            }
-        } else {
-            // Phase 2: Returning to target position
-            if (_cumulativePosition >= _recoveryTargetPosition) {
-                LOG_SERVO("Recovery: Reached target position %d", _recoveryTargetPosition);
-                servo.WriteSpe(_servoId, 0, _acceleration);
-                _cumulativePosition = _recoveryTargetPosition;  // Clamp
+                break;
+
+            case HomingRecovery::Step::DONE_AT_TARGET:
+                LOG_SERVO("Recovery: Reached target position %d (cumPos=%d)",
+                          _recovery.target(), _tracker.position());
+                servo.WriteSpe(_servoId, 0, _moveAcceleration);
+                endMove();
+                _settling = true;
                 _state = BlindState::CLOSED;
                 _needsRecovery = false;
-                _recoveryReturning = false;
-
                 if (_storage) {
-                    _storage->setCurrentPosition(_cumulativePosition);
-                    _storage->setWasMoving(false);
+                    _storage->setCurrentPosition(_tracker.position(), _blind);
+                    _storage->setWasMoving(false, _blind);
                 }
-            }
+                break;
+
+            case HomingRecovery::Step::NONE:
+                break;
         }
     }
 
+    // Stop a jammed or obstructed blind within a few samples
+    if (checkStall()) {
+        publishState();
+        return;
+    }
+
+    // Advance a position-targeted move
+    if (_hasTarget && (_state == BlindState::OPENING || _state == BlindState::CLOSING)) {
+        updateApproach();
+    }
+
     // Check calibration limits during normal operation
     checkCalibrationLimits();
 
     // Save position periodically
     savePositionIfNeeded();
 
+    // Persist the final resting position once the stop ramp has finished
+    checkSettled();
+
     // Check for movement timeout (only for uncalibrated devices or recovery)
     // Calibrated devices rely on position limits instead of timeout
     // Skip timeout during active calibration - user controls when to stop
@@ -396,18 +778,21 @@ void ServoController::update() {
             // Clear recovery state on timeout
             if (_state == BlindState::RECOVERING) {
                 _needsRecovery = false;
-                _recoveryReturning = false;
+                _recovery.cancel();
             }
 
             // Save final position on stop
             if (_storage && _calibrated) {
-                _storage->setCurrentPosition(_cumulativePosition);
+                _storage->setCurrentPosition(_tracker.position(), _blind);
             }
         }
     }
+
+    publishState();
 }
 
 void ServoController::setServoId(uint8_t id) {
+    MotionLock guard(_mutex);
     _servoId = id;
     LOG_SERVO("Servo ID changed to %d", _servoId);
 }
@@ -417,14 +802,17 @@ uint8_t ServoController::getServoId() const {
 }
 
 void ServoController::setSpeed(uint16_t speed) {
+    MotionLock guard(_mutex);
     _speed = speed;
 }
 
 void ServoController::setAcceleration(uint8_t acc) {
+    MotionLock guard(_mutex);
     _acceleration = acc;
 }
 
 void ServoController::setInvertDirection(bool invert) {
+    MotionLock guard(_mutex);
     _invertDirection = invert;
     LOG_SERVO("Direction inversion set to: %s", invert ? "true (right mount)" : "false (left mount)");
 }
@@ -435,6 +823,8 @@ bool ServoController::getInvertDirection() const {
 
 // Calibration methods
 void ServoController::startCalibration() {
+    MotionLock guard(_mutex);
+
     if (!_hallSensor) {
         LOG_ERROR("Cannot calibrate: Hall sensor not set");
         return;
@@ -449,6 +839,7 @@ void ServoController::startCalibration() {
 
     // Clear any existing hall sensor trigger so we detect a NEW trigger
     _hallSensor->clearTriggered();
+    _hallStopIssued = false;
 
     LOG_SERVO("Hall sensor cleared, raw state: %s",
               _hallSensor->getRawState() == LOW ? "LOW (magnet)" : "HIGH (no magnet)");
@@ -458,30 +849,36 @@ void ServoController::startCalibration() {
 }
 
 void ServoController::setBottomPosition() {
+    MotionLock guard(_mutex);
+
     if (_calibrationState != CalibrationState::AT_HOME) {
         LOG_ERROR("Cannot set bottom: not in AT_HOME state");
         return;
     }
 
-    _maxPosition = _cumulativePosition;
+    _maxPosition = _tracker.position();
     _calibrated = true;
     _calibrationState = CalibrationState::COMPLETE;
 
     // Save to storage
     if (_storage) {
-        _storage->setMaxPosition(_maxPosition);
-        _storage->setCalibrated(true);
-        _storage->setCurrentPosition(_cumulativePosition);
+        _storage->setMaxPosition(_maxPosition, _blind);
+        _storage->setCalibrated(true, _blind);
+        _storage->setCurrentPosition(_tracker.position(), _blind);
     }
 
     LOG_SERVO("Calibration complete - maxPosition=%d", _maxPosition);
+    publishState();
 }
 
 void ServoController::cancelCalibration() {
+    MotionLock guard(_mutex);
+
     if (_calibrationState != CalibrationState::IDLE) {
         LOG_SERVO("Cancelling calibration");
         stop();
         _calibrationState = CalibrationState::IDLE;
+        publishState();
     }
 }
 
@@ -505,7 +902,7 @@ const char* ServoController::getCalibrationStateString() const {
 }
 
 int32_t ServoController::getCumulativePosition() const {
-    return _cumulativePosition;
+    return _tracker.position();
 }
 
 int32_t ServoController::getMaxPosition() const {
@@ -516,15 +913,33 @@ bool ServoController::isCalibrated() const {
     return _calibrated;
 }
 
+float ServoController::getVelocity() const {
+    return _tracker.velocity();
+}
+
+int ServoController::getPositionPercent() const {
+    if (!_calibrated || _maxPosition <= 0) return -1;
+    int32_t pos = constrain(_tracker.position(), (int32_t)0, _maxPosition);
+    return 100 - (int)(((int64_t)pos * 100 + _maxPosition / 2) / _maxPosition);
+}
+
+bool ServoController::hasTarget() const {
+    return _hasTarget;
+}
+
+int32_t ServoController::getTargetPosition() const {
+    return _targetPosition;
+}
+
 // Power outage recovery methods
 void ServoController::checkPowerOutageRecovery() {
     if (!_storage || !_calibrated) {
         return;  // Can't recover if not calibrated
     }
 
-    bool wasMoving = _storage->getWasMoving();
+    bool wasMoving = _storage->getWasMoving(_blind);
     if (wasMoving) {
-        _recoveryTargetPosition = _storage->getTargetPosition();
+        _recoveryTargetPosition = _storage->getTargetPosition(_blind);
         _needsRecovery = true;
         LOG_SERVO("Power outage detected! Was moving to position %d, will re-home first", _recoveryTargetPosition);
     }
@@ -535,23 +950,35 @@ bool ServoController::needsRecovery() const {
 }
 
 void ServoController::startRecovery() {
+    MotionLock guard(_mutex);
+
     if (!_needsRecovery || !_hallSensor) {
         LOG_SERVO("startRecovery called but recovery not needed or no hall sensor");
         return;
     }
 
+    if (_probePending) {
+        LOG_SERVO("Servo probe still running - recovery will start when it finishes");
+        _recoveryDeferred = true;
+        return;
+    }
+
     LOG_SERVO("Starting power outage recovery - moving to home first");
 
     _state = BlindState::RECOVERING;
-    _recoveryReturning = false;
-    _movementStartTime = millis();
+    _recovery.start(_recoveryTargetPosition);
+    beginMove(false);
+    _settling = false;
+    _hallStopIssued = false;
 
     // Clear hall sensor trigger so we detect fresh
     _hallSensor->clearTriggered();
 
     // Move toward home (open direction)
-    int16_t actualSpeed = _invertDirection ? -_speed : _speed;
-    servo.WriteSpe(_servoId, actualSpeed, _acceleration);
+    int16_t actualSpeed = _invertDirection ? -_moveSpeed : _moveSpeed;
+    servo.WriteSpe(_servoId, actualSpeed, _moveAcceleration);
+
+    wakeTask();
 }
 
 bool ServoController::isRecovering() const {
@@ -559,17 +986,143 @@ bool ServoController::isRecovering() const {
 }
 
 void ServoController::updateCumulativePosition() {
-    int rawPos = _currentPosition;
+    // Position across rotations, and a velocity estimate for predictive limit stopping
+    _tracker.update(_currentPosition, micros());
+}
+
+bool ServoController::checkHomeEdge() {
+    if (_hallSensor->isTriggered()) {
+        if (!_hallStopIssued) {
+            servo.WriteSpe(_servoId, 0, _moveAcceleration);
+        }
+        _hallStopIssued = false;
+
+        // Re-base the position frame on the edge itself: home is where the magnet
+        // was first seen, independent of debounce time and stopping distance
+        _tracker.rebase(_hallSensor->getTriggerPosition());
+        return true;
+    }
+
+    if (_hallSensor->hasPendingEdge()) {
+        if (!_hallStopIssued) {
+            servo.WriteSpe(_servoId, 0, _moveAcceleration);
+            _hallStopIssued = true;
+            LOG_SERVO("Hall edge captured - stopping while debounce confirms");
+        }
+    } else if (_hallStopIssued) {
+        // Debounce rejected the edge - keep driving toward home
+        _hallStopIssued = false;
+        int16_t actualSpeed = _invertDirection ? -_moveSpeed : _moveSpeed;
+        servo.WriteSpe(_servoId, actualSpeed, _moveAcceleration);
+        LOG_SERVO("Hall edge rejected - resuming move toward home");
+    }
+
+    return false;
+}
+
+int32_t ServoController::stopDistance() const {
+    return MotionProfile::stoppingDistance(
+        _tracker.velocity(), MotionProfile::accelerationFromRegister(_moveAcceleration), MOTION_STOP_LATENCY_MS);
+}
+
+bool ServoController::limitAhead(int32_t remaining) const {
+    // Stop once the remaining travel is within what the servo needs to come to rest
+    return remaining <= stopDistance();
+}
+
+void ServoController::beginMove(bool closing) {
+    endMove();
 
-    // Calculate delta with wrap-around handling
-    int delta = rawPos - _lastRawPosition;
+    // The configured speed/acceleration are ceilings; an unlearned direction runs at them
+    DriveProfile profile = _storage ? _storage->getDriveProfile(closing, _blind) : DriveProfile{0, 0};
+    _moveSpeed = profile.speed ? min(profile.speed, _speed) : _speed;
+    _moveAcceleration = profile.speed && profile.acceleration && _acceleration
+                            ? min(profile.acceleration, _acceleration) : _acceleration;
+    _moveClosing = closing;
+    _moveActive = true;
+    _movementStartTime = millis();
 
-    // Handle wrap-around (4095 -> 0 or 0 -> 4095)
-    if (delta > 2048) delta -= 4096;
-    if (delta < -2048) delta += 4096;
+    float accel = MotionProfile::accelerationFromRegister(_moveAcceleration);
+    _loadMonitor.reset(accel > 0.0f ? (uint32_t)(_moveSpeed * 1000.0f / accel) : 0);
+}
 
-    _cumulativePosition += delta;
-    _lastRawPosition = rawPos;
+void ServoController::endMove() {
+    if (!_moveActive) {
+        return;
+    }
+    _moveActive = false;
+
+    // Stalls say nothing about what the blind needs, and short moves never reach cruise
+    if (!_storage || _loadMonitor.stalled() || millis() - _movementStartTime < MOTION_ADAPT_MIN_MOVE_MS) {
+        return;
+    }
+
+    DriveProfile current = {_moveSpeed, _moveAcceleration};
+    DriveProfile next = LoadMonitor::adapt(current, _speed, _acceleration,
+                                           _loadMonitor.peakRampLoad(), _loadMonitor.peakCruiseLoad());
+    if (next.speed != current.speed || next.acceleration != current.acceleration) {
+        LOG_SERVO("Blind %d %s profile: speed %d -> %d, acc %d -> %d (peak load ramp %d, cruise %d)",
+                  _blind, _moveClosing ? "closing" : "opening", current.speed, next.speed,
+                  current.acceleration, next.acceleration,
+                  _loadMonitor.peakRampLoad(), _loadMonitor.peakCruiseLoad());
+    }
+    _storage->setDriveProfile(next, _moveClosing, _blind);
+}
+
+bool ServoController::checkStall() {
+    if (!_moveActive ||
+        (_state != BlindState::OPENING && _state != BlindState::CLOSING && _state != BlindState::RECOVERING)) {
+        return false;
+    }
+
+    // Deliberately stopped on a hall edge while debounce confirms it
+    uint16_t commanded = _hallStopIssued ? 0 : (_hasTarget ? _commandedSpeed : _moveSpeed);
+    int load = getTelemetry().load;
+    if (!_loadMonitor.sample(millis() - _movementStartTime, _tracker.velocity(), commanded, load)) {
+        return false;
+    }
+
+    _stallCount++;
+    LOG_ERROR("Blind %d stalled: vel=%d, load=%d (commanded %d) - stopping at cumPos=%d",
+              _blind, (int)_tracker.velocity(), load, commanded, _tracker.position());
+
+    bool recovering = (_state == BlindState::RECOVERING);
+    if (_calibrationState == CalibrationState::FINDING_HOME) {
+        cancelCalibration();
+    } else {
+        stop();
+    }
+    if (recovering) {
+        _needsRecovery = false;
+        _recovery.cancel();
+    }
+    return true;
+}
+
+DriveProfile ServoController::getDriveProfile(bool closing) const {
+    DriveProfile profile = _storage ? _storage->getDriveProfile(closing, _blind) : DriveProfile{0, 0};
+    if (!profile.speed) {
+        return DriveProfile{_speed, _acceleration};
+    }
+    return profile;
+}
+
+void ServoController::checkSettled() {
+    if (!_settling || _state == BlindState::OPENING || _state == BlindState::CLOSING ||
+        _state == BlindState::RECOVERING) {
+        return;
+    }
+
+    if (fabsf(_tracker.velocity()) >= MOTION_SETTLED_VELOCITY) {
+        return;
+    }
+
+    _settling = false;
+    LOG_SERVO("Servo at rest: cumPos=%d", _tracker.position());
+
+    if (_storage && _calibrated) {
+        _storage->setCurrentPosition(_tracker.position(), _blind);
+    }
 }
 
 void ServoController::checkCalibrationLimits() {
@@ -581,15 +1134,16 @@ void ServoController::checkCalibrationLimits() {
         return;
     }
 
-    // Check if we've hit the limits and auto-stop
-    if (_state == BlindState::OPENING && _cumulativePosition <= 0) {
-        LOG_SERVO("LIMIT HIT: Reached home position (0), stopping. cumPos=%d", _cumulativePosition);
-        _cumulativePosition = 0;  // Clamp to exactly 0
+    // Stop ahead of the limits so the deceleration ramp ends on them.
+    // Position is not clamped - tracking keeps following the servo while it settles.
+    if (_state == BlindState::OPENING && limitAhead(_tracker.position())) {
+        LOG_SERVO("LIMIT: Approaching home position (0), stopping. cumPos=%d, vel=%d",
+                  _tracker.position(), (int)_tracker.velocity());
         stop();
         _state = BlindState::OPEN;
-    } else if (_state == BlindState::CLOSING && _cumulativePosition >= _maxPosition) {
-        LOG_SERVO("LIMIT HIT: Reached max position (%d), stopping. cumPos=%d", _maxPosition, _cumulativePosition);
-        _cumulativePosition = _maxPosition;  // Clamp to max
+    } else if (_state == BlindState::CLOSING && limitAhead(_maxPosition - _tracker.position())) {
+        LOG_SERVO("LIMIT: Approaching max position (%d), stopping. cumPos=%d, vel=%d",
+                  _maxPosition, _tracker.position(), (int)_tracker.velocity());
         stop();
         _state = BlindState::CLOSED;
     }
@@ -603,7 +1157,7 @@ void ServoController::savePositionIfNeeded() {
     // Save position periodically while moving
     if (_state == BlindState::OPENING || _state == BlindState::CLOSING) {
         if (now - _lastPositionSaveTime >= POSITION_SAVE_INTERVAL_MS) {
-            _storage->setCurrentPosition(_cumulativePosition);
+            _storage->setCurrentPosition(_tracker.position(), _blind);
             _lastPositionSaveTime = now;
         }
     }
@@ -0,0 +1,60 @@
+#include "status_json.h"
+#include <stdlib.h>
+
+bool StatusJson::render(BufferWriter& out, const DeviceStateSnapshot& state) {
+    out.print("{\"state\":");
+    out.jsonString(state.blindState);
+    out.printf(",\"position\":%d", state.position);
+
+    out.print(",\"wifi\":{\"ssid\":");
+    out.jsonString(state.wifiSsid);
+    out.printf(",\"rssi\":%d,\"ip\":", state.wifiRssi);
+    out.jsonString(state.wifiIp);
+    out.print("}");
+
+    // Calibration info
+    out.printf(",\"calibration\":{\"calibrated\":%s,\"cumulativePosition\":%ld,\"maxPosition\":%ld",
+               state.calibrated ? "true" : "false",
+               (long)state.cumulativePosition, (long)state.maxPosition);
+    int percent = state.positionPercent();
+    if (percent >= 0) {
+        out.printf(",\"percent\":%d", percent);
+    }
+    out.print(",\"state\":");
+    out.jsonString(state.calibrationState);
+    out.print("}");
+
+    out.printf(",\"servo\":{\"connected\":%s}}", state.servoConnected ? "true" : "false");
+    return !out.overflowed();
+}
+
+bool StatusJson::renderRuntime(BufferWriter& out, const DeviceStateSnapshot& state,
+                               const SseClientStats* clients, int clientCount,
+                               uint32_t coalesced, uint32_t dropped, unsigned long uptime) {
+    out.printf("{\"uptime\":%lu", uptime);
+
+    // Servo telemetry from the last motion task sample
+    out.print(",\"servo\":{");
+    if (state.servo.valid) {
+        int decivolts = abs(state.servo.voltage);
+        out.printf("\"speed\":%d,\"load\":%d,\"voltage\":%s%d.%d,\"temperature\":%d",
+                   state.servo.speed, state.servo.load,
+                   state.servo.voltage < 0 ? "-" : "", decivolts / 10, decivolts % 10,
+                   state.servo.temperature);
+    }
+    out.print("}");
+
+    // SSE backpressure stats
+    out.print(",\"sse\":{\"clients\":[");
+    for (int i = 0; i < clientCount; i++) {
+        const SseClientStats& client = clients[i];
+        out.printf("%s{\"queue\":%u,\"maxQueue\":%u,\"coalesced\":%lu,\"dropped\":%lu}",
+                   i ? "," : "", client.queueDepth, client.maxQueueDepth,
+                   (unsigned long)client.coalesced, (unsigned long)client.dropped);
+        coalesced += client.coalesced;
+        dropped += client.dropped;
+    }
+    out.printf("],\"coalesced\":%lu,\"dropped\":%lu}}",
+               (unsigned long)coalesced, (unsigned long)dropped);
+    return !out.overflowed();
+}
@@ -1,12 +1,46 @@
 #include "storage.h"
 #include "config.h"
 #include "logger.h"
+#include "metrics.h"
 #include <Preferences.h>
 #include <WiFi.h>
+#include <esp_rom_crc.h>
 
 static Preferences preferences;
 
-Storage::Storage() : _initialized(false) {
+static const uint8_t MOTION_RECORD_VERSION = 1;
+static const uint8_t MOTION_RECORD_FLAG_MOVING = 0x01;
+static const uint8_t WIFI_FAST_RECORD_VERSION = 1;
+
+namespace {
+// NVS key of a per-blind setting: blind 0 keeps the single-blind key, the
+// others append their index ("max_pos" -> "max_pos2"), staying within 15 chars
+class BlindKey {
+public:
+    BlindKey(const char* key, uint8_t blind) {
+        if (blind == 0) {
+            strncpy(_key, key, sizeof(_key) - 1);
+            _key[sizeof(_key) - 1] = '\0';
+        } else {
+            snprintf(_key, sizeof(_key), "%s%u", key, blind);
+        }
+    }
+    const char* c_str() const { return _key; }
+private:
+    char _key[16];
+};
+}
+
+Storage::Storage()
+    : _initialized(false)
+    , _configMutex(nullptr)
+    , _wearWindowStart(0)
+    , _wifiFastValid(false)
+{
+    memset(_motion, 0, sizeof(_motion));
+    memset(_driveDirty, 0, sizeof(_driveDirty));
+    memset(&_wifiFast, 0, sizeof(_wifiFast));
+    memset(&_stats, 0, sizeof(_stats));
 }
 
 bool Storage::init() {
@@ -17,19 +51,26 @@ bool Storage::init() {
         return false;
     }
 
+    if (!_configMutex) {
+        _configMutex = xSemaphoreCreateMutex();
+    }
+
     _initialized = true;
+    loadCache();
+    for (uint8_t blind = 0; blind < BLIND_COUNT; blind++) {
+        loadMotionRecord(blind);
+    }
+    loadWifiFastRecord();
+
     LOG_NVS("NVS initialized successfully");
     return true;
 }
 
-bool Storage::loadConfig(DeviceConfig& config) {
-    if (!_initialized) {
-        LOG_ERROR("NVS not initialized");
-        return false;
-    }
-
+void Storage::loadCache() {
     LOG_NVS("Loading configuration from NVS");
 
+    DeviceConfig config;
+
     String ssid = getString(NVS_KEY_WIFI_SSID);
     String pass = getString(NVS_KEY_WIFI_PASS);
     // Use empty string as default - main.cpp will handle the deviceId suffix
@@ -37,6 +78,18 @@ bool Storage::loadConfig(DeviceConfig& config) {
     String broker = getString(NVS_KEY_MQTT_BROKER);
     String mqttUser = getString(NVS_KEY_MQTT_USER);
     String mqttPass = getString(NVS_KEY_MQTT_PASS);
+    String devicePass = getString(NVS_KEY_DEVICE_PASS);
+    String logLevels = getString(NVS_KEY_LOG_LEVELS);
+    String mqttGroups = getString(NVS_KEY_MQTT_GROUPS);
+    String staticIp = getString(NVS_KEY_WIFI_STATIC_IP);
+    String schedule = getString(NVS_KEY_SCHEDULE);
+    String location = getString(NVS_KEY_LOCATION);
+    String timezone = getString(NVS_KEY_TIMEZONE, SCHEDULE_DEFAULT_TIMEZONE);
+
+    if (devicePass.length() >= sizeof(config.devicePassword)) {
+        // Stored by firmware that did not check the length; only the prefix will match
+        LOG_ERROR("Stored device password exceeds %d bytes - set it again", DEVICE_PASSWORD_MAX_LENGTH);
+    }
 
     strncpy(config.wifiSsid, ssid.c_str(), sizeof(config.wifiSsid) - 1);
     strncpy(config.wifiPassword, pass.c_str(), sizeof(config.wifiPassword) - 1);
@@ -44,9 +97,66 @@ bool Storage::loadConfig(DeviceConfig& config) {
     strncpy(config.mqttBroker, broker.c_str(), sizeof(config.mqttBroker) - 1);
     strncpy(config.mqttUser, mqttUser.c_str(), sizeof(config.mqttUser) - 1);
     strncpy(config.mqttPassword, mqttPass.c_str(), sizeof(config.mqttPassword) - 1);
+    strncpy(config.devicePassword, devicePass.c_str(), sizeof(config.devicePassword) - 1);
+    strncpy(config.logLevels, logLevels.c_str(), sizeof(config.logLevels) - 1);
+    strncpy(config.mqttGroups, mqttGroups.c_str(), sizeof(config.mqttGroups) - 1);
+    strncpy(config.staticIp, staticIp.c_str(), sizeof(config.staticIp) - 1);
+    strncpy(config.schedule, schedule.c_str(), sizeof(config.schedule) - 1);
+    strncpy(config.location, location.c_str(), sizeof(config.location) - 1);
+    strncpy(config.timezone, timezone.c_str(), sizeof(config.timezone) - 1);
 
     config.mqttPort = getUInt16("mqtt_port", MQTT_PORT);
-    config.servoId = getUInt8(NVS_KEY_SERVO_ID, DEFAULT_SERVO_ID);
+    config.setupComplete = getBool(NVS_KEY_SETUP_COMPLETE, false);
+    config.powerMode = getUInt8(NVS_KEY_POWER_MODE, POWER_MODE_DEFAULT);
+    config.autoHome = getBool(NVS_KEY_AUTO_HOME, false);
+
+    for (uint8_t i = 0; i < BLIND_COUNT; i++) {
+        BlindConfig& blind = config.blinds[i];
+        blind.servoId = getUInt8(BlindKey(NVS_KEY_SERVO_ID, i).c_str(), blind.servoId);
+        blind.rightMount = getString(BlindKey(NVS_KEY_ORIENTATION, i).c_str(), "left") == "right";  // Default to left mount
+        blind.servoSpeed = getUInt16(BlindKey(NVS_KEY_SERVO_SPEED, i).c_str(), SERVO_SPEED);       // Default from config.h
+        blind.maxPosition = getInt32(BlindKey(NVS_KEY_MAX_POSITION, i).c_str(), 0);
+        blind.calibrated = getBool(BlindKey(NVS_KEY_CALIBRATED, i).c_str(), false);
+
+        BlindKey driveKey(NVS_KEY_DRIVE_PROFILE, i);
+        if (preferences.getBytesLength(driveKey.c_str()) == sizeof(blind.drive)) {
+            preferences.getBytes(driveKey.c_str(), blind.drive, sizeof(blind.drive));
+        }
+    }
+
+    lockConfig();
+    _config = config;
+    unlockConfig();
+}
+
+void Storage::lockConfig() {
+    if (_configMutex) {
+        xSemaphoreTake(_configMutex, portMAX_DELAY);
+    }
+}
+
+void Storage::unlockConfig() {
+    if (_configMutex) {
+        xSemaphoreGive(_configMutex);
+    }
+}
+
+String Storage::cachedString(const char* value) {
+    lockConfig();
+    String result(value);
+    unlockConfig();
+    return result;
+}
+
+bool Storage::loadConfig(DeviceConfig& config) {
+    if (!_initialized) {
+        LOG_ERROR("NVS not initialized");
+        return false;
+    }
+
+    lockConfig();
+    config = _config;
+    unlockConfig();
 
     LOG_NVS("Config loaded - WiFi SSID: %s, Device: %s, MQTT: %s:%d",
             config.wifiSsid, config.deviceName, config.mqttBroker, config.mqttPort);
@@ -70,176 +180,725 @@ bool Storage::saveConfig(const DeviceConfig& config) {
     success &= setString(NVS_KEY_MQTT_USER, config.mqttUser);
     success &= setString(NVS_KEY_MQTT_PASS, config.mqttPassword);
     success &= setUInt16("mqtt_port", config.mqttPort);
-    success &= setUInt8(NVS_KEY_SERVO_ID, config.servoId);
+    for (uint8_t i = 0; i < BLIND_COUNT; i++) {
+        success &= setUInt8(BlindKey(NVS_KEY_SERVO_ID, i).c_str(), config.blinds[i].servoId);
+    }
 
-    if (success) {
-        LOG_NVS("Configuration saved successfully");
-    } else {
+    if (!success) {
         LOG_ERROR("Failed to save some configuration values");
+        return false;
     }
 
-    return success;
+    // Cache fields covered by saveConfig (others have their own setters)
+    lockConfig();
+    memcpy(_config.wifiSsid, config.wifiSsid, sizeof(_config.wifiSsid));
+    memcpy(_config.wifiPassword, config.wifiPassword, sizeof(_config.wifiPassword));
+    memcpy(_config.deviceName, config.deviceName, sizeof(_config.deviceName));
+    memcpy(_config.mqttBroker, config.mqttBroker, sizeof(_config.mqttBroker));
+    memcpy(_config.mqttUser, config.mqttUser, sizeof(_config.mqttUser));
+    memcpy(_config.mqttPassword, config.mqttPassword, sizeof(_config.mqttPassword));
+    _config.mqttPort = config.mqttPort;
+    for (int i = 0; i < BLIND_COUNT; i++) {
+        _config.blinds[i].servoId = config.blinds[i].servoId;
+    }
+    unlockConfig();
+
+    LOG_NVS("Configuration saved successfully");
+    return true;
 }
 
 String Storage::getWifiSsid() {
-    return getString(NVS_KEY_WIFI_SSID);
+    return cachedString(_config.wifiSsid);
 }
 
 String Storage::getWifiPassword() {
-    return getString(NVS_KEY_WIFI_PASS);
+    return cachedString(_config.wifiPassword);
 }
 
 String Storage::getDeviceName() {
-    String name = getString(NVS_KEY_DEVICE_NAME);
+    String name = cachedString(_config.deviceName);
     String baseName = name.isEmpty() ? String(DEVICE_NAME_PREFIX) : name;
     // Always include the deviceId suffix for consistent identification across BLE/WiFi
     return baseName + "_" + getDeviceId();
 }
 
 String Storage::getMqttBroker() {
-    return getString(NVS_KEY_MQTT_BROKER);
+    return cachedString(_config.mqttBroker);
 }
 
 String Storage::getMqttUser() {
-    return getString(NVS_KEY_MQTT_USER);
+    return cachedString(_config.mqttUser);
 }
 
 String Storage::getMqttPassword() {
-    return getString(NVS_KEY_MQTT_PASS);
+    return cachedString(_config.mqttPassword);
 }
 
 uint16_t Storage::getMqttPort() {
-    return getUInt16("mqtt_port", MQTT_PORT);
+    return _config.mqttPort;
 }
 
-uint8_t Storage::getServoId() {
-    return getUInt8(NVS_KEY_SERVO_ID, DEFAULT_SERVO_ID);
+uint8_t Storage::getServoId(uint8_t blind) {
+    return _config.blinds[blind].servoId;
+}
+
+// Copy a String into a fixed cache field (setters check FITS_FIELD first)
+#define CACHE_STRING(field, value) \
+    do { \
+        strncpy(field, (value).c_str(), sizeof(field) - 1); \
+        field[sizeof(field) - 1] = '\0'; \
+    } while (0)
+
+// Longer values are refused: NVS would keep all of them while the cache kept
+// a prefix, and a cut password never matches what the user types again
+#define FITS_FIELD(field, value) ((value).length() < sizeof(field))
+
+static bool tooLong(const char* what, const String& value, size_t fieldSize) {
+    LOG_ERROR("%s too long (%u bytes, max %u)", what, (unsigned)value.length(), (unsigned)(fieldSize - 1));
+    return false;
 }
 
 bool Storage::setWifiCredentials(const String& ssid, const String& password) {
+    if (!FITS_FIELD(_config.wifiSsid, ssid)) return tooLong("SSID", ssid, sizeof(_config.wifiSsid));
+    if (!FITS_FIELD(_config.wifiPassword, password)) {
+        return tooLong("WiFi password", password, sizeof(_config.wifiPassword));
+    }
     LOG_NVS("Setting WiFi credentials for SSID: %s", ssid.c_str());
     bool success = setString(NVS_KEY_WIFI_SSID, ssid);
     success &= setString(NVS_KEY_WIFI_PASS, password);
+    if (success) {
+        lockConfig();
+        CACHE_STRING(_config.wifiSsid, ssid);
+        CACHE_STRING(_config.wifiPassword, password);
+        unlockConfig();
+    }
+
+    // The remembered AP belongs to the old network
+    clearWifiFastRecord();
     return success;
 }
 
 bool Storage::setDeviceName(const String& name) {
+    if (!FITS_FIELD(_config.deviceName, name)) return tooLong("Device name", name, sizeof(_config.deviceName));
     LOG_NVS("Setting device name: %s", name.c_str());
-    return setString(NVS_KEY_DEVICE_NAME, name);
+    bool success = setString(NVS_KEY_DEVICE_NAME, name);
+    if (success) {
+        lockConfig();
+        CACHE_STRING(_config.deviceName, name);
+        unlockConfig();
+    }
+    return success;
 }
 
 bool Storage::setDevicePassword(const String& password) {
+    if (!FITS_FIELD(_config.devicePassword, password)) {
+        return tooLong("Device password", password, sizeof(_config.devicePassword));
+    }
     LOG_NVS("Setting device password (length: %d)", password.length());
-    return setString(NVS_KEY_DEVICE_PASS, password);
+    bool success = setString(NVS_KEY_DEVICE_PASS, password);
+    if (success) {
+        lockConfig();
+        CACHE_STRING(_config.devicePassword, password);
+        unlockConfig();
+    }
+    return success;
 }
 
 String Storage::getDevicePassword() {
-    return getString(NVS_KEY_DEVICE_PASS);
+    return cachedString(_config.devicePassword);
+}
+
+bool Storage::hasDevicePassword() {
+    return _config.devicePassword[0] != '\0';
+}
+
+bool Storage::checkDevicePassword(const String& candidate) {
+    lockConfig();
+    bool ok = _config.devicePassword[0] == '\0' ||
+              strcmp(_config.devicePassword, candidate.c_str()) == 0;
+    unlockConfig();
+    return ok;
 }
 
 bool Storage::setMqttConfig(const String& broker, uint16_t port,
                             const String& user, const String& password) {
+    if (!FITS_FIELD(_config.mqttBroker, broker)) return tooLong("MQTT broker", broker, sizeof(_config.mqttBroker));
+    if (!FITS_FIELD(_config.mqttUser, user)) return tooLong("MQTT user", user, sizeof(_config.mqttUser));
+    if (!FITS_FIELD(_config.mqttPassword, password)) {
+        return tooLong("MQTT password", password, sizeof(_config.mqttPassword));
+    }
     LOG_NVS("Setting MQTT config - broker: %s:%d", broker.c_str(), port);
     bool success = setString(NVS_KEY_MQTT_BROKER, broker);
     success &= setUInt16("mqtt_port", port);
     success &= setString(NVS_KEY_MQTT_USER, user);
     success &= setString(NVS_KEY_MQTT_PASS, password);
+    if (success) {
+        lockConfig();
+        CACHE_STRING(_config.mqttBroker, broker);
+        CACHE_STRING(_config.mqttUser, user);
+        CACHE_STRING(_config.mqttPassword, password);
+        _config.mqttPort = port;
+        unlockConfig();
+    }
     return success;
 }
 
-bool Storage::setServoId(uint8_t id) {
-    LOG_NVS("Setting servo ID: %d", id);
-    return setUInt8(NVS_KEY_SERVO_ID, id);
+bool Storage::setServoId(uint8_t id, uint8_t blind) {
+    LOG_NVS("Setting servo ID of blind %d: %d", blind, id);
+    bool success = setUInt8(BlindKey(NVS_KEY_SERVO_ID, blind).c_str(), id);
+    if (success) {
+        lockConfig();
+        _config.blinds[blind].servoId = id;
+        unlockConfig();
+    }
+    return success;
 }
 
 // Calibration methods
-int32_t Storage::getMaxPosition() {
-    return getInt32(NVS_KEY_MAX_POSITION, 0);
+int32_t Storage::getMaxPosition(uint8_t blind) {
+    return _config.blinds[blind].maxPosition;
 }
 
-bool Storage::setMaxPosition(int32_t pos) {
-    LOG_NVS("Setting max position: %d", pos);
-    return setInt32(NVS_KEY_MAX_POSITION, pos);
+bool Storage::setMaxPosition(int32_t pos, uint8_t blind) {
+    LOG_NVS("Setting max position of blind %d: %d", blind, pos);
+    bool success = setInt32(BlindKey(NVS_KEY_MAX_POSITION, blind).c_str(), pos);
+    if (success) {
+        lockConfig();
+        _config.blinds[blind].maxPosition = pos;
+        unlockConfig();
+    }
+    return success;
 }
 
-int32_t Storage::getCurrentPosition() {
-    return getInt32(NVS_KEY_CURRENT_POSITION, 0);
+int32_t Storage::getCurrentPosition(uint8_t blind) {
+    portENTER_CRITICAL(&_motionMux);
+    int32_t pos = _motion[blind].record.position;
+    portEXIT_CRITICAL(&_motionMux);
+    return pos;
 }
 
-bool Storage::setCurrentPosition(int32_t pos) {
+bool Storage::setCurrentPosition(int32_t pos, uint8_t blind) {
     // Don't log every position save to avoid spam
-    return setInt32(NVS_KEY_CURRENT_POSITION, pos);
+    if (!_initialized) return false;
+    portENTER_CRITICAL(&_motionMux);
+    bool changed = (_motion[blind].record.position != pos);
+    _motion[blind].record.position = pos;
+    portEXIT_CRITICAL(&_motionMux);
+    if (changed) {
+        markMotionDirty(false, blind);
+    }
+    return true;
 }
 
-bool Storage::isCalibrated() {
-    return getBool(NVS_KEY_CALIBRATED, false);
+bool Storage::isCalibrated(uint8_t blind) {
+    return _config.blinds[blind].calibrated;
 }
 
-bool Storage::setCalibrated(bool cal) {
-    LOG_NVS("Setting calibrated: %s", cal ? "true" : "false");
-    return setBool(NVS_KEY_CALIBRATED, cal);
+bool Storage::setCalibrated(bool cal, uint8_t blind) {
+    LOG_NVS("Setting calibrated of blind %d: %s", blind, cal ? "true" : "false");
+    bool success = setBool(BlindKey(NVS_KEY_CALIBRATED, blind).c_str(), cal);
+    if (success) {
+        lockConfig();
+        _config.blinds[blind].calibrated = cal;
+        unlockConfig();
+    }
+    return success;
 }
 
 bool Storage::getAutoHome() {
-    return getBool(NVS_KEY_AUTO_HOME, false);
+    return _config.autoHome;
 }
 
 bool Storage::setAutoHome(bool val) {
     LOG_NVS("Setting auto-home: %s", val ? "true" : "false");
-    return setBool(NVS_KEY_AUTO_HOME, val);
+    bool success = setBool(NVS_KEY_AUTO_HOME, val);
+    if (success) {
+        lockConfig();
+        _config.autoHome = val;
+        unlockConfig();
+    }
+    return success;
 }
 
 // Power outage recovery methods
-bool Storage::getWasMoving() {
-    return getBool(NVS_KEY_WAS_MOVING, false);
+bool Storage::getWasMoving(uint8_t blind) {
+    portENTER_CRITICAL(&_motionMux);
+    bool moving = (_motion[blind].record.flags & MOTION_RECORD_FLAG_MOVING) != 0;
+    portEXIT_CRITICAL(&_motionMux);
+    return moving;
+}
+
+bool Storage::setWasMoving(bool moving, uint8_t blind) {
+    if (!_initialized) return false;
+    portENTER_CRITICAL(&_motionMux);
+    MotionRecord& record = _motion[blind].record;
+    bool was = (record.flags & MOTION_RECORD_FLAG_MOVING) != 0;
+    if (moving) {
+        record.flags |= MOTION_RECORD_FLAG_MOVING;
+    } else {
+        record.flags &= ~MOTION_RECORD_FLAG_MOVING;
+    }
+    portEXIT_CRITICAL(&_motionMux);
+    // The moving flag drives power outage recovery - get it to flash promptly
+    if (was != moving) {
+        markMotionDirty(true, blind);
+    }
+    return true;
+}
+
+int32_t Storage::getTargetPosition(uint8_t blind) {
+    portENTER_CRITICAL(&_motionMux);
+    int32_t target = _motion[blind].record.target;
+    portEXIT_CRITICAL(&_motionMux);
+    return target;
+}
+
+bool Storage::setTargetPosition(int32_t pos, uint8_t blind) {
+    if (!_initialized) return false;
+    portENTER_CRITICAL(&_motionMux);
+    bool changed = (_motion[blind].record.target != pos);
+    _motion[blind].record.target = pos;
+    portEXIT_CRITICAL(&_motionMux);
+    if (changed) {
+        markMotionDirty(false, blind);
+    }
+    return true;
+}
+
+void Storage::flush(bool force) {
+    if (!_initialized) return;
+
+    unsigned long now = millis();
+
+    // Roll the hourly wear window
+    if (now - _wearWindowStart >= 3600000UL) {
+        _wearWindowStart = now;
+        _stats.writesThisHour = 0;
+        _stats.wearLimited = false;
+    }
+
+    for (uint8_t blind = 0; blind < BLIND_COUNT; blind++) {
+        flushMotion(blind, now, force);
+        flushDriveProfile(blind);
+    }
+}
+
+void Storage::flushMotion(uint8_t blind, unsigned long now, bool force) {
+    MotionSlot& slot = _motion[blind];
+
+    portENTER_CRITICAL(&_motionMux);
+    bool dirty = slot.dirty;
+    bool urgent = slot.urgent;
+    portEXIT_CRITICAL(&_motionMux);
+
+    if (!dirty) return;
+
+    if (!force && !urgent) {
+        unsigned long interval = _stats.wearLimited ? STORAGE_WEAR_BACKOFF_INTERVAL_MS
+                                                    : STORAGE_FLUSH_INTERVAL_MS;
+        if (now - slot.lastFlush < interval) {
+            return;
+        }
+    }
+
+    portENTER_CRITICAL(&_motionMux);
+    MotionRecord record = slot.record;
+    slot.dirty = false;
+    slot.urgent = false;
+    portEXIT_CRITICAL(&_motionMux);
+
+    record.writeCount++;
+    if (!writeMotionRecord(record, blind)) {
+        // Keep it dirty and retry on the next interval
+        portENTER_CRITICAL(&_motionMux);
+        slot.dirty = true;
+        portEXIT_CRITICAL(&_motionMux);
+        slot.lastFlush = now;
+        return;
+    }
+
+    portENTER_CRITICAL(&_motionMux);
+    slot.record.writeCount = record.writeCount;
+    portEXIT_CRITICAL(&_motionMux);
+
+    slot.lastFlush = now;
+    _stats.motionWrites++;
+    _stats.motionWritesLifetime++;
+    _stats.writesThisHour++;
+
+    if (!_stats.wearLimited && _stats.writesThisHour >= STORAGE_WEAR_BUDGET_PER_HOUR) {
+        _stats.wearLimited = true;
+        LOG_NVS("Motion record wear budget reached (%d/h) - flushing every %d s",
+                STORAGE_WEAR_BUDGET_PER_HOUR, STORAGE_WEAR_BACKOFF_INTERVAL_MS / 1000);
+    }
+}
+
+StorageStats Storage::getStats() {
+    return _stats;
+}
+
+void Storage::markMotionDirty(bool urgent, uint8_t blind) {
+    portENTER_CRITICAL(&_motionMux);
+    MotionSlot& slot = _motion[blind];
+    if (slot.dirty && !urgent) {
+        _stats.coalescedUpdates++;
+    }
+    slot.dirty = true;
+    if (urgent) {
+        slot.urgent = true;
+    }
+    portEXIT_CRITICAL(&_motionMux);
 }
 
-bool Storage::setWasMoving(bool moving) {
-    return setBool(NVS_KEY_WAS_MOVING, moving);
+void Storage::loadMotionRecord(uint8_t blind) {
+    MotionRecord record;
+    BlindKey key(NVS_KEY_MOTION_RECORD, blind);
+    size_t len = preferences.getBytesLength(key.c_str());
+
+    if (len == sizeof(record) &&
+        preferences.getBytes(key.c_str(), &record, sizeof(record)) == sizeof(record) &&
+        record.version == MOTION_RECORD_VERSION &&
+        record.checksum == motionChecksum(record)) {
+        _motion[blind].record = record;
+        _stats.motionWritesLifetime += record.writeCount;
+        LOG_NVS("Motion record %d loaded: pos=%d, target=%d, moving=%s, writes=%u",
+                blind, record.position, record.target,
+                (record.flags & MOTION_RECORD_FLAG_MOVING) ? "yes" : "no", record.writeCount);
+        return;
+    }
+
+    memset(&record, 0, sizeof(record));
+    record.version = MOTION_RECORD_VERSION;
+
+    if (blind > 0) {
+        if (len > 0) {
+            LOG_ERROR("Motion record %d invalid (len=%d) - starting from home", blind, len);
+        }
+        _motion[blind].record = record;
+        return;
+    }
+
+    if (len > 0) {
+        LOG_ERROR("Motion record invalid (len=%d) - falling back to legacy keys", len);
+    }
+
+    // Migrate from the separate keys used by earlier firmware (primary blind only)
+    record.position = getInt32(NVS_KEY_CURRENT_POSITION, 0);
+    record.target = getInt32(NVS_KEY_TARGET_POSITION, 0);
+    if (getBool(NVS_KEY_WAS_MOVING, false)) {
+        record.flags |= MOTION_RECORD_FLAG_MOVING;
+    }
+    _motion[0].record = record;
+
+    if (preferences.isKey(NVS_KEY_CURRENT_POSITION) ||
+        preferences.isKey(NVS_KEY_TARGET_POSITION) ||
+        preferences.isKey(NVS_KEY_WAS_MOVING)) {
+        LOG_NVS("Migrating legacy position keys to motion record");
+        record.writeCount = 1;
+        if (writeMotionRecord(record, 0)) {
+            _motion[0].record.writeCount = record.writeCount;
+            _stats.motionWritesLifetime += record.writeCount;
+            preferences.remove(NVS_KEY_CURRENT_POSITION);
+            preferences.remove(NVS_KEY_TARGET_POSITION);
+            preferences.remove(NVS_KEY_WAS_MOVING);
+        }
+    }
 }
 
-int32_t Storage::getTargetPosition() {
-    return getInt32(NVS_KEY_TARGET_POSITION, 0);
+bool Storage::writeMotionRecord(const MotionRecord& record, uint8_t blind) {
+    MotionRecord out = record;
+    out.version = MOTION_RECORD_VERSION;
+    out.checksum = motionChecksum(out);
+
+    _stats.nvsWrites++;
+    MetricScope timer(MetricTimer::NVS_WRITE);
+    if (preferences.putBytes(BlindKey(NVS_KEY_MOTION_RECORD, blind).c_str(), &out, sizeof(out)) != sizeof(out)) {
+        LOG_ERROR("Failed to write motion record %d", blind);
+        return false;
+    }
+    return true;
 }
 
-bool Storage::setTargetPosition(int32_t pos) {
-    return setInt32(NVS_KEY_TARGET_POSITION, pos);
+uint32_t Storage::motionChecksum(const MotionRecord& record) {
+    return esp_rom_crc32_le(0, (const uint8_t*)&record, offsetof(MotionRecord, checksum));
 }
 
-String Storage::getOrientation() {
-    return getString(NVS_KEY_ORIENTATION, "left");  // Default to left mount
+String Storage::getOrientation(uint8_t blind) {
+    return _config.blinds[blind].rightMount ? "right" : "left";
 }
 
-bool Storage::setOrientation(const String& orientation) {
+bool Storage::setOrientation(const String& orientation, uint8_t blind) {
     // Validate - only allow "left" or "right"
     if (orientation != "left" && orientation != "right") {
         LOG_ERROR("Invalid orientation: %s (must be 'left' or 'right')", orientation.c_str());
         return false;
     }
-    LOG_NVS("Setting orientation: %s", orientation.c_str());
-    return setString(NVS_KEY_ORIENTATION, orientation);
+    LOG_NVS("Setting orientation of blind %d: %s", blind, orientation.c_str());
+    bool success = setString(BlindKey(NVS_KEY_ORIENTATION, blind).c_str(), orientation);
+    if (success) {
+        lockConfig();
+        _config.blinds[blind].rightMount = (orientation == "right");
+        unlockConfig();
+    }
+    return success;
+}
+
+bool Storage::isRightMount(uint8_t blind) {
+    return _config.blinds[blind].rightMount;
+}
+
+uint16_t Storage::getServoSpeed(uint8_t blind) {
+    return _config.blinds[blind].servoSpeed;
+}
+
+bool Storage::setServoSpeed(uint16_t speed, uint8_t blind) {
+    LOG_NVS("Setting servo speed of blind %d: %d", blind, speed);
+    bool success = setUInt16(BlindKey(NVS_KEY_SERVO_SPEED, blind).c_str(), speed);
+    if (!success) {
+        return false;
+    }
+
+    // The learned profile was bounded by the old speed - start again from the new one
+    lockConfig();
+    _config.blinds[blind].servoSpeed = speed;
+    DriveProfile* drive = _config.blinds[blind].drive;
+    bool learned = drive[0].speed || drive[1].speed;
+    memset(drive, 0, sizeof(_config.blinds[blind].drive));
+    _driveDirty[blind] = false;
+    unlockConfig();
+    if (learned) {
+        preferences.remove(BlindKey(NVS_KEY_DRIVE_PROFILE, blind).c_str());
+    }
+    return true;
+}
+
+DriveProfile Storage::getDriveProfile(bool closing, uint8_t blind) {
+    lockConfig();
+    DriveProfile profile = _config.blinds[blind].drive[closing ? 1 : 0];
+    unlockConfig();
+    return profile;
+}
+
+bool Storage::setDriveProfile(const DriveProfile& profile, bool closing, uint8_t blind) {
+    lockConfig();
+    DriveProfile& slot = _config.blinds[blind].drive[closing ? 1 : 0];
+    bool changed = slot.speed != profile.speed || slot.acceleration != profile.acceleration;
+    if (changed) {
+        slot = profile;
+        _driveDirty[blind] = true;
+    }
+    unlockConfig();
+
+    if (changed) {
+        LOG_NVS("Blind %d %s profile: speed=%d, acc=%d", blind, closing ? "closing" : "opening",
+                profile.speed, profile.acceleration);
+    }
+    return true;
+}
+
+void Storage::flushDriveProfile(uint8_t blind) {
+    DriveProfile drive[2];
+    lockConfig();
+    bool dirty = _driveDirty[blind];
+    _driveDirty[blind] = false;
+    memcpy(drive, _config.blinds[blind].drive, sizeof(drive));
+    unlockConfig();
+
+    if (!dirty) return;
+
+    _stats.nvsWrites++;
+    MetricScope timer(MetricTimer::NVS_WRITE);
+    if (preferences.putBytes(BlindKey(NVS_KEY_DRIVE_PROFILE, blind).c_str(), drive, sizeof(drive)) != sizeof(drive)) {
+        LOG_ERROR("Failed to write drive profile %d", blind);
+    }
+}
+
+uint8_t Storage::getPowerMode() {
+    return _config.powerMode;
+}
+
+bool Storage::setPowerMode(uint8_t mode) {
+    LOG_NVS("Setting power mode: %d", mode);
+    bool success = setUInt8(NVS_KEY_POWER_MODE, mode);
+    if (success) {
+        lockConfig();
+        _config.powerMode = mode;
+        unlockConfig();
+    }
+    return success;
+}
+
+String Storage::getLogLevels() {
+    return cachedString(_config.logLevels);
+}
+
+bool Storage::setLogLevels(const String& spec) {
+    if (!FITS_FIELD(_config.logLevels, spec)) return tooLong("Log levels", spec, sizeof(_config.logLevels));
+    LOG_NVS("Setting log levels: %s", spec.c_str());
+    bool success = setString(NVS_KEY_LOG_LEVELS, spec);
+    if (success) {
+        lockConfig();
+        CACHE_STRING(_config.logLevels, spec);
+        unlockConfig();
+    }
+    return success;
+}
+
+String Storage::getMqttGroups() {
+    return cachedString(_config.mqttGroups);
+}
+
+bool Storage::setMqttGroups(const String& groups) {
+    if (!FITS_FIELD(_config.mqttGroups, groups)) return tooLong("MQTT groups", groups, sizeof(_config.mqttGroups));
+    LOG_NVS("Setting MQTT groups: %s", groups.c_str());
+    bool success = setString(NVS_KEY_MQTT_GROUPS, groups);
+    if (success) {
+        lockConfig();
+        CACHE_STRING(_config.mqttGroups, groups);
+        unlockConfig();
+    }
+    return success;
+}
+
+void Storage::loadWifiFastRecord() {
+    WifiFastRecord record;
+    size_t len = preferences.getBytesLength(NVS_KEY_WIFI_FAST);
+
+    if (len == sizeof(record) &&
+        preferences.getBytes(NVS_KEY_WIFI_FAST, &record, sizeof(record)) == sizeof(record) &&
+        record.version == WIFI_FAST_RECORD_VERSION &&
+        record.checksum == esp_rom_crc32_le(0, (const uint8_t*)&record, offsetof(WifiFastRecord, checksum))) {
+        _wifiFast = record;
+        _wifiFastValid = true;
+        LOG_NVS("WiFi fast record loaded: %02x:%02x:%02x:%02x:%02x:%02x ch %d",
+                record.bssid[0], record.bssid[1], record.bssid[2],
+                record.bssid[3], record.bssid[4], record.bssid[5], record.channel);
+    } else if (len > 0) {
+        LOG_ERROR("WiFi fast record invalid (len=%d) - ignoring", len);
+    }
+}
+
+bool Storage::getWifiFastRecord(WifiFastRecord& record) {
+    lockConfig();
+    bool valid = _wifiFastValid;
+    record = _wifiFast;
+    unlockConfig();
+    return valid;
+}
+
+bool Storage::setWifiFastRecord(const WifiFastRecord& record) {
+    WifiFastRecord out = record;
+    out.version = WIFI_FAST_RECORD_VERSION;
+    out.checksum = esp_rom_crc32_le(0, (const uint8_t*)&out, offsetof(WifiFastRecord, checksum));
+
+    lockConfig();
+    bool unchanged = _wifiFastValid && memcmp(&out, &_wifiFast, sizeof(out)) == 0;
+    unlockConfig();
+    if (unchanged) {
+        return true;  // Same AP and lease as last time - spare the flash
+    }
+
+    LOG_NVS("Saving WiFi fast record (ch %d)", out.channel);
+    _stats.nvsWrites++;
+    uint32_t start = Metrics::start();
+    size_t written = preferences.putBytes(NVS_KEY_WIFI_FAST, &out, sizeof(out));
+    Metrics::record(MetricTimer::NVS_WRITE, start);
+    if (written != sizeof(out)) {
+        LOG_ERROR("Failed to write WiFi fast record");
+        return false;
+    }
+
+    lockConfig();
+    _wifiFast = out;
+    _wifiFastValid = true;
+    unlockConfig();
+    return true;
 }
 
-bool Storage::isRightMount() {
-    return getOrientation() == "right";
+void Storage::clearWifiFastRecord() {
+    lockConfig();
+    bool valid = _wifiFastValid;
+    _wifiFastValid = false;
+    unlockConfig();
+
+    if (valid) {
+        LOG_NVS("Clearing WiFi fast record");
+        preferences.remove(NVS_KEY_WIFI_FAST);
+    }
+}
+
+String Storage::getSchedule() {
+    return cachedString(_config.schedule);
+}
+
+bool Storage::setSchedule(const String& rules) {
+    if (!FITS_FIELD(_config.schedule, rules)) return tooLong("Schedule", rules, sizeof(_config.schedule));
+    LOG_NVS("Setting schedule: %s", rules.isEmpty() ? "(none)" : rules.c_str());
+    bool success = setString(NVS_KEY_SCHEDULE, rules);
+    if (success) {
+        lockConfig();
+        CACHE_STRING(_config.schedule, rules);
+        unlockConfig();
+    }
+    return success;
 }
 
-uint16_t Storage::getServoSpeed() {
-    return getUInt16(NVS_KEY_SERVO_SPEED, SERVO_SPEED);  // Default from config.h
+String Storage::getLocation() {
+    return cachedString(_config.location);
 }
 
-bool Storage::setServoSpeed(uint16_t speed) {
-    LOG_NVS("Setting servo speed: %d", speed);
-    return setUInt16(NVS_KEY_SERVO_SPEED, speed);
+String Storage::getTimezone() {
+    return cachedString(_config.timezone);
+}
+
+bool Storage::setLocation(const String& location, const String& timezone) {
+    if (!FITS_FIELD(_config.location, location)) return tooLong("Location", location, sizeof(_config.location));
+    if (!FITS_FIELD(_config.timezone, timezone)) return tooLong("Timezone", timezone, sizeof(_config.timezone));
+    LOG_NVS("Setting location: %s, timezone %s", location.isEmpty() ? "(none)" : location.c_str(),
+            timezone.c_str());
+    bool success = setString(NVS_KEY_LOCATION, location);
+    success &= setString(NVS_KEY_TIMEZONE, timezone);
+    if (success) {
+        lockConfig();
+        CACHE_STRING(_config.location, location);
+        CACHE_STRING(_config.timezone, timezone);
+        unlockConfig();
+    }
+    return success;
+}
+
+String Storage::getStaticIp() {
+    return cachedString(_config.staticIp);
+}
+
+bool Storage::setStaticIp(const String& spec) {
+    if (!FITS_FIELD(_config.staticIp, spec)) return tooLong("Static IP", spec, sizeof(_config.staticIp));
+    LOG_NVS("Setting static IP: %s", spec.isEmpty() ? "(DHCP)" : spec.c_str());
+    bool success = setString(NVS_KEY_WIFI_STATIC_IP, spec);
+    if (success) {
+        lockConfig();
+        CACHE_STRING(_config.staticIp, spec);
+        unlockConfig();
+    }
+
+    // A remembered lease must not override the new addressing
+    clearWifiFastRecord();
+    return success;
 }
 
 bool Storage::isSetupComplete() {
-    return getBool(NVS_KEY_SETUP_COMPLETE, false);
+    return _config.setupComplete;
 }
 
 bool Storage::setSetupComplete(bool complete) {
     LOG_NVS("Setting setup complete: %s", complete ? "true" : "false");
-    return setBool(NVS_KEY_SETUP_COMPLETE, complete);
+    bool success = setBool(NVS_KEY_SETUP_COMPLETE, complete);
+    if (success) {
+        lockConfig();
+        _config.setupComplete = complete;
+        unlockConfig();
+    }
+    return success;
 }
 
 bool Storage::clearAll() {
@@ -250,6 +909,17 @@ bool Storage::clearAll() {
 
     LOG_NVS("Clearing all stored data");
     bool success = preferences.clear();
+
+    // Drop the cached settings and record too so nothing is written back after the wipe
+    lockConfig();
+    _config = DeviceConfig();
+    _wifiFastValid = false;
+    unlockConfig();
+
+    portENTER_CRITICAL(&_motionMux);
+    memset(_motion, 0, sizeof(_motion));
+    memset(_driveDirty, 0, sizeof(_driveDirty));
+    portEXIT_CRITICAL(&_motionMux);
     if (success) {
         LOG_NVS("All data cleared");
     } else {
@@ -303,7 +973,13 @@ String Storage::getString(const char* key, const char* defaultValue) {
 
 bool Storage::setString(const char* key, const String& value) {
     if (!_initialized) return false;
-    return preferences.putString(key, value) > 0;
+    _stats.nvsWrites++;
+    MetricScope timer(MetricTimer::NVS_WRITE);
+    if (value.isEmpty()) {
+        // putString() reports 0 bytes for ""; a missing key reads back as "" anyway
+        return preferences.remove(key) || !preferences.isKey(key);
+    }
+    return preferences.putString(key, value) == value.length();
 }
 
 uint16_t Storage::getUInt16(const char* key, uint16_t defaultValue) {
@@ -313,6 +989,8 @@ uint16_t Storage::getUInt16(const char* key, uint16_t defaultValue) {
 
 bool Storage::setUInt16(const char* key, uint16_t value) {
     if (!_initialized) return false;
+    _stats.nvsWrites++;
+    MetricScope timer(MetricTimer::NVS_WRITE);
     return preferences.putUShort(key, value) > 0;
 }
 
@@ -323,6 +1001,8 @@ uint8_t Storage::getUInt8(const char* key, uint8_t defaultValue) {
 
 bool Storage::setUInt8(const char* key, uint8_t value) {
     if (!_initialized) return false;
+    _stats.nvsWrites++;
+    MetricScope timer(MetricTimer::NVS_WRITE);
     return preferences.putUChar(key, value) > 0;
 }
 
@@ -333,6 +1013,8 @@ int32_t Storage::getInt32(const char* key, int32_t defaultValue) {
 
 bool Storage::setInt32(const char* key, int32_t value) {
     if (!_initialized) return false;
+    _stats.nvsWrites++;
+    MetricScope timer(MetricTimer::NVS_WRITE);
     return preferences.putInt(key, value) > 0;
 }
 
@@ -343,5 +1025,7 @@ bool Storage::getBool(const char* key, bool defaultValue) {
 
 bool Storage::setBool(const char* key, bool value) {
     if (!_initialized) return false;
+    _stats.nvsWrites++;
+    MetricScope timer(MetricTimer::NVS_WRITE);
     return preferences.putBool(key, value);
 }
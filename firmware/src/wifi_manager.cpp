@@ -2,26 +2,57 @@
 #include "config.h"
 #include "logger.h"
 #include "storage.h"
+#include "device_state.h"
 #include <WiFi.h>
 #include <ESPmDNS.h>
+#include <esp_netif.h>
+#include <lwip/dhcp.h>
+#include <lwip/tcpip.h>
 
 extern Storage storage;
 
+static struct netif* staNetif() {
+    esp_netif_t* sta = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+    return sta ? (struct netif*)esp_netif_get_netif_impl(sta) : nullptr;
+}
+
+// tcpip thread. Unlike esp_netif_dhcpc_start() (WiFi.config(INADDR_NONE)),
+// starting lwIP's client directly keeps the reused address on the interface
+// while DHCP runs. An ACK for the same address rebinds it without touching
+// open sockets; only a NAK or a different address changes it.
+static void dhcpStartInPlace(void* arg) {
+    dhcp_start((struct netif*)arg);
+}
+
+static void dhcpStop(void* arg) {
+    dhcp_release_and_stop((struct netif*)arg);
+}
+
 WifiManager::WifiManager()
     : _state(WifiState::DISCONNECTED)
     , _connectStartTime(0)
+    , _lastRssiPublish(0)
     , _lastReconnectAttempt(0)
     , _reconnectAttempts(0)
     , _onConnectedCallback(nullptr)
     , _onDisconnectedCallback(nullptr)
     , _onConnectionFailedCallback(nullptr)
     , _isInitialConnection(false)
+    , _fastAttempt(false)
+    , _leaseReused(false)
+    , _leaseConfirming(false)
+    , _lastConnectFast(false)
+    , _attemptStartTime(0)
+    , _connectedAt(0)
+    , _lastConnectMs(0)
+    , _mdnsStarted(false)
 {
 }
 
 void WifiManager::init() {
     LOG_WIFI("Initializing WiFi");
 
+    WiFi.persistent(false);        // Credentials live in our own NVS keys - no flash write per begin()
     WiFi.mode(WIFI_STA);
     WiFi.setAutoReconnect(false);  // We'll handle reconnection ourselves
 
@@ -43,18 +74,125 @@ bool WifiManager::connect(const String& ssid, const String& password, bool isIni
 
     _ssid = ssid;
     _password = password;
-    _state = WifiState::CONNECTING;
-    _connectStartTime = millis();
     _reconnectAttempts = 0;
     _isInitialConnection = isInitial;
 
     LOG_WIFI("Connecting to WiFi: %s (initial: %s)", _ssid.c_str(), isInitial ? "yes" : "no");
 
+    begin();
+
+    return true;
+}
+
+void WifiManager::begin() {
+    _state = WifiState::CONNECTING;
+    _connectStartTime = millis();
+    _attemptStartTime = _connectStartTime;
+    _leaseReused = false;
+    _leaseConfirming = false;
+    stopLeaseConfirm();
+
+    WifiFastRecord record;
+    if (!storage.getWifiFastRecord(record) || record.channel == 0) {
+        beginFull();
+        return;
+    }
+
+    // Reuse the last lease as well, so the link is usable as soon as it associates
+    if (!applyStaticIp()) {
+        if (record.ip != 0) {
+            WiFi.config(IPAddress(record.ip), IPAddress(record.gateway),
+                        IPAddress(record.subnet), IPAddress(record.dns));
+            _leaseReused = true;
+        } else {
+            WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+        }
+    }
+
+    _fastAttempt = true;
+    LOG_WIFI("Fast connect: %02x:%02x:%02x:%02x:%02x:%02x on channel %d%s",
+             record.bssid[0], record.bssid[1], record.bssid[2],
+             record.bssid[3], record.bssid[4], record.bssid[5], record.channel,
+             _leaseReused ? " (cached lease)" : "");
+    WiFi.begin(_ssid.c_str(), _password.c_str(), record.channel, record.bssid);
+}
+
+void WifiManager::beginFull() {
+    _fastAttempt = false;
+    _leaseReused = false;
+    if (!applyStaticIp()) {
+        WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);  // DHCP
+    }
     WiFi.begin(_ssid.c_str(), _password.c_str());
+}
 
+bool WifiManager::applyStaticIp() {
+    String spec = storage.getStaticIp();
+    if (spec.isEmpty()) {
+        return false;
+    }
+
+    IPAddress ip, gateway, subnet, dns;
+    if (!parseStaticIp(spec, ip, gateway, subnet, dns)) {
+        LOG_WARN(WIFI, "Ignoring invalid static IP config: %s", spec.c_str());
+        return false;
+    }
+    WiFi.config(ip, gateway, subnet, dns);
     return true;
 }
 
+bool WifiManager::parseStaticIp(const String& spec, IPAddress& ip, IPAddress& gateway,
+                                IPAddress& subnet, IPAddress& dns) {
+    IPAddress* fields[] = {&ip, &gateway, &subnet, &dns};
+    int count = 0;
+    int start = 0;
+
+    for (;;) {
+        if (count == 4) {
+            return false;  // Too many fields
+        }
+        int comma = spec.indexOf(',', start);
+        String part = spec.substring(start, comma < 0 ? spec.length() : comma);
+        part.trim();
+        if (!fields[count++]->fromString(part)) {
+            return false;
+        }
+        if (comma < 0) {
+            break;
+        }
+        start = comma + 1;
+    }
+
+    if (count < 3) {
+        return false;
+    }
+    if (count == 3) {
+        dns = gateway;
+    }
+    return (uint32_t)ip != 0 && (uint32_t)subnet != 0;
+}
+
+void WifiManager::saveFastRecord() {
+    uint8_t* bssid = WiFi.BSSID();
+    if (!bssid) {
+        return;
+    }
+
+    WifiFastRecord record;
+    memset(&record, 0, sizeof(record));
+    memcpy(record.bssid, bssid, sizeof(record.bssid));
+    record.channel = WiFi.channel();
+
+    // Only a DHCP lease is remembered; a static IP is applied from its own setting
+    if (storage.getStaticIp().isEmpty()) {
+        record.ip = WiFi.localIP();
+        record.gateway = WiFi.gatewayIP();
+        record.subnet = WiFi.subnetMask();
+        record.dns = WiFi.dnsIP();
+    }
+    storage.setWifiFastRecord(record);
+}
+
 bool WifiManager::connectWithStoredCredentials() {
     String ssid = storage.getWifiSsid();
     String password = storage.getWifiPassword();
@@ -71,6 +209,7 @@ void WifiManager::disconnect() {
     LOG_WIFI("Disconnecting from WiFi");
     WiFi.disconnect(true);
     _state = WifiState::DISCONNECTED;
+    publishState();
 }
 
 WifiState WifiManager::getState() const {
@@ -120,14 +259,32 @@ void WifiManager::update() {
             break;
 
         case WifiState::CONNECTED:
+            if (_leaseConfirming) {
+                // Polls lwIP's DHCP state byte; it only moves forward to BOUND here
+                struct netif* netif = staNetif();
+                if (netif && dhcp_supplied_address(netif)) {
+                    _leaseConfirming = false;
+                    LOG_WIFI("DHCP lease confirmed: %s", WiFi.localIP().toString().c_str());
+                    saveFastRecord();
+                    publishState();
+                } else if (millis() - _connectedAt >= WIFI_LEASE_CONFIRM_TIMEOUT_MS) {
+                    // Keep the address; lwIP carries on retrying in the background
+                    _leaseConfirming = false;
+                    LOG_WARN(WIFI, "No DHCP answer yet - keeping cached lease");
+                }
+            }
+
             // Check if we've lost connection
             if (wifiStatus != WL_CONNECTED) {
                 LOG_WIFI("WiFi connection lost");
                 _state = WifiState::DISCONNECTED;
+                publishState();
                 if (_onDisconnectedCallback) {
                     _onDisconnectedCallback();
                 }
                 startReconnect();
+            } else if (millis() - _lastRssiPublish >= WIFI_RSSI_PUBLISH_INTERVAL_MS) {
+                publishState();
             }
             break;
 
@@ -152,23 +309,40 @@ void WifiManager::handleConnectionResult() {
         _reconnectAttempts = 0;
         bool wasInitial = _isInitialConnection;
         _isInitialConnection = false;
+        _connectedAt = millis();
+        _lastConnectFast = _fastAttempt;
+        _lastConnectMs = _connectedAt - _attemptStartTime;
 
         String ip = WiFi.localIP().toString();
         int rssi = WiFi.RSSI();
 
-        LOG_WIFI("Connected! IP: %s, RSSI: %d dBm", ip.c_str(), rssi);
+        LOG_WIFI("Connected! IP: %s, RSSI: %d dBm (%s, %lu ms)", ip.c_str(), rssi,
+                 _fastAttempt ? "fast" : "full", _lastConnectMs);
+        publishState();
+        saveFastRecord();
 
-        // Start mDNS
-        if (MDNS.begin(_hostname.c_str())) {
-            MDNS.addService("http", "tcp", HTTP_PORT);
-            MDNS.addService("famesmartblinds", "tcp", HTTP_PORT);
-            LOG_WIFI("mDNS started: %s.local", _hostname.c_str());
+        // mDNS follows the interface across reconnects - start it once
+        startMdns();
+
+        if (_leaseReused) {
+            startLeaseConfirm();
         }
 
         if (_onConnectedCallback) {
             _onConnectedCallback(ip);
         }
     }
+    else if (_fastAttempt &&
+             (status == WL_CONNECT_FAILED ||
+              status == WL_NO_SSID_AVAIL ||
+              (millis() - _connectStartTime > WIFI_FAST_CONNECT_TIMEOUT_MS))) {
+        // AP moved channel, was replaced or is still booting: scan and use DHCP.
+        // The record is kept, so the next attempt tries the fast path again.
+        LOG_WIFI("Fast connect failed (status: %d) - falling back to full scan", status);
+        WiFi.disconnect();
+        _connectStartTime = millis();
+        beginFull();
+    }
     else if (status == WL_CONNECT_FAILED ||
              status == WL_NO_SSID_AVAIL ||
              (millis() - _connectStartTime > WIFI_CONNECT_TIMEOUT_MS)) {
@@ -205,10 +379,52 @@ void WifiManager::startReconnect() {
     LOG_WIFI("Reconnection attempt %d/%d", _reconnectAttempts, WIFI_MAX_RECONNECT_ATTEMPTS);
 
     WiFi.disconnect();
-    delay(100);
-    _state = WifiState::CONNECTING;
-    _connectStartTime = millis();
-    WiFi.begin(_ssid.c_str(), _password.c_str());
+    begin();
+}
+
+void WifiManager::startLeaseConfirm() {
+    struct netif* netif = staNetif();
+    if (!netif || tcpip_callback(dhcpStartInPlace, netif) != ERR_OK) {
+        return;
+    }
+    _leaseReused = false;
+    _leaseConfirming = true;
+    _dhcpInPlace = true;
+    LOG_WIFI("Confirming cached DHCP lease");
+}
+
+void WifiManager::stopLeaseConfirm() {
+    // esp_netif doesn't know about the client started in place, so
+    // WiFi.config() wouldn't stop it before applying a static address
+    struct netif* netif = staNetif();
+    if (_dhcpInPlace && netif) {
+        tcpip_callback(dhcpStop, netif);   // Queued ahead of the WiFi.config() that follows
+    }
+    _dhcpInPlace = false;
+}
+
+void WifiManager::startMdns() {
+    if (_mdnsStarted) {
+        return;
+    }
+    if (MDNS.begin(_hostname.c_str())) {
+        MDNS.addService("http", "tcp", HTTP_PORT);
+        MDNS.addService("famesmartblinds", "tcp", HTTP_PORT);
+        _mdnsStarted = true;
+        LOG_WIFI("mDNS started: %s.local", _hostname.c_str());
+    }
+}
+
+void WifiManager::publishState() {
+    _lastRssiPublish = millis();
+    if (isConnected()) {
+        char ip[16];
+        IPAddress addr = WiFi.localIP();
+        snprintf(ip, sizeof(ip), "%u.%u.%u.%u", addr[0], addr[1], addr[2], addr[3]);
+        deviceState.publishWifi(true, _ssid.c_str(), WiFi.RSSI(), ip);
+    } else {
+        deviceState.publishWifi(false, _ssid.c_str(), 0, "");
+    }
 }
 
 String WifiManager::getHostname() const {
@@ -220,4 +436,13 @@ void WifiManager::setHostname(const String& hostname) {
     _hostname.replace(" ", "-");
     _hostname.toLowerCase();
     WiFi.setHostname(_hostname.c_str());
+
+    // Re-announce under the new name
+    if (_mdnsStarted) {
+        MDNS.end();
+        _mdnsStarted = false;
+        if (isConnected()) {
+            startMdns();
+        }
+    }
 }
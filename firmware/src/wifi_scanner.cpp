@@ -0,0 +1,200 @@
+#include "wifi_scanner.h"
+#include "logger.h"
+#include "buffer_writer.h"
+#include <WiFi.h>
+
+static uint32_t fnv1a(const char* text, size_t length) {
+    uint32_t hash = 2166136261UL;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (uint8_t)text[i];
+        hash *= 16777619UL;
+    }
+    return hash;
+}
+
+WifiScanner::WifiScanner()
+    : _count(0)
+    , _scanning(false)
+    , _streaming(false)
+    , _channel(0)
+    , _page(0)
+    , _channelStart(0)
+    , _completedAt(0)
+    , _hasCache(false)
+{
+}
+
+void WifiScanner::start() {
+    // Every request streams the whole table from page 0
+    for (int i = 0; i < _count; i++) {
+        _entries[i].pending = true;
+    }
+    _page = 0;
+    _streaming = true;
+
+    if (_scanning) {
+        LOG_WIFI("WiFi scan already running - resending %d networks found so far", _count);
+        return;
+    }
+
+    if (_hasCache && millis() - _completedAt < WIFI_SCAN_CACHE_TTL_MS) {
+        LOG_WIFI("Replaying cached WiFi scan (%d networks, %lus old)",
+                 _count, (millis() - _completedAt) / 1000);
+        return;
+    }
+
+    LOG_WIFI("Starting WiFi scan (%d channels)", WIFI_SCAN_CHANNELS);
+    _count = 0;
+    _scanning = true;
+    _channel = 1;
+    startChannel();
+}
+
+void WifiScanner::startChannel() {
+    _channelStart = millis();
+    int16_t result = WiFi.scanNetworks(true, false, false, WIFI_SCAN_MS_PER_CHANNEL, _channel);
+    if (result == WIFI_SCAN_FAILED) {
+        LOG_WARN(WIFI, "Scan of channel %d could not be started", _channel);
+    }
+}
+
+void WifiScanner::update() {
+    if (!_scanning) {
+        return;
+    }
+
+    int16_t result = WiFi.scanComplete();
+    if (result == WIFI_SCAN_RUNNING) {
+        if (millis() - _channelStart < WIFI_SCAN_CHANNEL_TIMEOUT_MS) {
+            return;
+        }
+        LOG_WARN(WIFI, "Scan of channel %d timed out", _channel);
+    } else if (result >= 0) {
+        // Read the driver's records in place (no String per network)
+        for (int16_t i = 0; i < result; i++) {
+            wifi_ap_record_t* ap = (wifi_ap_record_t*)WiFi.getScanInfoByIndex(i);
+            if (ap) {
+                merge(ap->ssid, ap->rssi, ap->primary, ap->authmode != WIFI_AUTH_OPEN);
+            }
+        }
+        LOG_DEBUG(WIFI, "Channel %d: %d networks", _channel, result);
+    }
+    WiFi.scanDelete();
+
+    if (_channel >= WIFI_SCAN_CHANNELS) {
+        finish();
+    } else {
+        _channel++;
+        startChannel();
+    }
+}
+
+void WifiScanner::finish() {
+    _scanning = false;
+    _hasCache = true;
+    _completedAt = millis();
+    LOG_WIFI("WiFi scan complete - %d networks", _count);
+}
+
+void WifiScanner::merge(const uint8_t* ssid, int rssi, uint8_t channel, bool encrypted) {
+    const char* name = (const char*)ssid;
+    size_t length = strnlen(name, sizeof(_entries[0].ssid) - 1);
+    if (length == 0) {
+        return;  // Hidden network
+    }
+    uint32_t hash = fnv1a(name, length);
+
+    int weakest = -1;
+    for (int i = 0; i < _count; i++) {
+        WifiScanEntry& entry = _entries[i];
+        if (entry.hash == hash && strncmp(entry.ssid, name, length) == 0 && entry.ssid[length] == '\0') {
+            // Same SSID from another AP or channel: keep (and resend) the stronger one
+            if (rssi > entry.rssi) {
+                entry.rssi = rssi;
+                entry.channel = channel;
+                entry.pending = true;
+            }
+            return;
+        }
+        if (weakest < 0 || entry.rssi < _entries[weakest].rssi) {
+            weakest = i;
+        }
+    }
+
+    WifiScanEntry* slot;
+    if (_count < WIFI_SCAN_MAX_NETWORKS) {
+        slot = &_entries[_count++];
+    } else if (rssi > _entries[weakest].rssi) {
+        slot = &_entries[weakest];  // Full (dense building): drop the weakest
+    } else {
+        return;
+    }
+
+    memcpy(slot->ssid, name, length);
+    slot->ssid[length] = '\0';
+    slot->hash = hash;
+    slot->rssi = rssi;
+    slot->channel = channel;
+    slot->encrypted = encrypted;
+    slot->pending = true;
+}
+
+size_t WifiScanner::nextPage(char* buffer, size_t size) {
+    if (!_streaming) {
+        return 0;
+    }
+
+    static const size_t PAGE_TAIL = 10;   // ],"d":1}
+    BufferWriter out(buffer, size);
+    out.printf("{\"i\":%u,\"n\":[", _page);
+
+    // Strongest pending networks first, as many as fit
+    int written = 0;
+    for (;;) {
+        int best = -1;
+        for (int i = 0; i < _count; i++) {
+            if (_entries[i].pending && (best < 0 || _entries[i].rssi > _entries[best].rssi)) {
+                best = i;
+            }
+        }
+        if (best < 0) {
+            break;
+        }
+
+        WifiScanEntry& entry = _entries[best];
+        char item[192];
+        BufferWriter itemOut(item, sizeof(item));
+        itemOut.print(written > 0 ? ",{\"s\":" : "{\"s\":");
+        itemOut.jsonString(entry.ssid);
+        itemOut.printf(",\"r\":%d,\"e\":%d}", entry.rssi, entry.encrypted ? 1 : 0);
+
+        if (out.length() + itemOut.length() + PAGE_TAIL >= size) {
+            if (written == 0) {
+                // Can never fit, even alone
+                LOG_WARN(WIFI, "Skipping network '%s': page too small", entry.ssid);
+                entry.pending = false;
+                continue;
+            }
+            break;
+        }
+        out.print(item);
+        entry.pending = false;
+        written++;
+    }
+
+    bool more = false;
+    for (int i = 0; i < _count && !more; i++) {
+        more = _entries[i].pending;
+    }
+    bool done = !_scanning && !more;
+    if (written == 0 && !done) {
+        return 0;  // Wait for the next channel
+    }
+
+    out.printf("],\"d\":%d}", done ? 1 : 0);
+    _page++;
+    if (done) {
+        _streaming = false;
+    }
+    return out.length();
+}
@@ -0,0 +1,334 @@
+#ifndef MOTION_SIM_H
+#define MOTION_SIM_H
+
+#include <stdlib.h>
+#include "config.h"
+#include "hall_debounce.h"
+#include "motion_profile.h"
+#include "sim_servo.h"
+
+struct MoveResult {
+    double stopError;       // Final resting position minus the requested one (counts)
+    int32_t trackingError;  // Tracked cumulative position minus ground truth at rest
+    uint32_t samples;
+    uint32_t speedWrites;
+    bool stalled;           // LoadMonitor stopped the move
+    int64_t stallUs;        // Sim time the stop was decided
+    int peakRampLoad;
+    int peakCruiseLoad;
+};
+
+struct RecoveryResult {
+    bool homed;             // The hall edge was confirmed and the frame re-based
+    bool completed;         // HomingRecovery finished (at home or back at the target)
+    bool stalled;
+    double homeError;       // Tracked home minus the true magnet edge (counts)
+    double stopError;       // Final resting position minus the target, from the true edge
+    int64_t durationUs;
+    uint32_t speedWrites;
+};
+
+// The motion task run against a SimServo, with the firmware's own tracking
+// and decision units: PositionTracker, stoppingDistance(), approachCommand(),
+// LoadMonitor, HallDebounce and HomingRecovery, on the same config.h tuning.
+// The sim stands in for the bus (SimServo), the hall GPIO (SimHall, polled
+// every HALL_POLL_US like the CHANGE interrupt firing) and the clock.
+//
+// Still hand-written here, mirroring ServoController/HallSensor: the task
+// schedule (a fixed sample period, plus an immediate sample when a hall edge
+// wakes the task), loop() running debounceEdge() every LOOP_INTERVAL_MS, the
+// checkHomeEdge() stop/resume writes, the speed sign per direction, and the
+// state transitions and storage writes around each move.
+class MotionSim {
+public:
+    MotionSim(SimServo& servo, uint32_t sampleUs, uint8_t acc = SERVO_ACCELERATION)
+        : _servo(servo), _sampleUs(sampleUs), _acc(acc)
+        , _origin(servo.position()), _rebased(0), _samples(0)
+        , _debounce(HALL_DEBOUNCE_US), _hall(nullptr) {
+        // setStorage(): the first reading only seeds the encoder
+        _tracker.reset(0);
+        readSample();
+        _samples = 0;
+    }
+
+    // Feed HallDebounce from a hall sensor between samples like the ISR: the
+    // edge that starts a candidate latches the last sample's position and time
+    // (setPositionSnapshot()) and wakes the motion task
+    void attachHall(SimHall* hall) {
+        _hall = hall;
+        _hallHigh = hall->read(_servo.position(), _servo.nowUs());
+        _nextLoopUs = _servo.nowUs() + LOOP_INTERVAL_MS * 1000;
+        clearTriggered();
+    }
+
+    // One motion sample, ahead of schedule if a hall edge wakes the task
+    void sample() {
+        if (_hall) {
+            int64_t due = _servo.nowUs() + _sampleUs;
+            while (_servo.nowUs() < due) {
+                _servo.advance(HALL_POLL_US);
+                if (pollHall()) {
+                    break;
+                }
+            }
+        } else {
+            _servo.advance(_sampleUs);
+        }
+        readSample();
+    }
+
+    // HallSensor state
+    bool edgeCaptured() const { return _debounce.pending() || _triggered; }
+    bool homeTriggered() const { return _triggered; }
+    int32_t triggerPosition() const { return _triggerPosition; }
+
+    // Ground truth relative to where tracking started
+    double travelled() const { return _servo.position() - _origin; }
+
+    // OPEN/CLOSE toward a calibrated limit (limitAhead() in the controller)
+    MoveResult runToLimit(int32_t limit, int16_t speed) {
+        float accel = MotionProfile::accelerationFromRegister(_acc);
+        int direction = limit >= _tracker.position() ? 1 : -1;
+        _servo.writeSpeed((int16_t)(direction * speed), _acc);
+        beginMove(speed, accel);
+
+        for (uint32_t i = 0; i < MAX_SAMPLES; i++) {
+            sample();
+            if (stallCheck(speed)) {
+                break;
+            }
+            int32_t remaining = direction * (limit - _tracker.position());
+            if (remaining <= stopDistance(accel)) {
+                break;
+            }
+        }
+        _servo.writeSpeed(0, _acc);
+        return settle(limit);
+    }
+
+    // POSITION/GOTO (moveToPosition() and updateApproach() in the controller)
+    MoveResult runToTarget(int32_t target, uint16_t cruiseSpeed) {
+        float accel = MotionProfile::accelerationFromRegister(_acc);
+        float decel = MotionProfile::approachDeceleration(accel);
+        int direction = target >= _tracker.position() ? 1 : -1;
+        uint16_t commanded = 0;
+        beginMove(cruiseSpeed, accel);
+
+        // First profile step straight from the command, then one per sample
+        for (uint32_t i = 0; i < MAX_SAMPLES; i++) {
+            if (i > 0) {
+                sample();
+                if (stallCheck(commanded)) {
+                    break;
+                }
+            }
+            int32_t distance = direction * (target - _tracker.position());
+            uint16_t speed = MotionProfile::approachCommand(distance, stopDistance(accel), cruiseSpeed,
+                                                            decel, commanded);
+            if (speed == 0) {
+                break;
+            }
+            if (speed != commanded) {
+                commanded = speed;
+                _servo.writeSpeed((int16_t)(direction * speed), _acc);
+            }
+        }
+        _servo.writeSpeed(0, _acc);
+        return settle(target);
+    }
+
+    // Power-outage recovery (startRecovery() and update() in the controller):
+    // home toward lower positions until the hall edge at homeAt confirms, then
+    // return to target in the re-based frame. Needs attachHall().
+    RecoveryResult runRecovery(int32_t target, uint16_t speed, double homeAt) {
+        float accel = MotionProfile::accelerationFromRegister(_acc);
+        HomingRecovery recovery;
+        recovery.start(target);
+        clearTriggered();
+        int64_t startUs = _servo.nowUs();
+        uint32_t startWrites = _servo.writes();
+
+        bool homed = false;
+        bool stalled = false;
+        _servo.writeSpeed((int16_t)-speed, _acc);
+        beginMove(speed, accel);
+
+        for (uint32_t i = 0; i < MAX_SAMPLES && recovery.active(); i++) {
+            sample();
+
+            bool homeFound = !recovery.returning() && checkHomeEdge((int16_t)-speed);
+            homed = homed || homeFound;
+            HomingRecovery::Step step = recovery.sample(homeFound, _tracker.position(), stopDistance(accel));
+            if (step == HomingRecovery::Step::RETURN_TO_TARGET) {
+                beginMove(speed, accel);
+                _servo.writeSpeed((int16_t)speed, _acc);
+            } else if (step == HomingRecovery::Step::DONE_AT_TARGET) {
+                _servo.writeSpeed(0, _acc);
+            }
+
+            if (recovery.active() && stallCheck(_hallStopIssued ? 0 : speed)) {
+                stalled = true;
+                recovery.cancel();
+            }
+        }
+        bool completed = !recovery.active() && !stalled;
+        _servo.writeSpeed(0, _acc);
+        while (!_servo.atRest()) {
+            sample();
+        }
+
+        // Position frame origin in ground truth
+        double home = floor(_origin) + _rebased;
+        RecoveryResult result;
+        result.homed = homed;
+        result.completed = completed;
+        result.stalled = stalled;
+        result.homeError = home - homeAt;
+        result.stopError = _servo.position() - homeAt - target;
+        result.durationUs = _servo.nowUs() - startUs;
+        result.speedWrites = _servo.writes() - startWrites;
+        return result;
+    }
+
+    int32_t cumulative() const { return _tracker.position(); }
+    float velocity() const { return _tracker.velocity(); }
+
+private:
+    static const uint32_t MAX_SAMPLES = 200000;
+    static const uint32_t HALL_POLL_US = 100;
+
+    SimServo& _servo;
+    uint32_t _sampleUs;
+    uint8_t _acc;
+    double _origin;
+    int64_t _rebased;           // Sum of rebase() origins since the start
+    uint32_t _samples;
+    PositionTracker _tracker;
+
+    LoadMonitor _monitor;
+    int64_t _moveStartUs = 0;
+    int64_t _stallUs = -1;
+
+    // HallSensor and the checkHomeEdge() flag
+    HallDebounce _debounce;
+    SimHall* _hall;
+    bool _hallHigh = true;
+    int64_t _nextLoopUs = 0;
+    bool _triggered = false;
+    int32_t _triggerPosition = 0;
+    int32_t _snapshotPosition = 0;
+    int64_t _snapshotUs = 0;
+    float _snapshotVelocity = 0.0f;
+    int32_t _edgeSnapshotPosition = 0;
+    int64_t _edgeSnapshotUs = 0;
+    bool _hallStopIssued = false;
+
+    // readServoStatus() + updateCumulativePosition() + setPositionSnapshot()
+    void readSample() {
+        _tracker.update(_servo.readRaw(), (uint32_t)_servo.nowUs());
+        _samples++;
+        _snapshotPosition = _tracker.position();
+        _snapshotUs = _servo.nowUs();
+        _snapshotVelocity = _tracker.velocity();
+    }
+
+    // The pin between samples: edges go to the ISR path, and loop() runs
+    // debounceEdge() on its own period. Returns true when an edge wakes the task.
+    bool pollHall() {
+        int64_t nowUs = _servo.nowUs();
+        bool high = _hall->read(_servo.position(), nowUs);
+        bool woke = false;
+        if (high != _hallHigh) {
+            _hallHigh = high;
+            if (!_triggered && _debounce.onEdge(!high, nowUs)) {
+                _edgeSnapshotPosition = _snapshotPosition;
+                _edgeSnapshotUs = _snapshotUs;
+                woke = true;
+            }
+        }
+
+        if (nowUs >= _nextLoopUs) {
+            _nextLoopUs += LOOP_INTERVAL_MS * 1000;
+            if (_debounce.pending() && !_triggered &&
+                _debounce.poll(!high, nowUs) == HallDebounce::Result::CONFIRMED) {
+                float sinceSnapshot = (_debounce.edgeTimeUs() - _edgeSnapshotUs) / 1000000.0f;
+                _triggerPosition = MotionProfile::extrapolate(_edgeSnapshotPosition, _snapshotVelocity,
+                                                              sinceSnapshot);
+                _triggered = true;
+            }
+        }
+        return woke;
+    }
+
+    void clearTriggered() {
+        _triggered = false;
+        _debounce.reset();
+        _hallStopIssued = false;
+    }
+
+    // checkHomeEdge() in the controller; homingSpeed is the signed resume speed
+    bool checkHomeEdge(int16_t homingSpeed) {
+        if (_triggered) {
+            if (!_hallStopIssued) {
+                _servo.writeSpeed(0, _acc);
+            }
+            _hallStopIssued = false;
+            _tracker.rebase(_triggerPosition);
+            _rebased += _triggerPosition;
+            return true;
+        }
+
+        if (_debounce.pending()) {
+            if (!_hallStopIssued) {
+                _servo.writeSpeed(0, _acc);
+                _hallStopIssued = true;
+            }
+        } else if (_hallStopIssued) {
+            _hallStopIssued = false;
+            _servo.writeSpeed(homingSpeed, _acc);
+        }
+        return false;
+    }
+
+    int32_t stopDistance(float accel) const {
+        return MotionProfile::stoppingDistance(_tracker.velocity(), accel, MOTION_STOP_LATENCY_MS);
+    }
+
+    // beginMove() / checkStall() in the controller
+    void beginMove(uint16_t speed, float accel) {
+        _moveStartUs = _servo.nowUs();
+        _stallUs = -1;
+        _monitor.reset(accel > 0.0f ? (uint32_t)(speed * 1000.0f / accel) : 0);
+    }
+
+    bool stallCheck(uint16_t commanded) {
+        uint32_t elapsedMs = (uint32_t)((_servo.nowUs() - _moveStartUs) / 1000);
+        if (!_monitor.sample(elapsedMs, _tracker.velocity(), commanded, _servo.readLoad())) {
+            return false;
+        }
+        _stallUs = _servo.nowUs();
+        return true;
+    }
+
+    // Keep sampling through the stop ramp (checkSettled() in the controller)
+    MoveResult settle(int32_t requested) {
+        while (!_servo.atRest()) {
+            sample();
+        }
+        sample();
+
+        MoveResult result;
+        result.stopError = travelled() - requested;
+        result.trackingError = _tracker.position() -
+                               (int32_t)(floor(_servo.position()) - floor(_origin) - _rebased);
+        result.samples = _samples;
+        result.speedWrites = _servo.writes();
+        result.stalled = _monitor.stalled();
+        result.stallUs = _stallUs;
+        result.peakRampLoad = _monitor.peakRampLoad();
+        result.peakCruiseLoad = _monitor.peakCruiseLoad();
+        return result;
+    }
+};
+
+#endif // MOTION_SIM_H
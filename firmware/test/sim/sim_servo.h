@@ -0,0 +1,166 @@
+#ifndef SIM_SERVO_H
+#define SIM_SERVO_H
+
+#include <math.h>
+#include <stdint.h>
+#include "motion_profile.h"
+
+// Simulated STS servo in wheel (speed) mode, as seen from the bus: speed
+// commands take effect after the bus latency and are reached through the
+// servo's own acceleration ramp; the position register wraps at 4096.
+class SimServo {
+public:
+    explicit SimServo(int32_t startRaw = 2048, uint32_t busLatencyUs = 1000)
+        : _position(startRaw), _velocity(0.0), _target(0.0), _accel(0.0)
+        , _pendingSpeed(0), _pendingAccel(0), _pendingAtUs(-1), _busLatencyUs(busLatencyUs)
+        , _nowUs(0), _writes(0), _firstMotionUs(-1)
+        , _cruiseLoad(0), _rampLoad(0), _hasJam(false), _jamAt(0.0), _jamLoad(0), _jammed(false), _jammedUs(-1) {}
+
+    // Present load (0.1% of max torque) while cruising and while ramping
+    void setLoad(int cruiseLoad, int rampLoad) {
+        _cruiseLoad = cruiseLoad;
+        _rampLoad = rampLoad;
+    }
+
+    // An obstruction at this (unwrapped) position: driving into it holds the
+    // servo there reading jamLoad (0 models the overload protection cutting torque)
+    void jamAt(double position, int jamLoad = 1000) {
+        _hasJam = true;
+        _jamAt = position;
+        _jamLoad = jamLoad;
+    }
+
+    // WriteSpe(id, speed, acc): steps/s, acc in 100 steps/s^2 (0 = no ramp)
+    void writeSpeed(int16_t speed, uint8_t acc) {
+        _pendingSpeed = speed;
+        _pendingAccel = MotionProfile::accelerationFromRegister(acc);
+        _pendingAtUs = _nowUs + _busLatencyUs;
+        _writes++;
+    }
+
+    // Integrate in 100 us steps
+    void advance(uint32_t micros) {
+        int64_t end = _nowUs + micros;
+        while (_nowUs < end) {
+            int64_t step = end - _nowUs < 100 ? end - _nowUs : 100;
+            if (_pendingAtUs >= 0 && _nowUs >= _pendingAtUs) {
+                _target = _pendingSpeed;
+                _accel = _pendingAccel;
+                _pendingAtUs = -1;
+            }
+
+            double dt = step / 1e6;
+            if (_accel <= 0.0) {
+                _velocity = _target;
+            } else if (_velocity < _target) {
+                _velocity = fmin(_velocity + _accel * dt, _target);
+            } else if (_velocity > _target) {
+                _velocity = fmax(_velocity - _accel * dt, _target);
+            }
+            double next = _position + _velocity * dt;
+            if (_hasJam && ((_position < _jamAt && next >= _jamAt) || (_position > _jamAt && next <= _jamAt))) {
+                _jamDirection = _velocity > 0.0 ? 1 : -1;
+                _jammed = true;
+                _jammedUs = _nowUs;
+                next = _jamAt;
+            }
+            if (_jammed) {
+                if (_target * _jamDirection > 0.0) {
+                    _velocity = 0.0;
+                    next = _jamAt;
+                } else {
+                    _jammed = false;
+                }
+            }
+            _position = next;
+            _nowUs += step;
+
+            if (_firstMotionUs < 0 && _velocity != 0.0) {
+                _firstMotionUs = _nowUs;
+            }
+        }
+    }
+
+    // Present position register (FeedBack + ReadPos), 0-4095
+    int32_t readRaw() const {
+        int32_t counts = (int32_t)floor(_position);
+        return ((counts % 4096) + 4096) % 4096;
+    }
+
+    // Present load register, signed like the direction of travel
+    int readLoad() const {
+        if (_jammed) {
+            return _jamDirection * _jamLoad;
+        }
+        if (_velocity == 0.0) {
+            return 0;
+        }
+        int sign = _velocity > 0.0 ? 1 : -1;
+        return sign * (_velocity != _target ? _rampLoad : _cruiseLoad);
+    }
+
+    // Ground truth, never wrapped
+    double position() const { return _position; }
+    double velocity() const { return _velocity; }
+    bool atRest() const { return _velocity == 0.0 && _target == 0.0 && _pendingAtUs < 0; }
+
+    int64_t nowUs() const { return _nowUs; }
+    uint32_t writes() const { return _writes; }
+    int64_t firstMotionUs() const { return _firstMotionUs; }
+    int64_t jammedUs() const { return _jammedUs; }
+
+private:
+    double _position;
+    double _velocity;
+    double _target;
+    double _accel;
+
+    int16_t _pendingSpeed;
+    float _pendingAccel;
+    int64_t _pendingAtUs;
+    uint32_t _busLatencyUs;
+
+    int64_t _nowUs;
+    uint32_t _writes;
+    int64_t _firstMotionUs;
+
+    int _cruiseLoad;
+    int _rampLoad;
+    bool _hasJam;
+    double _jamAt;
+    int _jamLoad;
+    int _jamDirection = 0;
+    bool _jammed;
+    int64_t _jammedUs;
+};
+
+// Simulated hall sensor: LOW while the magnet, a window of positions on the
+// blind, is over the sensor. Entering the window may bounce for a while.
+class SimHall {
+public:
+    SimHall(double magnetStart, double magnetEnd, uint32_t bounceUs = 0)
+        : _start(magnetStart), _end(magnetEnd), _bounceUs(bounceUs), _enteredUs(-1) {}
+
+    // Pin level at this instant (true = HIGH, no magnet)
+    bool read(double position, int64_t nowUs) {
+        bool inside = position >= _start && position <= _end;
+        if (!inside) {
+            _enteredUs = -1;
+            return true;
+        }
+        if (_enteredUs < 0) {
+            _enteredUs = nowUs;
+        }
+        // Toggle every 200 us while bouncing
+        int64_t since = nowUs - _enteredUs;
+        return since < (int64_t)_bounceUs && (since / 200) % 2 == 1;
+    }
+
+private:
+    double _start;
+    double _end;
+    uint32_t _bounceUs;
+    int64_t _enteredUs;
+};
+
+#endif // SIM_SERVO_H
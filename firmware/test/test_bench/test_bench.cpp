@@ -0,0 +1,266 @@
+#include <unity.h>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "buffer_writer.h"
+#include "command.h"
+#include "log_history.h"
+#include "motion_sim.h"
+#include "status_json.h"
+
+// Host benchmarks for the firmware core. Timings are host nanoseconds, only
+// meaningful relative to earlier runs on the same machine; the budgets are
+// loose ceilings that catch order-of-magnitude regressions. Motion figures
+// come from the simulation and are deterministic.
+
+static double nanosPerCall(int iterations, void (*fn)()) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        fn();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+
+static char statusBuffer[STATUS_BUFFER_SIZE];
+static volatile size_t sink;
+
+static DeviceStateSnapshot statusState;
+static SseClientStats statusClients[3];
+
+static void statusFixture() {
+    statusState = DeviceStateSnapshot();
+    statusState.blindState = "opening";
+    statusState.position = 1234;
+    statusState.cumulativePosition = 23456;
+    statusState.maxPosition = 40960;
+    statusState.calibrated = true;
+    statusState.calibrationState = "idle";
+    strcpy(statusState.wifiSsid, "Home \"Network\"");
+    statusState.wifiRssi = -61;
+    strcpy(statusState.wifiIp, "192.168.1.42");
+    statusState.servoConnected = true;
+    statusState.servo.speed = 500;
+    statusState.servo.load = -120;
+    statusState.servo.voltage = 121;
+    statusState.servo.temperature = 38;
+    statusState.servo.valid = true;
+    for (SseClientStats& client : statusClients) {
+        client = {1, 3, 17, 0};
+    }
+}
+
+// The document HttpServer::currentStatus() serves, from the same renderer
+static void renderStatusDocument() {
+    BufferWriter out(statusBuffer, sizeof(statusBuffer));
+    StatusJson::render(out, statusState);
+    sink = out.length();
+}
+
+// The runtime block of /info
+static void renderRuntimeBlock() {
+    BufferWriter out(statusBuffer, sizeof(statusBuffer));
+    StatusJson::renderRuntime(out, statusState, statusClients, 3, 0, 2, 86400);
+    sink = out.length();
+}
+
+// Log history as /logs streams it: AsyncWebServer asks for one TCP segment at a time
+static LogHistory logHistory;
+static uint8_t logChunk[1460];
+static char logDocument[LOG_BUFFER_SIZE * (2 * LOG_ENTRY_SIZE + 4) + 64];
+
+static size_t streamLogs(uint32_t since) {
+    LogCursor cursor;
+    logHistory.begin(cursor, since);
+    size_t total = 0;
+    size_t n;
+    while ((n = logHistory.fill(cursor, logChunk, sizeof(logChunk))) > 0) {
+        memcpy(logDocument + total, logChunk, n);
+        total += n;
+    }
+    logDocument[total] = '\0';
+    return total;
+}
+
+static bool startsWith(const char* text, const char* prefix) {
+    return strncmp(text, prefix, strlen(prefix)) == 0;
+}
+
+static void streamAllLogs() {
+    sink = streamLogs(0);
+}
+
+static void parseCommands() {
+    static const char* const texts[] = {"open", "POSITION:40", "speed:800", "LOGLEVEL:servo=debug", "bogus"};
+    Command command;
+    for (const char* text : texts) {
+        sink = CommandParser::parse(text, strlen(text), command);
+    }
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void bench_status_render() {
+    statusFixture();
+    double ns = nanosPerCall(200000, renderStatusDocument);
+    printf("status document: %.0f ns, %u bytes\n", ns, (unsigned)sink);
+    TEST_ASSERT_LESS_THAN(STATUS_BUFFER_SIZE, (int)sink);
+    TEST_ASSERT_LESS_THAN(50000, (int)ns);
+
+    TEST_ASSERT_EQUAL_STRING(
+        "{\"state\":\"opening\",\"position\":1234,"
+        "\"wifi\":{\"ssid\":\"Home \\\"Network\\\"\",\"rssi\":-61,\"ip\":\"192.168.1.42\"},"
+        "\"calibration\":{\"calibrated\":true,\"cumulativePosition\":23456,\"maxPosition\":40960,"
+        "\"percent\":43,\"state\":\"idle\"},"
+        "\"servo\":{\"connected\":true}}",
+        statusBuffer);
+
+    renderRuntimeBlock();
+    TEST_ASSERT_EQUAL_STRING(
+        "{\"uptime\":86400,"
+        "\"servo\":{\"speed\":500,\"load\":-120,\"voltage\":12.1,\"temperature\":38},"
+        "\"sse\":{\"clients\":[{\"queue\":1,\"maxQueue\":3,\"coalesced\":17,\"dropped\":0},"
+        "{\"queue\":1,\"maxQueue\":3,\"coalesced\":17,\"dropped\":0},"
+        "{\"queue\":1,\"maxQueue\":3,\"coalesced\":17,\"dropped\":0}],"
+        "\"coalesced\":51,\"dropped\":2}}",
+        statusBuffer);
+
+    // Below 1 V the sign has no integer part to carry it
+    statusState.servo.voltage = -5;
+    renderRuntimeBlock();
+    TEST_ASSERT_NOT_NULL(strstr(statusBuffer, "\"voltage\":-0.5,"));
+}
+
+static void bench_logs_json() {
+    // Fill past the ring so the oldest entries have been overwritten
+    logHistory.clear();
+    char entry[LOG_ENTRY_SIZE];
+    for (int i = 1; i <= LOG_BUFFER_SIZE + 10; i++) {
+        snprintf(entry, sizeof(entry), "[%08d] [SERVO] Target %d reached: \"cumPos\"=%d\tC:\\blind\n",
+                 i * 15, i, i * 100);
+        logHistory.add(entry);
+    }
+
+    double ns = nanosPerCall(20000, streamAllLogs);
+    printf("logs document: %.0f ns, %u bytes in %u-byte chunks\n",
+           ns, (unsigned)sink, (unsigned)sizeof(logChunk));
+    TEST_ASSERT_LESS_THAN(200000, (int)ns);
+
+    TEST_ASSERT_TRUE(startsWith(logDocument, "{\"first\":11,\"logs\":[\"[00000165] [SERVO] Target 11 "));
+    TEST_ASSERT_NOT_NULL(strstr(logDocument, ": \\\"cumPos\\\"=1100\\tC:\\\\blind\\n\",\""));
+    const char* footer = "\"],\"next\":60}";
+    TEST_ASSERT_EQUAL_STRING(footer, logDocument + sink - strlen(footer));
+
+    // ?since= returns only newer entries; nothing new is an empty list
+    streamLogs(58);
+    TEST_ASSERT_TRUE(startsWith(logDocument, "{\"first\":11,\"logs\":[\"[00000885] "));
+    streamLogs(60);
+    TEST_ASSERT_EQUAL_STRING("{\"first\":11,\"logs\":[],\"next\":60}", logDocument);
+
+    // Clearing keeps the sequence, so an old cursor stays valid
+    logHistory.clear();
+    logHistory.add("after clear");
+    streamLogs(60);
+    TEST_ASSERT_EQUAL_STRING("{\"first\":61,\"logs\":[\"after clear\"],\"next\":61}", logDocument);
+
+    // Numbering restarts on every boot: a cursor past the last entry is from
+    // before a restart and reads from the oldest entry, with a "next" that is
+    // valid again
+    streamLogs(62);
+    TEST_ASSERT_EQUAL_STRING("{\"first\":61,\"logs\":[\"after clear\"],\"next\":61}", logDocument);
+    streamLogs(1000);
+    TEST_ASSERT_EQUAL_STRING("{\"first\":61,\"logs\":[\"after clear\"],\"next\":61}", logDocument);
+}
+
+static void bench_command_parse() {
+    double ns = nanosPerCall(200000, parseCommands) / 5;
+    printf("command parse: %.0f ns/command\n", ns);
+    TEST_ASSERT_LESS_THAN(5000, (int)ns);
+}
+
+// Stop error at a limit for each speed and sample period. The prediction
+// reserves MOTION_STOP_LATENCY_MS of travel, so with samples at least that
+// often a stop must never run past the limit (end stop) and falls short by at
+// most that reserve. Slower sample periods are reported, not guarded.
+static void bench_stop_error_vs_speed_and_sample_rate() {
+    static const int16_t speeds[] = {250, 500, 1000, 2000, 3000};
+    static const uint32_t samplesMs[] = {5, 10, 15, 30, 50};
+
+    printf("limit stop error (counts), rows = speed, columns = sample period\n%6s", "");
+    for (uint32_t ms : samplesMs) {
+        printf("%7ums", (unsigned)ms);
+    }
+    printf("\n");
+
+    for (int16_t speed : speeds) {
+        printf("%6d", speed);
+        int32_t shortfall = speed * MOTION_STOP_LATENCY_MS / 1000 + MOTION_LIMIT_TOLERANCE;
+        for (uint32_t ms : samplesMs) {
+            SimServo servo(1000);
+            MotionSim sim(servo, ms * 1000);
+            MoveResult result = sim.runToLimit(30011, speed);
+            printf("%+9.1f", result.stopError);
+
+            TEST_ASSERT_EQUAL_INT32(0, result.trackingError);
+            if (ms <= MOTION_STOP_LATENCY_MS) {
+                TEST_ASSERT_LESS_OR_EQUAL(MOTION_LIMIT_TOLERANCE, (int32_t)ceil(result.stopError));
+                TEST_ASSERT_GREATER_OR_EQUAL(-shortfall, (int32_t)floor(result.stopError));
+            }
+        }
+        printf("\n");
+    }
+}
+
+// Power-outage recovery for each speed and sample period: re-home on the real
+// debounce (sensor chatter included), re-base on the extrapolated edge and
+// return to the target. Home is taken from the first edge between two
+// samples, so with samples at least every MOTION_STOP_LATENCY_MS it must land
+// within a few counts of the magnet at any speed; the return then stops like
+// a limit stop. Slower sample periods are reported, not guarded.
+static void bench_recovery_home_repeatability() {
+    static const uint16_t speeds[] = {250, 500, 1000, 2000, 3000};
+    static const uint32_t samplesMs[] = {5, 10, 15, 30, 50};
+    const double homeAt = 4000.0;
+    const int32_t target = 9000;
+
+    printf("recovery home error / return stop error (counts), rows = speed, columns = sample period\n%6s", "");
+    for (uint32_t ms : samplesMs) {
+        printf("%12ums", (unsigned)ms);
+    }
+    printf("\n");
+
+    for (uint16_t speed : speeds) {
+        printf("%6d", speed);
+        int32_t shortfall = speed * MOTION_STOP_LATENCY_MS / 1000 + MOTION_LIMIT_TOLERANCE;
+        for (uint32_t ms : samplesMs) {
+            // Stale stored position: the sim starts 12000 counts above the magnet
+            SimServo servo(16000);
+            SimHall hall(homeAt - 150.0, homeAt, 1500);
+            MotionSim sim(servo, ms * 1000);
+            sim.attachHall(&hall);
+            RecoveryResult result = sim.runRecovery(target, speed, homeAt);
+            printf("%+7.1f/%+6.1f", result.homeError, result.stopError);
+
+            TEST_ASSERT_TRUE(result.homed);
+            TEST_ASSERT_TRUE(result.completed);
+            if (ms <= MOTION_STOP_LATENCY_MS) {
+                TEST_ASSERT_LESS_OR_EQUAL(3, (int32_t)ceil(fabs(result.homeError)));
+                TEST_ASSERT_LESS_OR_EQUAL(MOTION_LIMIT_TOLERANCE + 3, (int32_t)ceil(result.stopError));
+                TEST_ASSERT_GREATER_OR_EQUAL(-shortfall - 3, (int32_t)floor(result.stopError));
+            }
+        }
+        printf("\n");
+    }
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(bench_status_render);
+    RUN_TEST(bench_logs_json);
+    RUN_TEST(bench_command_parse);
+    RUN_TEST(bench_stop_error_vs_speed_and_sample_rate);
+    RUN_TEST(bench_recovery_home_repeatability);
+    return UNITY_END();
+}
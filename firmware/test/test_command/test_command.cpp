@@ -0,0 +1,77 @@
+#include <unity.h>
+#include <string.h>
+#include "command.h"
+
+static bool parse(const char* text, Command& out) {
+    return CommandParser::parse(text, strlen(text), out);
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_plain_names_case_insensitive() {
+    Command command;
+    TEST_ASSERT_TRUE(parse("open", command));
+    TEST_ASSERT_EQUAL(CommandId::OPEN, command.id);
+    TEST_ASSERT_TRUE(parse("  Close\r\n", command));
+    TEST_ASSERT_EQUAL(CommandId::CLOSE, command.id);
+    TEST_ASSERT_TRUE(parse("CALIBRATE_SETBOTTOM", command));
+    TEST_ASSERT_EQUAL(CommandId::CALIBRATE_SETBOTTOM, command.id);
+}
+
+static void test_numeric_arguments_are_range_checked() {
+    Command command;
+    TEST_ASSERT_TRUE(parse("POSITION:40", command));
+    TEST_ASSERT_EQUAL(CommandId::POSITION, command.id);
+    TEST_ASSERT_EQUAL_INT32(40, command.value);
+
+    TEST_ASSERT_FALSE(parse("POSITION:101", command));
+    TEST_ASSERT_FALSE(parse("POSITION:", command));
+    TEST_ASSERT_FALSE(parse("POSITION:-1", command));
+    TEST_ASSERT_FALSE(parse("SPEED:4096", command));
+    TEST_ASSERT_TRUE(parse("SPEED:4095", command));
+    TEST_ASSERT_FALSE(parse("GOTO:1234567890", command));
+}
+
+static void test_unknown_and_unexpected_arguments_rejected() {
+    Command command;
+    TEST_ASSERT_FALSE(parse("", command));
+    TEST_ASSERT_FALSE(parse("OPENX", command));
+    TEST_ASSERT_FALSE(parse("OPEN:1", command));
+    TEST_ASSERT_FALSE(parse("LOGLEVEL", command));
+}
+
+static void test_text_argument_points_into_buffer() {
+    const char* text = "loglevel:servo=debug";
+    Command command;
+    TEST_ASSERT_TRUE(parse(text, command));
+    TEST_ASSERT_EQUAL(CommandId::LOGLEVEL, command.id);
+    TEST_ASSERT_EQUAL_PTR(text + 9, command.text);
+    TEST_ASSERT_EQUAL(11, command.textLength);
+}
+
+static void test_format_round_trips() {
+    char buffer[32];
+    Command command;
+    TEST_ASSERT_TRUE(parse("position:7", command));
+    TEST_ASSERT_EQUAL_STRING("POSITION:7", CommandParser::format(command, buffer, sizeof(buffer)));
+    TEST_ASSERT_TRUE(parse(buffer, command));
+    TEST_ASSERT_EQUAL_INT32(7, command.value);
+}
+
+static void test_motion_commands() {
+    TEST_ASSERT_TRUE(Command(CommandId::STOP).isMotion());
+    TEST_ASSERT_TRUE(Command(CommandId::POSITION, 50).isMotion());
+    TEST_ASSERT_FALSE(Command(CommandId::RESTART).isMotion());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_plain_names_case_insensitive);
+    RUN_TEST(test_numeric_arguments_are_range_checked);
+    RUN_TEST(test_unknown_and_unexpected_arguments_rejected);
+    RUN_TEST(test_text_argument_points_into_buffer);
+    RUN_TEST(test_format_round_trips);
+    RUN_TEST(test_motion_commands);
+    return UNITY_END();
+}
@@ -0,0 +1,71 @@
+#include <unity.h>
+#include <stdarg.h>
+#include <string.h>
+#include "log_args.h"
+
+// Laid out like a queue slot: the next slot's sequence follows the arguments
+struct GuardedArgs {
+    LogArgs args;
+    uint32_t guard;
+};
+
+static GuardedArgs record;
+static char entry[256];
+
+static const char* captureAndFormat(const char* format, ...) {
+    record.guard = 0xA5A5A5A5;
+    va_list ap;
+    va_start(ap, format);
+    record.args.capture(format, ap);
+    va_end(ap);
+    record.args.format(format, entry, sizeof(entry));
+    return entry;
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_numbers_and_strings_are_captured() {
+    TEST_ASSERT_EQUAL_STRING("pos=-12 speed=800 load=0.5 ip=192.168.1.42 100%",
+                             captureAndFormat("pos=%d speed=%u load=%.1f ip=%s 100%%", -12, 800u, 0.5, "192.168.1.42"));
+    TEST_ASSERT_EQUAL_STRING("t=12345678901 s=(null) [  ab]",
+                             captureAndFormat("t=%lld s=%s [%*s]", 12345678901LL, (const char*)nullptr, 4, "ab"));
+    TEST_ASSERT_EQUAL_STRING("Received on blinds/grp: OPEN",
+                             captureAndFormat("Received on %s: %.*s", "blinds/grp", 4, "OPENxyz"));
+}
+
+static void test_string_space_overflow_stays_in_the_record() {
+    // The first argument takes all of the string space; the rest print empty
+    char longText[LOG_STRING_ARG_BYTES * 2];
+    memset(longText, 'a', sizeof(longText) - 1);
+    longText[sizeof(longText) - 1] = '\0';
+    const char* out = captureAndFormat("%s|%s|%s|%d", longText, "second", "third", 7);
+    TEST_ASSERT_EQUAL_UINT32(0xA5A5A5A5, record.guard);
+    TEST_ASSERT_EQUAL_INT(LOG_STRING_ARG_BYTES - 1 + 4, (int)strlen(out));
+    TEST_ASSERT_EQUAL_STRING("|||7", out + LOG_STRING_ARG_BYTES - 1);
+
+    // Exactly full after two arguments, as a long SSID and device name do
+    char first[LOG_STRING_ARG_BYTES / 2];
+    memset(first, 'x', sizeof(first) - 1);
+    first[sizeof(first) - 1] = '\0';
+    out = captureAndFormat("WiFi: %s, Device: %s, MQTT: %s:%d", first, first, "broker.local", 1883);
+    TEST_ASSERT_EQUAL_UINT32(0xA5A5A5A5, record.guard);
+    TEST_ASSERT_EQUAL_UINT8(LOG_STRING_ARG_BYTES, record.args.stringBytes);
+    TEST_ASSERT_NOT_NULL(strstr(out, ", MQTT: :1883"));
+}
+
+static void test_uncaptured_conversions_are_verbatim() {
+    // An unknown conversion ends capture and the output, its argument type unknown
+    TEST_ASSERT_EQUAL_STRING("a=1 b=%q", captureAndFormat("a=%d b=%q c=%d", 1, 2));
+    // More arguments than LOG_MAX_ARGS
+    TEST_ASSERT_EQUAL_STRING("1 2 3 4 5 6 7 8 %d",
+                             captureAndFormat("%d %d %d %d %d %d %d %d %d", 1, 2, 3, 4, 5, 6, 7, 8, 9));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_numbers_and_strings_are_captured);
+    RUN_TEST(test_string_space_overflow_stays_in_the_record);
+    RUN_TEST(test_uncaptured_conversions_are_verbatim);
+    return UNITY_END();
+}
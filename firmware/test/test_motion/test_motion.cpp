@@ -0,0 +1,376 @@
+#include <unity.h>
+#include <math.h>
+#include "motion_sim.h"
+#include "hall_debounce.h"
+
+void setUp() {}
+void tearDown() {}
+
+static void test_encoder_delta_takes_short_way_round() {
+    TEST_ASSERT_EQUAL_INT32(10, MotionProfile::encoderDelta(100, 110));
+    TEST_ASSERT_EQUAL_INT32(-10, MotionProfile::encoderDelta(110, 100));
+    TEST_ASSERT_EQUAL_INT32(1, MotionProfile::encoderDelta(4095, 0));
+    TEST_ASSERT_EQUAL_INT32(-1, MotionProfile::encoderDelta(0, 4095));
+    TEST_ASSERT_EQUAL_INT32(20, MotionProfile::encoderDelta(4090, 14));
+    TEST_ASSERT_EQUAL_INT32(2048, MotionProfile::encoderDelta(0, 2048));
+}
+
+static void test_tracking_survives_many_revolutions() {
+    // Start right below the wrap so the first samples cross it
+    SimServo servo(4000);
+    MotionSim sim(servo, MOTION_SAMPLE_INTERVAL_MS * 1000);
+
+    servo.writeSpeed(3000, SERVO_ACCELERATION);
+    for (int i = 0; i < 1000; i++) {
+        sim.sample();
+    }
+    int32_t truth = (int32_t)(floor(servo.position()) - 4000);
+    TEST_ASSERT_GREATER_THAN(10 * 4096, truth);
+    TEST_ASSERT_EQUAL_INT32(truth, sim.cumulative());
+
+    servo.writeSpeed(-3000, SERVO_ACCELERATION);
+    for (int i = 0; i < 2000; i++) {
+        sim.sample();
+    }
+    truth = (int32_t)(floor(servo.position()) - 4000);
+    TEST_ASSERT_LESS_THAN(0, truth);
+    TEST_ASSERT_EQUAL_INT32(truth, sim.cumulative());
+}
+
+static void test_stopping_distance() {
+    // 1000 steps/s, 20 ms latency, 5000 steps/s^2 ramp: 20 + 100
+    TEST_ASSERT_EQUAL_INT32(120, MotionProfile::stoppingDistance(1000.0f, 5000.0f, 20));
+    TEST_ASSERT_EQUAL_INT32(120, MotionProfile::stoppingDistance(-1000.0f, 5000.0f, 20));
+    TEST_ASSERT_EQUAL_INT32(20, MotionProfile::stoppingDistance(1000.0f, 0.0f, 20));
+    TEST_ASSERT_EQUAL_INT32(0, MotionProfile::stoppingDistance(0.0f, 5000.0f, 20));
+}
+
+static void test_approach_speed_profile() {
+    TEST_ASSERT_EQUAL_UINT16(1000, MotionProfile::approachSpeed(100000, 1000, 2500.0f, 80));
+    TEST_ASSERT_EQUAL_UINT16(80, MotionProfile::approachSpeed(0, 1000, 2500.0f, 80));
+    TEST_ASSERT_EQUAL_UINT16(80, MotionProfile::approachSpeed(1, 1000, 2500.0f, 80));
+    // sqrt(2 * 2500 * 50) = 500
+    TEST_ASSERT_EQUAL_UINT16(500, MotionProfile::approachSpeed(50, 1000, 2500.0f, 80));
+    // Floor never above the cruise speed
+    TEST_ASSERT_EQUAL_UINT16(50, MotionProfile::approachSpeed(10, 50, 2500.0f, 80));
+}
+
+static void test_position_tracker_seeds_on_first_reading() {
+    // Restored from storage: whatever angle the encoder reports first is not travel
+    PositionTracker tracker;
+    tracker.reset(12000);
+    tracker.update(3000, 1000000);
+    TEST_ASSERT_EQUAL_INT32(12000, tracker.position());
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, tracker.velocity());
+
+    tracker.update(3030, 1015000);
+    TEST_ASSERT_EQUAL_INT32(12030, tracker.position());
+    TEST_ASSERT_EQUAL_FLOAT(1000.0f, tracker.velocity());   // 2000 counts/s, smoothed from 0
+
+    // After reset() the next reading seeds again
+    tracker.reset(500);
+    tracker.update(100, 1030000);
+    TEST_ASSERT_EQUAL_INT32(500, tracker.position());
+}
+
+static void test_position_tracker_wraps_and_rebases() {
+    PositionTracker tracker;
+    tracker.update(4090, 0);
+    tracker.update(10, 15000);
+    TEST_ASSERT_EQUAL_INT32(16, tracker.position());
+    tracker.update(4000, 30000);
+    TEST_ASSERT_EQUAL_INT32(-90, tracker.position());
+
+    // Back-to-back reads move the position but not the velocity
+    float velocity = tracker.velocity();
+    tracker.update(4010, 30500);
+    TEST_ASSERT_EQUAL_INT32(-80, tracker.position());
+    TEST_ASSERT_EQUAL_FLOAT(velocity, tracker.velocity());
+
+    // A long gap restarts the velocity
+    tracker.update(4020, 3000000);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, tracker.velocity());
+
+    // Home edge confirmed at -100 in the old frame
+    tracker.rebase(-100);
+    TEST_ASSERT_EQUAL_INT32(30, tracker.position());
+}
+
+static void test_approach_command() {
+    float decel = MotionProfile::approachDeceleration(MotionProfile::accelerationFromRegister(50));
+    TEST_ASSERT_EQUAL_FLOAT(2500.0f, decel);
+    TEST_ASSERT_EQUAL_FLOAT(MOTION_APPROACH_DEFAULT_DECEL, MotionProfile::approachDeceleration(0.0f));
+
+    // Arrived, passed, or inside the stopping distance
+    TEST_ASSERT_EQUAL_UINT16(0, MotionProfile::approachCommand(MOTION_TARGET_TOLERANCE / 2, 0, 1000, decel, 1000));
+    TEST_ASSERT_EQUAL_UINT16(0, MotionProfile::approachCommand(-50, 0, 1000, decel, 1000));
+    TEST_ASSERT_EQUAL_UINT16(0, MotionProfile::approachCommand(100, 100, 1000, decel, 1000));
+
+    // Cruise from the start, braking at sqrt(2 * 2500 * 50) = 500 past the stop reserve
+    TEST_ASSERT_EQUAL_UINT16(1000, MotionProfile::approachCommand(100000, 20, 1000, decel, 0));
+    TEST_ASSERT_EQUAL_UINT16(500, MotionProfile::approachCommand(70, 20, 1000, decel, 1000));
+
+    // Small changes keep the commanded speed; the floor always goes out
+    TEST_ASSERT_EQUAL_UINT16(510, MotionProfile::approachCommand(70, 20, 1000, decel, 510));
+    TEST_ASSERT_EQUAL_UINT16(MOTION_APPROACH_MIN_SPEED,
+                             MotionProfile::approachCommand(21, 20, 1000, decel, MOTION_APPROACH_MIN_SPEED + 5));
+}
+
+static void test_homing_recovery_steps() {
+    HomingRecovery recovery;
+    TEST_ASSERT_TRUE(recovery.sample(true, 0, 0) == HomingRecovery::Step::NONE);   // Not started
+
+    recovery.start(8000);
+    TEST_ASSERT_TRUE(recovery.active());
+    TEST_ASSERT_TRUE(recovery.sample(false, 500, 0) == HomingRecovery::Step::NONE);
+    TEST_ASSERT_TRUE(recovery.sample(true, 0, 0) == HomingRecovery::Step::RETURN_TO_TARGET);
+    TEST_ASSERT_TRUE(recovery.returning());
+
+    // Returning: stop once the target is within the stopping distance
+    TEST_ASSERT_TRUE(recovery.sample(false, 7800, 150) == HomingRecovery::Step::NONE);
+    TEST_ASSERT_TRUE(recovery.sample(false, 7860, 150) == HomingRecovery::Step::DONE_AT_TARGET);
+    TEST_ASSERT_FALSE(recovery.active());
+
+    // Target was home
+    recovery.start(0);
+    TEST_ASSERT_TRUE(recovery.sample(true, 0, 0) == HomingRecovery::Step::DONE_AT_HOME);
+    TEST_ASSERT_FALSE(recovery.active());
+
+    recovery.start(8000);
+    recovery.cancel();
+    TEST_ASSERT_FALSE(recovery.active());
+    TEST_ASSERT_FALSE(recovery.returning());
+}
+
+static void test_hall_edge_extrapolation() {
+    TEST_ASSERT_EQUAL_INT32(110, MotionProfile::extrapolate(100, 1000.0f, 0.01f));
+    TEST_ASSERT_EQUAL_INT32(90, MotionProfile::extrapolate(100, -1000.0f, 0.01f));
+    TEST_ASSERT_EQUAL_INT32(100, MotionProfile::extrapolate(100, 0.0f, 1.0f));
+}
+
+static void test_hall_edge_is_placed_between_samples() {
+    // Magnet 5000 counts from the start; the sensor bounces for 2 ms on arrival
+    SimServo servo(100);
+    SimHall hall(5100.0, 5200.0, 2000);
+    MotionSim sim(servo, MOTION_SAMPLE_INTERVAL_MS * 1000);
+    sim.attachHall(&hall);
+
+    servo.writeSpeed(1500, SERVO_ACCELERATION);
+    while (!sim.homeTriggered() && sim.travelled() < 6000) {
+        sim.sample();
+    }
+    TEST_ASSERT_TRUE(sim.homeTriggered());
+
+    // 1500 steps/s moves ~22 counts per sample; the edge lands within a few
+    int32_t error = sim.triggerPosition() - 5000;
+    TEST_ASSERT_LESS_OR_EQUAL(3, abs(error));
+}
+
+static void test_hall_debounce_confirms_stable_low() {
+    HallDebounce debounce(5000);
+    TEST_ASSERT_TRUE(debounce.onEdge(true, 1000));
+    TEST_ASSERT_TRUE(debounce.pending());
+    TEST_ASSERT_TRUE(debounce.poll(true, 5999) == HallDebounce::Result::WAITING);
+    TEST_ASSERT_TRUE(debounce.poll(true, 6000) == HallDebounce::Result::CONFIRMED);
+    TEST_ASSERT_FALSE(debounce.pending());
+    TEST_ASSERT_EQUAL_INT64(1000, debounce.edgeTimeUs());
+    TEST_ASSERT_TRUE(debounce.poll(true, 7000) == HallDebounce::Result::IDLE);
+
+    // A rising edge alone (magnet leaving) starts nothing
+    TEST_ASSERT_FALSE(debounce.onEdge(false, 8000));
+    TEST_ASSERT_FALSE(debounce.pending());
+}
+
+static void test_hall_debounce_chatter_restarts_window() {
+    // LOW at the one instant it is polled is not enough: every edge in between
+    // restarts the window, while home stays at the first edge
+    HallDebounce debounce(5000);
+    TEST_ASSERT_TRUE(debounce.onEdge(true, 1000));
+    TEST_ASSERT_FALSE(debounce.onEdge(false, 3000));
+    TEST_ASSERT_FALSE(debounce.onEdge(true, 4000));
+    TEST_ASSERT_TRUE(debounce.poll(true, 6000) == HallDebounce::Result::WAITING);
+    TEST_ASSERT_TRUE(debounce.poll(true, 8999) == HallDebounce::Result::WAITING);
+    TEST_ASSERT_TRUE(debounce.poll(true, 9000) == HallDebounce::Result::CONFIRMED);
+    TEST_ASSERT_EQUAL_INT64(1000, debounce.edgeTimeUs());
+    TEST_ASSERT_EQUAL_UINT16(2, debounce.bounces());
+}
+
+static void test_hall_debounce_rejects_glitch() {
+    HallDebounce debounce(5000);
+    TEST_ASSERT_TRUE(debounce.onEdge(true, 1000));
+    TEST_ASSERT_FALSE(debounce.onEdge(false, 1050));
+    TEST_ASSERT_TRUE(debounce.poll(false, 3000) == HallDebounce::Result::WAITING);
+    TEST_ASSERT_TRUE(debounce.poll(false, 6050) == HallDebounce::Result::REJECTED);
+    TEST_ASSERT_FALSE(debounce.pending());
+
+    // The next arrival starts a fresh candidate
+    TEST_ASSERT_TRUE(debounce.onEdge(true, 20000));
+    TEST_ASSERT_EQUAL_UINT16(0, debounce.bounces());
+}
+
+static void test_limit_stop_never_passes_the_limit() {
+    // Default speed and sample rate, both directions, across the wrap. The stop
+    // may fall short by the travel reserved for MOTION_STOP_LATENCY_MS.
+    SimServo servo(3000);
+    MotionSim sim(servo, MOTION_SAMPLE_INTERVAL_MS * 1000);
+    int32_t shortfall = SERVO_SPEED * MOTION_STOP_LATENCY_MS / 1000 + MOTION_LIMIT_TOLERANCE;
+
+    MoveResult result = sim.runToLimit(20000, SERVO_SPEED);
+    TEST_ASSERT_EQUAL_INT32(0, result.trackingError);
+    TEST_ASSERT_LESS_OR_EQUAL(MOTION_LIMIT_TOLERANCE, (int32_t)ceil(result.stopError));
+    TEST_ASSERT_GREATER_OR_EQUAL(-shortfall, (int32_t)floor(result.stopError));
+
+    // Closing: an overshoot is a negative error
+    result = sim.runToLimit(0, SERVO_SPEED);
+    TEST_ASSERT_EQUAL_INT32(0, result.trackingError);
+    TEST_ASSERT_LESS_OR_EQUAL(MOTION_LIMIT_TOLERANCE, (int32_t)ceil(-result.stopError));
+    TEST_ASSERT_GREATER_OR_EQUAL(-shortfall, (int32_t)floor(-result.stopError));
+}
+
+static void test_targeted_move_does_not_overshoot() {
+    SimServo servo;
+    MotionSim sim(servo, MOTION_SAMPLE_INTERVAL_MS * 1000);
+
+    MoveResult result = sim.runToTarget(12345, 1500);
+    TEST_ASSERT_EQUAL_INT32(0, result.trackingError);
+    TEST_ASSERT_LESS_OR_EQUAL(MOTION_TARGET_TOLERANCE, (int32_t)ceil(fabs(result.stopError)));
+}
+
+static void test_recovery_rehomes_and_returns() {
+    // Stored position is stale by 700 counts; the magnet edge is at 4000 on the
+    // way down. Home comes from the edge, so the return lands on the target.
+    SimServo servo(12000);
+    SimHall hall(3900.0, 4000.0, 1000);
+    MotionSim sim(servo, MOTION_SAMPLE_INTERVAL_MS * 1000);
+    sim.attachHall(&hall);
+
+    RecoveryResult result = sim.runRecovery(5000, SERVO_SPEED, 4000.0);
+    TEST_ASSERT_TRUE(result.homed);
+    TEST_ASSERT_TRUE(result.completed);
+    TEST_ASSERT_FALSE(result.stalled);
+    TEST_ASSERT_LESS_OR_EQUAL(3, (int32_t)ceil(fabs(result.homeError)));
+    int32_t shortfall = SERVO_SPEED * MOTION_STOP_LATENCY_MS / 1000 + MOTION_LIMIT_TOLERANCE;
+    TEST_ASSERT_LESS_OR_EQUAL(MOTION_LIMIT_TOLERANCE, (int32_t)ceil(result.stopError));
+    TEST_ASSERT_GREATER_OR_EQUAL(-shortfall, (int32_t)floor(result.stopError));
+}
+
+static void test_jam_stops_within_a_few_samples() {
+    SimServo servo;
+    servo.setLoad(200, 350);
+    servo.jamAt(2048 + 6000);
+    MotionSim sim(servo, MOTION_SAMPLE_INTERVAL_MS * 1000);
+
+    MoveResult result = sim.runToLimit(20000, SERVO_SPEED);
+    TEST_ASSERT_TRUE(result.stalled);
+    TEST_ASSERT_EQUAL_INT32(0, result.trackingError);
+
+    // Velocity smoothing takes a few samples to fall, then MOTION_STALL_SAMPLES confirm
+    int64_t latencyUs = result.stallUs - servo.jammedUs();
+    TEST_ASSERT_LESS_OR_EQUAL((MOTION_STALL_SAMPLES + 4) * MOTION_SAMPLE_INTERVAL_MS * 1000, (int32_t)latencyUs);
+}
+
+static void test_jam_without_load_reading_still_stops() {
+    // Overload protection has cut torque: no progress, but the load reads 0
+    SimServo servo;
+    servo.jamAt(2048 - 3000, 0);
+    MotionSim sim(servo, MOTION_SAMPLE_INTERVAL_MS * 1000);
+
+    MoveResult result = sim.runToLimit(-20000, SERVO_SPEED);
+    TEST_ASSERT_TRUE(result.stalled);
+    int64_t latencyUs = result.stallUs - servo.jammedUs();
+    TEST_ASSERT_LESS_OR_EQUAL((MOTION_STALL_STILL_MS + 5 * MOTION_SAMPLE_INTERVAL_MS) * 1000, (int32_t)latencyUs);
+}
+
+static void test_heavy_blind_is_not_a_stall() {
+    // Loaded close to the stall threshold, at full speed and while ramping slowly
+    SimServo servo;
+    servo.setLoad(MOTION_STALL_LOAD - 20, 900);
+    MotionSim sim(servo, MOTION_SAMPLE_INTERVAL_MS * 1000, MOTION_ADAPT_MIN_ACCEL);
+
+    MoveResult result = sim.runToLimit(30011, 3000);
+    TEST_ASSERT_FALSE(result.stalled);
+    TEST_ASSERT_GREATER_THAN(MOTION_ADAPT_LOAD_HIGH, result.peakCruiseLoad);
+    TEST_ASSERT_GREATER_THAN(MOTION_ADAPT_LOAD_HIGH, result.peakRampLoad);
+
+    result = sim.runToTarget(2000, 1500);
+    TEST_ASSERT_FALSE(result.stalled);
+}
+
+static void test_profile_adapts_to_load() {
+    DriveProfile profile = {1000, 50};
+
+    // Heavy cruise slows the next move, heavy ramp softens acceleration
+    DriveProfile next = LoadMonitor::adapt(profile, 1000, 50, MOTION_ADAPT_LOAD_HIGH + 1, MOTION_ADAPT_LOAD_HIGH + 1);
+    TEST_ASSERT_EQUAL_UINT16(1000 - MOTION_ADAPT_SPEED_STEP, next.speed);
+    TEST_ASSERT_EQUAL_UINT8(50 - MOTION_ADAPT_ACCEL_STEP, next.acceleration);
+
+    // Light moves climb back, never past the configured ceiling
+    next = LoadMonitor::adapt(next, 1000, 50, 0, 0);
+    next = LoadMonitor::adapt(next, 1000, 50, 0, 0);
+    TEST_ASSERT_EQUAL_UINT16(1000, next.speed);
+    TEST_ASSERT_EQUAL_UINT8(50, next.acceleration);
+
+    // Inside the band nothing changes
+    int mid = (MOTION_ADAPT_LOAD_LOW + MOTION_ADAPT_LOAD_HIGH) / 2;
+    next = LoadMonitor::adapt(profile, 1000, 50, mid, mid);
+    TEST_ASSERT_EQUAL_UINT16(1000, next.speed);
+    TEST_ASSERT_EQUAL_UINT8(50, next.acceleration);
+
+    // Floors hold, and a servo ramp of 0 (none) is left alone
+    profile = {MOTION_ADAPT_MIN_SPEED, MOTION_ADAPT_MIN_ACCEL};
+    next = LoadMonitor::adapt(profile, 1000, 50, 1000, 1000);
+    TEST_ASSERT_EQUAL_UINT16(MOTION_ADAPT_MIN_SPEED, next.speed);
+    TEST_ASSERT_EQUAL_UINT8(MOTION_ADAPT_MIN_ACCEL, next.acceleration);
+    next = LoadMonitor::adapt(profile, 1000, 0, 1000, 1000);
+    TEST_ASSERT_EQUAL_UINT8(0, next.acceleration);
+}
+
+static void test_directions_learn_separately() {
+    // Up (opening) strains, down coasts: after a few moves each way up is slower
+    DriveProfile up = {SERVO_SPEED, SERVO_ACCELERATION};
+    DriveProfile down = up;
+    for (int i = 0; i < 5; i++) {
+        SimServo servo;
+        servo.setLoad(MOTION_ADAPT_LOAD_HIGH + 50, MOTION_ADAPT_LOAD_HIGH + 80);
+        MotionSim sim(servo, MOTION_SAMPLE_INTERVAL_MS * 1000, up.acceleration);
+        MoveResult result = sim.runToLimit(-15000, up.speed);
+        TEST_ASSERT_FALSE(result.stalled);
+        up = LoadMonitor::adapt(up, SERVO_SPEED, SERVO_ACCELERATION, result.peakRampLoad, result.peakCruiseLoad);
+
+        SimServo light;
+        light.setLoad(100, 150);
+        MotionSim lightSim(light, MOTION_SAMPLE_INTERVAL_MS * 1000, down.acceleration);
+        result = lightSim.runToLimit(15000, down.speed);
+        down = LoadMonitor::adapt(down, SERVO_SPEED, SERVO_ACCELERATION, result.peakRampLoad, result.peakCruiseLoad);
+    }
+    TEST_ASSERT_EQUAL_UINT16(SERVO_SPEED - 5 * MOTION_ADAPT_SPEED_STEP, up.speed);
+    TEST_ASSERT_LESS_THAN(SERVO_ACCELERATION, up.acceleration);
+    TEST_ASSERT_EQUAL_UINT16(SERVO_SPEED, down.speed);
+    TEST_ASSERT_EQUAL_UINT8(SERVO_ACCELERATION, down.acceleration);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_encoder_delta_takes_short_way_round);
+    RUN_TEST(test_tracking_survives_many_revolutions);
+    RUN_TEST(test_stopping_distance);
+    RUN_TEST(test_approach_speed_profile);
+    RUN_TEST(test_position_tracker_seeds_on_first_reading);
+    RUN_TEST(test_position_tracker_wraps_and_rebases);
+    RUN_TEST(test_approach_command);
+    RUN_TEST(test_homing_recovery_steps);
+    RUN_TEST(test_hall_edge_extrapolation);
+    RUN_TEST(test_hall_edge_is_placed_between_samples);
+    RUN_TEST(test_hall_debounce_confirms_stable_low);
+    RUN_TEST(test_hall_debounce_chatter_restarts_window);
+    RUN_TEST(test_hall_debounce_rejects_glitch);
+    RUN_TEST(test_limit_stop_never_passes_the_limit);
+    RUN_TEST(test_targeted_move_does_not_overshoot);
+    RUN_TEST(test_recovery_rehomes_and_returns);
+    RUN_TEST(test_jam_stops_within_a_few_samples);
+    RUN_TEST(test_jam_without_load_reading_still_stops);
+    RUN_TEST(test_heavy_blind_is_not_a_stall);
+    RUN_TEST(test_profile_adapts_to_load);
+    RUN_TEST(test_directions_learn_separately);
+    return UNITY_END();
+}
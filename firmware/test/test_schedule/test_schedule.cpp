@@ -0,0 +1,233 @@
+#include <unity.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "config.h"
+#include "schedule.h"
+
+static bool parse(const char* text, ScheduleRule& out) {
+    return Schedule::parseRule(text, strlen(text), out);
+}
+
+static const char* roundTrip(const char* text) {
+    static char buffer[64];
+    ScheduleRule rule;
+    if (!parse(text, rule)) {
+        return "(invalid)";
+    }
+    return Schedule::format(rule, buffer, sizeof(buffer));
+}
+
+static void useTimezone(const char* tz) {
+    setenv("TZ", tz, 1);
+    tzset();
+}
+
+static int64_t utc(int year, int month, int day, int hour, int minute) {
+    return Schedule::daysFromCivil(year, month, day) * 86400 + hour * 3600 + minute * 60;
+}
+
+static GeoLocation at(float latitude, float longitude) {
+    GeoLocation location;
+    location.latitude = latitude;
+    location.longitude = longitude;
+    location.valid = true;
+    return location;
+}
+
+void setUp() {
+    useTimezone("UTC0");
+}
+void tearDown() {}
+
+static void test_rules_parse_and_format_canonically() {
+    TEST_ASSERT_EQUAL_STRING("weekdays 07:30 OPEN", roundTrip("Weekdays 7:30 open"));
+    TEST_ASSERT_EQUAL_STRING("daily 22:00 CLOSE", roundTrip("22:00 close"));
+    TEST_ASSERT_EQUAL_STRING("weekends 09:00 POSITION:60", roundTrip("sat,sun 09:00 position:60"));
+    TEST_ASSERT_EQUAL_STRING("mon,wed,fri sunrise+15 OPEN", roundTrip("mon,wed,fri sunrise+15 OPEN"));
+    TEST_ASSERT_EQUAL_STRING("sun,fri,sat sunset-20 CLOSE", roundTrip("fri-sun SUNSET-20 CLOSE"));
+    TEST_ASSERT_EQUAL_STRING("weekdays sunset STOP", roundTrip("mon-fri sunset+0 STOP"));
+
+    ScheduleRule rule;
+    TEST_ASSERT_TRUE(parse("sunset-20 CLOSE", rule));
+    TEST_ASSERT_EQUAL(ScheduleTrigger::SUNSET, rule.trigger);
+    TEST_ASSERT_EQUAL_INT(-20, rule.minutes);
+    TEST_ASSERT_EQUAL_UINT8(0x7F, rule.days);
+}
+
+static void test_invalid_rules_are_rejected() {
+    ScheduleRule rule;
+    TEST_ASSERT_FALSE(parse("", rule));
+    TEST_ASSERT_FALSE(parse("07:30", rule));             // No command
+    TEST_ASSERT_FALSE(parse("24:00 OPEN", rule));
+    TEST_ASSERT_FALSE(parse("07:3 OPEN", rule));
+    TEST_ASSERT_FALSE(parse("someday 07:30 OPEN", rule));
+    TEST_ASSERT_FALSE(parse("mon-xyz 07:30 OPEN", rule));
+    TEST_ASSERT_FALSE(parse("noon OPEN", rule));
+    TEST_ASSERT_FALSE(parse("sunset+721 CLOSE", rule));
+    TEST_ASSERT_FALSE(parse("07:30 RESTART", rule));      // Only motion commands
+    TEST_ASSERT_FALSE(parse("07:30 SPEED:500", rule));
+    TEST_ASSERT_FALSE(parse("07:30 OPEN extra", rule));
+    TEST_ASSERT_FALSE(parse("07:30 OPEN blind=x", rule));
+}
+
+static void test_blind_range_follows_blind_count() {
+    ScheduleRule rule;
+    TEST_ASSERT_TRUE(parse("07:30 OPEN blind=0", rule));
+    TEST_ASSERT_EQUAL_UINT8(0, rule.command.blind);
+
+    char text[32];
+    snprintf(text, sizeof(text), "07:30 OPEN blind=%d", BLIND_COUNT - 1);
+    TEST_ASSERT_TRUE(parse(text, rule));
+    TEST_ASSERT_EQUAL_UINT8(BLIND_COUNT - 1, rule.command.blind);
+
+    snprintf(text, sizeof(text), "07:30 OPEN blind=%d", BLIND_COUNT);
+    TEST_ASSERT_FALSE(parse(text, rule));
+}
+
+static void test_list_is_all_or_nothing() {
+    ScheduleRule rules[SCHEDULE_MAX_RULES];
+    const char* list = "weekdays 07:30 OPEN; ;sunset CLOSE;";
+    TEST_ASSERT_EQUAL_INT(2, Schedule::parseList(list, strlen(list), rules, SCHEDULE_MAX_RULES));
+    TEST_ASSERT_EQUAL(CommandId::CLOSE, rules[1].command.id);
+
+    TEST_ASSERT_EQUAL_INT(0, Schedule::parseList("", 0, rules, SCHEDULE_MAX_RULES));
+
+    const char* bad = "07:30 OPEN;25:00 CLOSE";
+    TEST_ASSERT_EQUAL_INT(-1, Schedule::parseList(bad, strlen(bad), rules, SCHEDULE_MAX_RULES));
+
+    const char* three = "07:30 OPEN;08:00 STOP;22:00 CLOSE";
+    TEST_ASSERT_EQUAL_INT(-1, Schedule::parseList(three, strlen(three), rules, 2));
+}
+
+static void test_location_parsing() {
+    GeoLocation location;
+    TEST_ASSERT_TRUE(Schedule::parseLocation("51.5074,-0.1278", 15, location));
+    TEST_ASSERT_TRUE(location.valid);
+    TEST_ASSERT_FLOAT_WITHIN(0.0001f, 51.5074f, location.latitude);
+    TEST_ASSERT_FLOAT_WITHIN(0.0001f, -0.1278f, location.longitude);
+
+    TEST_ASSERT_TRUE(Schedule::parseLocation("", 0, location));
+    TEST_ASSERT_FALSE(location.valid);
+
+    TEST_ASSERT_FALSE(Schedule::parseLocation("91,0", 4, location));
+    TEST_ASSERT_FALSE(Schedule::parseLocation("0,181", 5, location));
+    TEST_ASSERT_FALSE(Schedule::parseLocation("51.5", 4, location));
+    TEST_ASSERT_FALSE(Schedule::parseLocation("51.5,x", 6, location));
+}
+
+static void test_days_from_civil() {
+    TEST_ASSERT_EQUAL_INT64(0, Schedule::daysFromCivil(1970, 1, 1));
+    TEST_ASSERT_EQUAL_INT64(19723, Schedule::daysFromCivil(2024, 1, 1));
+    TEST_ASSERT_EQUAL_INT64(19782, Schedule::daysFromCivil(2024, 2, 29));
+    TEST_ASSERT_EQUAL_INT64(-1, Schedule::daysFromCivil(1969, 12, 31));
+}
+
+// Published times (UTC), within a few minutes for the almanac algorithm
+static void test_sun_events_match_published_times() {
+    GeoLocation london = at(51.5074f, -0.1278f);
+    int32_t minutes;
+
+    TEST_ASSERT_TRUE(Schedule::sunEvent(2024, 6, 21, london, true, minutes));
+    TEST_ASSERT_INT32_WITHIN(3, 3 * 60 + 43, minutes);
+    TEST_ASSERT_TRUE(Schedule::sunEvent(2024, 6, 21, london, false, minutes));
+    TEST_ASSERT_INT32_WITHIN(3, 20 * 60 + 21, minutes);
+    TEST_ASSERT_TRUE(Schedule::sunEvent(2024, 12, 21, london, true, minutes));
+    TEST_ASSERT_INT32_WITHIN(3, 8 * 60 + 4, minutes);
+    TEST_ASSERT_TRUE(Schedule::sunEvent(2024, 12, 21, london, false, minutes));
+    TEST_ASSERT_INT32_WITHIN(3, 15 * 60 + 53, minutes);
+
+    // Sydney sunrise (07:00 AEST) falls on the previous UTC date
+    GeoLocation sydney = at(-33.8688f, 151.2093f);
+    TEST_ASSERT_TRUE(Schedule::sunEvent(2024, 6, 21, sydney, true, minutes));
+    TEST_ASSERT_INT32_WITHIN(3, 7 * 60 - 10 * 60, minutes);
+    TEST_ASSERT_TRUE(Schedule::sunEvent(2024, 6, 21, sydney, false, minutes));
+    TEST_ASSERT_INT32_WITHIN(3, 16 * 60 + 54 - 10 * 60, minutes);
+}
+
+static void test_polar_night_and_midnight_sun_have_no_event() {
+    GeoLocation tromso = at(69.6492f, 18.9553f);
+    int32_t minutes;
+    TEST_ASSERT_FALSE(Schedule::sunEvent(2024, 12, 21, tromso, true, minutes));
+    TEST_ASSERT_FALSE(Schedule::sunEvent(2024, 6, 21, tromso, false, minutes));
+    TEST_ASSERT_TRUE(Schedule::sunEvent(2024, 3, 20, tromso, true, minutes));
+
+    // A sun rule there finds nothing in a December week
+    ScheduleRule rule;
+    TEST_ASSERT_TRUE(parse("sunrise OPEN", rule));
+    int64_t next;
+    TEST_ASSERT_FALSE(Schedule::nextOccurrence(rule, utc(2024, 12, 18, 0, 0), tromso, next));
+}
+
+static void test_next_time_follows_weekday_mask() {
+    GeoLocation none;
+    ScheduleRule rule;
+    int64_t next;
+    int64_t wednesday = utc(2024, 6, 19, 8, 0);    // Wed 08:00
+
+    TEST_ASSERT_TRUE(parse("weekdays 07:30 OPEN", rule));
+    TEST_ASSERT_TRUE(Schedule::nextOccurrence(rule, wednesday, none, next));
+    TEST_ASSERT_EQUAL_INT64(utc(2024, 6, 20, 7, 30), next);
+
+    // Friday evening skips the weekend
+    TEST_ASSERT_TRUE(Schedule::nextOccurrence(rule, utc(2024, 6, 21, 18, 0), none, next));
+    TEST_ASSERT_EQUAL_INT64(utc(2024, 6, 24, 7, 30), next);
+
+    // Passed today, only today: a week out
+    TEST_ASSERT_TRUE(parse("wed 07:30 OPEN", rule));
+    TEST_ASSERT_TRUE(Schedule::nextOccurrence(rule, wednesday, none, next));
+    TEST_ASSERT_EQUAL_INT64(utc(2024, 6, 26, 7, 30), next);
+
+    // Still to come today; an event exactly at `after` is not repeated
+    TEST_ASSERT_TRUE(parse("wed 09:00 CLOSE", rule));
+    TEST_ASSERT_TRUE(Schedule::nextOccurrence(rule, wednesday, none, next));
+    TEST_ASSERT_EQUAL_INT64(utc(2024, 6, 19, 9, 0), next);
+    TEST_ASSERT_TRUE(Schedule::nextOccurrence(rule, next, none, next));
+    TEST_ASSERT_EQUAL_INT64(utc(2024, 6, 26, 9, 0), next);
+}
+
+static void test_next_time_is_local_across_dst() {
+    useTimezone("CET-1CEST,M3.5.0,M10.5.0/3");
+    GeoLocation none;
+    ScheduleRule rule;
+    int64_t next;
+    TEST_ASSERT_TRUE(parse("daily 07:00 OPEN", rule));
+
+    // 07:00 CET on Saturday, 07:00 CEST after the change overnight
+    TEST_ASSERT_TRUE(Schedule::nextOccurrence(rule, utc(2024, 3, 29, 12, 0), none, next));
+    TEST_ASSERT_EQUAL_INT64(utc(2024, 3, 30, 6, 0), next);
+    TEST_ASSERT_TRUE(Schedule::nextOccurrence(rule, next, none, next));
+    TEST_ASSERT_EQUAL_INT64(utc(2024, 3, 31, 5, 0), next);
+}
+
+static void test_next_sun_event_applies_offset() {
+    GeoLocation london = at(51.5074f, -0.1278f);
+    ScheduleRule rule;
+    int64_t next;
+    int32_t sunset;
+    TEST_ASSERT_TRUE(Schedule::sunEvent(2024, 6, 21, london, false, sunset));
+
+    TEST_ASSERT_TRUE(parse("sunset-20 CLOSE", rule));
+    TEST_ASSERT_TRUE(Schedule::nextOccurrence(rule, utc(2024, 6, 21, 12, 0), london, next));
+    TEST_ASSERT_EQUAL_INT64(utc(2024, 6, 21, 0, 0) + (sunset - 20) * 60, next);
+
+    // No location, no sun rules
+    GeoLocation none;
+    TEST_ASSERT_FALSE(Schedule::nextOccurrence(rule, utc(2024, 6, 21, 12, 0), none, next));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_rules_parse_and_format_canonically);
+    RUN_TEST(test_invalid_rules_are_rejected);
+    RUN_TEST(test_blind_range_follows_blind_count);
+    RUN_TEST(test_list_is_all_or_nothing);
+    RUN_TEST(test_location_parsing);
+    RUN_TEST(test_days_from_civil);
+    RUN_TEST(test_sun_events_match_published_times);
+    RUN_TEST(test_polar_night_and_midnight_sun_have_no_event);
+    RUN_TEST(test_next_time_follows_weekday_mask);
+    RUN_TEST(test_next_time_is_local_across_dst);
+    RUN_TEST(test_next_sun_event_applies_offset);
+    return UNITY_END();
+}
@@ -70,11 +70,17 @@ extension WiFiNetwork: Codable {
     }
 }
 
-/// Response wrapper for WiFi scan results from firmware
+/// One page of WiFi scan results from firmware.
+/// Results are streamed in MTU-sized pages: page 0 starts a new scan and
+/// done is 1 on the last page. Older firmware sends one page without either.
 struct WiFiScanResponse: Codable {
+    let page: Int?
     let networks: [WiFiNetwork]
+    let done: Int?
 
     enum CodingKeys: String, CodingKey {
+        case page = "i"
         case networks = "n"
+        case done = "d"
     }
 }
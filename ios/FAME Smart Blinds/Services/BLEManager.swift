@@ -286,10 +286,6 @@ class BLEManager: NSObject, ObservableObject {
     private func parseWifiScanResults(_ jsonString: String) {
         NSLog("[BLE] Parsing WiFi scan results: %@", jsonString)
 
-        // Cancel timeout since we received results
-        wifiScanTimeoutTask?.cancel()
-        isWifiScanning = false
-
         guard let data = jsonString.data(using: .utf8) else {
             NSLog("[BLE] Failed to convert WiFi scan results to data")
             return
@@ -297,9 +293,26 @@ class BLEManager: NSObject, ObservableObject {
 
         do {
             let response = try JSONDecoder().decode(WiFiScanResponse.self, from: data)
+
+            // Page 0 starts a new scan; later pages add to (or strengthen) what we have
+            var networks = response.networks
+            if (response.page ?? 0) > 0 {
+                var bySsid = Dictionary(scannedWifiNetworks.map { ($0.ssid, $0) }, uniquingKeysWith: { a, _ in a })
+                for network in response.networks {
+                    if let existing = bySsid[network.ssid], existing.rssi >= network.rssi { continue }
+                    bySsid[network.ssid] = network
+                }
+                networks = Array(bySsid.values)
+            }
             // Sort by signal strength (strongest first)
-            scannedWifiNetworks = response.networks.sorted { $0.rssi > $1.rssi }
+            scannedWifiNetworks = networks.sorted { $0.rssi > $1.rssi }
             NSLog("[BLE] Parsed %d WiFi networks", scannedWifiNetworks.count)
+
+            if (response.done ?? 1) == 1 {
+                // Cancel timeout since the last page arrived
+                wifiScanTimeoutTask?.cancel()
+                isWifiScanning = false
+            }
         } catch {
             NSLog("[BLE] Failed to decode WiFi scan results: %@", error.localizedDescription)
         }
@@ -9,6 +9,11 @@ class HTTPClient: ObservableObject {
 
     private let session: URLSession
 
+    /// Reconnect attempts for an OTA upload whose connection drops
+    private static let otaMaxResumeAttempts = 5
+    private static let otaMaxBusyRetries = 10
+    private static let otaMaxFinishPolls = 30
+
     init() {
         let config = URLSessionConfiguration.default
         config.timeoutIntervalForRequest = Constants.Timeout.httpRequest
@@ -356,15 +361,17 @@ class HTTPClient: ObservableObject {
     /// 1. POST /ota/begin?size=TOTAL - Initialize update
     /// 2. POST /ota/chunk (body=chunk data) - Send each chunk
     /// 3. POST /ota/end - Finalize update
+    /// If the connection drops mid-upload, /ota/begin?resume=1 continues from
+    /// the last chunk the device flashed.
     func uploadFirmware(_ firmwareData: Data, to ipAddress: String, deviceId: String, progress: @escaping (Double) -> Void) async throws {
-        let chunkSize = 8192  // 8KB chunks - fits easily in ESP32 RAM
         let totalSize = firmwareData.count
-        let totalChunks = (totalSize + chunkSize - 1) / chunkSize
+        // Identifies the image so a dropped upload can be resumed
+        let imageId = String(format: "%08x", firmwareData.crc32())
 
-        print("[OTA] Starting chunked upload: \(totalSize) bytes in \(totalChunks) chunks")
+        print("[OTA] Starting chunked upload: \(totalSize) bytes")
 
         // Step 1: Initialize OTA
-        let beginUrl = URL(string: "http://\(ipAddress)/ota/begin?size=\(totalSize)")!
+        let beginUrl = URL(string: "http://\(ipAddress)/ota/begin?size=\(totalSize)&id=\(imageId)")!
         var beginRequest = URLRequest(url: beginUrl)
         beginRequest.httpMethod = "POST"
         beginRequest.timeoutInterval = 10
@@ -373,10 +380,18 @@ class HTTPClient: ObservableObject {
         let (beginData, beginResponse) = try await session.data(for: beginRequest)
         try handleAuthResponse(beginResponse, data: beginData, forDeviceId: deviceId)
 
-        print("[OTA] Begin successful, sending chunks...")
+        // Use the chunk size the device negotiated (older firmware doesn't report one)
+        let negotiated = (try? JSONDecoder().decode(OTAResponse.self, from: beginData))?.chunkSize ?? 0
+        let chunkSize = negotiated > 0 ? negotiated : 8192
+        let totalChunks = (totalSize + chunkSize - 1) / chunkSize
+
+        print("[OTA] Begin successful, sending \(totalChunks) chunks of \(chunkSize) bytes...")
 
         // Step 2: Send chunks (chunks use session established by begin)
-        for chunkIndex in 0..<totalChunks {
+        var chunkIndex = 0
+        var resumeAttempts = 0
+        var busyRetries = 0
+        while chunkIndex < totalChunks {
             let startOffset = chunkIndex * chunkSize
             let endOffset = min(startOffset + chunkSize, totalSize)
             let chunkData = firmwareData.subdata(in: startOffset..<endOffset)
@@ -392,7 +407,35 @@ class HTTPClient: ObservableObject {
             chunkRequest.timeoutInterval = 30
             await addAuthHeader(to: &chunkRequest, forDeviceId: deviceId)
 
-            let (chunkResponseData, chunkResponse) = try await session.upload(for: chunkRequest, from: chunkData)
+            let chunkResponseData: Data
+            let chunkResponse: URLResponse
+            do {
+                (chunkResponseData, chunkResponse) = try await session.upload(for: chunkRequest, from: chunkData)
+            } catch let error as URLError {
+                // Connection dropped - the device keeps the session, so carry on
+                // from the last chunk it flashed instead of starting over
+                guard resumeAttempts < HTTPClient.otaMaxResumeAttempts else {
+                    try? await abortOTA(at: ipAddress, deviceId: deviceId)
+                    throw error
+                }
+                resumeAttempts += 1
+                print("[OTA] Chunk \(chunkIndex) failed (\(error.localizedDescription)), resuming (attempt \(resumeAttempts))")
+                try await Task.sleep(nanoseconds: 2_000_000_000)
+                guard let next = await resumeOTA(at: ipAddress, deviceId: deviceId, totalSize: totalSize, imageId: imageId) else {
+                    throw error
+                }
+                chunkIndex = next
+                continue
+            }
+
+            if let busyResponse = chunkResponse as? HTTPURLResponse,
+               busyResponse.statusCode == 503, busyRetries < HTTPClient.otaMaxBusyRetries {
+                // Every buffer on the device is still being flashed - send the chunk again shortly
+                let retryAfter = UInt64(busyResponse.value(forHTTPHeaderField: "Retry-After") ?? "") ?? 1
+                busyRetries += 1
+                try await Task.sleep(nanoseconds: retryAfter * 1_000_000_000)
+                continue
+            }
 
             guard let chunkHttpResponse = chunkResponse as? HTTPURLResponse,
                   chunkHttpResponse.statusCode == 200 else {
@@ -402,6 +445,8 @@ class HTTPClient: ObservableObject {
                 throw HTTPError.serverError((chunkResponse as? HTTPURLResponse)?.statusCode ?? 0, "Chunk \(chunkIndex) failed: \(errorBody)")
             }
 
+            busyRetries = 0
+
             // Update progress
             let currentProgress = Double(endOffset) / Double(totalSize)
             await MainActor.run {
@@ -412,6 +457,7 @@ class HTTPClient: ObservableObject {
             if chunkIndex % 10 == 0 || chunkIndex == totalChunks - 1 {
                 print("[OTA] Chunk \(chunkIndex + 1)/\(totalChunks) sent (\(Int(currentProgress * 100))%)")
             }
+            chunkIndex += 1
         }
 
         // Step 3: Finalize OTA
@@ -423,12 +469,44 @@ class HTTPClient: ObservableObject {
         endRequest.timeoutInterval = 30
         await addAuthHeader(to: &endRequest, forDeviceId: deviceId)
 
-        let (endData, endResponse) = try await session.data(for: endRequest)
-        try handleAuthResponse(endResponse, data: endData, forDeviceId: deviceId)
+        // The device answers 202 while it flashes the last chunks and verifies the image
+        var finishPolls = 0
+        while true {
+            let (endData, endResponse) = try await session.data(for: endRequest)
+            if let pendingResponse = endResponse as? HTTPURLResponse,
+               pendingResponse.statusCode == 202, finishPolls < HTTPClient.otaMaxFinishPolls {
+                let retryAfter = UInt64(pendingResponse.value(forHTTPHeaderField: "Retry-After") ?? "") ?? 1
+                finishPolls += 1
+                try await Task.sleep(nanoseconds: retryAfter * 1_000_000_000)
+                continue
+            }
+            try handleAuthResponse(endResponse, data: endData, forDeviceId: deviceId)
+            break
+        }
 
         print("[OTA] Firmware upload complete, device restarting...")
     }
 
+    /// Ask the device to resume an interrupted upload. Returns the chunk index to
+    /// continue from (0 if the device had to start a new session), or nil if the
+    /// device could not be reached.
+    private func resumeOTA(at ipAddress: String, deviceId: String, totalSize: Int, imageId: String) async -> Int? {
+        let url = URL(string: "http://\(ipAddress)/ota/begin?size=\(totalSize)&id=\(imageId)&resume=1")!
+        var request = URLRequest(url: url)
+        request.httpMethod = "POST"
+        request.timeoutInterval = 10
+        await addAuthHeader(to: &request, forDeviceId: deviceId)
+
+        guard let result = try? await session.data(for: request),
+              (result.1 as? HTTPURLResponse)?.statusCode == 200 else {
+            return nil
+        }
+        let body = try? JSONDecoder().decode(OTAResponse.self, from: result.0)
+        let next = body?.resumed == true ? (body?.nextIndex ?? 0) : 0
+        print("[OTA] Resumed at chunk \(next)")
+        return next
+    }
+
     /// Abort an in-progress OTA update
     func abortOTA(at ipAddress: String, deviceId: String) async throws {
         let url = URL(string: "http://\(ipAddress)/ota/abort")!
@@ -534,7 +612,7 @@ struct DeviceStatus: Codable {
     let position: Int
     let wifi: WifiStatus
     let calibration: CalibrationStatus?
-    let uptime: Int
+    let uptime: Int?
 
     struct WifiStatus: Codable {
         let ssid: String
@@ -594,6 +672,9 @@ struct OTAResponse: Codable {
     let success: Bool
     let message: String?
     let error: String?
+    let chunkSize: Int?  // Negotiated by /ota/begin
+    let resumed: Bool?   // /ota/begin?resume=1 kept the previous session
+    let nextIndex: Int?  // First chunk the device still needs
 }
 
 struct OTAStatusResponse: Codable {